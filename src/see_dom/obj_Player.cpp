@@ -33,6 +33,7 @@
 
 
 #include <sjbase/browser.h>
+#include <sjtools/peaks.h>
 #include <see_dom/sj_see.h>
 #include <see_dom/sj_see_helpers.h>
 
@@ -192,6 +193,29 @@ IMPLEMENT_FUNCTION(player, getDurationAtPos)
 }
 
 
+IMPLEMENT_FUNCTION(player, getPeaksAtPos)
+{
+	// returns min/max pairs in the range -100..100; if a count is given, the peaks are combined to this number of pairs
+	wxArrayLong ret;
+	SjPeaks peaks;
+	if( peaks.Load(g_mainFrame->GetQueueUrl(ARG_POS)) )
+	{
+		long i, peakCount = peaks.GetCount(), retCount = ARG_LONG_OR_DEF(1, 0);
+		float min, max;
+		if( retCount <= 0 || retCount > peakCount ) {
+			retCount = peakCount;
+		}
+		for( i = 0; i < retCount; i++ )
+		{
+			peaks.GetMinMax((i*peakCount)/retCount, ((i+1)*peakCount)/retCount, min, max);
+			ret.Add((long)(min*100.0F));
+			ret.Add((long)(max*100.0F));
+		}
+	}
+	RETURN_ARRAY_LONG( ret );
+}
+
+
 IMPLEMENT_FUNCTION(player, addAtPos)
 {
 	g_mainFrame->Enqueue(ARG_STRING(1), ARG_POS,
@@ -452,6 +476,7 @@ void SjSee::Player_init()
 	PUT_FUNC(m_Player_prototype, player, getAlbumAtPos,     0);
 	PUT_FUNC(m_Player_prototype, player, getTitleAtPos,     0);
 	PUT_FUNC(m_Player_prototype, player, getDurationAtPos,  0);
+	PUT_FUNC(m_Player_prototype, player, getPeaksAtPos,     0);
 	PUT_FUNC(m_Player_prototype, player, addAtPos,          0);
 	PUT_FUNC(m_Player_prototype, player, removeAtPos,       0);
 	PUT_FUNC(m_Player_prototype, player, removeAll,         0);
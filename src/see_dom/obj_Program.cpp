@@ -569,6 +569,7 @@ IMPLEMENT_HASPROPERTY(program)
 	 || VAL_PROPERTY( listModeOrder )
 	 || VAL_PROPERTY( memory )
 	 || VAL_PROPERTY( memoryPeak )
+	 || VAL_PROPERTY( skinStats )
 	 || VAL_PROPERTY( hwnd )
 	 || VAL_PROPERTY( onLoad )
 	 || VAL_PROPERTY( onUnload )
@@ -654,6 +655,18 @@ IMPLEMENT_GET(program)
 	{
 		RETURN_LONG( g_gc_system.peakSize );
 	}
+	else if( VAL_PROPERTY( skinStats ) )
+	{
+		const SjSkinPaintStat& stat = g_mainFrame->GetPaintStat();
+		wxArrayLong ret;
+		ret.Add(stat.m_targetUpdates);
+		ret.Add(stat.m_targetUpdatesSkipped);
+		ret.Add(stat.m_itemRedraws);
+		ret.Add(stat.m_itemRedrawsCoalesced);
+		ret.Add(stat.m_batchRedraws);
+		ret.Add(stat.m_paintEvents);
+		RETURN_ARRAY_LONG( ret );
+	}
 	else if( VAL_PROPERTY( hwnd ) )
 	{
 		RETURN_LONG( (long)g_mainFrame->GetHandle() );
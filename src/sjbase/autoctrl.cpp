@@ -313,6 +313,10 @@ SjAutoCtrl::~SjAutoCtrl()
 
 void SjAutoCtrl::SaveAutoCtrlSettings()
 {
+	if( g_mainFrame && g_mainFrame->m_player.IsBenchmark() ) {
+		return; // the settings are modified for the benchmark
+	}
+
 	ValidateSettings();
 
 	wxConfigBase* c = g_tools->m_config;
@@ -951,7 +955,7 @@ wxString SjAutoCtrl::GetAutoPlayUrl()
 			}
 
 			wxString dummySelectSql;
-			advSearch.GetAsSql(&ignoreIdsHash, dummySelectSql);
+			advSearch.GetAsSqlCached(&ignoreIdsHash, dummySelectSql);
 			ignoreIdsCount = ignoreIdsHash.GetCount();
 		}
 
@@ -983,7 +987,7 @@ wxString SjAutoCtrl::GetAutoPlayUrl()
 
 			// get all track IDs in this adv. search
 			wxString dummySelectSql;
-			advSearch.GetAsSql(&trackIdsHash, dummySelectSql);
+			advSearch.GetAsSqlCached(&trackIdsHash, dummySelectSql);
 		}
 
 		// convert hash to array
@@ -51,6 +51,7 @@ wxString SjBackend::GetName() const
 {
 	     if(m_id==SJBE_ID_STDOUTPUT )  { return "stdoutput";  }
 	else if(m_id==SJBE_ID_PRELISTEN )  { return "prelisten";  }
+	else if(m_id==SJBE_ID_NULLOUTPUT)  { return "nulloutput"; }
 	else                               { return "unknown";    }
 }
 
@@ -70,11 +71,31 @@ SjBackendStream::SjBackendStream(const wxString& url, SjBackend* backend, SjBack
 	m_cbp.stream       = this;
 	m_userdata         = userdata;
 
-	// we keep a list of all streams created on the backend; may be useful for the implementations
-	backend->m_allStreams.Add(this);
+	if( m_cb )
+	{
+		// we keep a list of all streams created on the backend; may be useful for the implementations
+		backend->m_allStreams.Add(this);
+
+		// inform the user about the new stream, can be used to set up m_userdata_*
+		// startingTime is set while samplerate/channels are still invalid!
+		m_cbp.msg          = SJBE_MSG_CREATE;
+		m_cb(&m_cbp);
+	}
+}
+
+
+void SjBackendStream::Adopt(SjBackendCallback* cb, SjBackendUserdata* userdata)
+{
+	wxASSERT( wxThread::IsMain() );
+	wxASSERT( m_cb == NULL && cb != NULL );
+
+	// a prerolled stream is used - from now on, it behaves as if it was just constructed with the given callback
+	m_cb               = cb;
+	m_cbp.startingTime = wxDateTime::Now().GetAsDOS();
+	m_userdata         = userdata;
+
+	m_cbp.backend->m_allStreams.Add(this);
 
-	// inform the user about the new stream, can be used to set up m_userdata_*
-	// startingTime is set while samplerate/channels are still invalid!
 	m_cbp.msg          = SJBE_MSG_CREATE;
 	m_cb(&m_cbp);
 }
@@ -85,8 +106,10 @@ SjBackendStream::~SjBackendStream()
 	wxASSERT( wxThread::IsMain() );
 
 	// inform the user that the userdata can be destroyed now; it's up to the user what to do.
-	m_cbp.msg = SJBE_MSG_DESTROY_USERDATA;
-	m_cb(&m_cbp);
+	if( m_cb ) {
+		m_cbp.msg = SJBE_MSG_DESTROY_USERDATA;
+		m_cb(&m_cbp);
+	}
 
 	// remove stream from list
 	wxArrayPtrVoid* allStreams =  &m_cbp.backend->m_allStreams;
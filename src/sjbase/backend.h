@@ -33,12 +33,14 @@
 
 class SjBackendStream;
 class SjBackendUserdata;
+class SjBackendDecoder;
 
 
 enum SjBackendId
 {
 	SJBE_ID_STDOUTPUT  = 0,
-	SJBE_ID_PRELISTEN  = 1
+	SJBE_ID_PRELISTEN  = 1,
+	SJBE_ID_NULLOUTPUT = 2  // no sound device, eg. for benchmarks
 };
 
 
@@ -96,6 +98,16 @@ public:
 	virtual void             SetDeviceState   (SjBackendState state) = 0;
 	virtual void             SetDeviceVol     (double gain) = 0; // 0.0 - 1.0, only called on opened devices
 
+	// Optional: prepare the stream for the given URL some seconds before it is needed, a following CreateStream() for the
+	// same URL (and without seeking) then only needs to start the prepared stream.  Prerolled streams are not part of
+	// GetAllStreams() and do not send any messages before they're used by CreateStream().
+	virtual void             PrerollStream    (const wxString& url) { }
+	virtual void             CancelPreroll    () { }
+
+	// Optional: decode-only access to a file, eg. for background analysis.  Unlike CreateStream(), this may be
+	// called from any thread and the decoder is independent from the device.  Returns NULL if not supported.
+	virtual SjBackendDecoder* CreateDecoder   (const wxString& url) { return NULL; }
+
 	// higher-level functions
 	bool                     IsDeviceOpened   () const { return (GetDeviceState()!=SJBE_STATE_CLOSED); }
 	SjBackendId              GetId            () const { return m_id; };
@@ -114,7 +126,8 @@ class SjBackendStream
 {
 	// The following function must be added by the backend implementation.
 	// The user creates stream using SjBackend::CreateStream().
-protected:                   SjBackendStream  (const wxString& url, SjBackend* backend, SjBackendCallback* cb, SjBackendUserdata*);
+protected:                   SjBackendStream  (const wxString& url, SjBackend* backend, SjBackendCallback* cb, SjBackendUserdata*); // cb=NULL for prerolled streams, see Adopt()
+	void                     Adopt            (SjBackendCallback* cb, SjBackendUserdata*); // make a prerolled stream a normal one
 public: virtual              ~SjBackendStream ();
 	virtual void             GetTime          (long& totalMs, long& elapsedMs) = 0; // -1=unknown
 	virtual void             SeekAbs          (long ms) = 0;
@@ -137,4 +150,33 @@ private:
 };
 
 
+class SjBackendDecoder
+{
+	// The decoder is created using SjBackend::CreateDecoder() and may be used by one thread at the same time.
+public:
+	                         SjBackendDecoder () { m_samplerate = 44100; m_channels = 2; m_failed = false; m_isAborted = NULL; m_abortUserdata = NULL; }
+	virtual                  ~SjBackendDecoder() { }
+	virtual long             Read             (float* buffer, long maxFrames) = 0; // interleaved, returns the number of frames read, 0 on end of stream or on errors
+
+	// while Read() waits for data, it calls the given function regularly and gives up if it returns true;
+	// Read() also gives up if the source stalls.  In both cases, Failed() returns true afterwards.
+	void                     SetAbortCallback (bool (*isAborted)(void* userdata), void* userdata) { m_isAborted = isAborted; m_abortUserdata = userdata; }
+	bool                     Failed           () const { return m_failed; }
+
+	// valid after the first call to Read()
+	int                      GetSamplerate    () const { return m_samplerate; }
+	int                      GetChannels      () const { return m_channels; }
+
+protected:
+	int                      m_samplerate;
+	int                      m_channels;
+	bool                     m_failed;
+	bool                     IsAborted        () { return m_isAborted && m_isAborted(m_abortUserdata); }
+
+private:
+	bool                   (*m_isAborted)     (void* userdata);
+	void*                    m_abortUserdata;
+};
+
+
 #endif // __SJ_BACKEND_H__
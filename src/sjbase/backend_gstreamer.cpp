@@ -31,6 +31,8 @@
 #include <sjbase/backend_gstreamer.h>
 #include <sjmodules/vis/vis_vidout_module.h>
 #include <gst/video/videooverlay.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
 
 
 /*******************************************************************************
@@ -48,19 +50,46 @@
 #define MILLISEC_TO_NANOSEC_FACTOR     1000000L
 #define NANOSEC_TO_MILLISEC_DIVISOR    1000000L
 
+#define FRAME_BYTES                    (SJ_GST_MIXER_CHANNELS*sizeof(float))
+#define STREAM_WAIT_NS                 (5*MILLISEC_TO_NANOSEC_FACTOR) // max. time the mixer waits for the data of a stream
+#define STREAM_MAX_BUFFERS             8 // decoded buffers held by a stream until the mixer needs them
+#define MIXER_QUEUED_BLOCKS            2 // mixed blocks queued before the output, defines our latency
 
-void SjGstreamerBackendStream::set_pipeline_state(GstState s)
+
+static void set_pipeline_state(GstElement* pipeline, GstState s)
 {
-	if( !m_pipeline ) {
+	if( !pipeline ) {
 		return; // not ready
 	}
 
-	if( gst_element_set_state(m_pipeline, s) == GST_STATE_CHANGE_ASYNC ) {
-		gst_element_get_state(m_pipeline, NULL, NULL, 3000*MILLISEC_TO_NANOSEC_FACTOR /*async change, wait max. 3 seconds*/);
+	if( gst_element_set_state(pipeline, s) == GST_STATE_CHANGE_ASYNC ) {
+		gst_element_get_state(pipeline, NULL, NULL, 3000*MILLISEC_TO_NANOSEC_FACTOR /*async change, wait max. 3 seconds*/);
 	}
 }
 
 
+static void set_pipeline_volume(GstElement* pipeline, double gain)
+{
+	GstElement* volumeElem = gst_bin_get_by_name(GST_BIN(pipeline), "sjVolume");
+	if( volumeElem )
+	{
+		g_object_set(G_OBJECT(volumeElem), "volume", (gdouble)gain /*0: mute, 1.0: 100%, >1.0: additional gain*/, NULL /*NULL marks end of list*/);
+		gst_object_unref(volumeElem);
+	}
+}
+
+
+static GstCaps* create_mixer_caps()
+{
+	return gst_caps_new_simple("audio/x-raw",
+				"format",   G_TYPE_STRING, "F32LE",       // or S16LE, U8, ...
+				"layout",   G_TYPE_STRING, "interleaved", // LRLRLRLRLRLRLR ...
+				"rate",     G_TYPE_INT,    SJ_GST_MIXER_RATE,
+				"channels", G_TYPE_INT,    SJ_GST_MIXER_CHANNELS,
+				NULL);
+}
+
+
 GstBusSyncReply on_bus_sync_handler(GstBus* bus, GstMessage* msg, gpointer user_data)
 {
 	// ignore anything but 'prepare-window-handle' element messages
@@ -82,49 +111,51 @@ GstBusSyncReply on_bus_sync_handler(GstBus* bus, GstMessage* msg, gpointer user_
 }
 
 
-gboolean on_bus_message(GstBus* bus, GstMessage* msg, gpointer userdata)
+static void log_bus_error(GstMessage* msg)
 {
-	SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)userdata;
-	if( stream == NULL ) { return true; }
+	// get information about the error
+	GError* error = NULL;
+	gchar*  debug = NULL;
+	gst_message_parse_error(msg, &error, &debug);
 
-	bool prepareNext = false;
+	// log the error
+	const gchar* errormessage = error->message;        GST_TO_WXSTRING(errormessage);
+	const gchar* objname =  GST_OBJECT_NAME(msg->src); GST_TO_WXSTRING(objname);
+	wxString debugStr; if( debug ) { GST_TO_WXSTRING(debug); debugStr = " (" + debugWxStr + ")"; }
+	wxLogError("GStreamer Error: %s: %s%s", objnameWxStr.c_str(), errormessageWxStr.c_str(), debugStr.c_str());
 
-	switch( GST_MESSAGE_TYPE(msg) )
-	{
-		case GST_MESSAGE_ERROR:
-			// there may be series of error messages for one stream.
-			// error messages are normally not followed by a GST_MESSAGE_EOS error
-			{
-				// get information about the error
-				GError* error = NULL;
-				gchar*  debug = NULL;
-				gst_message_parse_error(msg, &error, &debug);
-
-				// log the error
-				const gchar* errormessage = error->message;        GST_TO_WXSTRING(errormessage);
-				const gchar* objname =  GST_OBJECT_NAME(msg->src); GST_TO_WXSTRING(objname);
-				wxString debugStr; if( debug ) { GST_TO_WXSTRING(debug); debugStr = " (" + debugWxStr + ")"; }
-				wxLogError("GStreamer Error: %s: %s%s", objnameWxStr.c_str(), errormessageWxStr.c_str(), debugStr.c_str());
-
-				g_free(debug);
-				g_error_free(error);
+	g_free(debug);
+	g_error_free(error);
+}
 
-				prepareNext = true;
-			}
-			break;
 
-		case GST_MESSAGE_EOS:
-			// we go here if we reach the end of the stream
-			prepareNext = true;
-			break;
+gboolean on_bus_message(GstBus* bus, GstMessage* msg, gpointer userdata)
+{
+	SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)userdata;
+	if( stream == NULL ) { return true; }
 
-		default:
-			break;
+	if( stream->m_cb == NULL )
+	{
+		// prerolled stream, not yet used: errors only make the preroll unusable,
+		// if the stream is really needed, it is created again and errors are logged then
+		if( GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR ) {
+			stream->m_prerollFailed = true;
+		}
+		return true;
 	}
 
-	if( prepareNext )
+	// there may be series of error messages for one stream.
+	// error messages are normally not followed by a GST_MESSAGE_EOS error.
+	// (GST_MESSAGE_EOS is only used for streams with video: for mixed streams, the end of the stream is reached when the mixer has read all data from the appsink)
+	if( GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR
+	 || (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS && stream->m_direct) )
 	{
-		if( prepareNext && !stream->m_eosSend )
+		if( GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR ) {
+			log_bus_error(msg);
+		}
+
+		wxCriticalSectionLocker locker(stream->m_backend->m_mixerCritical);
+		if( !stream->m_eosSend )
 		{
 			stream->m_cbp.msg = SJBE_MSG_END_OF_STREAM;
 			stream->m_cb(&stream->m_cbp);
@@ -136,10 +167,20 @@ gboolean on_bus_message(GstBus* bus, GstMessage* msg, gpointer userdata)
 }
 
 
+gboolean on_mixer_bus_message(GstBus* bus, GstMessage* msg, gpointer userdata)
+{
+	if( GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR ) {
+		log_bus_error(msg);
+	}
+
+	return true;
+}
+
+
 void on_pad_added(GstElement* decodebin, GstPad* newSourcePad, gpointer userdata)
 {
-	// a new pad appears in the "decodebin" element - link this to the
-	// element with the name "sjAudioEntry"
+	// a new pad appears in the "decodebin" element - video pads are linked to a
+	// video sink, audio pads are linked in on_no_more_pads()
 	SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)userdata;
 	if( stream == NULL ) { return; }
 
@@ -153,8 +194,14 @@ void on_pad_added(GstElement* decodebin, GstPad* newSourcePad, gpointer userdata
 			GST_TO_WXSTRING(name);
 			if( nameWxStr.StartsWith("video") )
 			{
+				if( stream->m_cb == NULL ) {
+					stream->m_prerollFailed = true; // we do not preroll videos, this would open the video output too early
+					gst_caps_unref(caps);
+					return;
+				}
 				stream->m_cbp.msg = SJBE_MSG_VIDEO_DETECTED;
 				stream->m_cb(&stream->m_cbp);
+				stream->m_hasVideo = true;
 				isVideoPad = true;
 			}
 		gst_caps_unref(caps);
@@ -186,56 +233,57 @@ void on_pad_added(GstElement* decodebin, GstPad* newSourcePad, gpointer userdata
 			gst_element_sync_state_with_parent(videosink);
 		}
 	}
-	else
+	else if( stream->m_audioPad == NULL )
 	{
-		// add audio pad to our audio sink
-		GstElement* audioEntry = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjAudioEntry");
-		if( audioEntry )
-		{
-			// get sink pad of the "audio entry element"
-			GstPad* destSinkPad = gst_element_get_static_pad(audioEntry, "sink");
-
-			// link the new source pad to the "audio entry element"
-			GstPadLinkReturn linkret = gst_pad_link(newSourcePad, destSinkPad);
-			if( linkret!=GST_PAD_LINK_OK ) {
-				wxLogError("GStreamer error: Cannot link audio.");
-			}
-
-			gst_object_unref(audioEntry);
-		}
+		// remember the audio pad, we do not know yet if there is also a video
+		stream->m_audioPad = GST_PAD(gst_object_ref(newSourcePad));
 	}
 }
 
 
-GstPadProbeReturn on_pad_data(GstPad* pad, GstPadProbeInfo* info, gpointer userdata)
+void on_no_more_pads(GstElement* decodebin, gpointer userdata)
 {
-	SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)userdata; if( stream == NULL ) { return GST_PAD_PROBE_OK; }
+	// all pads are added, decodebin starts the data flow after this signal returns.
+	// now link the audio pad to the element with the name "sjAudioEntry"
+	SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)userdata;
+	if( stream == NULL || stream->m_audioPad == NULL ) { return; }
 
-	// on the first call on a new stream, correct the "channels" and "samplerate"
-	if( !stream->m_capsChecked )
+	if( stream->m_hasVideo )
 	{
-		stream->m_capsChecked = true;
-		GstCaps* caps = gst_pad_get_current_caps(pad);
-		if( caps ) {
-			GstStructure* s = gst_caps_get_structure(caps, 0); // no need to free or unref the structure, it belongs to the GstCaps.
-			if( s ) {
-				gint v;
-				if( gst_structure_get_int(s, "rate", &v) ) {
-					if( v >= 1000 && v <= 1000000 ) {
-						stream->m_cbp.samplerate = v;
-					}
-				}
-				if( gst_structure_get_int(s, "channels", &v) ) {
-					if( v >= 1 && v <= 32 ) {
-						stream->m_cbp.channels = v;
-					}
-				}
-			}
-			gst_caps_unref(caps);
+		if( stream->m_cb == NULL ) {
+			return; // prerolled video, not used, see on_pad_added()
 		}
+
+		stream->m_backend->UseDirectOutput(stream);
 	}
 
-	// forward the buffer to the given callback
+	GstElement* audioEntry = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjAudioEntry");
+	if( audioEntry )
+	{
+		// get sink pad of the "audio entry element"
+		GstPad* destSinkPad = gst_element_get_static_pad(audioEntry, "sink");
+
+		// link the audio pad to the "audio entry element"
+		GstPadLinkReturn linkret = gst_pad_link(stream->m_audioPad, destSinkPad);
+		if( linkret!=GST_PAD_LINK_OK ) {
+			wxLogError("GStreamer error: Cannot link audio.");
+		}
+
+		gst_object_unref(destSinkPad);
+		gst_object_unref(audioEntry);
+	}
+
+	gst_object_unref(stream->m_audioPad);
+	stream->m_audioPad = NULL;
+}
+
+
+GstPadProbeReturn on_direct_pad_data(GstPad* pad, GstPadProbeInfo* info, gpointer userdata)
+{
+	// forward the audio of a stream with video to the given callback, see UseDirectOutput();
+	// the format is the same as for mixed streams
+	SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)userdata; if( stream == NULL ) { return GST_PAD_PROBE_OK; }
+
 	GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
 	buffer = gst_buffer_make_writable(buffer);
 
@@ -255,6 +303,265 @@ GstPadProbeReturn on_pad_data(GstPad* pad, GstPadProbeInfo* info, gpointer userd
 }
 
 
+void on_decoder_pad_added(GstElement* decodebin, GstPad* newSourcePad, gpointer userdata)
+{
+	// link the first audio pad of the decoder to the element given as userdata, all other pads are ignored
+	GstElement* audioEntry = (GstElement*)userdata;
+	if( audioEntry == NULL ) { return; }
+
+	GstPad* destSinkPad = gst_element_get_static_pad(audioEntry, "sink");
+	if( destSinkPad )
+	{
+		if( !gst_pad_is_linked(destSinkPad) )
+		{
+			GstCaps* caps = gst_pad_get_current_caps(newSourcePad);
+			if( caps )
+			{
+				const gchar* name = gst_structure_get_name(gst_caps_get_structure(caps, 0));
+				if( name && g_str_has_prefix(name, "audio") ) {
+					gst_pad_link(newSourcePad, destSinkPad);
+				}
+				gst_caps_unref(caps);
+			}
+		}
+		gst_object_unref(destSinkPad);
+	}
+}
+
+
+void on_mixer_need_data(GstElement* appsrc, guint length, gpointer userdata)
+{
+	// called from the streaming thread of the output pipeline whenever the queue of the appsrc runs low
+	SjGstreamerBackend* backend = (SjGstreamerBackend*)userdata;
+	if( backend == NULL ) { return; }
+
+	backend->MixBlock(appsrc);
+}
+
+
+/*******************************************************************************
+ * The Mixer
+ ******************************************************************************/
+
+
+bool SjGstreamerBackend::CreateMixer()
+{
+	/*
+	stream 1: decodebin --> audioconvert --> audioresample --> capsfilter --> appsink --.
+	stream 2: decodebin --> ...                                           --> appsink --+--> MixBlock()
+	                                                                                     |   : here we call the DSP handler
+	output:   appsrc --> volume --> audiosink <------------------------------------------'   : for each stream
+	*/
+
+	wxASSERT( m_mixerPipeline == NULL );
+
+	GError* error = NULL;
+	m_mixerPipeline          = gst_pipeline_new        (                 "sjMixer"      );
+	GstElement* appsrc       = gst_element_factory_make("appsrc",        "sjMixerSource");
+	GstElement* volume       = gst_element_factory_make("volume",        "sjVolume"     );
+	GstElement* audiosink    = gst_parse_bin_from_description(m_iniAudioPipeline, true, &error);
+	if( error ) {
+		const gchar* errormessage = error->message; GST_TO_WXSTRING(errormessage);
+		wxLogError("GStreamer Error: %s. Please check the audio configuration at Settings/Advanced.", errormessageWxStr.c_str());
+		g_error_free(error);
+	} // no "return", no "else" - it may be possible, the pipeline is created even on errors, see http://gstreamer.freedesktop.org/data/doc/gstreamer/head/gstreamer/html/gstreamer-GstParse.html#gst-parse-launch
+	if( !m_mixerPipeline || !appsrc || !volume || !audiosink ) {
+		wxLogError("GStreamer error: Cannot create objects.");
+		if( m_mixerPipeline ) { gst_object_unref(GST_OBJECT(m_mixerPipeline)); m_mixerPipeline = NULL; }
+		return false; // error
+	}
+
+	// create pipeline
+	gst_bin_add_many(GST_BIN(m_mixerPipeline), appsrc, volume, audiosink, NULL); // NULL marks end of list
+	gst_element_link_many(appsrc, volume, audiosink, NULL);
+
+	// setup the source, we deliver blocks of SJ_GST_MIXER_FRAMES in our own format
+	GstCaps* caps = create_mixer_caps();
+		g_object_set(G_OBJECT(appsrc),
+				"caps",      caps,
+				"format",    GST_FORMAT_TIME,
+				"max-bytes", (guint64)(SJ_GST_MIXER_BLOCK_BYTES*MIXER_QUEUED_BLOCKS),
+				NULL);
+	gst_caps_unref(caps);
+	g_signal_connect(appsrc, "need-data", G_CALLBACK(on_mixer_need_data), this /*userdata*/);
+
+	// add a message handler
+	GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(m_mixerPipeline));
+		m_mixerBusWatchId = gst_bus_add_watch(bus, on_mixer_bus_message, this /*userdata*/);
+	gst_object_unref(bus);
+
+	m_mixerFrames = 0;
+	return true;
+}
+
+
+void SjGstreamerBackend::DestroyMixer()
+{
+	if( m_mixerPipeline )
+	{
+		set_pipeline_state(m_mixerPipeline, GST_STATE_NULL); // this also stops the streaming thread calling MixBlock()
+		gst_object_unref(GST_OBJECT(m_mixerPipeline));
+		m_mixerPipeline = NULL;
+		g_source_remove(m_mixerBusWatchId);
+		m_mixerBusWatchId = 0;
+	}
+}
+
+
+void SjGstreamerBackend::MixBlock(GstElement* appsrc)
+{
+	memset(m_mixerBuffer, 0, SJ_GST_MIXER_BLOCK_BYTES);
+
+	m_mixerCritical.Enter();
+
+		size_t i, iCnt = m_mixerStreams.GetCount();
+		for( i = 0; i < iCnt; i++ )
+		{
+			SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)m_mixerStreams.Item(i);
+			long frames = stream->ReadFrames(m_mixerStreamBuffer, SJ_GST_MIXER_FRAMES);
+			if( frames > 0 )
+			{
+				// forward the data to the given callback, then add them to the mix;
+				// as the data are already copied, there is no need to make any GstBuffer writable
+				stream->m_cbp.msg    = SJBE_MSG_DSP;
+				stream->m_cbp.buffer = m_mixerStreamBuffer;
+				stream->m_cbp.bytes  = frames*FRAME_BYTES;
+				stream->m_cb(&stream->m_cbp);
+
+				long s, sCnt = frames*SJ_GST_MIXER_CHANNELS;
+				for( s = 0; s < sCnt; s++ ) {
+					m_mixerBuffer[s] += m_mixerStreamBuffer[s];
+				}
+			}
+			else if( stream->m_eos && !stream->m_eosSend )
+			{
+				stream->m_cbp.msg = SJBE_MSG_END_OF_STREAM;
+				stream->m_cb(&stream->m_cbp);
+				stream->m_eosSend = true;
+			}
+		}
+
+	m_mixerCritical.Leave();
+
+	// deliver the block to the output
+	GstBuffer* buffer = gst_buffer_new_allocate(NULL, SJ_GST_MIXER_BLOCK_BYTES, NULL);
+	if( buffer == NULL ) { return; }
+
+	gst_buffer_fill(buffer, 0, m_mixerBuffer, SJ_GST_MIXER_BLOCK_BYTES);
+	GST_BUFFER_PTS     (buffer) = gst_util_uint64_scale(m_mixerFrames,        GST_SECOND, SJ_GST_MIXER_RATE);
+	GST_BUFFER_DURATION(buffer) = gst_util_uint64_scale(SJ_GST_MIXER_FRAMES, GST_SECOND, SJ_GST_MIXER_RATE);
+	m_mixerFrames += SJ_GST_MIXER_FRAMES;
+
+	gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer); // takes the ownership of the buffer
+}
+
+
+void SjGstreamerBackend::UseDirectOutput(SjGstreamerBackendStream* stream)
+{
+	/*
+	              .--> audioconvert --> audioresample --> capsfilter --> (X) volume --> audiosink
+	decodebin --> |                                                       :
+	              '--> videosink                                          : here we call the DSP handler
+	*/
+
+	// streams with video are not mixed: the videosink syncs to the clock of the stream pipeline,
+	// so the audio must be played there as well, otherwise they drift apart by the latency of the mixer
+	// and pausing the mixer would not stop the video.  Called from the streaming thread before any data flow.
+	m_mixerCritical.Enter();
+		stream->m_direct = true;
+		int i = m_mixerStreams.Index(stream);
+		if( i != wxNOT_FOUND ) {
+			m_mixerStreams.RemoveAt(i);
+		}
+	m_mixerCritical.Leave();
+
+	GError* error = NULL;
+	GstElement* volume     = gst_element_factory_make("volume", "sjVolume");
+	GstElement* audiosink  = gst_parse_bin_from_description(m_iniAudioPipeline, true, &error);
+	GstElement* capsfilter = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjCapsFilter");
+	if( error ) {
+		const gchar* errormessage = error->message; GST_TO_WXSTRING(errormessage);
+		wxLogError("GStreamer Error: %s. Please check the audio configuration at Settings/Advanced.", errormessageWxStr.c_str());
+		g_error_free(error);
+	}
+	if( !volume || !audiosink || !capsfilter ) {
+		wxLogError("GStreamer error: Cannot create objects.");
+		if( volume )     { gst_object_unref(GST_OBJECT(volume)); }
+		if( audiosink )  { gst_object_unref(GST_OBJECT(audiosink)); }
+		if( capsfilter ) { gst_object_unref(GST_OBJECT(capsfilter)); }
+		return; // error
+	}
+
+	// replace the appsink by our own output
+	gst_element_unlink(capsfilter, stream->m_appsink);
+	gst_element_set_state(stream->m_appsink, GST_STATE_NULL);
+	gst_bin_remove(GST_BIN(stream->m_pipeline), stream->m_appsink);
+	gst_object_unref(GST_OBJECT(stream->m_appsink));
+	stream->m_appsink = NULL;
+
+	gst_bin_add_many(GST_BIN(stream->m_pipeline), volume, audiosink, NULL); // NULL marks end of list
+	gst_element_link_many(capsfilter, volume, audiosink, NULL);
+	g_object_set(G_OBJECT(volume), "volume", (gdouble)m_deviceVol, NULL);
+
+	GstPad* pad = gst_element_get_static_pad(volume, "sink");
+		if( gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_direct_pad_data, (gpointer)stream/*userdata*/, NULL) == 0 ) {
+			wxLogError("GStreamer Error: Cannot add probe callback.");
+		}
+	gst_object_unref(pad);
+
+	gst_element_sync_state_with_parent(volume);
+	gst_element_sync_state_with_parent(audiosink);
+	gst_object_unref(capsfilter);
+}
+
+
+long SjGstreamerBackendStream::ReadFrames(float* dest, long frames)
+{
+	// read the given number of frames from the appsink; returns the number of frames read, this may be less
+	// if the stream is not ready or has ended.  Called by the mixer with m_mixerCritical locked.
+	long done = 0;
+	while( done < frames )
+	{
+		if( m_pendingBuffer == NULL )
+		{
+			GstSample* sample = gst_app_sink_try_pull_sample(GST_APP_SINK(m_appsink), done? 0 : STREAM_WAIT_NS);
+			if( sample == NULL ) {
+				if( gst_app_sink_is_eos(GST_APP_SINK(m_appsink)) ) {
+					m_eos = true;
+				}
+				break; // no more data available (yet)
+			}
+
+			m_pendingBuffer = gst_buffer_ref(gst_sample_get_buffer(sample));
+			m_pendingOffset = 0;
+			gst_sample_unref(sample);
+
+			if( GST_BUFFER_PTS_IS_VALID(m_pendingBuffer) ) {
+				m_pendingPosMs = GST_BUFFER_PTS(m_pendingBuffer)/NANOSEC_TO_MILLISEC_DIVISOR;
+			}
+		}
+
+		gsize bufferBytes = gst_buffer_get_size(m_pendingBuffer);
+		gsize bytes = bufferBytes - m_pendingOffset;
+		if( bytes > (frames-done)*FRAME_BYTES ) {
+			bytes = (frames-done)*FRAME_BYTES;
+		}
+
+		gst_buffer_extract(m_pendingBuffer, m_pendingOffset, dest + done*SJ_GST_MIXER_CHANNELS, bytes);
+		m_pendingOffset += bytes;
+		done += bytes / FRAME_BYTES;
+		m_elapsedMs = m_pendingPosMs + (long)((m_pendingOffset/FRAME_BYTES)*1000/SJ_GST_MIXER_RATE);
+
+		if( m_pendingOffset >= bufferBytes || bytes == 0 ) {
+			gst_buffer_unref(m_pendingBuffer);
+			m_pendingBuffer = NULL;
+		}
+	}
+
+	return done;
+}
+
+
 /*******************************************************************************
  * Public Backend Implementation
  ******************************************************************************/
@@ -268,10 +575,17 @@ SjGstreamerBackend::SjGstreamerBackend(SjBackendId id)
 	//     audioecho delay=500000000 intensity=0.6 feedback=0.4 ! autoaudiosink
 	//     pulsesink
 	//     filesink location=/tmp/raw
+	//     fakesink sync=true
 	#define AUDIOPIPELINE_ININAME "gstreamer/"+GetName()+"AudioPipeline"
 	#define AUDIOPIPELINE_DEFAULT "autoaudiosink"
 	#define VIDEOPIPELINE_ININAME "gstreamer/"+GetName()+"VideoPipeline"
 	#define VIDEOPIPELINE_DEFAULT "autovideosink"
+	m_prerollStream   = NULL;
+	m_mixerPipeline   = NULL;
+	m_mixerBusWatchId = 0;
+	m_mixerFrames     = 0;
+	m_deviceVol       = 1.0;
+
 	wxConfigBase* c = g_tools->m_config;
 	m_iniAudioPipeline = c->Read(AUDIOPIPELINE_ININAME, AUDIOPIPELINE_DEFAULT);
 	if( WantsVideo() ) {
@@ -303,43 +617,41 @@ void SjGstreamerBackend::GetLittleOptions(SjArrayLittleOption& lo)
 }
 
 
-SjBackendStream* SjGstreamerBackend::CreateStream(const wxString& uri, long seekMs, SjBackendCallback* cb, SjBackendUserdata* userdata)
+SjGstreamerBackendStream* SjGstreamerBackend::BuildStream(const wxString& uri, SjBackendCallback* cb, SjBackendUserdata* userdata)
 {
 	SjGstreamerBackendStream* stream = new SjGstreamerBackendStream(uri, this, cb, userdata);
 	if( stream == NULL ) { return NULL; }
 
+	stream->m_cbp.samplerate = SJ_GST_MIXER_RATE;
+	stream->m_cbp.channels   = SJ_GST_MIXER_CHANNELS;
+
 	/*
-	              .--> audioconvert --> capsfilter --> (X) volume -> audiosink
-	decodebin --> |                                     :
-	              '--> videosink                        :
-	                                                    : here we add our DSP handler
+	              .--> audioconvert --> audioresample --> capsfilter --> appsink --> (mixer)
+	decodebin --> |
+	              '--> videosink (if there is a video, the appsink is replaced, see UseDirectOutput())
 	*/
 
 	// create objects
 	// NB: is is the far faster part, on my computer creating the pipeline takes 4 ms while starting the stream takes 40 ms -
 	// if there are no other problems on recreating the pipeline on every call, there is no need to change this - esp. as there are some advantages as easier cleaning up, different samplerates etc.
-	GError* error = NULL;
-	stream->m_pipeline       = gst_pipeline_new        (                 "sjPlayer"    );
-	GstElement* decodebin    = gst_element_factory_make("uridecodebin",  "sjSource"    );
-	GstElement* audioconvert = gst_element_factory_make("audioconvert",  "sjAudioEntry");
-	GstElement* capsfilter   = gst_element_factory_make("capsfilter",    NULL          );
-	GstElement* volume       = gst_element_factory_make("volume",        "sjVolume"    );
-	GstElement* audiosink    = gst_parse_bin_from_description(m_iniAudioPipeline, true, &error);
-	if( error ) {
-		const gchar* errormessage = error->message; GST_TO_WXSTRING(errormessage);
-		wxLogError("GStreamer Error: %s. Please check the audio configuration at Settings/Advanced.", errormessageWxStr.c_str());
-		g_error_free(error);
-	} // no "return", no "else" - it may be possible, the pipeline is created even on errors, see http://gstreamer.freedesktop.org/data/doc/gstreamer/head/gstreamer/html/gstreamer-GstParse.html#gst-parse-launch
-	if( !stream->m_pipeline || !decodebin || !audioconvert || !capsfilter || !volume || !audiosink ) {
+	stream->m_pipeline        = gst_pipeline_new        (                 "sjPlayer"    );
+	GstElement* decodebin     = gst_element_factory_make("uridecodebin",  "sjSource"    );
+	GstElement* audioconvert  = gst_element_factory_make("audioconvert",  "sjAudioEntry");
+	GstElement* audioresample = gst_element_factory_make("audioresample", NULL          );
+	GstElement* capsfilter    = gst_element_factory_make("capsfilter",    "sjCapsFilter");
+	GstElement* appsink       = gst_element_factory_make("appsink",       "sjAppSink"   );
+	if( !stream->m_pipeline || !decodebin || !audioconvert || !audioresample || !capsfilter || !appsink ) {
 		wxLogError("GStreamer error: Cannot create objects.");
 		delete stream;
 		return NULL; // error
 	}
 
 	// create pipeline
-	gst_bin_add_many(GST_BIN(stream->m_pipeline), decodebin, audioconvert, capsfilter, volume, audiosink, NULL); // NULL marks end of list
-	gst_element_link_many(audioconvert, capsfilter, volume, audiosink, NULL);
+	gst_bin_add_many(GST_BIN(stream->m_pipeline), decodebin, audioconvert, audioresample, capsfilter, appsink, NULL); // NULL marks end of list
+	gst_element_link_many(audioconvert, audioresample, capsfilter, appsink, NULL);
 	g_signal_connect(decodebin, "pad-added", G_CALLBACK(on_pad_added), stream /*userdata*/);
+	g_signal_connect(decodebin, "no-more-pads", G_CALLBACK(on_no_more_pads), stream /*userdata*/);
+	stream->m_appsink = GST_ELEMENT(gst_object_ref(appsink));
 
 	// add a message handler
 	GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(stream->m_pipeline));
@@ -347,102 +659,191 @@ SjBackendStream* SjGstreamerBackend::CreateStream(const wxString& uri, long seek
 		gst_bus_set_sync_handler(bus, on_bus_sync_handler, stream /*userdata*/, NULL);
 	gst_object_unref(bus);
 
-	// setup capsfilter and dsp callback
-	GstCaps* caps = gst_caps_new_simple("audio/x-raw",
-				"format", G_TYPE_STRING, "F32LE",       // or S16LE, U8, ...
-				"layout", G_TYPE_STRING, "interleaved", // LRLRLRLRLRLRLR ...
-				//"rate", G_TYPE_INT, info->rate,       // if we set a fixed rate, we must probably add a resampler to the pipeline, however, currently this is not needed
-				//"channels", G_TYPE_INT, 2,            // enable this to force a fixed number of channels, currently not needed
-				NULL);
-		 g_object_set(G_OBJECT(capsfilter), "caps", caps, NULL);
+	// setup capsfilter and appsink; the appsink does not sync to the clock, the pace is given by the mixer
+	GstCaps* caps = create_mixer_caps();
+		g_object_set(G_OBJECT(capsfilter), "caps", caps, NULL);
 	gst_caps_unref(caps);
 
-	GstPad* pad = gst_element_get_static_pad(volume, "sink"); // sink/src is defined from the view of within the element: elements receive data on their sink pads and generate data on their source pads.
-		gulong probeid = gst_pad_add_probe(pad,
-			(GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER),
-			on_pad_data, (gpointer)stream/*userdata*/, NULL);
-		if( probeid==0 ) {
-			wxLogError("GStreamer Error: Cannot add probe callback.");
-		}
-	gst_object_unref(pad);
+	g_object_set(G_OBJECT(appsink),
+			"sync",        FALSE,
+			"max-buffers", (guint)STREAM_MAX_BUFFERS,
+			"drop",        FALSE,
+			NULL);
 
 	// open stream
-	stream->set_pipeline_state(GST_STATE_READY);
+	set_pipeline_state(stream->m_pipeline, GST_STATE_READY);
 
 		GstElement* source = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjSource");
 		if( source )
 		{
 			WXSTRING_TO_GST(uri);
 			g_object_set(G_OBJECT(source), "uri", uriGstStr, NULL /*NULL marks end of list*/);
+			gst_object_unref(source);
 		}
 
-	stream->set_pipeline_state(GST_STATE_PLAYING);
+	return stream;
+}
+
+
+SjBackendStream* SjGstreamerBackend::CreateStream(const wxString& uri, long seekMs, SjBackendCallback* cb, SjBackendUserdata* userdata)
+{
+	// use the prerolled stream, if any - the pipeline is already running and waits
+	// with the first decoded data in the appsink, so adding it to the mixer is sufficient
+	SjGstreamerBackendStream* stream = NULL;
+	if( m_prerollStream && m_prerollStream->GetUrl() == uri && seekMs <= 0 && !m_prerollStream->m_prerollFailed )
+	{
+		stream = m_prerollStream;
+		m_prerollStream = NULL;
+
+		stream->Adopt(cb, userdata);
+	}
+	else
+	{
+		stream = BuildStream(uri, cb, userdata);
+		if( stream == NULL ) { return NULL; }
+
+		set_pipeline_state(stream->m_pipeline, GST_STATE_PLAYING);
+
+		if( seekMs > 0 )
+		{
+			gst_element_seek_simple(stream->m_pipeline, GST_FORMAT_TIME,
+				(GstSeekFlags)(GST_SEEK_FLAG_FLUSH|GST_SEEK_FLAG_KEY_UNIT), seekMs*MILLISEC_TO_NANOSEC_FACTOR);
+			stream->m_elapsedMs = seekMs;
+		}
+	}
 
-	if( seekMs > 0 )
+	// open the output, if not yet done
+	if( m_mixerPipeline == NULL )
 	{
-		gst_element_seek_simple(stream->m_pipeline, GST_FORMAT_TIME,
-			(GstSeekFlags)(GST_SEEK_FLAG_FLUSH|GST_SEEK_FLAG_KEY_UNIT), seekMs*MILLISEC_TO_NANOSEC_FACTOR);
+		if( !CreateMixer() ) {
+			delete stream;
+			return NULL;
+		}
+		set_pipeline_state(m_mixerPipeline, GST_STATE_PLAYING);
 	}
 
+	// from now on, the stream is mixed to the output - if it has no video
+	m_mixerCritical.Enter();
+		if( !stream->m_direct ) {
+			m_mixerStreams.Add(stream);
+		}
+	m_mixerCritical.Leave();
+
 	return stream;
 }
 
 
+void SjGstreamerBackend::PrerollStream(const wxString& uri)
+{
+	if( m_prerollStream )
+	{
+		if( m_prerollStream->GetUrl() == uri ) {
+			return; // already prerolled
+		}
+		CancelPreroll();
+	}
+
+	SjGstreamerBackendStream* stream = BuildStream(uri, NULL, NULL);
+	if( stream == NULL ) { return; }
+
+	// start decoding; as the stream is not yet added to the mixer, this stops as soon
+	// as the appsink is filled.  We do not wait for this.
+	gst_element_set_state(stream->m_pipeline, GST_STATE_PLAYING);
+
+	m_prerollStream = stream;
+}
+
+
+void SjGstreamerBackend::CancelPreroll()
+{
+	if( m_prerollStream )
+	{
+		delete m_prerollStream; // as the stream has no callback, this does not send any message
+		m_prerollStream = NULL;
+	}
+}
+
+
+SjBackendDecoder* SjGstreamerBackend::CreateDecoder(const wxString& uri)
+{
+	SjGstreamerBackendDecoder* decoder = new SjGstreamerBackendDecoder(uri);
+	if( decoder->m_pipeline == NULL ) {
+		delete decoder;
+		return NULL;
+	}
+	return decoder;
+}
+
+
 SjBackendState SjGstreamerBackend::GetDeviceState() const
 {
-	const wxArrayPtrVoid& allStreams = GetAllStreams();
-	size_t i, iCnt = allStreams.GetCount();
-	if( iCnt == 0 ) {
+	if( GetAllStreams().GetCount() == 0 || m_mixerPipeline == NULL ) {
 		return SJBE_STATE_CLOSED;
 	}
 
-	for( i = 0; i < iCnt; i++ )
-	{
-		SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)allStreams.Item(i);
-		GstState state;
-		if( gst_element_get_state(stream->m_pipeline, &state, NULL, 3000*MILLISEC_TO_NANOSEC_FACTOR /*wait max. 3 seconds*/) != GST_STATE_CHANGE_SUCCESS ) {
-			return SJBE_STATE_PLAYING; // we assume, a stream is coming very soon
-		}
-		if( state != GST_STATE_PAUSED ) {
-			return SJBE_STATE_PLAYING;
-		}
+	GstState state;
+	if( gst_element_get_state(m_mixerPipeline, &state, NULL, 3000*MILLISEC_TO_NANOSEC_FACTOR /*wait max. 3 seconds*/) != GST_STATE_CHANGE_SUCCESS ) {
+		return SJBE_STATE_PLAYING; // we assume, a stream is coming very soon
 	}
 
-	return SJBE_STATE_PAUSED;
+	return state==GST_STATE_PAUSED? SJBE_STATE_PAUSED : SJBE_STATE_PLAYING;
 }
 
 
 void SjGstreamerBackend::SetDeviceState(SjBackendState state)
 {
-	if( state == SJBE_STATE_CLOSED ) {
-		return; // if there are no streams on the device, it is closed, nothing special to do here
+	if( state == SJBE_STATE_CLOSED )
+	{
+		// the user has deleted all streams before, release the output device
+		if( GetAllStreams().GetCount() == 0 ) {
+			DestroyMixer();
+		}
+		return;
 	}
 
-	const wxArrayPtrVoid& allStreams = GetAllStreams();
-	size_t i, iCnt = allStreams.GetCount();
-	for( i = 0; i < iCnt; i++ )
-	{
-		SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)allStreams.Item(i);
+	// pausing the output is sufficient for mixed streams, they stop as soon as their appsinks are filled;
+	// streams with video have their own output and are paused together with the mixer
+	GstState gstState = state==SJBE_STATE_PLAYING? GST_STATE_PLAYING : GST_STATE_PAUSED;
+	set_pipeline_state(m_mixerPipeline, gstState);
 
-		stream->set_pipeline_state(state==SJBE_STATE_PLAYING? GST_STATE_PLAYING : GST_STATE_PAUSED);
+	wxArrayPtrVoid directPipelines;
+	m_mixerCritical.Enter();
+		const wxArrayPtrVoid& allStreams = GetAllStreams();
+		size_t i, iCnt = allStreams.GetCount();
+		for( i = 0; i < iCnt; i++ )
+		{
+			SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)allStreams.Item(i);
+			if( stream->m_direct ) {
+				directPipelines.Add(stream->m_pipeline);
+			}
+		}
+	m_mixerCritical.Leave();
+
+	for( i = 0; i < directPipelines.GetCount(); i++ ) {
+		set_pipeline_state((GstElement*)directPipelines.Item(i), gstState);
 	}
 }
 
 
 void SjGstreamerBackend::SetDeviceVol(double gain)
 {
+	m_deviceVol = gain; // used for streams with video created later
+	if( m_mixerPipeline == NULL ) {
+		return;
+	}
+
+	// this does not set the "main" volume but the volume of our output;
+	// we cannot get louder than the OS-setting this way.
+	set_pipeline_volume(m_mixerPipeline, gain);
+
+	wxCriticalSectionLocker locker(m_mixerCritical);
 	const wxArrayPtrVoid& allStreams = GetAllStreams();
 	size_t i, iCnt = allStreams.GetCount();
 	for( i = 0; i < iCnt; i++ )
 	{
 		SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)allStreams.Item(i);
-
-		// this does not set the "main" volume but the volume of the stream;
-		// we cannot get louder than the OS-setting this way, however, this may be useful for our crossfading.
-		GstElement* volumeElem = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjVolume");
-		if( volumeElem )
-		{
-			g_object_set(G_OBJECT(volumeElem), "volume", (gdouble)gain /*0: mute, 1.0: 100%, >1.0: additional gain*/, NULL /*NULL marks end of list*/);
+		if( stream->m_direct ) {
+			set_pipeline_volume(stream->m_pipeline, gain);
 		}
 	}
 }
@@ -451,33 +852,217 @@ void SjGstreamerBackend::SetDeviceVol(double gain)
 void SjGstreamerBackendStream::GetTime(long& totalMs, long& elapsedMs)
 {
 	totalMs   = -1; // unknown total time
-	elapsedMs = -1; // unknown elapsed time
+	elapsedMs = m_elapsedMs; // the position of the data delivered to the mixer
 
 	gint64 ns;
-	if( gst_element_query_duration(m_pipeline, GST_FORMAT_TIME, &ns) ) {
-		totalMs = ns/NANOSEC_TO_MILLISEC_DIVISOR;
+	if( m_direct && gst_element_query_position(m_pipeline, GST_FORMAT_TIME, &ns) ) {
+		elapsedMs = ns/NANOSEC_TO_MILLISEC_DIVISOR; // streams with video are not mixed
 	}
 
-	if( gst_element_query_position(m_pipeline, GST_FORMAT_TIME, &ns) ) {
-		elapsedMs = ns/NANOSEC_TO_MILLISEC_DIVISOR;
+	if( gst_element_query_duration(m_pipeline, GST_FORMAT_TIME, &ns) ) {
+		totalMs = ns/NANOSEC_TO_MILLISEC_DIVISOR;
 	}
 }
 
 
 void SjGstreamerBackendStream::SeekAbs(long seekMs)
 {
+	wxCriticalSectionLocker locker(m_backend->m_mixerCritical);
+
 	gst_element_seek_simple(m_pipeline, GST_FORMAT_TIME,
 		(GstSeekFlags)(GST_SEEK_FLAG_FLUSH|GST_SEEK_FLAG_KEY_UNIT), seekMs*MILLISEC_TO_NANOSEC_FACTOR);
+
+	// forget about data from before the seek
+	if( m_pendingBuffer ) {
+		gst_buffer_unref(m_pendingBuffer);
+		m_pendingBuffer = NULL;
+	}
+	m_eos       = false;
+	m_elapsedMs = seekMs;
 }
 
 
 SjGstreamerBackendStream::~SjGstreamerBackendStream()
 {
-	set_pipeline_state(GST_STATE_NULL);
-	gst_object_unref(GST_OBJECT(m_pipeline));
-	m_pipeline = NULL;
-	g_source_remove(m_bus_watch_id);
-	m_bus_watch_id = 0;
+	// remove the stream from the mixer first, MixBlock() must not use it any longer
+	m_backend->m_mixerCritical.Enter();
+		int i = m_backend->m_mixerStreams.Index(this);
+		if( i != wxNOT_FOUND ) {
+			m_backend->m_mixerStreams.RemoveAt(i);
+		}
+	m_backend->m_mixerCritical.Leave();
+
+	set_pipeline_state(m_pipeline, GST_STATE_NULL);
+	if( m_audioPad ) {
+		gst_object_unref(m_audioPad);
+		m_audioPad = NULL;
+	}
+	if( m_pendingBuffer ) {
+		gst_buffer_unref(m_pendingBuffer);
+		m_pendingBuffer = NULL;
+	}
+	if( m_appsink ) {
+		gst_object_unref(GST_OBJECT(m_appsink));
+		m_appsink = NULL;
+	}
+	if( m_pipeline ) {
+		gst_object_unref(GST_OBJECT(m_pipeline));
+		m_pipeline = NULL;
+	}
+	if( m_bus_watch_id ) {
+		g_source_remove(m_bus_watch_id);
+		m_bus_watch_id = 0;
+	}
+}
+
+
+/*******************************************************************************
+ * Decoder
+ ******************************************************************************/
+
+
+SjGstreamerBackendDecoder::SjGstreamerBackendDecoder(const wxString& uri)
+{
+	m_pipeline      = NULL;
+	m_appsink       = NULL;
+	m_pendingBuffer = NULL;
+	m_pendingOffset = 0;
+	m_eos           = false;
+	m_emptyPulls    = 0;
+
+	/*
+	decodebin --> audioconvert --> capsfilter --> appsink
+	*/
+
+	// create objects; we do not add a bus watch as we may be called from any thread, errors are checked in Read()
+	GstElement* pipeline     = gst_pipeline_new        (                 "sjDecoder");
+	GstElement* decodebin    = gst_element_factory_make("uridecodebin",  NULL       );
+	GstElement* audioconvert = gst_element_factory_make("audioconvert",  NULL       );
+	GstElement* capsfilter   = gst_element_factory_make("capsfilter",    NULL       );
+	GstElement* appsink      = gst_element_factory_make("appsink",       NULL       );
+	if( !pipeline || !decodebin || !audioconvert || !capsfilter || !appsink ) {
+		if( pipeline ) { gst_object_unref(GST_OBJECT(pipeline)); }
+		return; // error
+	}
+
+	gst_bin_add_many(GST_BIN(pipeline), decodebin, audioconvert, capsfilter, appsink, NULL); // NULL marks end of list
+	gst_element_link_many(audioconvert, capsfilter, appsink, NULL);
+	g_signal_connect(decodebin, "pad-added", G_CALLBACK(on_decoder_pad_added), audioconvert /*userdata*/);
+
+	// we want float samples, samplerate and channels are left as they are
+	GstCaps* caps = gst_caps_new_simple("audio/x-raw",
+				"format", G_TYPE_STRING, "F32LE",
+				"layout", G_TYPE_STRING, "interleaved",
+				NULL);
+		g_object_set(G_OBJECT(capsfilter), "caps", caps, NULL);
+	gst_caps_unref(caps);
+
+	// decode as fast as possible
+	g_object_set(G_OBJECT(appsink), "sync", FALSE, "max-buffers", (guint)STREAM_MAX_BUFFERS, NULL);
+
+	WXSTRING_TO_GST(uri);
+	g_object_set(G_OBJECT(decodebin), "uri", uriGstStr, NULL);
+
+	m_pipeline = pipeline;
+	m_appsink  = GST_ELEMENT(gst_object_ref(appsink));
+
+	gst_element_set_state(m_pipeline, GST_STATE_PLAYING); // we do not wait, Read() does
+}
+
+
+SjGstreamerBackendDecoder::~SjGstreamerBackendDecoder()
+{
+	if( m_pendingBuffer ) {
+		gst_buffer_unref(m_pendingBuffer);
+	}
+
+	if( m_pipeline ) {
+		gst_element_set_state(m_pipeline, GST_STATE_NULL);
+		gst_object_unref(GST_OBJECT(m_appsink));
+		gst_object_unref(GST_OBJECT(m_pipeline));
+	}
+}
+
+
+bool SjGstreamerBackendDecoder::HasError()
+{
+	// check the bus for errors; as there is no bus watch, we also remove all other messages here
+	bool hasError = false;
+	GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(m_pipeline));
+		GstMessage* msg;
+		while( (msg=gst_bus_pop(bus)) != NULL ) {
+			if( GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR ) {
+				hasError = true;
+			}
+			gst_message_unref(msg);
+		}
+	gst_object_unref(bus);
+	return hasError;
+}
+
+
+long SjGstreamerBackendDecoder::Read(float* buffer, long maxFrames)
+{
+	#define DECODER_WAIT_NS         (500*MILLISEC_TO_NANOSEC_FACTOR)
+	#define DECODER_MAX_EMPTY_PULLS 20 // give up if the source delivers nothing for 10 seconds, eg. a stalled network share
+	long done = 0;
+	while( done < maxFrames && !m_eos )
+	{
+		if( m_pendingBuffer == NULL )
+		{
+			GstSample* sample = gst_app_sink_try_pull_sample(GST_APP_SINK(m_appsink), DECODER_WAIT_NS);
+			if( sample == NULL ) {
+				if( HasError() ) {
+					m_eos    = true;
+					m_failed = true;
+				}
+				else if( gst_app_sink_is_eos(GST_APP_SINK(m_appsink)) ) {
+					m_eos = true;
+				}
+				else if( ++m_emptyPulls >= DECODER_MAX_EMPTY_PULLS || IsAborted() ) {
+					m_eos    = true;
+					m_failed = true;
+				}
+				continue;
+			}
+			m_emptyPulls = 0;
+
+			GstCaps* caps = gst_sample_get_caps(sample); // no need to unref, the caps belong to the sample
+			if( caps ) {
+				GstStructure* s = gst_caps_get_structure(caps, 0);
+				gint v;
+				if( gst_structure_get_int(s, "rate", &v) && v >= 1000 && v <= 1000000 ) {
+					m_samplerate = v;
+				}
+				if( gst_structure_get_int(s, "channels", &v) && v >= 1 && v <= 32 && (v == m_channels || done == 0) ) {
+					m_channels = v;
+				}
+			}
+
+			m_pendingBuffer = gst_buffer_ref(gst_sample_get_buffer(sample));
+			m_pendingOffset = 0;
+			gst_sample_unref(sample);
+		}
+
+		gsize frameBytes = m_channels*sizeof(float);
+		gsize bufferBytes = gst_buffer_get_size(m_pendingBuffer);
+		gsize bytes = bufferBytes - m_pendingOffset;
+		if( bytes > (maxFrames-done)*frameBytes ) {
+			bytes = (maxFrames-done)*frameBytes;
+		}
+		bytes -= bytes % frameBytes;
+
+		gst_buffer_extract(m_pendingBuffer, m_pendingOffset, buffer + done*m_channels, bytes);
+		m_pendingOffset += bytes;
+		done += bytes / frameBytes;
+
+		if( m_pendingOffset+frameBytes > bufferBytes || bytes == 0 ) {
+			gst_buffer_unref(m_pendingBuffer);
+			m_pendingBuffer = NULL;
+		}
+	}
+
+	return done;
 }
 
 
@@ -37,21 +37,67 @@
 class SjGstreamerBackendStream;
 
 
+// all streams of a backend are decoded to this format and mixed in-process,
+// the result is delivered to a single output pipeline
+#define SJ_GST_MIXER_RATE        44100
+#define SJ_GST_MIXER_CHANNELS    2
+#define SJ_GST_MIXER_FRAMES      1024 // frames per mixed block, ~23 ms
+#define SJ_GST_MIXER_BLOCK_BYTES (SJ_GST_MIXER_FRAMES*SJ_GST_MIXER_CHANNELS*sizeof(float))
+
+
 class SjGstreamerBackend : public SjBackend
 {
 public:
 	                 SjGstreamerBackend  (SjBackendId);
-	                 ~SjGstreamerBackend () { SetDeviceState(SJBE_STATE_CLOSED); }
+	                 ~SjGstreamerBackend () { CancelPreroll(); SetDeviceState(SJBE_STATE_CLOSED); }
 	void             GetLittleOptions    (SjArrayLittleOption&);
 	SjBackendStream* CreateStream        (const wxString& url, long seekMs, SjBackendCallback*, SjBackendUserdata* userdata);
 	SjBackendState   GetDeviceState      () const;
 	void             SetDeviceState      (SjBackendState);
 	void             SetDeviceVol        (double gain);
+	void             PrerollStream       (const wxString& url);
+	void             CancelPreroll       ();
+	SjBackendDecoder* CreateDecoder      (const wxString& url);
 
 protected:
 	wxString         m_iniAudioPipeline;
 	wxString         m_iniVideoPipeline;
+	SjGstreamerBackendStream* m_prerollStream;
+	SjGstreamerBackendStream* BuildStream(const wxString& url, SjBackendCallback*, SjBackendUserdata* userdata);
+
+	// the mixer - the output pipeline "appsrc ! volume ! audiosink" is the only one opening the device,
+	// except for streams with video, see UseDirectOutput()
+	GstElement*      m_mixerPipeline;
+	guint            m_mixerBusWatchId;
+	guint64          m_mixerFrames;
+	wxArrayPtrVoid   m_mixerStreams; // streams delivering data to the mixer, guarded by m_mixerCritical
+	wxCriticalSection m_mixerCritical;
+	float            m_mixerBuffer[SJ_GST_MIXER_FRAMES*SJ_GST_MIXER_CHANNELS];
+	float            m_mixerStreamBuffer[SJ_GST_MIXER_FRAMES*SJ_GST_MIXER_CHANNELS];
+	bool             CreateMixer         ();
+	void             DestroyMixer        ();
+	void             MixBlock            (GstElement* appsrc);
+	void             UseDirectOutput     (SjGstreamerBackendStream*);
+	double           m_deviceVol;
+
 	friend void      on_pad_added        (GstElement*, GstPad*, gpointer);
+	friend void      on_no_more_pads     (GstElement*, gpointer);
+	friend void      on_mixer_need_data  (GstElement*, guint, gpointer);
+	friend gboolean  on_bus_message      (GstBus*, GstMessage*, gpointer);
+	friend class     SjGstreamerBackendStream;
+};
+
+
+class SjGstreamerNullBackend : public SjGstreamerBackend
+{
+public:
+	// decodes to a fakesink instead of a sound device - as fast as possible or, if desired, in realtime
+	                 SjGstreamerNullBackend (bool realtime)
+		: SjGstreamerBackend(SJBE_ID_NULLOUTPUT)
+	{
+		m_iniAudioPipeline = realtime? "fakesink sync=true" : "fakesink sync=false";
+	}
+	void             GetLittleOptions    (SjArrayLittleOption&) { }
 };
 
 
@@ -66,25 +112,66 @@ protected:
 	SjGstreamerBackendStream(const wxString& url, SjGstreamerBackend* backend, SjBackendCallback* cb, SjBackendUserdata* userdata)
 		: SjBackendStream(url, backend, cb, userdata)
     {
-		m_backend      = backend;
-		m_pipeline     = NULL;
-		m_bus_watch_id = 0;
-		m_capsChecked  = false;
-		m_eosSend      = false;
+		m_backend       = backend;
+		m_pipeline      = NULL;
+		m_appsink       = NULL;
+		m_bus_watch_id  = 0;
+		m_eos           = false;
+		m_eosSend       = false;
+		m_prerollFailed = false;
+		m_audioPad      = NULL;
+		m_hasVideo      = false;
+		m_direct        = false;
+		m_pendingBuffer = NULL;
+		m_pendingOffset = 0;
+		m_pendingPosMs  = 0;
+		m_elapsedMs     = 0;
     }
 
 	GstElement*         m_pipeline;
+	GstElement*         m_appsink;
 	guint               m_bus_watch_id;
 	SjGstreamerBackend* m_backend;
-	bool                m_capsChecked;
+	bool                m_eos;           // all data are read by the mixer
 	bool                m_eosSend;
-	void                set_pipeline_state  (GstState s);
+	bool                m_prerollFailed;
+	GstPad*             m_audioPad;      // the audio pad of the decoder, linked when all pads are known
+	bool                m_hasVideo;
+	bool                m_direct;        // set for streams with video, the audio is not mixed but played by an own audio sink
+
+	// the following fields are used by the mixer and guarded by SjGstreamerBackend::m_mixerCritical
+	GstBuffer*          m_pendingBuffer; // partly mixed buffer
+	gsize               m_pendingOffset;
+	long                m_pendingPosMs;
+	long                m_elapsedMs;
+	long                ReadFrames          (float* dest, long frames);
 
 	friend class             SjGstreamerBackend;
 	friend void              on_pad_added  (GstElement*, GstPad*, gpointer);
-	friend GstPadProbeReturn on_pad_data   (GstPad*, GstPadProbeInfo*, gpointer);
+	friend void              on_no_more_pads(GstElement*, gpointer);
+	friend GstPadProbeReturn on_direct_pad_data(GstPad*, GstPadProbeInfo*, gpointer);
 	friend gboolean          on_bus_message(GstBus*, GstMessage*, gpointer);
 };
 
 
+class SjGstreamerBackendDecoder : public SjBackendDecoder
+{
+public:
+	                    ~SjGstreamerBackendDecoder ();
+	long                Read                      (float* buffer, long maxFrames);
+
+protected:
+	                    SjGstreamerBackendDecoder (const wxString& url);
+	GstElement*         m_pipeline;
+	GstElement*         m_appsink;
+	GstBuffer*          m_pendingBuffer;
+	gsize               m_pendingOffset;
+	bool                m_eos;
+	int                 m_emptyPulls;
+	bool                HasError                  ();
+
+	friend class        SjGstreamerBackend;
+};
+
+
 #endif // __SJ_BACKEND_GSTREAMER_H__
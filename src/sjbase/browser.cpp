@@ -40,6 +40,7 @@
 BEGIN_EVENT_TABLE(SjBrowserWindow, wxWindow)
 	EVT_PAINT               (   SjBrowserWindow::OnPaint            )
 	EVT_IMAGE_THERE         (   SjBrowserWindow::OnImageThere       )
+	EVT_IDLE                (   SjBrowserWindow::OnIdle             )
 	EVT_ERASE_BACKGROUND    (   SjBrowserWindow::OnEraseBackground  )
 	EVT_SIZE                (   SjBrowserWindow::OnSize             )
 	EVT_LEFT_DOWN           (   SjBrowserWindow::OnMouseLeftDown    )
@@ -588,6 +589,14 @@ void SjBrowserWindow::OnImageThere(SjImageThereEvent& event)
 }
 
 
+void SjBrowserWindow::OnIdle(wxIdleEvent& event)
+{
+	// forward to the current view
+	if( m_currView && m_currView->OnIdle() )
+		event.RequestMore();
+}
+
+
 void SjBrowserWindow::OnSize(wxSizeEvent& event)
 {
 	wxSize clientSize = GetClientSize();
@@ -133,6 +133,7 @@ private:
 	void            OnEraseBackground   (wxEraseEvent&) {}
 	void            OnSize              (wxSizeEvent&);
 	void            OnImageThere        (SjImageThereEvent&);
+	void            OnIdle              (wxIdleEvent&);
 	void            OnMouseLeftDown     (wxMouseEvent&);
 	void            OnMouseLeftUp       (wxMouseEvent&);
 	void            OnMouseCaptureLost  (wxMouseCaptureLostEvent&);
@@ -234,6 +235,10 @@ public:
 	virtual void    OnSize              (wxSizeEvent& event) = 0;
 	virtual void    OnImageThere        (SjImageThereEvent& event) = 0;
 
+	// called if there are no other events to process, may be used eg. for prefetching;
+	// return true if you want to be called again
+	virtual bool    OnIdle              () { return false; }
+
 	// used by SjBrowserWindow, should not be used by classes derived from SjBrowserBase
 	bool __needsColumnMixerReload;
 
@@ -54,25 +54,18 @@ SjAlbumBrowser::SjAlbumBrowser(SjBrowserWindow* w)
 	m_fontSpace             = 0;
 	m_lastClickedCol        = NULL;
 	m_lastClickedRow        = NULL;
+	m_lastTooltipCol        = NULL;
+	m_lastTooltipRow        = NULL;
+	m_colCacheFirst         = NULL;
+	m_colCacheLast          = NULL;
+	m_colCacheGeneration    = -1;
 }
 
 
 void SjAlbumBrowser::Exit()
 {
-	int i;
-	for( i = 0; i < m_allocatedColCount; i++ )
-	{
-		if( m_applCol[i] )
-		{
-			if( m_applCol[i] == m_lastClickedCol )
-			{
-				m_lastClickedCol = NULL;
-				m_lastClickedRow = NULL;
-			}
-
-			delete m_applCol[i];
-		}
-	}
+	ClearColCache();
+	memset(m_applCol, 0, MAX_COL_COUNT*sizeof(SjCol*));
 
 	m_allocatedColCount = 0;
 	m_visibleColCount = 0;
@@ -83,6 +76,10 @@ void SjAlbumBrowser::Exit()
 
 void SjAlbumBrowser::Realize(bool reloadColumnMixer, bool keepColIndex)
 {
+	// Realize() is called whenever the content may have changed, eg. on
+	// RefreshAll() after changing a rating, so do not use cached columns
+	ClearColCache();
+
 	if( reloadColumnMixer )
 	{
 		m_scrollY = 0;
@@ -2457,20 +2454,10 @@ void SjAlbumBrowser::CalcPositions()
 
 	m_window->GetFontPxSizes(dc, m_fontVDiff, m_fontSpace, m_fontStdHeight);
 
-	// free all previously allocated objects
+	// forget all previously used objects, they stay in the column cache
 	for( i = 0; i < m_allocatedColCount; i++ )
 	{
-		if( m_applCol[i] )
-		{
-			if( m_applCol[i] == m_lastClickedCol )
-			{
-				m_lastClickedCol = NULL;
-				m_lastClickedRow = NULL;
-			}
-
-			delete m_applCol[i];
-			m_applCol[i] = 0;
-		}
+		m_applCol[i] = NULL;
 	}
 
 	m_allocatedColCount = 0;
@@ -2489,7 +2476,7 @@ void SjAlbumBrowser::CalcPositions()
 		// allocate column object for this column
 		if( m_applColIndex+i < m_applColCount )
 		{
-			m_applCol[i] = g_mainFrame->m_columnMixer.GetMaskedCol(m_applColIndex+i);
+			m_applCol[i] = GetCachedCol(m_applColIndex+i);
 		}
 		else
 		{
@@ -2536,3 +2523,155 @@ void SjAlbumBrowser::CalcPositions()
 		g_mainFrame->SetSkinAzValues('a');
 	}
 }
+
+
+/*******************************************************************************
+ * Column Cache
+ ******************************************************************************/
+
+
+void SjAlbumBrowser::ClearColCache()
+{
+	SjAlbumColCacheEntry *entry = m_colCacheFirst, *next;
+	while( entry )
+	{
+		next = entry->m_next;
+		delete entry->m_col;
+		delete entry;
+		entry = next;
+	}
+
+	m_colCache.Clear();
+	m_colCacheFirst = NULL;
+	m_colCacheLast = NULL;
+	m_colCacheGeneration = g_mainFrame? g_mainFrame->m_columnMixer.GetGeneration() : -1;
+
+	// the pointers may refer to deleted objects now
+	m_lastClickedCol = NULL;
+	m_lastClickedRow = NULL;
+	m_lastTooltipCol = NULL;
+	m_lastTooltipRow = NULL;
+}
+
+
+bool SjAlbumBrowser::IsColVisible(SjCol* col) const
+{
+	for( int i = 0; i < m_allocatedColCount; i++ )
+	{
+		if( m_applCol[i] == col )
+			return true;
+	}
+	return false;
+}
+
+
+SjCol* SjAlbumBrowser::GetCachedCol(long index)
+{
+	// cached columns may be invalid if the column mixer has changed
+	if( m_colCacheGeneration != g_mainFrame->m_columnMixer.GetGeneration() )
+	{
+		memset(m_applCol, 0, MAX_COL_COUNT*sizeof(SjCol*));
+		ClearColCache();
+	}
+
+	// column in cache?
+	SjAlbumColCacheEntry* entry = (SjAlbumColCacheEntry*)m_colCache.Lookup(index);
+	if( entry )
+	{
+		if( entry != m_colCacheFirst )
+		{
+			// move entry to the front of the list
+			entry->m_prev->m_next = entry->m_next;
+			if( entry->m_next )
+				entry->m_next->m_prev = entry->m_prev;
+			else
+				m_colCacheLast = entry->m_prev;
+
+			entry->m_prev = NULL;
+			entry->m_next = m_colCacheFirst;
+			m_colCacheFirst->m_prev = entry;
+			m_colCacheFirst = entry;
+		}
+		return entry->m_col;
+	}
+
+	// no, create a new column
+	SjCol* col = g_mainFrame->m_columnMixer.GetMaskedCol(index);
+	if( col == NULL )
+		return NULL;
+
+	// make room for the new column; columns currently in use are never removed
+	SjAlbumColCacheEntry* victim = m_colCacheLast;
+	while( m_colCache.GetCount() >= MAX_CACHED_COL_COUNT && victim )
+	{
+		SjAlbumColCacheEntry* prev = victim->m_prev;
+		if( !IsColVisible(victim->m_col) )
+		{
+			if( victim->m_prev ) victim->m_prev->m_next = victim->m_next; else m_colCacheFirst = victim->m_next;
+			if( victim->m_next ) victim->m_next->m_prev = victim->m_prev; else m_colCacheLast = victim->m_prev;
+			m_colCache.Remove(victim->m_index);
+
+			if( victim->m_col == m_lastClickedCol )
+			{
+				m_lastClickedCol = NULL;
+				m_lastClickedRow = NULL;
+			}
+
+			if( victim->m_col == m_lastTooltipCol )
+			{
+				m_lastTooltipCol = NULL;
+				m_lastTooltipRow = NULL;
+			}
+
+			delete victim->m_col;
+			delete victim;
+		}
+		victim = prev;
+	}
+
+	// add the new column to the front of the list
+	entry = new SjAlbumColCacheEntry;
+	entry->m_index = index;
+	entry->m_col = col;
+	entry->m_prev = NULL;
+	entry->m_next = m_colCacheFirst;
+	if( m_colCacheFirst )
+		m_colCacheFirst->m_prev = entry;
+	else
+		m_colCacheLast = entry;
+	m_colCacheFirst = entry;
+	m_colCache.Insert(index, entry);
+
+	return col;
+}
+
+
+bool SjAlbumBrowser::OnIdle()
+{
+	// prefetch the columns of the next and of the previous page so that scrolling
+	// needs no database access; we create only one column per call to keep the
+	// program responsive.  The columns nearest to the visible ones are created first.
+	if( m_allocatedColCount <= 0
+	 || m_colCacheGeneration != g_mainFrame->m_columnMixer.GetGeneration() )
+	{
+		return false;
+	}
+
+	long pageCols = m_allocatedColCount, i, index;
+	for( i = 0; i < pageCols; i++ )
+	{
+		index = m_applColIndex + pageCols + i;
+		if( index < m_applColCount && m_colCache.Lookup(index) == NULL )
+		{
+			return GetCachedCol(index)!=NULL;
+		}
+
+		index = m_applColIndex - 1 - i;
+		if( index >= 0 && m_colCache.Lookup(index) == NULL )
+		{
+			return GetCachedCol(index)!=NULL;
+		}
+	}
+
+	return false;
+}
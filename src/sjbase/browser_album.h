@@ -32,6 +32,16 @@
 
 
 
+class SjAlbumColCacheEntry
+{
+public:
+	long            m_index;
+	SjCol*          m_col;
+	SjAlbumColCacheEntry* m_prev;           // the previous entry is used more recently
+	SjAlbumColCacheEntry* m_next;
+};
+
+
 class SjAlbumBrowser : public SjBrowserBase
 {
 public:
@@ -78,6 +88,7 @@ public:
 	void            DoPaint             (wxDC&);
 	void            OnSize              (wxSizeEvent& event);
 	void            OnImageThere        (SjImageThereEvent& event);
+	bool            OnIdle              ();
 
 private:
 	// setting the scrollbars
@@ -127,7 +138,19 @@ private:
 	long            m_applColCount;         // the real number of colums available by SjColumnMixer::GetMaskedCol()
 	long            m_applColIndex;         // the SjColumnMixer index of the first column visible
 	#define         MAX_COL_COUNT 64        // MAX_COL_COUNT is the max. number of columns visible the SAME time
-	SjCol*          m_applCol[MAX_COL_COUNT];
+	SjCol*          m_applCol[MAX_COL_COUNT];// the objects are owned by the column cache
+
+	// the column cache holds the visible columns and, as far as prefetched
+	// on idle, the columns of the previous and the next page.  The cache is
+	// cleared on Realize() and if the column mixer's generation changes.
+	#define         MAX_CACHED_COL_COUNT (MAX_COL_COUNT*4)
+	SjCol*          GetCachedCol        (long index);
+	void            ClearColCache       ();
+	bool            IsColVisible        (SjCol*) const;
+	SjLPHash        m_colCache;             // column index -> SjAlbumColCacheEntry
+	SjAlbumColCacheEntry* m_colCacheFirst;  // the most recently used entry
+	SjAlbumColCacheEntry* m_colCacheLast;   // the least recently used entry, removed first
+	long            m_colCacheGeneration;
 
 	long            m_visibleColCount;      // the number of COMPLETELY visible columns
 	long            m_allocatedColCount;    // the number of COMPLETELY OR PARTLY visible columns,
@@ -131,6 +131,7 @@ SjListBrowser::SjListBrowser(SjBrowserWindow* w)
 	m_columnDragIndex = -1;
 	m_lastContextMenuTrackIndex = -1;
 	m_visibleTrackCount = 1;
+	m_fontHeight = 0;
 	m_tracksNeededToFitCoverHeight = -1;
 	m_lastClickedCover = NULL;
 
@@ -329,12 +330,16 @@ void SjListBrowser::Exit()
 
 	SaveConfig();
 	ClearTooltips();
+	ClearRowCache();
 	FreeAllocatedCover();
 }
 
 
 void SjListBrowser::Realize(bool reloadColumnMixer, bool keepColIndex)
 {
+	// the track data may have changed
+	ClearRowCache();
+
 	// first, calculate the number of rows needed to fit the height of a cover
 	CalculateFontHeight();
 	long tracksNeededToFitCoverHeight = 0;
@@ -374,8 +379,10 @@ void SjListBrowser::Realize(bool reloadColumnMixer, bool keepColIndex)
 void SjListBrowser::CalculateFontHeight()
 {
 	wxClientDC  dc(m_window);
-	int dummy2;
+	int dummy2, oldFontHeight = m_fontHeight;
 	m_window->GetFontPxSizes(dc, m_fontVDiff, dummy2, m_fontHeight);
+	if( m_fontHeight != oldFontHeight )
+		ClearRowCache(); // the ellipsized values depend on the fonts
 
 	// map base cover percentage from GetBaseCoverHeight() to the number of lines
 	static const int s_covers[11] = { 3, 3, 4, 4, 5, 5, 6, 6, 7, 7/*def*/, 8 };
@@ -1493,12 +1500,29 @@ void SjListBrowser::OnVScroll(int nScrollCode, int nPos, bool redraw)
 
 	if( newIndex != m_scrollPos )
 	{
+		long diff = newIndex - m_scrollPos;
 		m_scrollPos = newIndex;
 		SetVScrollInfo();
 
 		if( redraw )
 		{
-			m_window->Refresh(FALSE, &m_tracksRect);
+			if( diff > -m_visibleTrackCount && diff < m_visibleTrackCount )
+			{
+				// move the tracks still visible and draw only the new ones
+				wxRect scrollRect = m_tracksRect;
+				m_window->ScrollWindow(0, -diff*m_fontHeight, &scrollRect);
+
+				// redraw the row partly visible before (scrolling down) or the row that
+				// was the first one (scrolling up, it may need a separator line now)
+				wxRect rowRect = m_tracksRect;
+				rowRect.y += diff>0? (m_visibleTrackCount-diff)*m_fontHeight : -diff*m_fontHeight;
+				rowRect.height = m_fontHeight;
+				m_window->Refresh(FALSE, &rowRect);
+			}
+			else
+			{
+				m_window->Refresh(FALSE, &m_tracksRect);
+			}
 
 			if( m_flags&SJ_BROWSER_VIEW_COVER )
 			{
@@ -1796,6 +1820,162 @@ void SjListBrowser::OnImageThere(SjImageThereEvent& event)
 }
 
 
+/*******************************************************************************
+ * Row Cache
+ ******************************************************************************/
+
+
+#define ROW_CACHE_MAX_ROWS  1024
+
+
+class SjListCell
+{
+public:
+	long            m_field;        // SJ_TI_*
+	wxString        m_value;        // the formatted value
+	long            m_width;        // the width m_drawnValue is calculated for, -1 if not yet drawn
+	wxString        m_drawnValue;   // the value as drawn, maybe ellipsized
+	long            m_drawnWidth;
+	bool            m_truncated;
+};
+
+
+class SjListRow
+{
+public:
+	                ~SjListRow          ();
+	SjListCell*     GetCell             (long field);
+	SjListCell*     AddCell             (long field, const wxString& value);
+	long            m_albumId;
+	wxString        m_url;              // needed for the queue position which is never cached
+	long            m_azField;
+	int             m_az;               // first character of the sort field, 'z'+1 for others, 0 if not possible
+
+private:
+	wxArrayPtrVoid  m_cells;
+};
+
+
+SjListRow::~SjListRow()
+{
+	int i, iCount = m_cells.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		delete (SjListCell*)m_cells[i];
+	}
+}
+
+
+SjListCell* SjListRow::GetCell(long field)
+{
+	int i, iCount = m_cells.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		if( ((SjListCell*)m_cells[i])->m_field == field )
+			return (SjListCell*)m_cells[i];
+	}
+	return NULL;
+}
+
+
+SjListCell* SjListRow::AddCell(long field, const wxString& value)
+{
+	SjListCell* cell = new SjListCell;
+	cell->m_field      = field;
+	cell->m_value      = value;
+	cell->m_width      = -1;
+	cell->m_drawnWidth = 0;
+	cell->m_truncated  = false;
+	m_cells.Add(cell);
+	return cell;
+}
+
+
+static int getAz(const SjTrackInfo& ti, long sortField)
+{
+	if( !isAzPossibleForCol(sortField) ) // can sort by A-Z?
+		return 0;
+
+	wxString str = SjNormaliseString(ti.GetFormattedValue(sortField), 0);
+	int az = str.Len()? str[0] : 'z'+1;
+	if( az < 'a' || az > 'z' )
+	{
+		az = 'z'+1;
+	}
+	return az;
+}
+
+
+SjListRow* SjListBrowser::GetRow(long offset)
+{
+	// row already cached with all needed columns?
+	long trackId = m_listView->GetTrackId(offset);
+	SjListRow* row = (SjListRow*)m_rowCache.Lookup(trackId);
+	if( row )
+	{
+		bool complete = (row->m_azField == m_sortField);
+		int col, colCount = m_columns.GetCount();
+		for( col = 0; col < colCount && complete; col++ )
+		{
+			if( row->GetCell(m_columns[col]) == NULL )
+				complete = false;
+		}
+
+		if( complete )
+			return row;
+	}
+
+	// (re-)load the track; existing cells are kept
+	SjTrackInfo ti;
+	long        tiAlbumId = 0, tiSpecial;
+	m_listView->GetTrack(offset, ti, tiAlbumId, tiSpecial);
+
+	if( row == NULL )
+	{
+		if( m_rowCache.GetCount() >= ROW_CACHE_MAX_ROWS )
+			ClearRowCache();
+
+		row = new SjListRow;
+		m_rowCache.Insert(trackId, row);
+	}
+
+	row->m_albumId = tiAlbumId;
+	row->m_url     = ti.m_url;
+	row->m_azField = m_sortField;
+	row->m_az      = getAz(ti, m_sortField);
+
+	int col, colCount = m_columns.GetCount();
+	for( col = 0; col < colCount; col++ )
+	{
+		if( row->GetCell(m_columns[col]) == NULL )
+			row->AddCell(m_columns[col], ti.GetFormattedValue(m_columns[col]));
+	}
+
+	return row;
+}
+
+
+void SjListBrowser::ClearRowCache()
+{
+	SjHashIterator  iterator;
+	SjListRow*      row;
+	long            trackId;
+	while( (row=(SjListRow*)m_rowCache.Iterate(iterator, &trackId)) )
+	{
+		delete row;
+	}
+	m_rowCache.Clear();
+}
+
+
+void SjListBrowser::InvalidateTrack(long trackId)
+{
+	SjListRow* row = (SjListRow*)m_rowCache.Remove(trackId);
+	if( row )
+		delete row;
+}
+
+
 void SjListBrowser::DoPaintHeader(wxDC& dc, long x, long y, long w, long h, bool addTooltips)
 {
 	dc.SetPen(*wxTRANSPARENT_PEN);
@@ -1893,30 +2073,19 @@ void SjListBrowser::DoPaintHeader(wxDC& dc, long x, long y, long w, long h, bool
 void SjListBrowser::DoPaintTrack(wxDC& dc, long x, long y, long w, long h, long offset,
                                  bool& lastTrackSelected,
                                  bool addTooltips, bool setAz, int* lastAz,
-                                 wxArrayLong* retLinePos, wxArrayLong* retAlbumIds)
+                                 wxArrayLong* retLinePos, wxArrayLong* retAlbumIds, bool draw)
 {
-	SjTrackInfo  ti;
-	// get the track information
-	long tiAlbumId, tiSpecial;
-	m_listView->GetTrack(offset, ti, tiAlbumId, tiSpecial);
+	// get the track information; if draw is false, only the A-Z state, the tooltips etc. are updated
+	SjListRow* row = GetRow(offset);
+	long tiSpecial = m_listView->GetTrackSpecial(offset);
 	bool tiGap = (tiSpecial&SJ_LISTVIEW_SPECIAL_GAP)!=0;
 	bool tiSelected = m_listView->IsTrackSelected(offset);
 	if( retAlbumIds )
-		retAlbumIds->Add(tiSpecial&SJ_LISTVIEW_SPECIAL_FIRST_TRACK? tiAlbumId : 0);
+		retAlbumIds->Add(tiSpecial&SJ_LISTVIEW_SPECIAL_FIRST_TRACK? row->m_albumId : 0);
 
 	// set A-Z
 	bool hiliteFirstChar = false;
-	wxString str;
-	int thisAz = 0;
-	if( isAzPossibleForCol(m_sortField) ) // can sort by A-Z?
-	{
-		str = SjNormaliseString(ti.GetFormattedValue(m_sortField), 0);
-		thisAz = str.Len()? str[0] : 'z'+1;
-		if( thisAz < 'a' || thisAz > 'z' )
-		{
-			thisAz = 'z'+1;
-		}
-	}
+	int thisAz = row->m_az;
 
 	if( lastAz != NULL
 	 && thisAz
@@ -1955,6 +2124,7 @@ void SjListBrowser::DoPaintTrack(wxDC& dc, long x, long y, long w, long h, long
 	wxRect drawRect;
 	int col, colCount = m_columns.GetCount();
 	long currX = x, field;
+	SjListCell* cell;
 	wxFont* largeFont;
 	wxFont* boldFont;
 	bool showNumpadNumbers = (g_kioskModule && g_accelModule && g_accelModule->UseNumpad());
@@ -1962,7 +2132,20 @@ void SjListBrowser::DoPaintTrack(wxDC& dc, long x, long y, long w, long h, long
 	{
 		// get information
 		field = m_columns[col];
-		str = ti.GetFormattedValue(field);
+		cell = row->GetCell(field);
+		wxASSERT( cell );
+		if( field == SJ_TI_Y_QUEUEPOS )
+		{
+			// the queue position changes without any notification
+			SjTrackInfo ti;
+			ti.m_url = row->m_url;
+			wxString str = ti.GetFormattedValue(field);
+			if( str != cell->m_value )
+			{
+				cell->m_value = str;
+				cell->m_width = -1;
+			}
+		}
 		if( showNumpadNumbers && field == SJ_TI_TRACKNR )
 		{
 			// TODO: hier sollte mal die "richtige" nummer im Numpad-Modus angezeigt werden ...
@@ -1988,28 +2171,45 @@ void SjListBrowser::DoPaintTrack(wxDC& dc, long x, long y, long w, long h, long
 		drawRect.width = m_columnWidths[col];
 
 		// draw background
-		bool drawLine = false;
-		if( lastTrackSelected && tiSelected && !tiGap )
+		if( draw )
 		{
-			dc.SetPen(g_mainFrame->m_workspaceColours[SJ_COLOUR_NORMAL].bgPen);
-			dc.DrawLine(drawRect.x, drawRect.y, drawRect.x+drawRect.width, drawRect.y);
-			dc.SetPen(*wxTRANSPARENT_PEN);
-			drawLine = true;
-		}
+			bool drawLine = false;
+			if( lastTrackSelected && tiSelected && !tiGap )
+			{
+				dc.SetPen(g_mainFrame->m_workspaceColours[SJ_COLOUR_NORMAL].bgPen);
+				dc.DrawLine(drawRect.x, drawRect.y, drawRect.x+drawRect.width, drawRect.y);
+				dc.SetPen(*wxTRANSPARENT_PEN);
+				drawLine = true;
+			}
 
-		dc.DrawRectangle(drawRect.x, drawRect.y+(drawLine?1:0), drawRect.width, drawRect.height-(drawLine?1:0));
+			dc.DrawRectangle(drawRect.x, drawRect.y+(drawLine?1:0), drawRect.width, drawRect.height-(drawLine?1:0));
+		}
 
-		// draw text
+		// draw text; the ellipsized text is calculated only once for each width
 		if( !tiGap )
 		{
 			drawRect.width -= 2;
-			if( g_tools->DrawSingleLineText(dc, str, drawRect, *largeFont, g_mainFrame->m_currSmallFont,
-			                                (hiliteFirstChar && m_sortField==field)? boldFont : NULL,
-			                                colour->hiColour) )
+			if( cell->m_width != drawRect.width )
 			{
-				if( addTooltips )
-					AddToTooltips(drawRect, str);
+				cell->m_width = drawRect.width;
+				cell->m_truncated = g_tools->DrawSingleLineText(dc, cell->m_value, drawRect, *largeFont, g_mainFrame->m_currSmallFont,
+				                    (hiliteFirstChar && m_sortField==field)? boldFont : NULL,
+				                    colour->hiColour, &cell->m_drawnValue);
+				cell->m_drawnWidth = drawRect.width;
 			}
+			else
+			{
+				if( draw )
+				{
+					g_tools->DrawSingleLineText(dc, cell->m_drawnValue, drawRect, *largeFont, g_mainFrame->m_currSmallFont,
+					                            (hiliteFirstChar && m_sortField==field)? boldFont : NULL,
+					                            colour->hiColour);
+				}
+				drawRect.width = cell->m_drawnWidth;
+			}
+
+			if( cell->m_truncated && addTooltips )
+				AddToTooltips(drawRect, cell->m_value);
 		}
 
 		// next
@@ -2017,7 +2217,7 @@ void SjListBrowser::DoPaintTrack(wxDC& dc, long x, long y, long w, long h, long
 	}
 
 	// draw space aright
-	if( currX < x+w )
+	if( currX < x+w && draw )
 	{
 		dc.SetBrush(g_mainFrame->m_workspaceColours[SJ_COLOUR_NORMAL].bgBrush);
 		dc.DrawRectangle(currX, y, (x+w)-currX, h);
@@ -2027,8 +2227,11 @@ void SjListBrowser::DoPaintTrack(wxDC& dc, long x, long y, long w, long h, long
 	if( (tiSpecial&SJ_LISTVIEW_SPECIAL_LAST_GAP) && retLinePos )
 	{
 		long lineY = y + m_fontHeight/2;
-		dc.SetPen(g_mainFrame->m_workspaceColours[SJ_COLOUR_NORMAL].fgPen);
-		dc.DrawLine(m_tracksRect.x, lineY, m_tracksRect.x+m_tracksRect.width, lineY);
+		if( draw )
+		{
+			dc.SetPen(g_mainFrame->m_workspaceColours[SJ_COLOUR_NORMAL].fgPen);
+			dc.DrawLine(m_tracksRect.x, lineY, m_tracksRect.x+m_tracksRect.width, lineY);
+		}
 		if( retLinePos )
 			retLinePos->Add(lineY);
 	}
@@ -2039,7 +2242,7 @@ void SjListBrowser::DoPaintTrack(wxDC& dc, long x, long y, long w, long h, long
 
 
 void SjListBrowser::DoPaintHeaderNTracks(wxDC& dc, long x, long y_, long w, long h, bool addTooltips,
-        wxArrayLong* retLinePos, wxArrayLong* retAlbumIds)
+        wxArrayLong* retLinePos, wxArrayLong* retAlbumIds, const wxRegion* updateRegion)
 {
 	// draw header
 	long currY = y_;
@@ -2050,29 +2253,21 @@ void SjListBrowser::DoPaintHeaderNTracks(wxDC& dc, long x, long y_, long w, long
 	int lastAz = 0;
 	if( m_scrollPos > 0 && isAzPossibleForCol(m_sortField) )
 	{
-		SjTrackInfo  ti;
-		long         tiAlbumId, tiSpecial;
-		m_listView->GetTrack(m_scrollPos-1, ti, tiAlbumId, tiSpecial);
-
-		wxString str = SjNormaliseString(ti.GetFormattedValue(m_sortField), 0);
-		lastAz = str.Len()? str[0] : 'z'+1;
-		if( lastAz < 'a' || lastAz > 'z' )
-		{
-			lastAz = 'z'+1;
-		}
+		lastAz = GetRow(m_scrollPos-1)->m_az;
 	}
 
-	// draw all tracks
+	// draw all tracks; tracks outside the update region are not drawn, however, they're needed for the tooltips etc.
 	long index = m_scrollPos;
 	bool lastTrackSelected = false;
 	long listViewTrackCount = m_listView->GetTrackCount();
 	while( currY < m_window->m_clientH && index < listViewTrackCount )
 	{
+		bool draw = (updateRegion==NULL || updateRegion->Contains(m_tracksRect.x, currY, m_tracksRect.width, m_fontHeight)!=wxOutRegion);
 		DoPaintTrack(dc, x, currY, w, m_fontHeight, index,
 		             lastTrackSelected /*used internally*/,
 		             addTooltips, (index==m_scrollPos)/*set Az?*/,
 		             &lastAz /*used internally*/,
-		             retLinePos, retAlbumIds);
+		             retLinePos, retAlbumIds, draw);
 
 		// next
 		index++;
@@ -2147,8 +2342,9 @@ void SjListBrowser::DoPaint(wxDC& dc)
 
 	wxArrayLong linePos;
 	wxArrayLong albumIds;
+	wxRegion updateRegion = m_window->GetUpdateRegion();
 	DoPaintHeaderNTracks(dc, workspaceRect.x-m_tracksHScroll, workspaceRect.y, w, workspaceRect.height,
-	                     true /*add tooltips*/, &linePos, &albumIds);
+	                     true /*add tooltips*/, &linePos, &albumIds, &updateRegion);
 
 	dc.DestroyClippingRegion();
 
@@ -33,6 +33,7 @@
 
 
 class SjListTooltip;
+class SjListRow;
 class SjImageThereEvent;
 
 
@@ -55,6 +56,7 @@ public:
 	void            GetOrder            (long& sortField, bool& desc) const {sortField=m_sortField; desc=m_sortDesc;}
 	void            SetColumns          (const wxArrayLong&);
 	wxArrayLong     GetColumns          () const {return m_columns;}
+	void            InvalidateTrack     (long trackId); // call if the data of a track are changed without RefreshAll()
 
 	// mouse handling
 	void            OnMouseLeftDown     (wxMouseEvent& event);
@@ -120,9 +122,9 @@ private:
 	int             m_coverW;
 	long            m_sortField; // value from SJ_TI_*
 	bool            m_sortDesc;
-	void            DoPaintHeaderNTracks(wxDC& dc, long x, long y, long w, long h, bool addTooltips, wxArrayLong* retLinePos=NULL, wxArrayLong* retAlbumIds=NULL);
+	void            DoPaintHeaderNTracks(wxDC& dc, long x, long y, long w, long h, bool addTooltips, wxArrayLong* retLinePos=NULL, wxArrayLong* retAlbumIds=NULL, const wxRegion* updateRegion=NULL);
 	void            DoPaintHeader(wxDC& dc, long x, long y, long w, long h, bool addTooltips);
-	void            DoPaintTrack(wxDC& dc, long x, long y, long w, long h, long offset, bool& lastTrackSelected, bool addTooltips, bool setAz, int* lastAz, wxArrayLong* retLinePos=NULL, wxArrayLong* retAlbumIds=NULL);
+	void            DoPaintTrack(wxDC& dc, long x, long y, long w, long h, long offset, bool& lastTrackSelected, bool addTooltips, bool setAz, int* lastAz, wxArrayLong* retLinePos=NULL, wxArrayLong* retAlbumIds=NULL, bool draw=true);
 	void            CalculateFontHeight();
 	void            CalculatePositions(bool calculateFontHeight=true);
 	void            OnHScroll(int nScrollCode, int nPos, bool redraw);
@@ -177,6 +179,12 @@ private:
 	void            ClearTooltips();
 	SjListTooltip*  FindTooltip(int mouseX, int mouseY);
 
+	// the rows by the track ID with the formatted and the ellipsized values;
+	// cleared on Realize() and if the fonts change, the column widths are checked by DoPaintTrack()
+	SjLPHash        m_rowCache;
+	SjListRow*      GetRow              (long offset);
+	void            ClearRowCache       ();
+
 	// misc.
 	long            m_tracksNeededToFitCoverHeight;
 
@@ -41,6 +41,7 @@ SjColumnMixer::SjColumnMixer()
 	m_selAnchorColIndex = -1;
 	m_maskedColCount = 0;
 	m_unmaskedColCount = 0;
+	m_generation = 0;
 }
 
 
@@ -99,6 +100,7 @@ void SjColumnMixer::UnloadModules()
 
 	m_moduleCount = 0;
 	m_libraryModule = NULL;
+	m_quickInfoCache.Clear();
 
 	SetColCount__();
 }
@@ -107,6 +109,7 @@ void SjColumnMixer::UnloadModules()
 
 void SjColumnMixer::ReloadColumns()
 {
+	m_quickInfoCache.Clear(); // called after library updates, the information may have changed
 	SetColCount__();
 }
 
@@ -198,8 +201,35 @@ SjSearchStat SjColumnMixer::SetSearch(const SjSearch& search, bool deepSearch)
 }
 
 
+bool SjColumnMixer::StartSearch(const SjSearch& search)
+{
+	// searching in the background is only supported by the library;
+	// if there are other modules, we search synchronously
+	if( m_moduleCount != 1 || m_modules[0] != m_libraryModule )
+	{
+		return false;
+	}
+
+	return ((SjLibraryModule*)m_libraryModule)->StartSearch(search);
+}
+
+
+bool SjColumnMixer::FinishSearch(SjSearchStat& retStat)
+{
+	if( m_libraryModule == NULL
+	 || !((SjLibraryModule*)m_libraryModule)->FinishSearch(retStat) )
+	{
+		return false;
+	}
+
+	SetColCount__();
+	return true;
+}
+
+
 void SjColumnMixer::SetColCount__()
 {
+	m_generation++;
 	m_maskedColCount = 0;
 	m_unmaskedColCount = 0;
 	m_selAnchorColIndex = -1;
@@ -818,6 +848,127 @@ bool SjColumnMixer::PrevNextRow(long& colIndex, long& rowIndex, int dir)
 }
 
 
+/*******************************************************************************
+ * SjQuickInfoCache
+ ******************************************************************************/
+
+
+SjQuickInfoCache::SjQuickInfoCache()
+{
+	m_first = NULL;
+	m_last  = NULL;
+}
+
+
+void SjQuickInfoCache::CopyInfo(SjQuickInfo& dest, const SjQuickInfo& src)
+{
+	// the strings may be used by another thread, so do not share the buffers
+	dest.m_trackName        = wxString(src.m_trackName.c_str());
+	dest.m_leadArtistName   = wxString(src.m_leadArtistName.c_str());
+	dest.m_albumName        = wxString(src.m_albumName.c_str());
+	dest.m_playtimeMs       = src.m_playtimeMs;
+	dest.m_fromTags         = src.m_fromTags;
+}
+
+
+void SjQuickInfoCache::Unlink(SjQuickInfoCacheEntry* e)
+{
+	if( e->m_prev ) e->m_prev->m_next = e->m_next; else m_first = e->m_next;
+	if( e->m_next ) e->m_next->m_prev = e->m_prev; else m_last = e->m_prev;
+	e->m_prev = NULL;
+	e->m_next = NULL;
+}
+
+
+void SjQuickInfoCache::LinkFirst(SjQuickInfoCacheEntry* e)
+{
+	e->m_prev = NULL;
+	e->m_next = m_first;
+	if( m_first ) m_first->m_prev = e; else m_last = e;
+	m_first = e;
+}
+
+
+bool SjQuickInfoCache::Lookup(const wxString& url, SjQuickInfo& ret)
+{
+	wxCriticalSectionLocker locker(m_critical);
+
+	SjQuickInfoCacheEntry* e = (SjQuickInfoCacheEntry*)m_hash.Lookup(url);
+	if( e == NULL )
+		return false;
+
+	if( e != m_first )
+	{
+		Unlink(e);
+		LinkFirst(e);
+	}
+
+	CopyInfo(ret, *e);
+	return true;
+}
+
+
+void SjQuickInfoCache::Insert(const wxString& url, const SjQuickInfo& info)
+{
+	wxCriticalSectionLocker locker(m_critical);
+
+	SjQuickInfoCacheEntry* e = (SjQuickInfoCacheEntry*)m_hash.Lookup(url);
+	if( e )
+	{
+		Unlink(e);
+	}
+	else
+	{
+		// remove the least recently used entry, if the cache is full
+		if( m_hash.GetCount() >= SJ_QUICKINFO_MAX_ENTRIES && m_last )
+		{
+			SjQuickInfoCacheEntry* old = m_last;
+			Unlink(old);
+			m_hash.Remove(old->m_url);
+			delete old;
+		}
+
+		e = new SjQuickInfoCacheEntry;
+		e->m_url = wxString(url.c_str());
+		m_hash.Insert(e->m_url, e);
+	}
+
+	CopyInfo(*e, info);
+	LinkFirst(e);
+}
+
+
+void SjQuickInfoCache::Remove(const wxString& url)
+{
+	wxCriticalSectionLocker locker(m_critical);
+
+	SjQuickInfoCacheEntry* e = (SjQuickInfoCacheEntry*)m_hash.Remove(url);
+	if( e )
+	{
+		Unlink(e);
+		delete e;
+	}
+}
+
+
+void SjQuickInfoCache::Clear()
+{
+	wxCriticalSectionLocker locker(m_critical);
+
+	SjQuickInfoCacheEntry *e = m_first, *next;
+	while( e )
+	{
+		next = e->m_next;
+		delete e;
+		e = next;
+	}
+
+	m_hash.Clear();
+	m_first = NULL;
+	m_last  = NULL;
+}
+
+
 /*******************************************************************************
  * Get Column/Row Information
  ******************************************************************************/
@@ -827,22 +978,31 @@ bool SjColumnMixer::GetQuickInfo(const wxString& url,
                                  wxString& trackName, wxString& leadArtistName, wxString& albumName,
                                  long& playtimeMs)
 {
-	int  m;
-	bool ok = FALSE;
+	int         m;
+	bool        ok;
+	SjQuickInfo info;
 
-	m_tempInfo.m_trackName.Empty();
-	m_tempInfo.m_leadArtistName.Empty();
-	m_tempInfo.m_playtimeMs = 0;
+	// first, try the cache; information read from the tags do not count
+	// as known, the URL may be added to a module in between
+	ok = m_quickInfoCache.Lookup(url, info) && !info.m_fromTags;
 
-	// first, try the "A-Z" module (normally the largest module)
-	if( m_libraryModule )
+	// then, try the "A-Z" module (normally the largest module, this also adds the information to the cache)
+	if( !ok && m_libraryModule )
 	{
-		ok = m_libraryModule->GetTrackInfo(url, m_tempInfo, SJ_TI_QUICKINFO, FALSE/*no log*/);
+		wxArrayString urls;
+		urls.Add(url);
+		((SjLibraryModule*)m_libraryModule)->LoadQuickInfo(urls, m_quickInfoCache);
+		ok = m_quickInfoCache.Lookup(url, info) && !info.m_fromTags;
 	}
 
 	// then, try the other modules
 	if( !ok )
 	{
+		m_tempInfo.m_trackName.Empty();
+		m_tempInfo.m_leadArtistName.Empty();
+		m_tempInfo.m_albumName.Empty();
+		m_tempInfo.m_playtimeMs = 0;
+
 		for( m = 0; m < m_moduleCount; m++ )
 		{
 			wxASSERT(m_modules[m]);
@@ -851,6 +1011,12 @@ bool SjColumnMixer::GetQuickInfo(const wxString& url,
 				ok = m_modules[m]->GetTrackInfo(url, m_tempInfo, SJ_TI_QUICKINFO, FALSE/*no log*/);
 				if( ok )
 				{
+					info.m_trackName = m_tempInfo.m_trackName;
+					info.m_leadArtistName = m_tempInfo.m_leadArtistName;
+					info.m_albumName = m_tempInfo.m_albumName;
+					info.m_playtimeMs = m_tempInfo.m_playtimeMs;
+					info.m_fromTags = false;
+					m_quickInfoCache.Insert(url, info);
 					break;
 				}
 			}
@@ -860,10 +1026,10 @@ bool SjColumnMixer::GetQuickInfo(const wxString& url,
 	// done so far
 	if( ok )
 	{
-		trackName = m_tempInfo.m_trackName;
-		leadArtistName = m_tempInfo.m_leadArtistName;
-		albumName = m_tempInfo.m_albumName;
-		playtimeMs = m_tempInfo.m_playtimeMs;
+		trackName = info.m_trackName;
+		leadArtistName = info.m_leadArtistName;
+		albumName = info.m_albumName;
+		playtimeMs = info.m_playtimeMs;
 		return TRUE;
 	}
 	else
@@ -876,6 +1042,37 @@ bool SjColumnMixer::GetQuickInfo(const wxString& url,
 }
 
 
+void SjColumnMixer::WarmQuickInfo(const wxArrayString& urls)
+{
+	// load the information of all URLs not yet in cache with as few queries as possible
+	if( m_libraryModule == NULL )
+		return;
+
+	#define SJ_QUICKINFO_WARM_CHUNK 256
+	wxArrayString   chunk;
+	SjQuickInfo     dummy;
+	size_t          i, iCount = urls.GetCount();
+	if( iCount > SJ_QUICKINFO_MAX_ENTRIES/2 )
+		iCount = SJ_QUICKINFO_MAX_ENTRIES/2; // warming more would only remove the entries just loaded
+
+	for( i = 0; i < iCount; i++ )
+	{
+		if( !m_quickInfoCache.Lookup(urls[i], dummy) )
+		{
+			chunk.Add(urls[i]);
+			if( chunk.GetCount() >= SJ_QUICKINFO_WARM_CHUNK )
+			{
+				((SjLibraryModule*)m_libraryModule)->LoadQuickInfo(chunk, m_quickInfoCache);
+				chunk.Empty();
+			}
+		}
+	}
+
+	if( chunk.GetCount() )
+		((SjLibraryModule*)m_libraryModule)->LoadQuickInfo(chunk, m_quickInfoCache);
+}
+
+
 wxString SjColumnMixer::GetTrackCoverUrl(const wxString& trackUrl)
 {
 	int  m;
@@ -45,6 +45,51 @@ enum SjSelectedUrlsScope
 };
 
 
+class SjQuickInfo
+{
+public:
+	                SjQuickInfo         () { m_playtimeMs = 0; m_fromTags = false; }
+	wxString        m_trackName;
+	wxString        m_leadArtistName;
+	wxString        m_albumName;
+	long            m_playtimeMs;
+	bool            m_fromTags;             // true for information read from the file by SjPlaylistEntry, the URL is not known by any module
+};
+
+
+class SjQuickInfoCacheEntry : public SjQuickInfo
+{
+public:
+	wxString        m_url;
+	SjQuickInfoCacheEntry* m_prev;          // the previous entry is used more recently
+	SjQuickInfoCacheEntry* m_next;
+};
+
+
+class SjQuickInfoCache
+{
+public:
+	// a bounded URL -> SjQuickInfo cache; all functions may be called
+	// from any thread, the strings are always copied deeply
+	                SjQuickInfoCache    ();
+	                ~SjQuickInfoCache   () { Clear(); }
+	bool            Lookup              (const wxString& url, SjQuickInfo&);
+	void            Insert              (const wxString& url, const SjQuickInfo&);
+	void            Remove              (const wxString& url);
+	void            Clear               ();
+
+private:
+	#define         SJ_QUICKINFO_MAX_ENTRIES 4096
+	wxCriticalSection m_critical;
+	SjSPHash        m_hash;                 // URL -> SjQuickInfoCacheEntry
+	SjQuickInfoCacheEntry* m_first;         // the most recently used entry
+	SjQuickInfoCacheEntry* m_last;          // the least recently used entry, removed first
+	void            Unlink              (SjQuickInfoCacheEntry*);
+	void            LinkFirst           (SjQuickInfoCacheEntry*);
+	static void     CopyInfo            (SjQuickInfo& dest, const SjQuickInfo& src);
+};
+
+
 class SjColumnMixer
 {
 public:
@@ -58,6 +103,8 @@ public:
 
 	// search handling
 	SjSearchStat    SetSearch           (const SjSearch&, bool deepSearch);
+	bool            StartSearch         (const SjSearch&); // background search, see SjLibraryModule::StartSearch()
+	bool            FinishSearch        (SjSearchStat&);
 	static wxString GetAzDescr          (int targetIdOrChar);
 
 	// column- and cover-view handling, a retrieved SjCol object that is no longer needed should be deleted
@@ -65,6 +112,7 @@ public:
 	SjCol*          GetUnmaskedCol      (long index);
 
 	long            GetMaskedColCount   () {return m_maskedColCount;}
+	long            GetGeneration       () const {return m_generation;} // changes whenever the columns may have changed
 	long            GetMaskedColIndexByAz(int targetId);
 	long            GetMaskedColIndexByColUrl(const wxString& colUrl);
 	bool            GetMaskedColIndexByRow(SjRow*, long& colIndex, long& rowIndex);
@@ -89,6 +137,15 @@ public:
 	bool            GetQuickInfo        (const wxString& url, wxString& trackName, wxString& leadArtistName, wxString& albumName, long& playtimeMs);
 	wxString        GetTrackCoverUrl    (const wxString& url);
 
+	// the information returned by GetQuickInfo() are cached; WarmQuickInfo()
+	// loads the information for many URLs at once, InvalidateQuickInfo()
+	// should be called if the information for an URL may have changed
+	// (an empty URL invalidates everything).  information read from the tags
+	// are cached as well, however, GetQuickInfo() returns FALSE for them.
+	void            WarmQuickInfo       (const wxArrayString& urls);
+	void            InvalidateQuickInfo (const wxString& url) { if( url.IsEmpty() ) { m_quickInfoCache.Clear(); } else { m_quickInfoCache.Remove(url); } }
+	SjQuickInfoCache m_quickInfoCache;
+
 private:
 	#define         SJ_COLUNMMIXER_MAX_MODULES 16
 	long            m_moduleCount;
@@ -105,6 +162,8 @@ private:
 	long            m_maskedColCount;
 	long            m_moduleMaskedColCount[SJ_COLUNMMIXER_MAX_MODULES];
 
+	long            m_generation;
+
 	long            m_selAnchorColIndex,
 	                m_selAnchorRowIndex;
 	bool            GetSelectionAnchor  (long& colIndex, long& rowIndex);
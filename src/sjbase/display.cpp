@@ -655,7 +655,9 @@ void SjMainFrame::UpdateDisplay()
 
 			value.vmax  = totalMs/SJ_SEEK_RESOLUTION; if( value.vmax==0 ) value.vmax = 1;
 			value.value = elapsedMs/SJ_SEEK_RESOLUTION;
+			value.peaks = m_player.GetPeaks(m_player.GetUrlOnAir());
 			SetSkinTargetValue(IDT_SEEK, value);
+			value.peaks = NULL;
 		}
 		else
 		{
@@ -1006,6 +1008,9 @@ void SjMainFrame::OnElapsedTimeTimer(wxTimerEvent& event)
 	m_mainApp->ProcessPendingEvents();
 	#endif
 
+	// collect the items changed below and redraw them at once
+	BeginSkinTargetUpdates();
+
 	// display stuff
 	unsigned long   thisTimestamp = SjTools::GetMsTicks();
 	bool            displayOverlayUpdated = false, seekOverlayUpdated = false;
@@ -1085,6 +1090,7 @@ void SjMainFrame::OnElapsedTimeTimer(wxTimerEvent& event)
 				value.vmax      = totalMs/SJ_SEEK_RESOLUTION;
 				value.thumbSize = 0;
 				value.value     = elapsedMs/SJ_SEEK_RESOLUTION;
+				value.peaks     = m_player.GetPeaks(m_player.GetUrlOnAir());
 			}
 		}
 		SetSkinTargetValueIfPossible(IDT_SEEK, value); // "if possible" avoids update the target eg. if it conflicts with an drag'n'drop image
@@ -1158,6 +1164,8 @@ void SjMainFrame::OnElapsedTimeTimer(wxTimerEvent& event)
 
 Done:
 
+	EndSkinTargetUpdates();
+
 	// invoke auto control stuff
 	m_autoCtrl.OnOneSecondTimer();
 }
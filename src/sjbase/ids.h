@@ -309,6 +309,8 @@
 #define IDO_SCRIPT_MENU00       8613 /* range start */
 #define IDO_SCRIPT_MENU99       8712 /* range end */
 #define IDO_CONSOLE             8713
+#define IDO_SEARCHDONE          8714
+#define IDO_SKINBENCHMARK       8715
 /* take care, we're close to end! At 8800 the IDPLAYER_ IDs start! */
 
 /* [PLAYER] [ID]s, IDPLAYER_*, posted from SjPlayer -> SjMainFrame -> SjPlayer.OnPostBack()
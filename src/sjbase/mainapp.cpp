@@ -320,6 +320,9 @@ bool SjMainApp::OnInit()
 		// environment settings
 		{ wxCMD_LINE_SWITCH, NULL, wxT_2("skiperrors"),  wxT_2("Do not show startup errors") },
 		{ wxCMD_LINE_SWITCH, NULL, wxT_2("minimize"),    wxT_2("Start minimized") },
+		{ wxCMD_LINE_SWITCH, NULL, wxT_2("benchmark"),   wxT_2("Play the given file(s) without sound device, log the DSP throughput and exit") },
+		{ wxCMD_LINE_SWITCH, NULL, wxT_2("realtime"),    wxT_2("Use --benchmark in realtime instead of as fast as possible") },
+		{ wxCMD_LINE_SWITCH, NULL, wxT_2("skinbenchmark"), wxT_2("Replay paint and mouse events against the current skin, log the timings and exit") },
 		{ wxCMD_LINE_OPTION, NULL, wxT_2("kioskrect"),   wxT_2("Where to show the kiosk: DISPLAY|X,Y,W,H[,clipmouse]") },
 		{ wxCMD_LINE_OPTION, NULL, wxT_2("visrect"),     wxT_2("Where to show the video screen: DISPLAY|X,Y,W,H") },
 		{ wxCMD_LINE_OPTION, NULL, wxT_2("blackrect"),   wxT_2("Add black areas: DISPLAY|X,Y,W,H[;DISPLAY,X,Y,W,H;...]") },
@@ -531,6 +534,7 @@ int SjMainApp::OnExit()
 
 	/* shutdown HTTP-services
 	 */
+	SjHttp::CloseIdleConnections();
 	wxSocketBase::Shutdown();
 
 	/* done.
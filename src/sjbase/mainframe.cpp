@@ -156,6 +156,9 @@ void SjMainFrame::Enqueue(const wxArrayString& urls, long enqueuePos,
 		}
 	}
 
+	// load the information shown in the display and in the queue with few queries
+	m_columnMixer.WarmQuickInfo(urls);
+
 	// do what to do
 	m_display.m_selectedIds.Clear();
 	m_player.m_queue.Enqueue(urls, enqueuePos, urlsVerified, &m_display.m_selectedIds,
@@ -1052,6 +1055,9 @@ SjMainFrame::SjMainFrame(SjMainApp* mainApp, int id, long skinFlags, const wxPoi
 	SetWorkspaceWindow(m_browser);
 
 	m_inPerformingSearch = FALSE;
+	m_asyncSearchFlags = 0;
+	m_asyncSearchStartTime = 0;
+	m_asyncSearchGatherStatistics = FALSE;
 
 	m_simpleSearchInputFromUser = FALSE;
 
@@ -1153,6 +1159,14 @@ SjMainFrame::SjMainFrame(SjMainApp* mainApp, int id, long skinFlags, const wxPoi
 
 	m_player.Init();
 
+	if( m_player.IsBenchmark() )
+	{
+		// nothing should be added to the queue or stop the playback while benchmarking;
+		// the auto control settings are not saved in this case
+		m_autoCtrl.m_flags &= ~(SJ_AUTOCTRL_AUTOPLAY_ENABLED|SJ_AUTOCTRL_LIMIT_PLAY_TIME|SJ_AUTOCTRL_SLEEP);
+		m_autoCtrl.m_jingleFlags = 0;
+	}
+
 	m_showRemainingTime = g_tools->m_config->Read(wxT("main/showRemainingTime"), 1L)!=0;
 
 	/* (/) load other GUI modules, this sets MANY global pointers to the modules
@@ -1284,6 +1298,7 @@ SjMainFrame::SjMainFrame(SjMainApp* mainApp, int id, long skinFlags, const wxPoi
 
 		int commandId = SJ_OPENFILES_DEFCMD;
 		if( SjMainApp::s_cmdLine->Found(wxT("enqueue")) ) commandId = SJ_OPENFILES_ENQUEUE;
+		if( m_player.IsBenchmark() ) commandId = SJ_OPENFILES_PLAY; // replaces the queue, no resume file is loaded
 		OpenFiles(filenames, commandId);
 	}
 	else if( m_player.m_queue.GetQueueFlags()&SJ_QUEUEF_RESUME )
@@ -1335,6 +1350,13 @@ SjMainFrame::SjMainFrame(SjMainApp* mainApp, int id, long skinFlags, const wxPoi
 		g_mainFrame->GetEventHandler()->QueueEvent(new wxCommandEvent(wxEVT_COMMAND_MENU_SELECTED, IDT_UPDATE_INDEX));
 	}
 
+	/* benchmark the skin? this is done when the window is shown and sized
+	 */
+	if( SjMainApp::s_cmdLine->Found(wxT("skinbenchmark")) )
+	{
+		g_mainFrame->GetEventHandler()->QueueEvent(new wxCommandEvent(wxEVT_COMMAND_MENU_SELECTED, IDO_SKINBENCHMARK));
+	}
+
 	/* start the timer - this should be VERY last as the timer
 	 * is used eg. to start a playback
 	 */
@@ -1476,6 +1498,7 @@ BEGIN_EVENT_TABLE(SjMainFrame, SjSkinWindow)
 	EVT_MENU_RANGE  (IDM_FIRST, IDM_LAST,                       SjMainFrame::OnFwdToSkin     )
 	EVT_MENU        (IDO_BROWSER_RELOAD_VIEW,                   SjMainFrame::OnFwdToSkin     )
 	EVT_MENU        (IDO_DEBUGSKIN_RELOAD,                      SjMainFrame::OnFwdToSkin     )
+	EVT_MENU        (IDO_SKINBENCHMARK,                         SjMainFrame::OnFwdToSkin     )
 	EVT_MENU        (IDO_SELECTALL,                             SjMainFrame::OnFwdToSkin     )
 	EVT_MENU        (IDO_UNQUEUE_MARKED,                        SjMainFrame::OnFwdToSkin     )
 	EVT_MENU        (IDO_UNQUEUE_ALL_BUT_MARKED,                SjMainFrame::OnFwdToSkin     )
@@ -1504,6 +1527,7 @@ BEGIN_EVENT_TABLE(SjMainFrame, SjSkinWindow)
 	EVT_MENU_RANGE  (IDO_SEARCHMUSICSEL000,
 	                 IDO_SEARCHMUSICSEL999,     SjMainFrame::OnSearchMusicSel       )
 	EVT_TIMER       (IDTIMER_SEARCHINPUT,       SjMainFrame::OnSimpleSearchInputTimer)
+	EVT_MENU        (IDO_SEARCHDONE,            SjMainFrame::OnSearchDone           )
 	EVT_TIMER       (IDTIMER_ELAPSEDTIME,       SjMainFrame::OnElapsedTimeTimer     )
 	EVT_CLOSE       (                           SjMainFrame::OnCloseWindow          )
 	EVT_ICONIZE     (                           SjMainFrame::OnIconizeWindow        )
@@ -1747,6 +1771,15 @@ void SjMainFrame::OnSkinTargetEvent(int targetId, SjSkinValue& value, long accel
 				}
 				break;
 
+			case IDO_SKINBENCHMARK:
+				{
+					wxString report = GetPaintBenchmarkReport();
+					wxLogInfo("%s", report.c_str());
+					wxPrintf("%s\n", report.c_str());
+					Close(true);
+				}
+				break;
+
 			case IDT_UPDATE_INDEX:
 			case IDT_DEEP_UPDATE_INDEX:
 				if( IsAllAvailable() || m_updateIndexAfterConstruction )
@@ -2298,7 +2331,15 @@ void SjMainFrame::OnFwdToModules(wxCommandEvent& event)
 		// this message is ONLY send if the player is stopped
 		// as the end of the queue is reached (eg. if repeat is on, this is never send)
 		// when we receive this message, we've received IDMODMSG_TRACK_ON_AIR_CHANGED before.
-		if( m_player.IsStopped()
+		if( m_player.IsBenchmark() )
+		{
+			// all files given to --benchmark are played, report and exit
+			wxString report = m_player.GetBenchmarkReport();
+			wxLogInfo("%s", report.c_str());
+			wxPrintf("%s\n", report.c_str());
+			Close(true);
+		}
+		else if( m_player.IsStopped()
 		 && m_player.m_queue.MoveToTopOnEoq() )
 		{
 			m_player.GotoAbsPos(0);
@@ -2345,7 +2386,7 @@ void SjMainFrame::OnFwdToPlayer(wxCommandEvent& event)
 
 void SjMainFrame::OnCloseWindow(wxCloseEvent& event)
 {
-	if( m_player.m_queue.GetQueueFlags()&SJ_QUEUEF_RESUME )
+	if( (m_player.m_queue.GetQueueFlags()&SJ_QUEUEF_RESUME) && !m_player.IsBenchmark() )
 	{
 		m_player.SaveToResumeFile(); // this should be done _very_ first, the OS may kill us at any time and it is a good idea to have the resume file ready then.
 	}
@@ -2834,7 +2875,7 @@ void SjMainFrame::OnSimpleSearchInput(wxCommandEvent& event)
 			{
 				// undelayed search
 				SetSearch(SJ_SETSEARCH_SETSIMPLE|
-				          SJ_SETSEARCH_NOTEXTCTRLUPDATE, text);
+				          SJ_SETSEARCH_NOTEXTCTRLUPDATE|SJ_SETSEARCH_ASYNC, text);
 			}
 
 			inSearchInput = FALSE;
@@ -2844,7 +2885,7 @@ void SjMainFrame::OnSimpleSearchInput(wxCommandEvent& event)
 void SjMainFrame::OnSimpleSearchInputTimer(wxTimerEvent& event)
 {
 	SetSearch(SJ_SETSEARCH_SETSIMPLE|
-	          SJ_SETSEARCH_NOTEXTCTRLUPDATE|SJ_SETSEARCH_NOAUTOHISTORYADD, m_simpleSearchDelayedText);
+	          SJ_SETSEARCH_NOTEXTCTRLUPDATE|SJ_SETSEARCH_NOAUTOHISTORYADD|SJ_SETSEARCH_ASYNC, m_simpleSearchDelayedText);
 }
 
 
@@ -2986,15 +3027,6 @@ void SjMainFrame::SetSearch(long flags, const wxString& newSimpleSearch, const S
 
 		if( searchModified )
 		{
-			// show hourglass if previous searches take a long time or
-			// if this is one of the first two searches (which will take
-			// longer; btw m_allSearchCount starts with 1)
-			if( useHourglass )
-			{
-				::wxBeginBusyCursor();
-				useHourglass = TRUE;
-			}
-
 			// update the search input window, if needed
 			if( !(flags&SJ_SETSEARCH_NOTEXTCTRLUPDATE) )
 			{
@@ -3019,72 +3051,119 @@ void SjMainFrame::SetSearch(long flags, const wxString& newSimpleSearch, const S
 				columnGuid = m_browser->GetFirstSelectedOrVisiblePos(columnGuidViewOffset);
 			}
 
-			// do the search
+			// do the search - in the background, if possible; SetSearchDone() is
+			// called from OnSearchDone() in this case
+			if( (flags&SJ_SETSEARCH_ASYNC)
+			 && !deepSearch
+			 && !(flags&(SJ_SETSEARCH_SETADV|SJ_SETSEARCH_CLEARADV))
+			 && m_columnMixer.StartSearch(m_search) )
 			{
-				SjSearchStat stat = m_columnMixer.SetSearch(m_search, deepSearch);
-				m_searchStat.m_totalResultCount = stat.m_totalResultCount;
-				if( flags&(SJ_SETSEARCH_SETADV|SJ_SETSEARCH_CLEARADV) )
-				{
-					m_searchStat.m_advResultCount = stat.m_advResultCount;
-					m_searchStat.m_mbytes = stat.m_mbytes;
-					m_searchStat.m_seconds = stat.m_seconds;
-				}
+				m_asyncSearchFlags = flags;
+				m_asyncSearchStartTime = thisSearchTime;
+				m_asyncSearchGatherStatistics = gatherStatistics;
 			}
-
-			// set skin values (should be done before updating the browser
-			// as the browser uses the text from the search information)
-			SjSkinValue v;
-			v.value = m_search.IsSet()? 1 : 0;
-			SetSkinTargetValue(IDT_SEARCH_BUTTON, v);
-			UpdateSearchInfo(0);
-
-			// update the browser
-			m_browser->ReloadColumnMixer(false);
-			if(  !m_search.m_simple.IsSet()
-			 && (!columnGuid.IsEmpty() || !m_searchLastColumnGuid.IsEmpty())  )
+			else
 			{
-				if( !columnGuid.IsEmpty() )
+				// show hourglass if previous searches take a long time or
+				// if this is one of the first two searches (which will take
+				// longer; btw m_allSearchCount starts with 1)
+				if( useHourglass )
 				{
-					m_browser->GotoPos(columnGuid, columnGuidViewOffset);
+					::wxBeginBusyCursor();
 				}
-				else
+
+				SjSearchStat stat = m_columnMixer.SetSearch(m_search, deepSearch);
+				SetSearchDone(stat, flags, columnGuid, columnGuidViewOffset, thisSearchTime, gatherStatistics);
+
+				// clear hourglass if set before
+				if( useHourglass )
 				{
-					m_browser->GotoPos(m_searchLastColumnGuid, m_searchLastColumnGuidViewOffset);
+					::wxEndBusyCursor();
 				}
 			}
+		}
 
-			GotDisplayInputFromUser();
+		m_inPerformingSearch = FALSE;
+	}
+}
 
-			// remember the row to use after an unsuccessful search or after ending the search
-			if( !m_search.IsSet() || m_searchStat.m_totalResultCount )
-			{
-				m_searchLastColumnGuidViewOffset = 0;
-				m_searchLastColumnGuid = m_browser->GetFirstSelectedOrVisiblePos(m_searchLastColumnGuidViewOffset);
-			}
 
-			// gather statistics for finding out the search delay
-			thisSearchTime = SjTools::GetMsTicks() - thisSearchTime;
-			wxLogDebug(wxT("%i ms needed for the query"), (int)thisSearchTime);
-			if( gatherStatistics )
-			{
-				m_allSearchCount++;
-				m_allSearchMs += m_allSearchCount>3? thisSearchTime : SJ_SEARCH_DELAY_MS;
-				// use default values for the first two
-				// searches as the real times are not
-				// representive as nothing is cached yet
-				// (m_allSearchCount starts with "1")
-			}
+void SjMainFrame::SetSearchDone(const SjSearchStat& stat, long flags, const wxString& columnGuid, long columnGuidViewOffset,
+                                unsigned long startTime, bool gatherStatistics)
+{
+	// take over the search statistics
+	m_searchStat.m_totalResultCount = stat.m_totalResultCount;
+	if( flags&(SJ_SETSEARCH_SETADV|SJ_SETSEARCH_CLEARADV) )
+	{
+		m_searchStat.m_advResultCount = stat.m_advResultCount;
+		m_searchStat.m_mbytes = stat.m_mbytes;
+		m_searchStat.m_seconds = stat.m_seconds;
+	}
 
-			// inform all modules about the new search
-			m_moduleSystem.BroadcastMsg(IDMODMSG_SEARCH_CHANGED);
+	// set skin values (should be done before updating the browser
+	// as the browser uses the text from the search information)
+	SjSkinValue v;
+	v.value = m_search.IsSet()? 1 : 0;
+	SetSkinTargetValue(IDT_SEARCH_BUTTON, v);
+	UpdateSearchInfo(0);
 
-			// clear hourglass if set before
-			if( useHourglass )
-			{
-				::wxEndBusyCursor();
-			}
+	// update the browser
+	m_browser->ReloadColumnMixer(false);
+	if(  !m_search.m_simple.IsSet()
+	 && (!columnGuid.IsEmpty() || !m_searchLastColumnGuid.IsEmpty())  )
+	{
+		if( !columnGuid.IsEmpty() )
+		{
+			m_browser->GotoPos(columnGuid, columnGuidViewOffset);
+		}
+		else
+		{
+			m_browser->GotoPos(m_searchLastColumnGuid, m_searchLastColumnGuidViewOffset);
 		}
+	}
+
+	GotDisplayInputFromUser();
 
+	// remember the row to use after an unsuccessful search or after ending the search
+	if( !m_search.IsSet() || m_searchStat.m_totalResultCount )
+	{
+		m_searchLastColumnGuidViewOffset = 0;
+		m_searchLastColumnGuid = m_browser->GetFirstSelectedOrVisiblePos(m_searchLastColumnGuidViewOffset);
+	}
+
+	// gather statistics for finding out the search delay
+	unsigned long thisSearchTime = SjTools::GetMsTicks() - startTime;
+	wxLogDebug(wxT("%i ms needed for the query"), (int)thisSearchTime);
+	if( gatherStatistics )
+	{
+		m_allSearchCount++;
+		m_allSearchMs += m_allSearchCount>3? thisSearchTime : SJ_SEARCH_DELAY_MS;
+		// use default values for the first two
+		// searches as the real times are not
+		// representive as nothing is cached yet
+		// (m_allSearchCount starts with "1")
+	}
+
+	// inform all modules about the new search
+	m_moduleSystem.BroadcastMsg(IDMODMSG_SEARCH_CHANGED);
+}
+
+
+void SjMainFrame::OnSearchDone(wxCommandEvent&)
+{
+	// a background search is done, see SetSearch()
+	if( m_inPerformingSearch )
+	{
+		// try again later
+		GetEventHandler()->QueueEvent(new wxCommandEvent(wxEVT_COMMAND_MENU_SELECTED, IDO_SEARCHDONE));
+		return;
+	}
+
+	SjSearchStat stat;
+	if( m_columnMixer.FinishSearch(stat) )
+	{
+		m_inPerformingSearch = TRUE;
+		SetSearchDone(stat, m_asyncSearchFlags, wxEmptyString, 0, m_asyncSearchStartTime, m_asyncSearchGatherStatistics);
 		m_inPerformingSearch = FALSE;
 	}
 }
@@ -123,7 +123,7 @@ public:
 	bool            StopAfterThisTrack  () const { return m_player.StopAfterThisTrack(); }
 	bool            StopAfterEachTrack  () const { return m_player.StopAfterEachTrack(); }
 	bool            ShowRemainingTime   () const { return m_showRemainingTime; }
-	void            OnUrlChanged        (const wxString& n, const wxString& o) { m_player.m_queue.OnUrlChanged(n, o); }
+	void            OnUrlChanged        (const wxString& o, const wxString& n) { m_columnMixer.InvalidateQuickInfo(o); if(!n.IsEmpty()) m_columnMixer.InvalidateQuickInfo(n); m_player.m_queue.OnUrlChanged(o, n); }
 	void            OnUrlChangingDone   () { UpdateDisplay(); }
 
 	// open files - this function is called eg. on a double click
@@ -145,6 +145,7 @@ public:
 	#define         SJ_SETSEARCH_SETADV             0x08
 	#define         SJ_SETSEARCH_NOTEXTCTRLUPDATE   0x10
 	#define         SJ_SETSEARCH_NOAUTOHISTORYADD   0x20
+	#define         SJ_SETSEARCH_ASYNC              0x40 // search in the background, if possible
 	void            SetSearch           (long flags, const wxString& newSimpleSearch=wxEmptyString, const SjAdvSearch* newAdvSearch=NULL);
 	const SjSearch* GetSearch           () const { return &m_search; }
 	const SjSearchStat* GetSearchStat   () const { return &m_searchStat; }
@@ -265,6 +266,8 @@ private:
 	wxString        NormalizeSearchText (const wxString&);
 	void            OnSimpleSearchInput (wxCommandEvent&); // also called on SetValue, so use the flag below
 	void            OnSimpleSearchInputTimer (wxTimerEvent&);
+	void            OnSearchDone        (wxCommandEvent&);
+	void            SetSearchDone       (const SjSearchStat&, long flags, const wxString& columnGuid, long columnGuidViewOffset, unsigned long startTime, bool gatherStatistics);
 	void            OnSearchHistory     (wxCommandEvent&);
 	void            OnSearchGenre       (wxCommandEvent&);
 	void            OnSearchMusicSel    (wxCommandEvent&);
@@ -275,6 +278,9 @@ private:
 	wxString        m_simpleSearchDelayedText;
 	long            m_allSearchCount,
 	                m_allSearchMs;
+	long            m_asyncSearchFlags;     // the state of the pending background search, see SetSearch()
+	unsigned long   m_asyncSearchStartTime;
+	bool            m_asyncSearchGatherStatistics;
 
 	// current search settings
 	SjSearch        m_search;
@@ -43,6 +43,8 @@
 #include <sjbase/columnmixer.h>
 #include <sjtools/volumecalc.h>
 #include <sjtools/volumefade.h>
+#include <sjtools/volumeanalyzer.h>
+#include <sjtools/peaks.h>
 #include <sjmodules/vis/vis_module.h>
 #include <sjmodules/fx/eq_equalizer.h>
 #include <see_dom/sj_see.h>
@@ -68,6 +70,7 @@
 #define THREAD_END_OF_STREAM_A       (IDPLAYER_FIRST+0)
 #define THREAD_AUTO_DELETE           (IDPLAYER_FIRST+1)
 #define THREAD_PRELISTEN_END         (IDPLAYER_FIRST+2)
+#define THREAD_ANALYZER_RESULT       (IDPLAYER_FIRST+3)
 
 
 SjPlayerModule::SjPlayerModule(SjInterfaceBase* interf)
@@ -94,6 +97,9 @@ void SjPlayerModule::GetLittleOptions (SjArrayLittleOption& lo)
 	}
 	lo.Add(new SjLittleEnumStr(_("Prelisten")+": "+_("Equalizer"), options, &g_mainFrame->m_player.m_prelistenEqPreset, "", "player/prelistenEqPreset", SJ_ICON_MODULE));
 
+	// auto volume
+	lo.Add(new SjLittleBit(_("Analyze volume of unplayed tracks"), _("No")+"|"+_("Yes"), &g_mainFrame->m_player.m_avAnalyze, 1L, 0, "player/autovolAnalyze", SJ_ICON_MODULE));
+
 	// backend settings
 	if( g_mainFrame->m_player.m_backend )
 	{
@@ -156,6 +162,15 @@ SjPlayer::SjPlayer()
 	m_prelistenDest         = SJ_PL_DEFAULT;
 	m_prelistenGain         = 1.0F;
 	m_prelistenUseSysVol    = SJ_SYSVOL_DEFAULT;
+
+	m_benchmark             = NULL;
+
+	m_avAnalyze             = 1;
+	m_analyzer              = NULL;
+	m_analyzerTimestamp     = 0;
+
+	m_peaks                 = NULL;
+	m_peaksLoaded           = false;
 }
 
 
@@ -168,9 +183,24 @@ void SjPlayer::Init()
 	m_isInitialized = true;
 	m_queue.Init();
 
-	m_backend = new BACKEND_CLASSNAME(SJBE_ID_STDOUTPUT);
+	#if SJ_USE_GSTREAMER
+	if( SjMainApp::s_cmdLine->Found("benchmark") ) {
+		m_benchmark = new SjPlayerBenchmark();
+		m_backend = new SjGstreamerNullBackend(SjMainApp::s_cmdLine->Found("realtime"));
+	}
+	#endif
+	if( m_backend == NULL ) {
+		m_backend = new BACKEND_CLASSNAME(SJBE_ID_STDOUTPUT);
+	}
 	m_prelistenBackend = new BACKEND_CLASSNAME(SJBE_ID_PRELISTEN);
 
+	if( m_benchmark == NULL ) {
+		m_analyzer = new SjVolumeAnalyzer(m_backend, THREAD_ANALYZER_RESULT);
+		m_analyzerTimestamp = SjTools::GetMsTicks();
+	}
+
+	m_peaks = new SjPeaks();
+
 	// load settings
 	wxConfigBase* c = g_tools->m_config;
 	m_useSysVol                 =c->Read("player/useSysVol",           SJ_SYSVOL_DEFAULT); // should be done before SetMainVol()
@@ -192,6 +222,7 @@ void SjPlayer::Init()
 	AvSetUseAlbumVol            (c->Read("player/usealbumvol",         SJ_AV_DEF_USE_ALBUM_VOL? 1L : 0L)!=0);
 	m_avDesiredVolume           = (float)c->Read("player/autovoldes",  (long)(SJ_AV_DEF_DESIRED_VOLUME*1000.0F)) / 1000.0F;
 	m_avMaxGain                 = (float)c->Read("player/autovolmax",  (long)(SJ_AV_DEF_MAX_GAIN*1000.0F)) / 1000.0F;
+	m_avAnalyze                 = c->Read("player/autovolAnalyze",     1L);
 
 	m_eqEnabled                 = (c->Read("player/eqActive",          SJ_EQ_DEF_ENABLED? 1L : 0L))!=0;
 	m_eqParam.FromString        (  c->Read("player/eqParam",           ""));
@@ -200,6 +231,15 @@ void SjPlayer::Init()
 	m_prelistenUseSysVol        =c->Read("player/prelistenUseSysVol",  SJ_SYSVOL_DEFAULT);
 	m_prelistenMixQuiet         = (float)c->Read("player/prelistenMixQuiet", (long)(SJ_DEF_PL_MIX_QUIET*1000.0F)) / 1000.0F;
 	m_prelistenEqPreset         = c->Read("player/prelistenEqPreset",  "");
+
+	// benchmarks play the given files exactly once, one after the other; the settings are not saved in this case
+	if( m_benchmark )
+	{
+		m_queue.SetShuffle(false);
+		m_queue.SetRepeat(SJ_REPEAT_OFF);
+		SetAutoCrossfade(false);
+		StopAfterEachTrack(false);
+	}
 }
 
 
@@ -208,6 +248,10 @@ void SjPlayer::SaveSettings() const
 	// SaveSettings() is only called by the client, if needed. SjPlayer does not call SaveSettings()
 	wxASSERT( wxThread::IsMain() );
 
+	if( m_benchmark ) {
+		return; // the settings are modified for the benchmark, see Init()
+	}
+
 	wxConfigBase* c = g_tools->m_config;
 
 	// save base - mute is not saved by design
@@ -260,6 +304,12 @@ void SjPlayer::Exit()
 
 		DeleteStream(&m_streamA, 0);
 
+		if( m_analyzer )
+		{
+			delete m_analyzer; // stops the threads, must be done before the backend is deleted
+			m_analyzer = NULL;
+		}
+
 		if( m_backend )
 		{
 			delete m_backend;
@@ -272,16 +322,29 @@ void SjPlayer::Exit()
 			m_prelistenBackend = NULL;
 		}
 
+		if( m_benchmark )
+		{
+			delete m_benchmark;
+			m_benchmark = NULL;
+		}
+
+		if( m_peaks )
+		{
+			delete m_peaks;
+			m_peaks = NULL;
+		}
+
 		m_queue.Exit();
 	}
 }
 
 
-void SjPlayer::SaveGatheredInfo(const wxString& url, unsigned long startingTime, SjVolumeCalc* volumeCalc, long realContinuousDecodedMs)
+void SjPlayer::SaveGatheredInfo(const wxString& url, unsigned long startingTime, SjVolumeCalc* volumeCalc, SjPeaks* peaks, long realContinuousDecodedMs)
 {
 	if( g_mainFrame
 	 && !SjMainApp::IsInShutdown()
-	 && !url.IsEmpty() )
+	 && !url.IsEmpty()
+	 && !IsBenchmark() /*do not touch the library by benchmarks*/ )
 	{
 		double newGain = -1.0L;
 		if( volumeCalc && volumeCalc->IsGainWorthSaving() )
@@ -295,6 +358,16 @@ void SjPlayer::SaveGatheredInfo(const wxString& url, unsigned long startingTime,
 		    newGain,        // -1 for unknown
 		    realContinuousDecodedMs);
 
+		// save the waveform overview if it covers (nearly) the whole track;
+		// the end may be missing eg. because of crossfading
+		if( peaks && realContinuousDecodedMs > 0 && peaks->GetMs() >= (realContinuousDecodedMs*9)/10 )
+		{
+			peaks->PadTo(realContinuousDecodedMs);
+			if( peaks->Save(url) && url == m_peaksUrl ) {
+				m_peaksUrl.Clear(); // force reloading
+			}
+		}
+
 		#if SJ_USE_SCRIPTS
 		SjSee::Player_onPlaybackDone(url);
 		#endif
@@ -485,6 +558,101 @@ void SjPlayer::LoadFromResumeFile()
  ******************************************************************************/
 
 
+class SjPlayerBenchmark
+{
+public:
+	SjPlayerBenchmark()
+	{
+		m_callbacks = 0;
+		m_audioMs   = 0.0;
+		m_dspUs     = 0;
+		memset(m_histogram, 0, sizeof(m_histogram));
+	}
+
+	void AddCallback(long bytes, int samplerate, int channels, wxLongLong startUs, wxLongLong endUs)
+	{
+		// called from the DSP thread after each DSP callback
+		wxCriticalSectionLocker locker(m_critical);
+
+		if( m_callbacks == 0 ) {
+			m_firstUs = startUs;
+		}
+		m_lastUs = endUs;
+
+		m_callbacks++;
+		if( samplerate > 0 && channels > 0 ) {
+			m_audioMs += (double)bytes / (double)(samplerate*channels*sizeof(float)) * 1000.0;
+		}
+
+		long usedUs = (endUs - startUs).ToLong();
+		m_dspUs += usedUs;
+		m_histogram[UsToBucket(usedUs)]++;
+	}
+
+	wxString GetReport()
+	{
+		wxCriticalSectionLocker locker(m_critical);
+
+		if( m_callbacks == 0 ) {
+			return "Benchmark: No data.";
+		}
+
+		double wallMs = (m_lastUs - m_firstUs).ToDouble() / 1000.0;
+		double dspMs  = m_dspUs.ToDouble() / 1000.0;
+		return wxString::Format("Benchmark: %.1f s audio in %.1f s: throughput %.1fx realtime, DSP %.1fx realtime; %i callbacks, latency p50=%i us, p90=%i us, p99=%i us, max=%i us",
+			m_audioMs/1000.0, wallMs/1000.0,
+			wallMs>0.0? m_audioMs/wallMs : 0.0,
+			dspMs>0.0?  m_audioMs/dspMs  : 0.0,
+			(int)m_callbacks,
+			(int)GetPercentileUs(50), (int)GetPercentileUs(90), (int)GetPercentileUs(99), (int)GetPercentileUs(100));
+	}
+
+private:
+	// the latency histogram has a resolution of 1 us up to 1 ms and of 100 us above
+	#define          SJ_BENCH_FINE_BUCKETS   1000
+	#define          SJ_BENCH_COARSE_BUCKETS 1000
+	#define          SJ_BENCH_COARSE_US      100
+	static int       UsToBucket         (long us)
+	{
+		if( us < 0 ) { us = 0; }
+		if( us < SJ_BENCH_FINE_BUCKETS ) { return us; }
+		long i = SJ_BENCH_FINE_BUCKETS + (us-SJ_BENCH_FINE_BUCKETS)/SJ_BENCH_COARSE_US;
+		return i < SJ_BENCH_FINE_BUCKETS+SJ_BENCH_COARSE_BUCKETS? i : SJ_BENCH_FINE_BUCKETS+SJ_BENCH_COARSE_BUCKETS-1;
+	}
+	static long      BucketToUs         (int i)
+	{
+		return i < SJ_BENCH_FINE_BUCKETS? i : SJ_BENCH_FINE_BUCKETS + (i-SJ_BENCH_FINE_BUCKETS)*SJ_BENCH_COARSE_US;
+	}
+	long             GetPercentileUs    (int percent) const
+	{
+		unsigned long wanted = (unsigned long)(((double)m_callbacks*percent)/100.0 + 0.5), sum = 0;
+		int i, lastUsed = 0;
+		for( i = 0; i < SJ_BENCH_FINE_BUCKETS+SJ_BENCH_COARSE_BUCKETS; i++ ) {
+			if( m_histogram[i] ) {
+				sum += m_histogram[i];
+				lastUsed = i;
+				if( sum >= wanted ) { break; }
+			}
+		}
+		return BucketToUs(lastUsed);
+	}
+
+	wxCriticalSection m_critical;
+	unsigned long    m_callbacks;
+	double           m_audioMs;
+	wxLongLong       m_dspUs;
+	wxLongLong       m_firstUs;
+	wxLongLong       m_lastUs;
+	unsigned long    m_histogram[SJ_BENCH_FINE_BUCKETS+SJ_BENCH_COARSE_BUCKETS];
+};
+
+
+wxString SjPlayer::GetBenchmarkReport() const
+{
+	return m_benchmark? m_benchmark->GetReport() : wxString();
+}
+
+
 class SjBackendUserdata
 {
 public:
@@ -498,6 +666,7 @@ public:
 		m_realMs               = 0;
 		m_autoDelete           = false; // if set, the stream is deleted on EOS or if fading is done
 		m_autoDeleteSend       = false;
+		m_peaksValid           = false;
 	}
 	long          m_onCreateFadeMs;
 	float         m_onCreateFadeDestGain;
@@ -508,6 +677,8 @@ public:
 	SjVolumeCalc  m_volumeCalc;
 	SjVolumeFade  m_volumeFade;
 	SjEqualizer   m_equalizer;
+	SjPeaks       m_peaks;
+	bool          m_peaksValid;         // only set if the stream is decoded continuously from the beginning
 
 	bool              m_autoDelete;
 	bool              m_autoDeleteSend;
@@ -537,9 +708,20 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 
 		if( buffer != NULL && bytes > 0 )
 		{
+			wxLongLong benchmarkStartUs;
+			if( player->m_benchmark ) {
+				benchmarkStartUs = wxGetUTCTimeUSec();
+			}
+
 			// calculate the volume - we do this ALWAYS, if autovol is enabled or not
 			userdata->m_volumeCalc.AddBuffer(buffer, bytes, samplerate, channels);
 
+			// collect the waveform overview, for the same reason before any effects are applied
+			if( userdata->m_peaksValid )
+			{
+				userdata->m_peaks.AddBuffer(buffer, bytes, samplerate, channels);
+			}
+
 			// apply the calulated gain, if desired
 			if( player->m_avEnabled )
 			{
@@ -597,6 +779,10 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 
 				SjApplyVolume(buffer, bytes, player->m_prelistenGain);
 			}
+
+			if( player->m_benchmark ) {
+				player->m_benchmark->AddCallback(bytes, samplerate, channels, benchmarkStartUs, wxGetUTCTimeUSec());
+			}
 		}
 	}
 	else if( cbp->msg == SJBE_MSG_CREATE )
@@ -680,7 +866,8 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 
 		wxASSERT( wxThread::IsMain() );
 
-		player->SaveGatheredInfo(stream->GetUrl(), stream->GetStartingTime(), &userdata->m_volumeCalc, userdata->m_realMs);
+		player->SaveGatheredInfo(stream->GetUrl(), stream->GetStartingTime(), &userdata->m_volumeCalc,
+		                         userdata->m_peaksValid? &userdata->m_peaks : NULL, userdata->m_realMs);
 
 		delete userdata;
 		stream->m_userdata = NULL;
@@ -711,6 +898,8 @@ SjBackendStream* SjPlayer::CreateStream(const wxString& url, bool createPreliste
 		startThisMs = explicitSeekMs;
 	}
 
+	userdata->m_peaksValid = (!createPrelistenStream && startThisMs == 0);
+
 	// create the stream
 	SjBackendStream* stream;
 	if( createPrelistenStream && m_prelistenDest == SJ_PL_OWNOUTPUT ) {
@@ -852,6 +1041,7 @@ void SjPlayer::Stop(bool stopVisIfPlaying, bool keepPrelisten)
 
 	// CLOSE devices
 	if( m_backend ) {
+		m_backend->CancelPreroll();
 		m_backend->SetDeviceState(SJBE_STATE_CLOSED);
 	}
 
@@ -920,11 +1110,30 @@ void SjPlayer::GotoAbsPos(long queuePos, bool fadeToPos)
 void SjPlayer::Seek(long seekMs)
 {
 	if( m_streamA ) {
+		m_streamA->m_userdata->m_peaksValid = false; // the peaks would no longer match the track position
 		m_streamA->SeekAbs(seekMs);
 	}
 }
 
 
+const SjPeaks* SjPlayer::GetPeaks(const wxString& url)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	if( m_peaks == NULL || url.IsEmpty() ) {
+		return NULL;
+	}
+
+	if( url != m_peaksUrl )
+	{
+		m_peaksUrl    = url;
+		m_peaksLoaded = m_peaks->Load(url);
+	}
+
+	return m_peaksLoaded? m_peaks : NULL;
+}
+
+
 void SjPlayer::SeekPrelisten(long seekMs)
 {
 	if( m_prelistenStream ) {
@@ -1152,20 +1361,60 @@ void SjPlayer::GetPrelistenInfo(wxString& url, long& totalMs, long& elapsedMs, l
 
 void SjPlayer::OneSecondTimer()
 {
-	if( !m_autoCrossfade || m_streamA == NULL || m_streamA->m_userdata == NULL ) {
-		return; // crossfading and silence detection disabled OR no stream
+	// analyze tracks without gain in the background; while playing, the analyzer throttles itself
+	if( m_analyzer )
+	{
+		#define ANALYZER_INTERVAL_MS (10*60*1000) // check for new tracks every 10 minutes
+		bool analyze = (m_avEnabled && m_avAnalyze);
+		if( m_analyzer->IsRunning() )
+		{
+			if( analyze ) {
+				m_analyzer->SetThrottle(m_streamA != NULL && !m_paused);
+			}
+			else {
+				m_analyzer->Stop();
+			}
+		}
+		else if( analyze && SjTools::GetMsTicks() > m_analyzerTimestamp+ANALYZER_INTERVAL_MS )
+		{
+			m_analyzerTimestamp = SjTools::GetMsTicks();
+			m_analyzer->SetThrottle(m_streamA != NULL && !m_paused);
+			m_analyzer->Start();
+		}
+	}
+
+	if( m_streamA == NULL || m_streamA->m_userdata == NULL ) {
+		return; // no stream
 	}
 
 	long totalMs = -1, elapsedMs = -1;
 	m_streamA->GetTime(totalMs, elapsedMs);
-	if( totalMs < m_autoCrossfadeMs*2 || elapsedMs < 0 || m_streamA->m_userdata->m_isVideo ) {
-		return; // do not crossfade on very short tracks OR if the position is unknwon OR if the current stream is a video (may cause problems if the next stream is also a video)
+	if( totalMs <= 0 || elapsedMs < 0 || m_streamA->m_userdata->m_isVideo ) {
+		return; // the position is unknwon OR the current stream is a video (may cause problems if the next stream is also a video)
 	}
 
 	#define HEADROOM_MS 50 // assumed time for stream creation
+	#define PREROLL_MS  5000
 	long startNextMs = totalMs - HEADROOM_MS;
 	if( m_autoCrossfade )  { startNextMs -= m_autoCrossfadeMs+m_crossfadeOffsetEndMs; }
 
+	// some seconds before the next track is needed, let the backend prepare it;
+	// starting it then is only a state change (also if we do not crossfade but wait for THREAD_END_OF_STREAM_A)
+	if( elapsedMs >= startNextMs-PREROLL_MS && !m_stopAfterThisTrack && !m_stopAfterEachTrack )
+	{
+		long prerollQueuePos = m_queue.GetNextPos(SJ_PREVNEXT_REGARD_REPEAT);
+		if( prerollQueuePos != -1 ) {
+			wxString prerollUrl = m_queue.GetUrlByPos(prerollQueuePos);
+			if( m_failedUrls.Index(prerollUrl) == wxNOT_FOUND ) {
+				m_backend->PrerollStream(prerollUrl);
+			}
+		}
+	}
+
+	if( !m_autoCrossfade || totalMs < m_autoCrossfadeMs*2 ) {
+		return; // crossfading disabled OR do not crossfade on very short tracks
+	}
+
 	if( elapsedMs < startNextMs ) {
 		return; // still waiting for the correct moment
 	}
@@ -1276,6 +1525,12 @@ void SjPlayer::ReceiveSignal(int signal, uintptr_t extraLong)
 			SendSignalToMainThread(THREAD_END_OF_STREAM_A, 0); // start over
 		}
 	}
+	else if( signal == THREAD_ANALYZER_RESULT )
+	{
+		if( m_analyzer ) {
+			m_analyzer->ReceiveResults();
+		}
+	}
 	else if( signal == THREAD_PRELISTEN_END )
 	{
 		// prelisten stream ended - safely delete the steam from the main thread and update display, menus etc.
@@ -43,6 +43,9 @@ class SjBackend;
 class SjBackendStream;
 struct SjBackendCallbackParam;
 class SjVolumeCalc;
+class SjPlayerBenchmark;
+class SjVolumeAnalyzer;
+class SjPeaks;
 
 
 class SjPlayer
@@ -114,6 +117,10 @@ public:
 	void            Seek                (long ms);
 	void            SeekPrelisten       (long ms);
 
+	// Waveform overview, collected while a track is played completely or by the volume analyzer.
+	// Returns NULL if there are no peaks for the given URL; the returned object is valid until the next call.
+	const SjPeaks*  GetPeaks            (const wxString& url);
+
 	// Automatic volume
 	#define         SJ_AV_DEF_STATE             TRUE
 	#define         SJ_AV_DEF_DESIRED_VOLUME    1.0F
@@ -156,6 +163,10 @@ public:
 	// thread for this purpose.
 	void            ReceiveSignal       (int id, uintptr_t extraLong);
 
+	// benchmark, started by the command line option --benchmark
+	bool            IsBenchmark         () const { return (m_benchmark!=NULL); }
+	wxString        GetBenchmarkReport  () const;
+
 private:
 	// The player's backend, normally selected by a define as SJ_USE_GSTREAMER or SJ_USE_XINE
 	SjBackend*       m_backend;
@@ -189,7 +200,7 @@ private:
 
 	// tools
 	void            SendSignalToMainThread(int id, uintptr_t extraLong=0) const;
-	void            SaveGatheredInfo    (const wxString& url, unsigned long startingTime, SjVolumeCalc*, long realDecodedBytes);
+	void            SaveGatheredInfo    (const wxString& url, unsigned long startingTime, SjVolumeCalc*, SjPeaks*, long realDecodedBytes);
 
 	// main volume stuff
 	int             m_mainVol;
@@ -205,6 +216,14 @@ private:
 	float           m_avDesiredVolume;
 	float           m_avMaxGain;
 	float           m_avCalculatedGain;
+	long            m_avAnalyze;        // analyze tracks without gain in the background?
+	SjVolumeAnalyzer* m_analyzer;
+	unsigned long   m_analyzerTimestamp;
+
+	// waveform overview, the peaks of the last URL given to GetPeaks()
+	SjPeaks*        m_peaks;
+	wxString        m_peaksUrl;
+	bool            m_peaksLoaded;
 
 	// equalizer
 	#define         SJ_EQ_DEF_ENABLED     false
@@ -224,6 +243,7 @@ private:
 	void*           m_visBuffer;
 	long            m_visBufferBytes;
 	wxArrayString   m_failedUrls;
+	SjPlayerBenchmark* m_benchmark;
 
 	friend class    SjPlayerModule;
 	friend void     SjPlayer_BackendCallback(SjBackendCallbackParam*);
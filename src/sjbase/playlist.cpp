@@ -66,6 +66,35 @@ WX_DEFINE_OBJARRAY(SjArrayPlaylistEntry);
 long SjPlaylistEntry::s_nextId = 1;
 
 
+void SjPlaylistEntry::SetPlayCount(long cnt)
+{
+	long oldCnt = GetPlayCount();
+	CheckAddInfo(SJ_ADDINFO_PLAYCOUNT);
+	m_addInfo->m_playCount = cnt;
+
+	if( m_playlist && (oldCnt==0) != (cnt==0) )
+	{
+		m_playlist->AddUnplayed(m_url, cnt==0? 1 : -1);
+	}
+}
+
+
+void SjPlaylistEntry::UrlChanged()
+{
+	if( m_addInfo )
+	{
+		// forgetting the add. information resets the playcount
+		if( m_playlist && m_addInfo->m_playCount != 0 )
+		{
+			m_playlist->AddUnplayed(m_url, 1);
+		}
+
+		delete m_addInfo;
+		m_addInfo = NULL;
+	}
+}
+
+
 void SjPlaylistEntry::LoadAddInfo(long what)
 {
 	if( g_mainFrame == NULL )
@@ -94,7 +123,17 @@ void SjPlaylistEntry::LoadAddInfo(long what)
 	 && !(m_addInfo->m_what&SJ_ADDINFO_MISC) )
 	{
 		// try to get them from the library
-		if( !g_mainFrame->m_columnMixer.GetQuickInfo(GetUrl(), m_addInfo->m_trackName, m_addInfo->m_leadArtistName, m_addInfo->m_albumName, m_addInfo->m_playtimeMs) )
+		SjQuickInfo tagInfo;
+		bool        found = g_mainFrame->m_columnMixer.GetQuickInfo(GetUrl(), m_addInfo->m_trackName, m_addInfo->m_leadArtistName, m_addInfo->m_albumName, m_addInfo->m_playtimeMs);
+		if( !found && g_mainFrame->m_columnMixer.m_quickInfoCache.Lookup(GetUrl(), tagInfo) && tagInfo.m_fromTags )
+		{
+			// the tags were read before
+			m_addInfo->m_trackName      = tagInfo.m_trackName;
+			m_addInfo->m_leadArtistName = tagInfo.m_leadArtistName;
+			m_addInfo->m_albumName      = tagInfo.m_albumName;
+			m_addInfo->m_playtimeMs     = tagInfo.m_playtimeMs;
+		}
+		else if( !found )
 		{
 			// try to get them from the decoding module that will handle this file
 			wxASSERT( m_urlVerified );
@@ -121,6 +160,15 @@ void SjPlaylistEntry::LoadAddInfo(long what)
 							{
 								m_addInfo->m_trackName = GetUrl();
 							}
+
+							// remember the information, reading tags is expensive
+							SjQuickInfo info;
+							info.m_trackName        = m_addInfo->m_trackName;
+							info.m_leadArtistName   = m_addInfo->m_leadArtistName;
+							info.m_albumName        = m_addInfo->m_albumName;
+							info.m_playtimeMs       = m_addInfo->m_playtimeMs;
+							info.m_fromTags         = true;
+							g_mainFrame->m_columnMixer.m_quickInfoCache.Insert(GetUrl(), info);
 						}
 						delete fsFile;
 					}
@@ -391,6 +439,13 @@ void SjPlaylist::RehashUrl(const wxString& oldUrl, const wxString& newUrl)
 
 	wxASSERT( count > 0 );
 	m_urlCounts.Insert(newUrl, count);
+
+	long unplayed = m_unplayedUrlCounts.Remove(oldUrl);
+	if( unplayed )
+	{
+		unplayed += m_unplayedUrlCounts.Lookup(newUrl);
+		m_unplayedUrlCounts.Insert(newUrl, unplayed);
+	}
 }
 
 
@@ -412,6 +467,12 @@ void SjPlaylist::OnUrlChanged(const wxString& oldUrl, const wxString& newUrl)
 			{
 				m_urlCounts.Insert(newUrl, count);
 			}
+
+			long unplayed = m_unplayedUrlCounts.Remove(oldUrl);
+			if( unplayed )
+			{
+				m_unplayedUrlCounts.Insert(newUrl, unplayed);
+			}
 		}
 
 		// force reloading information about this url
@@ -459,6 +520,11 @@ long SjPlaylist::RemoveAt(long index)
 		m_urlCounts.Insert(url, restCount-1);
 	}
 
+	if( m_array[index].GetPlayCount() == 0 )
+	{
+		AddUnplayed(url, -1);
+	}
+
 	m_array.RemoveAt(index);
 
 	return restCount-1;
@@ -496,31 +562,66 @@ long SjPlaylist::GetPosByUrl(const wxString& url) const
 }
 
 
+void SjPlaylist::AddUnplayed(const wxString& url, long delta)
+{
+	// see the remarks in RehashUrl() why we do not combine the two lines
+	long count = m_unplayedUrlCounts.Remove(url);
+	count += delta;
+
+	wxASSERT( count >= 0 );
+	if( count > 0 )
+	{
+		m_unplayedUrlCounts.Insert(url, count);
+	}
+
+	m_unplayedCount += delta;
+	wxASSERT( m_unplayedCount >= 0 );
+}
+
+
 long SjPlaylist::GetUnplayedCount(long currPos, long maxCnt) const
 {
 	long    unplayedCnt = 0;
-	long    i;
+	long    i, arrayCount = m_array.GetCount();
 
-	if( currPos < 0 )
+	if( currPos <= 0 )
 	{
-		currPos = 0;
+		// all unplayed titles are counted
+		unplayedCnt = m_unplayedCount;
 	}
-
-	// Count the unplayed titles; we're starting at the end of the list
-	// as normally the unplayed titles are here, esp. in kiosk mode where
-	// we use this function.
-	for( i = (long)(m_array.GetCount())-1; i >= currPos; i-- )
+	else if( currPos < arrayCount-currPos )
 	{
-		if( m_array[i].GetPlayCount() == 0 )
+		// subtract the unplayed titles before the given position
+		unplayedCnt = m_unplayedCount;
+		for( i = 0; i < currPos; i++ )
 		{
-			unplayedCnt++;
-			if( unplayedCnt >= maxCnt )
+			if( m_array[i].GetPlayCount() == 0 )
 			{
-				wxASSERT( unplayedCnt == maxCnt );
-				break;
+				unplayedCnt--;
 			}
 		}
 	}
+	else
+	{
+		// count the unplayed titles from the end of the list as normally
+		// the unplayed titles are here, esp. in kiosk mode where we use this function.
+		for( i = arrayCount-1; i >= currPos; i-- )
+		{
+			if( m_array[i].GetPlayCount() == 0 )
+			{
+				unplayedCnt++;
+				if( unplayedCnt == maxCnt )
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	if( maxCnt >= 0 && unplayedCnt > maxCnt )
+	{
+		unplayedCnt = maxCnt;
+	}
 
 	return unplayedCnt;
 }
@@ -91,16 +91,16 @@ public:
 	wxString        GetUrl              () { if(!m_urlVerified) { VerifyUrl(); } return m_url; }
 	wxString        GetUnverifiedUrl    () { return m_url; }
 	void            RenameUrl           (const wxString& oldUrl, const wxString& newUrl) { if(m_url==oldUrl) m_url=newUrl; }
-	void            UrlChanged          () { if(m_addInfo) { delete m_addInfo; m_addInfo=NULL; } }
+	void            UrlChanged          ();
 	wxString        GetLocalFile        (const wxString& containerUrl);
 
 	// get the ID, the ID is unique even for different URLs that are several times in the playlist
 	// and they stay equal if the playlist is modified
 	long            GetId               () const { return m_id; }
 
-	// get/set the playcount
+	// get/set the playcount; the playlist is informed if the entry becomes played or unplayed
 	long            GetPlayCount        () const { return m_addInfo? m_addInfo->m_playCount : 0; }
-	void            SetPlayCount        (long cnt) { CheckAddInfo(SJ_ADDINFO_PLAYCOUNT); m_addInfo->m_playCount = cnt; }
+	void            SetPlayCount        (long cnt);
 
 	// get/set the flags
 	long            GetFlags            () const { return m_addInfo? m_addInfo->m_flags : 0; }
@@ -151,10 +151,10 @@ WX_DECLARE_OBJARRAY(SjPlaylistEntry, SjArrayPlaylistEntry);
 class SjPlaylist
 {
 public:
-	                SjPlaylist          () { m_cacheFlags=0; }
+	                SjPlaylist          () { m_cacheFlags=0; m_unplayedCount=0; }
 
 	// clear playlist
-	void            Clear               () { m_cacheFlags=0; m_array.Clear(); m_urlCounts.Clear(); };
+	void            Clear               () { m_cacheFlags=0; m_array.Clear(); m_urlCounts.Clear(); m_unplayedUrlCounts.Clear(); m_unplayedCount=0; };
 
 	// adding URLs to playlist
 	void            Add                 (const wxArrayString& urls, bool urlsVerified);
@@ -163,12 +163,14 @@ public:
 		m_cacheFlags=0;
 		m_array.Add(new SjPlaylistEntry(this, url, urlVerified, flags));
 		m_urlCounts.Insert(url, m_urlCounts.Lookup(url)+1);
+		AddUnplayed(url, 1);
 	}
 	void            Insert              (const wxString& url, long addBeforeThisIndex, bool urlVerified, long flags)
 	{
 		m_cacheFlags=0;
 		m_array.Insert(new SjPlaylistEntry(this, url, urlVerified, flags), addBeforeThisIndex);
 		m_urlCounts.Insert(url, m_urlCounts.Lookup(url)+1);
+		AddUnplayed(url, 1);
 	}
 
 	// Update some information, urlVerified should normally be TRUE as
@@ -191,6 +193,7 @@ public:
 
 	bool            IsInPlaylist        (const wxString& url) const { return m_urlCounts.Lookup(url)!=0; }
 	long            GetCountInPlaylist  (const wxString& url) const { return m_urlCounts.Lookup(url); }
+	long            GetUnplayedCountInPlaylist (const wxString& url) const { return m_unplayedUrlCounts.Lookup(url); }
 
 	// get the number of unplayed titles; if you just want to
 	// check for a given border, you can set a border at which counting is aborted.
@@ -234,6 +237,12 @@ private:
 	SjArrayPlaylistEntry m_array;
 	SjSLHash        m_urlCounts;
 
+	// the same for the entries with a playcount of 0, updated by SjPlaylistEntry::SetPlayCount()
+	SjSLHash        m_unplayedUrlCounts;
+	long            m_unplayedCount;
+	void            AddUnplayed         (const wxString& url, long delta);
+	friend class    SjPlaylistEntry;
+
 	// meta data
 	wxString        m_playlistName;
 	wxString        m_playlistUrl;
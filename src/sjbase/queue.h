@@ -83,6 +83,7 @@ public:
 	void            SetCurrErroneous    ();
 	SjPlaylistEntry& GetInfo            (long pos/*-1 for current*/);
 	bool            IsEnqueued          (const wxString& url) const { return m_playlist.IsInPlaylist(url); }
+	bool            IsEnqueuedUnplayed  (const wxString& url) const { return m_playlist.GetUnplayedCountInPlaylist(url)>0 || IsPlaying(url); } // same as GetAllPosByUrl(unplayedOnly) but without iterating the queue
 	bool            IsPlaying           (const wxString& url) const { return m_pos>=0? (m_playlist.Item(m_pos).GetUrl()==url) : FALSE; }
 	bool            MoveToTopOnEoq      () const;
 
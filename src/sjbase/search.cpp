@@ -460,52 +460,171 @@ wxString SjRule::GetInclExclDescr() const
 }
 
 
-void SjRule::AddToInclExcl(const wxString& idsToAdd)
+static int compare_ids(long* i1, long* i2)
+{
+	return (*i1 < *i2)? -1 : ((*i1 > *i2)? 1 : 0);
+}
+
+
+static void sort_ids(wxArrayLong& ids)
 {
-	if( m_value[0].IsEmpty() )
+	// sort the IDs and remove duplicates
+	ids.Sort(compare_ids);
+
+	size_t i, iCount = ids.GetCount(), unique = 0;
+	for( i = 0; i < iCount; i++ )
 	{
-		m_value[0] = idsToAdd;
+		if( unique == 0 || ids[i] != ids[unique-1] )
+		{
+			ids[unique++] = ids[i];
+		}
 	}
-	else
+
+	if( unique < iCount )
 	{
-		m_value[0] += idsToAdd.Mid(1);//skip first comma as it is the last char in m_value[0]
+		ids.RemoveAt(unique, iCount-unique);
 	}
 }
 
 
-void SjRule::AddToInclExcl(SjLLHash* ids)
+static void parse_ids(const wxString& str, wxArrayLong& retSortedIds)
 {
-	wxString strToAdd;
-	long id;
-	SjHashIterator iterator;
-	while( ids->Iterate(iterator, &id) )
+	// older versions did not sort the IDs, so we always sort them here
+	retSortedIds.Empty();
+	retSortedIds.Alloc(str.Freq(','));
+
+	long id = 0;
+	bool hasDigits = FALSE;
+	for( wxString::const_iterator it = str.begin(); it != str.end(); ++it )
 	{
-		strToAdd.Printf(wxT("%i"), (int)id);
-		if( m_value[0].Find(wxT(",")+strToAdd+wxT(",")) == -1 )
+		wxChar c = *it;
+		if( c >= '0' && c <= '9' )
+		{
+			id = id*10 + (c-'0');
+			hasDigits = TRUE;
+		}
+		else
 		{
-			if( m_value[0].IsEmpty() ) m_value[0] = wxT(",");
-			m_value[0].Append(strToAdd+wxT(","));
+			if( hasDigits ) { retSortedIds.Add(id); }
+			id = 0;
+			hasDigits = FALSE;
 		}
 	}
+	if( hasDigits ) { retSortedIds.Add(id); }
+
+	sort_ids(retSortedIds);
 }
 
 
+static wxString ids_to_string(const wxArrayLong& sortedIds)
+{
+	size_t i, iCount = sortedIds.GetCount();
+	if( iCount == 0 )
+	{
+		return wxEmptyString;
+	}
 
-void SjRule::RemoveFromInclExcl(SjLLHash* ids)
+	wxString ret;
+	ret.Alloc(iCount*7);
+	ret = wxT(",");
+	for( i = 0; i < iCount; i++ )
+	{
+		ret << sortedIds[i] << wxT(",");
+	}
+	return ret;
+}
+
+
+static bool ids_contain(const wxArrayLong& sortedIds, long id)
+{
+	long lo = 0, hi = (long)sortedIds.GetCount()-1, mid;
+	while( lo <= hi )
+	{
+		mid = (lo+hi) / 2;
+		if( sortedIds[mid] < id )       { lo = mid+1; }
+		else if( sortedIds[mid] > id )  { hi = mid-1; }
+		else                            { return TRUE; }
+	}
+	return FALSE;
+}
+
+
+static void merge_ids(const wxArrayLong& sorted1, const wxArrayLong& sorted2, wxArrayLong& ret)
+{
+	size_t i1 = 0, i1Count = sorted1.GetCount(), i2 = 0, i2Count = sorted2.GetCount();
+	ret.Empty();
+	ret.Alloc(i1Count+i2Count);
+	while( i1 < i1Count || i2 < i2Count )
+	{
+		if( i2 >= i2Count || (i1 < i1Count && sorted1[i1] < sorted2[i2]) )
+		{
+			ret.Add(sorted1[i1++]);
+		}
+		else if( i1 >= i1Count || sorted2[i2] < sorted1[i1] )
+		{
+			ret.Add(sorted2[i2++]);
+		}
+		else
+		{
+			ret.Add(sorted1[i1++]); // same ID in both arrays
+			i2++;
+		}
+	}
+}
+
+
+void SjRule::GetInclExclIds(wxArrayLong& retSortedIds) const
+{
+	parse_ids(m_value[0], retSortedIds);
+}
+
+
+void SjRule::AddToInclExcl(const wxString& idsToAdd)
+{
+	wxArrayLong currIds, addIds, newIds;
+	parse_ids(m_value[0], currIds);
+	parse_ids(idsToAdd, addIds);
+	merge_ids(currIds, addIds, newIds);
+	m_value[0] = ids_to_string(newIds);
+}
+
+
+void SjRule::AddToInclExcl(SjLLHash* ids)
 {
-	wxString strToRemove;
+	wxArrayLong currIds, addIds, newIds;
 	long id;
 	SjHashIterator iterator;
+
+	addIds.Alloc(ids->GetCount());
 	while( ids->Iterate(iterator, &id) )
 	{
-		strToRemove.Printf(wxT(",%i,"), (int)id);
-		m_value[0].Replace(strToRemove, wxT(","));
+		addIds.Add(id);
 	}
+	sort_ids(addIds);
+
+	parse_ids(m_value[0], currIds);
+	merge_ids(currIds, addIds, newIds);
+	m_value[0] = ids_to_string(newIds);
+}
+
+
+void SjRule::RemoveFromInclExcl(SjLLHash* ids)
+{
+	wxArrayLong currIds, newIds;
+	size_t i, iCount;
 
-	if( m_value[0].Len()==1 )
+	parse_ids(m_value[0], currIds);
+	iCount = currIds.GetCount();
+	newIds.Alloc(iCount);
+	for( i = 0; i < iCount; i++ )
 	{
-		m_value[0].Clear();
+		if( ids->Lookup(currIds[i]) == 0 )
+		{
+			newIds.Add(currIds[i]);
+		}
 	}
+
+	m_value[0] = ids_to_string(newIds);
 }
 
 
@@ -1251,8 +1370,38 @@ bool LimitValues::Set(int fieldIndex, long max__, long multiplier)
 }
 
 
+// the sorted IDs queried by INIDSET() while SjAdvSearch::GetAsSql() runs its queries
+#define ID_SET_INCL  0
+#define ID_SET_EXCL  1
+static wxArrayLong s_idSets[2];
+
+
+bool SjAdvSearch::s_albumsPerQuery = FALSE;
+
+
+bool SjAdvSearch::IsInIdSet(int set, long id)
+{
+	if( set < 0 || set > 1 )
+	{
+		return FALSE;
+	}
+
+	return ids_contain(s_idSets[set], id);
+}
+
+
 SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 {
+	return DoGetAsSql(retHash, retSql, wxEmptyString);
+}
+
+
+SjSearchStat SjAdvSearch::DoGetAsSql(SjLLHash* retHash, wxString& retSql, const wxString& restrictSql) const
+{
+	// if restrictSql is given, only tracks matching this condition are checked;
+	// this is only supported when selecting tracks without limits, see SjAdvSearchCacheEntry
+	wxASSERT( wxThread::IsMain() ); // s_idSets is not protected
+
 	SjSearchStat stat;
 
 	//
@@ -1291,6 +1440,11 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 		SjRule*         rule;
 		wxArrayString   orderByArray;
 		wxString        incl;
+		wxArrayLong     ruleIds, mergedIds;
+		bool            hasIncl = FALSE, hasExcl = FALSE;
+
+		s_idSets[ID_SET_INCL].Empty();
+		s_idSets[ID_SET_EXCL].Empty();
 
 		for( r = 0; r < m_rules.GetCount(); r++ )
 		{
@@ -1300,15 +1454,21 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 			{
 				//
 				// MANUAL INCLUDE/EXCLUDE track ids; this is handled separatly from the select
-				// operation as these conditions should have a higher priority
+				// operation as these conditions should have a higher priority.
+				// The IDs of all rules are merged to one set per type and given to SQLite
+				// via INIDSET() - much faster than pasting thousands of IDs into the query.
 				//
-				if( !incl.IsEmpty() ) { incl += wxT(" OR "); }
-				incl += rule->GetAsSql();
+				rule->GetInclExclIds(ruleIds);
+				merge_ids(s_idSets[ID_SET_INCL], ruleIds, mergedIds);
+				s_idSets[ID_SET_INCL] = mergedIds;
+				hasIncl = TRUE;
 			}
 			else if( rule->m_field == SJ_PSEUDOFIELD_EXCLUDE )
 			{
-				if( !excl.IsEmpty() ) { excl += wxT(" AND "); }
-				excl += rule->GetAsSql();
+				rule->GetInclExclIds(ruleIds);
+				merge_ids(s_idSets[ID_SET_EXCL], ruleIds, mergedIds);
+				s_idSets[ID_SET_EXCL] = mergedIds;
+				hasExcl = TRUE;
 			}
 			else if( rule->m_field == SJ_PSEUDOFIELD_LIMIT )
 			{
@@ -1394,6 +1554,16 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 
 		}
 
+		if( hasIncl )
+		{
+			incl = s_idSets[ID_SET_INCL].IsEmpty()? wxT("(0)") : wxT("INIDSET(0,id)");
+		}
+
+		if( hasExcl )
+		{
+			excl = s_idSets[ID_SET_EXCL].IsEmpty()? wxT("(1)") : wxT("NOT INIDSET(1,id)");
+		}
+
 		// add include / exclude conditions to WHERE
 		if( !incl.IsEmpty() )
 		{
@@ -1425,6 +1595,12 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 		where = wxT("NOT(") + where + wxT(")");
 	}
 
+	if( !restrictSql.IsEmpty() )
+	{
+		wxASSERT( m_selectScope == SJ_SELECTSCOPE_TRACKS );
+		where = where.IsEmpty()? restrictSql : (wxT("(") + where + wxT(") AND ") + restrictSql);
+	}
+
 	//
 	// limit macros for the select
 	//
@@ -1516,12 +1692,61 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 				retHash->Insert(innerSql.GetLong(0), 1);
 			}
 		}
-		else
+		else if( !s_albumsPerQuery )
 		{
 			//
 			// select complete albums
 			//
 
+			bool        hasInnerLimit = (limit[LIMIT_BYTES].IsSet()||limit[LIMIT_MS].IsSet()||limit[LIMIT_TRACKS].IsSet());
+
+			// collect the matching albums in the wanted order; the temporary table numbers them
+			// by their position as INSERT keeps the order given by ORDER BY.  Albums whose tracks
+			// are all excluded still count for the album limit, this was always the case.
+			innerSql.Query(wxT("CREATE TEMP TABLE IF NOT EXISTS advsearchalbums (advpos INTEGER PRIMARY KEY, advalbumid INTEGER);"));
+			innerSql.Query(wxT("DELETE FROM advsearchalbums;"));
+
+			wxString                            albumQuery =  wxT("INSERT INTO advsearchalbums (advalbumid) SELECT DISTINCT albumid FROM tracks");
+			if( !where.IsEmpty() )            { albumQuery += wxT(" WHERE ") + where;       }
+			if( !orderBy.IsEmpty() )          { albumQuery += wxT(" ORDER BY ") + orderBy;  }
+			if( limit[LIMIT_ALBUMS].IsSet() ) { albumQuery += wxString::Format(wxT(" LIMIT %i"), (int)limit[LIMIT_ALBUMS].m_max.GetLo()); }
+			albumQuery += wxT(";");
+			#ifdef __WXDEBUG__
+				{ wxString queryDebug__(albumQuery); queryDebug__.Replace(wxT("%"), wxT("%%")); wxLogDebug(queryDebug__); }
+			#endif
+			innerSql.Query(albumQuery);
+
+			// get the tracks of all albums in a single pass, album by album;
+			// the tracks of an album come in the order of their IDs as before with "WHERE albumid=..."
+			wxString                            query =  wxT("SELECT ") + fields + wxT(" FROM advsearchalbums, tracks WHERE tracks.albumid=advalbumid");
+			if( !excl.IsEmpty() )             { query += wxT(" AND (") + excl + wxT(")"); }
+			query += wxT(" ORDER BY advpos, tracks.id;");
+			#ifdef __WXDEBUG__
+				{ wxString queryDebug__(query); queryDebug__.Replace(wxT("%"), wxT("%%")); wxLogDebug(queryDebug__); }
+			#endif
+
+			innerSql.Query(query);
+			while( innerSql.Next() )
+			{
+				if( hasInnerLimit )
+				{
+					CHECK_LIMIT     (LIMIT_BYTES);
+					CHECK_LIMIT     (LIMIT_MS);
+					CHECK_LIMIT_INC (LIMIT_TRACKS);
+				}
+
+				// add the track to the result
+				retHash->Insert(innerSql.GetLong(0), 1);
+			}
+
+			innerSql.Query(wxT("DELETE FROM advsearchalbums;"));
+		}
+		else
+		{
+			//
+			// select complete albums, one query per album (see s_albumsPerQuery)
+			//
+
 			bool        hasInnerLimit = (limit[LIMIT_BYTES].IsSet()||limit[LIMIT_MS].IsSet()||limit[LIMIT_TRACKS].IsSet());
 			wxSqlt      outerSql;
 
@@ -1530,9 +1755,6 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 			if( !where.IsEmpty() )            { outerQuery += wxT(" WHERE ") + where;       }
 			if( !orderBy.IsEmpty() )          { outerQuery += wxT(" ORDER BY ") + orderBy;  }
 			outerQuery += wxT(";");
-			#ifdef __WXDEBUG__
-				{ wxString queryDebug__(outerQuery); queryDebug__.Replace(wxT("%"), wxT("%%")); wxLogDebug(queryDebug__); }
-			#endif
 
 			// build inner query
 			wxString                            innerQuery =  wxT("SELECT ") + fields + wxT(" FROM tracks WHERE albumid=%i");
@@ -1567,6 +1789,9 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 	// done so far
 	//
 
+	s_idSets[ID_SET_INCL].Empty();
+	s_idSets[ID_SET_EXCL].Empty();
+
 	stat.m_advResultCount = retHash->GetCount();
 	if( limit[LIMIT_BYTES].IsSet() )
 	{
@@ -1608,6 +1833,352 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 }
 
 
+/*******************************************************************************
+ *  SjAdvSearch::GetAsSqlCached() and the materialized selections
+ ******************************************************************************/
+
+
+#define CACHE_MAX_ENTRIES       8
+#define CACHE_MAX_CHANGES       1000    // if more tracks are changed, the cached results are dropped
+#define CACHE_TIME_RELATIVE_MS  60000   // results depending on dates as "today" are recalculated after this time
+
+
+class SjAdvSearchCacheEntry
+{
+public:
+	SjAdvSearch     m_search;
+	SjSearchStat    m_stat;
+	wxString        m_sql;
+	wxArrayLong     m_ids;          // the resulting track IDs, allows random access
+	SjLLHash        m_idIndex;      // maps the track IDs to their index in m_ids plus 1
+	bool            m_incremental;  // if set, changed tracks can be checked one by one
+	unsigned long   m_expires;      // 0=never
+
+	void            SetIds          (SjLLHash* ids);
+	void            ApplyChanges    (const wxArrayLong& changedIds);
+};
+
+
+static wxArrayPtrVoid s_cacheEntries;         // the most recently used entry comes first
+static bool           s_cacheTriggers = FALSE; // set if the triggers filling sjtrackschanged exist
+static int            s_cacheTotalChanges = 0; // sqlite3_total_changes() after the last sync
+
+
+void SjAdvSearchCacheEntry::SetIds(SjLLHash* ids)
+{
+	long id;
+	SjHashIterator iterator;
+
+	m_ids.Empty();
+	m_ids.Alloc(ids->GetCount());
+	m_idIndex.Clear();
+	while( ids->Iterate(iterator, &id) )
+	{
+		m_ids.Add(id);
+		m_idIndex.Insert(id, m_ids.GetCount());
+	}
+}
+
+
+void SjAdvSearchCacheEntry::ApplyChanges(const wxArrayLong& changedIds)
+{
+	wxASSERT( m_incremental );
+
+	// find out which of the changed tracks match the search now; deleted tracks never match
+	size_t i, iCount = changedIds.GetCount();
+	wxString restrictSql;
+	restrictSql.Alloc(iCount*7+16);
+	restrictSql = wxT("id IN (");
+	for( i = 0; i < iCount; i++ )
+	{
+		if( i ) restrictSql << wxT(",");
+		restrictSql << changedIds[i];
+	}
+	restrictSql << wxT(")");
+
+	SjLLHash matchingIds;
+	wxString dummySql;
+	m_search.DoGetAsSql(&matchingIds, dummySql, restrictSql);
+
+	// add or remove the changed tracks; removing swaps the last ID into the gap
+	long id, index, lastId;
+	for( i = 0; i < iCount; i++ )
+	{
+		id = changedIds[i];
+		index = m_idIndex.Lookup(id);
+		if( matchingIds.Lookup(id) )
+		{
+			if( index == 0 )
+			{
+				m_ids.Add(id);
+				m_idIndex.Insert(id, m_ids.GetCount());
+			}
+		}
+		else if( index )
+		{
+			lastId = m_ids.Last();
+			m_ids[index-1] = lastId;
+			m_idIndex.Insert(lastId, index);
+			m_ids.RemoveAt(m_ids.GetCount()-1);
+			m_idIndex.Remove(id);
+		}
+	}
+
+	m_stat.m_advResultCount = m_ids.GetCount();
+	m_sql = m_ids.IsEmpty()? wxT("(0)") : wxT("INFILTER(tracks.id)");
+}
+
+
+static void update_triggers(wxSqlt& sql)
+{
+	// the triggers recording the changed tracks exist only while there are incremental entries;
+	// otherwise every write to the tracks table, eg. during a library update, would fill sjtrackschanged for nothing
+	bool needed = FALSE;
+	size_t i, iCount = s_cacheEntries.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		if( ((SjAdvSearchCacheEntry*)s_cacheEntries[i])->m_incremental )
+		{
+			needed = TRUE;
+			break;
+		}
+	}
+
+	if( needed && !s_cacheTriggers )
+	{
+		sql.Query(wxT("CREATE TEMP TRIGGER IF NOT EXISTS sjtracksinserted AFTER INSERT ON tracks BEGIN INSERT OR IGNORE INTO sjtrackschanged (id) VALUES (NEW.id); END;"));
+		sql.Query(wxT("CREATE TEMP TRIGGER IF NOT EXISTS sjtracksupdated AFTER UPDATE ON tracks BEGIN INSERT OR IGNORE INTO sjtrackschanged (id) VALUES (OLD.id); INSERT OR IGNORE INTO sjtrackschanged (id) VALUES (NEW.id); END;"));
+		sql.Query(wxT("CREATE TEMP TRIGGER IF NOT EXISTS sjtracksdeleted AFTER DELETE ON tracks BEGIN INSERT OR IGNORE INTO sjtrackschanged (id) VALUES (OLD.id); END;"));
+		s_cacheTriggers = TRUE;
+	}
+	else if( !needed && s_cacheTriggers )
+	{
+		sql.Query(wxT("DROP TRIGGER IF EXISTS sjtracksinserted;"));
+		sql.Query(wxT("DROP TRIGGER IF EXISTS sjtracksupdated;"));
+		sql.Query(wxT("DROP TRIGGER IF EXISTS sjtracksdeleted;"));
+		sql.Query(wxT("DELETE FROM sjtrackschanged;"));
+		s_cacheTriggers = FALSE;
+	}
+
+	s_cacheTotalChanges = sqlite3_total_changes(sql.GetDb()->GetDb());
+}
+
+
+static void clear_cache()
+{
+	size_t i, iCount = s_cacheEntries.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		delete (SjAdvSearchCacheEntry*)s_cacheEntries[i];
+	}
+	s_cacheEntries.Empty();
+}
+
+
+void SjAdvSearch::ClearCache()
+{
+	wxASSERT( wxThread::IsMain() );
+
+	clear_cache();
+
+	wxSqlt sql;
+	sql.Query(wxT("SELECT COUNT(*) FROM sqlite_temp_master WHERE name='sjtrackschanged';"));
+	if( sql.Next() && sql.GetLong(0) )
+	{
+		update_triggers(sql); // drops the triggers
+	}
+}
+
+
+static void sync_cache()
+{
+	// Changes to the tracks table are recorded by some temporary triggers, whoever does them
+	// (tag editor, ratings, playback statistics ...). The triggers and the table are bound to the
+	// database connection, so they're missing on the first call and after another database was
+	// opened; the cache is cleared then.
+	wxSqlt sql;
+	sql.Query(wxT("SELECT COUNT(*) FROM sqlite_temp_master WHERE name='sjtrackschanged';"));
+	if( !sql.Next() || sql.GetLong(0) == 0 )
+	{
+		clear_cache();
+		sql.Query(wxT("CREATE TEMP TABLE sjtrackschanged (id INTEGER PRIMARY KEY);"));
+		s_cacheTriggers = FALSE;
+		update_triggers(sql);
+		return;
+	}
+
+	// nothing written on this connection since the last sync? (sqlite3_total_changes() also counts the rows
+	// written by the triggers; the counter is taken in update_triggers() after our own DELETE, so emptying
+	// sjtrackschanged below does not count as a change)
+	if( sqlite3_total_changes(sql.GetDb()->GetDb()) == s_cacheTotalChanges )
+	{
+		return;
+	}
+
+	// get the changed tracks
+	wxArrayLong changedIds;
+	if( s_cacheTriggers )
+	{
+		sql.Query(wxT("SELECT id FROM sjtrackschanged LIMIT ") + sql.LParam(CACHE_MAX_CHANGES+1) + wxT(";"));
+		while( sql.Next() )
+		{
+			changedIds.Add(sql.GetLong(0));
+		}
+
+		if( !changedIds.IsEmpty() )
+		{
+			sql.Query(wxT("DELETE FROM sjtrackschanged;"));
+		}
+	}
+
+	// update the cached results; non-incremental entries are dropped on any write as we do not know what has changed.
+	size_t i;
+	SjAdvSearchCacheEntry* entry;
+	for( i = 0; i < s_cacheEntries.GetCount(); i++ )
+	{
+		entry = (SjAdvSearchCacheEntry*)s_cacheEntries[i];
+		if( entry->m_incremental && s_cacheTriggers && changedIds.GetCount() <= CACHE_MAX_CHANGES )
+		{
+			if( !changedIds.IsEmpty() )
+			{
+				entry->ApplyChanges(changedIds);
+			}
+		}
+		else
+		{
+			delete entry;
+			s_cacheEntries.RemoveAt(i);
+			i--;
+		}
+	}
+
+	update_triggers(sql);
+}
+
+
+bool SjAdvSearch::IsCacheable(bool& retIncremental, bool& retTimeRelative) const
+{
+	retIncremental  = (m_selectScope == SJ_SELECTSCOPE_TRACKS);
+	retTimeRelative = FALSE;
+
+	if( m_id == 0 || !IsSet() )
+	{
+		return FALSE;
+	}
+
+	size_t r, rCount = m_rules.GetCount();
+	long orderById;
+	for( r = 0; r < rCount; r++ )
+	{
+		const SjRule& rule = m_rules[r];
+		switch( rule.m_field )
+		{
+			case SJ_PSEUDOFIELD_SQL:
+			case SJ_PSEUDOFIELD_QUEUEPOS:
+				return FALSE; // the result may depend on anything
+
+			case SJ_PSEUDOFIELD_LIMIT:
+				SjTools::ParseNumber(rule.m_value[1], &orderById);
+				if( orderById == SJ_PSEUDOFIELD_RANDOM )
+				{
+					return FALSE; // each call should get another random selection
+				}
+				retIncremental = FALSE; // a changed track may affect the others
+				break;
+
+			default:
+				if( SjRule::GetFieldType(rule.m_field) == SJ_FIELDTYPE_DATE )
+				{
+					retTimeRelative = TRUE; // we do not check if the date is relative, eg. "today -7"
+				}
+				break;
+		}
+	}
+
+	return TRUE;
+}
+
+
+SjAdvSearchCacheEntry* SjAdvSearch::GetCacheEntry() const
+{
+	wxASSERT( wxThread::IsMain() );
+
+	bool incremental, timeRelative;
+	if( !IsCacheable(incremental, timeRelative) )
+	{
+		return NULL;
+	}
+
+	if( SjBusyInfo::InYield() )
+	{
+		return NULL; // eg. the library is updated just now, do not start recording the changes
+	}
+
+	sync_cache();
+
+	// search for an existing entry
+	size_t i, iCount = s_cacheEntries.GetCount();
+	SjAdvSearchCacheEntry* entry;
+	for( i = 0; i < iCount; i++ )
+	{
+		entry = (SjAdvSearchCacheEntry*)s_cacheEntries[i];
+		if( entry->m_search == *this )
+		{
+			s_cacheEntries.RemoveAt(i);
+			if( entry->m_expires == 0 || (long)(entry->m_expires - SjTools::GetMsTicks()) > 0 )
+			{
+				s_cacheEntries.Insert(entry, 0);
+				return entry;
+			}
+
+			delete entry; // expired
+			break;
+		}
+	}
+
+	// create a new entry
+	SjLLHash ids;
+	entry = new SjAdvSearchCacheEntry;
+	entry->m_search      = *this;
+	entry->m_stat        = DoGetAsSql(&ids, entry->m_sql, wxEmptyString);
+	entry->m_incremental = incremental;
+	entry->m_expires     = timeRelative? SjTools::GetMsTicks()+CACHE_TIME_RELATIVE_MS : 0;
+	entry->SetIds(&ids);
+
+	s_cacheEntries.Insert(entry, 0);
+	while( s_cacheEntries.GetCount() > CACHE_MAX_ENTRIES )
+	{
+		delete (SjAdvSearchCacheEntry*)s_cacheEntries.Last();
+		s_cacheEntries.RemoveAt(s_cacheEntries.GetCount()-1);
+	}
+
+	wxSqlt sql;
+	update_triggers(sql);
+
+	return entry;
+}
+
+
+SjSearchStat SjAdvSearch::GetAsSqlCached(SjLLHash* retHash, wxString& retSql) const
+{
+	SjAdvSearchCacheEntry* entry = GetCacheEntry();
+	if( entry == NULL )
+	{
+		return GetAsSql(retHash, retSql);
+	}
+
+	size_t i, iCount = entry->m_ids.GetCount();
+	retHash->Clear();
+	for( i = 0; i < iCount; i++ )
+	{
+		retHash->Insert(entry->m_ids[i], 1);
+	}
+
+	retSql = entry->m_sql;
+	return entry->m_stat;
+}
+
+
 wxString SjAdvSearch::GetRandomUrl() const
 {
 	// advanced search valid?
@@ -1615,6 +2186,15 @@ wxString SjAdvSearch::GetRandomUrl() const
 		return ""; // advanced search not valid.
 	}
 
+	// materialized selection? this allows random access
+	SjAdvSearchCacheEntry* entry = GetCacheEntry();
+	if( entry ) {
+		if( entry->m_ids.IsEmpty() ) {
+			return ""; // no tracks at all.
+		}
+		return g_mainFrame->m_libraryModule->GetUrl(entry->m_ids[SjTools::Rand(entry->m_ids.GetCount())]);
+	}
+
 	// get all hash IDs
 	SjLLHash trackIdsHash;
 	{
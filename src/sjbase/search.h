@@ -276,9 +276,11 @@ public:
 	bool            Unserialize         (SjStringSerializer&);
 
 	// special stuff for include/exclude IDs
-	// (internally, the IDs are stored in a string as ",123,456,78," (note the commas at start/end!)
+	// (internally, the IDs are stored in a string as ",78,123,456," (note the commas at start/end!);
+	// the IDs are kept sorted and unique, so adding and removing is done by merging sorted arrays)
 	long            GetInclExclCount    () const;
 	wxString        GetInclExclDescr    () const;
+	void            GetInclExclIds      (wxArrayLong& retSortedIds) const;
 	void            RemoveFromInclExcl  (SjLLHash* ids);
 	void            AddToInclExcl       (SjLLHash* ids);
 	void            AddToInclExcl       (const wxString& idsToAdd);
@@ -312,6 +314,9 @@ WX_DECLARE_OBJARRAY(SjRule, SjArrayRule);
 
 
 
+class SjAdvSearchCacheEntry;
+
+
 class SjAdvSearch
 {
 public:
@@ -347,6 +352,23 @@ public:
 	// Normally, the function returns sth. like "(1)", "(0)" or "INFILTER(tracks.id)"
 	SjSearchStat    GetAsSql            (SjLLHash*, wxString&) const;
 
+	// Same as GetAsSql() but the result of saved searches is cached and updated
+	// with the changed tracks only. Searches that depend on the queue, on random
+	// values or on plain SQL are never cached.
+	SjSearchStat    GetAsSqlCached      (SjLLHash*, wxString&) const;
+
+	// drop the cached results and stop recording changes, should be called before
+	// larger changes to the library, eg. before an update
+	static void     ClearCache          ();
+
+	// used by the SQL-Function INIDSET(set, id) while GetAsSql() runs its queries;
+	// set 0 contains the manually included IDs, set 1 the excluded ones
+	static bool     IsInIdSet           (int set, long id);
+
+	// if set, complete albums are selected by one query per album as done before the joined
+	// query was introduced; only used by the testdrive to compare the results and the timings
+	static bool     s_albumsPerQuery;
+
 	// Get concrete URLs
 	wxString        GetRandomUrl        () const;
 
@@ -370,8 +392,13 @@ private:
 	void            CopyFrom            (const SjAdvSearch& o);
 	bool            IsEqualTo           (const SjAdvSearch& o) const;
 
+	SjSearchStat    DoGetAsSql          (SjLLHash*, wxString&, const wxString& restrictSql) const;
+	bool            IsCacheable         (bool& retIncremental, bool& retTimeRelative) const;
+	SjAdvSearchCacheEntry* GetCacheEntry() const;
+
 	friend class    SjAdvSearchDialog;
 	friend class    SjAdvSearchModule;
+	friend class    SjAdvSearchCacheEntry;
 };
 
 
@@ -37,6 +37,7 @@
 #include <sjbase/base.h>
 #include <sjtools/imgthread.h>
 #include <sjtools/msgbox.h>
+#include <sjtools/peaks.h>
 #include <sjbase/skin.h>
 #include <sjbase/skinml.h>
 #include <sjmodules/kiosk/kiosk.h>
@@ -45,6 +46,7 @@
 #include <sjmodules/vis/vis_bg.h>
 #include <see_dom/sj_see.h>
 #include <wx/display.h>
+#include <wx/stopwatch.h>
 
 #include <wx/listimpl.cpp> // sic!
 WX_DEFINE_LIST(SjSkinImageList);
@@ -264,6 +266,16 @@ void SjSkinItem::RedrawMe()
 		return;
 	}
 
+	m_skinWindow->m_paintStat.m_itemRedraws++;
+
+	// redraw later together with other items? (not while dragging, the drag image is handled item by item)
+	if( m_skinWindow->m_updateBatch > 0 && m_skinWindow->m_dragImage == NULL )
+	{
+		m_skinWindow->m_updateRegion.Union(m_rect);
+		m_skinWindow->m_paintStat.m_itemRedrawsCoalesced++;
+		return;
+	}
+
 	// check if there are items ABOVE this item
 	if( m_hasOverlayingItems==-1 /*don't know yet*/ )
 	{
@@ -306,15 +318,12 @@ void SjSkinItem::RedrawMe()
 		bool drawDone = FALSE;
 
 		// ...drawing offscreen to avoid flickering
-		wxBitmap    memBitmap(m_rect.width, m_rect.height);
 		wxMemoryDC  memDc;
-		memDc.SelectObject(memBitmap);
-		if( memDc.IsOk() )
+		if( m_skinWindow->SelectBackBuffer(memDc) )
 		{
 			HideDragImage();
-			m_skinWindow->RedrawAll(memDc, &m_rect, 0-m_rect.x, 0-m_rect.y);
-			m_skinWindow->RedrawFinalLines(memDc, 0-m_rect.x, 0-m_rect.y);
-			dc.Blit(m_rect.x, m_rect.y, m_rect.width, m_rect.height, &memDc, 0, 0);
+			m_skinWindow->RedrawViaBackBuffer(dc, memDc, m_rect);
+			m_skinWindow->ReleaseBackBuffer(memDc);
 			ShowDragImage();
 			drawDone = TRUE;
 		}
@@ -1918,6 +1927,14 @@ SjSkinScrollbarItem::SjSkinScrollbarItem()
 
 	m_hideIfUnused = FALSE;
 	m_hideScrollbar = FALSE;
+
+	m_peaks     = NULL;
+}
+
+
+SjSkinScrollbarItem::~SjSkinScrollbarItem()
+{
+	delete m_peaks;
 }
 
 
@@ -1938,6 +1955,13 @@ bool SjSkinScrollbarItem::Create(const wxHtmlTag& tag, wxString& error)
 		m_hideScrollbar = TRUE;
 	}
 
+	wxColour peaksColour;
+	if( tag.GetParamAsColour(wxT("PEAKCOLOR"), &peaksColour) )
+	{
+		m_peaks = new SjPeaks();
+		m_peaksPen.SetColour(peaksColour);
+	}
+
 
 	// hotizontal or vertical scrollbar? flip scrollbar?
 	if( m_image->GetSubimageYCount() >= 5 )
@@ -2028,6 +2052,23 @@ void SjSkinScrollbarItem::SetValue(const SjSkinValue& value)
 {
 	wxASSERT(value.thumbSize >= 0);
 
+	// new waveform overview? the given peaks may be changed by the caller, so we make a copy
+	if( m_peaks )
+	{
+		bool peaksChanged = false;
+		if( value.peaks == NULL ) {
+			if( !m_peaks->IsEmpty() ) { m_peaks->Clear(); peaksChanged = true; }
+		}
+		else if( value.peaks->GetUrl() != m_peaks->GetUrl() || value.peaks->GetCount() != m_peaks->GetCount() ) {
+			m_peaks->CopyFrom(*value.peaks);
+			peaksChanged = true;
+		}
+
+		if( peaksChanged ) {
+			RedrawMe();
+		}
+	}
+
 	long newMin   = value.vmin;
 	long newMax   = value.vmax;
 	long newValue = value.value;
@@ -2397,6 +2438,34 @@ void SjSkinScrollbarItem::OnPaint(wxDC& dc)
 			// then useing wxClientDC (wxPaintDC is fine). See also SjTools::DrawBitmapHBg() and SjTools::DrawBitmapVBg().
 			// If we encounter other errors, we should avoid clipping in these functions and use wxDC::GetSubBitmap()
 			// instead.
+
+		if( m_peaks && !m_peaks->IsEmpty() && m_horizontal )
+		{
+			DrawPeaks(dc);
+		}
+	}
+}
+
+
+void SjSkinScrollbarItem::DrawPeaks(wxDC& dc)
+{
+	// draw one vertical line per pixel, the thumb is left out
+	long count = m_peaks->GetCount(), width = m_allRect.width, x, first, last;
+	long halfHeight = m_allRect.height / 2, yCenter = m_allRect.y + halfHeight;
+	float min, max;
+	dc.SetPen(m_peaksPen);
+	for( x = 0; x < width; x++ )
+	{
+		if( m_allRect.x+x >= m_thumbPart.m_rect.x && m_allRect.x+x < m_thumbPart.m_rect.x+m_thumbPart.m_rect.width ) {
+			continue;
+		}
+
+		first = (x * count) / width;
+		last  = ((x+1) * count) / width; if( last <= first ) last = first+1;
+		m_peaks->GetMinMax(first, last, min, max);
+
+		dc.DrawLine(m_allRect.x+x, yCenter - (long)(max*halfHeight),
+		            m_allRect.x+x, yCenter - (long)(min*halfHeight) + 1);
 	}
 }
 
@@ -2678,6 +2747,187 @@ bool SjSkinDivItem::Create(const wxHtmlTag& tag, wxString& error)
 }
 
 
+/*******************************************************************************
+ * SjSkinItemGrid
+ ******************************************************************************/
+
+
+#define GRID_MIN_CELL_SIZE  32  // in pixels
+#define GRID_MAX_CELLS      64  // per row/column, larger windows get larger cells
+
+
+SjSkinItemGrid::SjSkinItemGrid()
+{
+	m_layout    = NULL;
+	m_cells     = NULL;
+	m_cellSize  = GRID_MIN_CELL_SIZE;
+	m_cols      = 0;
+	m_rows      = 0;
+	m_currStamp = 0;
+}
+
+
+void SjSkinItemGrid::Clear()
+{
+	delete [] m_cells;
+	m_cells     = NULL;
+	m_cols      = 0;
+	m_rows      = 0;
+	m_layout    = NULL;
+	m_items.Empty();
+	m_stamps.Empty();
+}
+
+
+bool SjSkinItemGrid::GetCellRange(const wxRect& r, long& col1, long& row1, long& col2, long& row2) const
+{
+	if( r.width <= 0 || r.height <= 0 )
+	{
+		return FALSE;
+	}
+
+	col1 = r.x / m_cellSize;                if( col1 < 0 ) col1 = 0;
+	row1 = r.y / m_cellSize;                if( row1 < 0 ) row1 = 0;
+	col2 = (r.x+r.width-1) / m_cellSize;    if( col2 >= m_cols ) col2 = m_cols-1;
+	row2 = (r.y+r.height-1) / m_cellSize;   if( row2 >= m_rows ) row2 = m_rows-1;
+
+	return (r.x+r.width > 0 && r.y+r.height > 0 && col1 <= col2 && row1 <= row2);
+}
+
+
+void SjSkinItemGrid::Build(SjSkinLayout* layout, long width, long height)
+{
+	Clear();
+
+	if( layout == NULL || width <= 0 || height <= 0 )
+	{
+		return;
+	}
+
+	m_cellSize = wxMax(width, height) / GRID_MAX_CELLS;
+	if( m_cellSize < GRID_MIN_CELL_SIZE ) m_cellSize = GRID_MIN_CELL_SIZE;
+	m_cols  = (width +m_cellSize-1) / m_cellSize;
+	m_rows  = (height+m_cellSize-1) / m_cellSize;
+	m_cells = new wxArrayLong[m_cols*m_rows];
+
+	// add the items in painting order, so the indices in each cell are ascending
+	SjSkinItemList::Node* itemnode = layout->m_itemList.GetFirst();
+	long col1, row1, col2, row2, col, row;
+	while( itemnode )
+	{
+		SjSkinItem* item = itemnode->GetData();
+		wxASSERT(item);
+
+		if( (item->m_usesPaint || item->m_usesMouse)
+		 && GetCellRange(item->m_rect, col1, row1, col2, row2) )
+		{
+			long index = m_items.GetCount();
+			m_items.Add(item);
+			m_stamps.Add(0);
+			for( row = row1; row <= row2; row++ )
+			{
+				for( col = col1; col <= col2; col++ )
+				{
+					m_cells[row*m_cols+col].Add(index);
+				}
+			}
+		}
+
+		itemnode = itemnode->GetNext();
+	}
+
+	m_layout = layout;
+}
+
+
+static int compare_indices(long* i1, long* i2)
+{
+	return (*i1 < *i2)? -1 : ((*i1 > *i2)? 1 : 0);
+}
+
+
+void SjSkinItemGrid::GetItems(const wxRect& rect, wxArrayPtrVoid& retItems)
+{
+	retItems.Empty();
+
+	long col1, row1, col2, row2, col, row;
+	if( !GetCellRange(rect, col1, row1, col2, row2) )
+	{
+		return;
+	}
+
+	// collect the intersecting items of all cells, each item only once
+	m_currStamp++;
+	wxArrayLong indices;
+	size_t i, iCount;
+	long index;
+	for( row = row1; row <= row2; row++ )
+	{
+		for( col = col1; col <= col2; col++ )
+		{
+			const wxArrayLong& cell = m_cells[row*m_cols+col];
+			iCount = cell.GetCount();
+			for( i = 0; i < iCount; i++ )
+			{
+				index = cell[i];
+				if( m_stamps[index] != m_currStamp )
+				{
+					m_stamps[index] = m_currStamp;
+					if( rect.Intersects(((SjSkinItem*)m_items[index])->m_rect) )
+					{
+						indices.Add(index);
+					}
+				}
+			}
+		}
+	}
+
+	// back to painting order
+	if( row1 != row2 || col1 != col2 )
+	{
+		indices.Sort(compare_indices);
+	}
+
+	iCount = indices.GetCount();
+	retItems.Alloc(iCount);
+	for( i = 0; i < iCount; i++ )
+	{
+		retItems.Add(m_items[indices[i]]);
+	}
+}
+
+
+SjSkinItem* SjSkinItemGrid::FindClickableItem(long x, long y) const
+{
+	wxASSERT( Contains(x, y) );
+
+	// check the items of the cell from last to first as the last item is atop
+	const wxArrayLong& cell = m_cells[(y/m_cellSize)*m_cols + (x/m_cellSize)];
+	SjSkinItem* item;
+	long i;
+	for( i = (long)cell.GetCount()-1; i >= 0; i-- )
+	{
+		item = (SjSkinItem*)m_items[cell[i]];
+		if(  item->m_usesMouse
+		 #ifdef SJ_SKIN_USE_HIDE
+		 && !item->m_hidden
+		 #endif
+		  )
+		{
+			if( x >= item->m_rect.x
+			 && y >= item->m_rect.y
+			 && x < (item->m_rect.x + item->m_rect.width)
+			 && y < (item->m_rect.y + item->m_rect.height) )
+			{
+				return item;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
 /*******************************************************************************
  * SjSkin - Loading And Selecting Skins
  ******************************************************************************/
@@ -2718,6 +2968,8 @@ SjSkinWindow::SjSkinWindow(wxWindow* parent, wxWindowID id, long skinFlags, cons
 	m_dragImage             = NULL;
 	m_mouseInDisplayMove    = false;
 	m_inputWindowFontHeight = -1;
+	m_backBufferInUse       = false;
+	m_updateBatch           = 0;
 
 	m_skinFlags             = skinFlags;
 }
@@ -2878,6 +3130,7 @@ void SjSkinWindow::LoadLayout(SjSkinLayout* newLayout /*may be NULL*/,
 	//      set the new layout
 	//          >>>>>>>>>>>>>>>>>>
 
+	m_itemGrid.Clear();
 	m_currLayout = newLayout; // m_currLayout may be NULL now
 
 	// create an item list for every target
@@ -3321,6 +3574,8 @@ void SjSkinWindow::CalcItemRectangles(long width, long height)
 		CalcChildItemRectangles(item);
 	}
 
+	m_itemGrid.Build(m_currLayout, width, height);
+
 	// move away unused windows
 	if(   m_workspaceWindow
 	 && (   !m_currLayout->m_hasWorkspace
@@ -3351,6 +3606,17 @@ void SjSkinWindow::CalcItemRectangles(long width, long height)
 
 
 SjSkinItem* SjSkinWindow::FindClickableItem(long x, long y) const
+{
+	if( m_itemGrid.IsBuiltFor(m_currLayout) && m_itemGrid.Contains(x, y) )
+	{
+		return m_itemGrid.FindClickableItem(x, y);
+	}
+
+	return FindClickableItemLinear(x, y); // eg. the mouse is captured and outside the window
+}
+
+
+SjSkinItem* SjSkinWindow::FindClickableItemLinear(long x, long y) const
 {
 	// try all other items (from last to first as the last
 	// item is atop)
@@ -3432,8 +3698,18 @@ void SjSkinWindow::SetSkinTargetValue(int targetId, const SjSkinValue& value, bo
 		}
 	}
 
+	// anything changed?
+	m_paintStat.m_targetUpdates++;
+	if( m_targets[targetId].m_valueSet
+	 && m_targets[targetId].m_value == value )
+	{
+		m_paintStat.m_targetUpdatesSkipped++;
+		return;
+	}
+
 	// save the value
 	m_targets[targetId].m_value = value;
+	m_targets[targetId].m_valueSet = TRUE;
 
 	// promote the value to all items using this targets
 	itemnode = m_targets[targetId].m_itemList.GetFirst();
@@ -3870,39 +4146,16 @@ void SjSkinWindow::OnPaint(wxPaintEvent& event)
 	wxPaintDC   dc(this);
 	bool        drawDone = FALSE;
 
-	// draw offscreen
-#if 0
-	// simple but slow, not using the update region
-	wxSize size = GetClientSize();
-
-	wxBitmap    memBitmap(size.x, size.y);
-	wxMemoryDC  memDc;
-	memDc.SelectObject(memBitmap);
-	if( memDc.IsOk() )
-	{
-		RedrawAll(memDc);
-		RedrawFinalLines(memDc);
-
-		dc.Blit(0, 0, size.x, size.y, &memDc, 0, 0);
-		drawDone = TRUE;
-	}
-#else
-	// more complex and fast using the update region
-	wxRegion updateRegion = GetUpdateRegion();
-	wxRect updateRect = updateRegion.GetBox();
+	m_paintStat.m_paintEvents++;
 
-	wxBitmap    memBitmap(updateRect.width, updateRect.height);
+	// draw offscreen
 	wxMemoryDC  memDc;
-	memDc.SelectObject(memBitmap);
-	if( memDc.IsOk() )
+	if( SelectBackBuffer(memDc) )
 	{
-		RedrawAll(memDc, &updateRect, 0-updateRect.x, 0-updateRect.y);
-		RedrawFinalLines(memDc, 0-updateRect.x, 0-updateRect.y);
-
-		dc.Blit(updateRect.x, updateRect.y, updateRect.width, updateRect.height, &memDc, 0, 0);
+		RedrawViaBackBuffer(dc, memDc, GetUpdateRegion());
+		ReleaseBackBuffer(memDc);
 		drawDone = TRUE;
 	}
-#endif
 
 	// draw onscreen
 	if( !drawDone )
@@ -3937,9 +4190,136 @@ void SjSkinWindow::OnImageThere(SjImageThereEvent& event)
 }
 
 
+bool SjSkinWindow::SelectBackBuffer(wxMemoryDC& memDc)
+{
+	// The back buffer is a scratch bitmap for the rectangle just redrawn, it is (re-)selected
+	// into the memory DC by RedrawViaBackBuffer() - so always redraw a rectangle before
+	// copying it to the screen.
+	if( m_backBufferInUse )
+	{
+		return FALSE; // recursive call, the caller should draw onscreen
+	}
+
+	wxSize size = GetClientSize();
+	if( size.x <= 0 || size.y <= 0 )
+	{
+		return FALSE;
+	}
+
+	if( m_backBuffer.IsOk() )
+	{
+		memDc.SelectObject(m_backBuffer);
+	}
+
+	m_backBufferInUse = true;
+	return TRUE;
+}
+
+
+void SjSkinWindow::ReleaseBackBuffer(wxMemoryDC& memDc)
+{
+	memDc.SelectObject(wxNullBitmap);
+	m_backBufferInUse = false;
+}
+
+
+void SjSkinWindow::RedrawViaBackBuffer(wxDC& dc, wxMemoryDC& memDc, const wxRect& rect__)
+{
+	wxSize size = GetClientSize();
+	wxRect rect = rect__;
+	rect.Intersect(wxRect(0, 0, size.x, size.y));
+	if( rect.IsEmpty() )
+	{
+		return;
+	}
+
+	// the items draw in window coordinates, the device origin moves the rectangle to 0/0 of the scratch
+	// bitmap; everything outside the bitmap is clipped, so the cost depends on the bitmap size and not on
+	// the item sizes.  We re-use the bitmap as long as it is at most twice as wide and high as needed.
+	if( !m_backBuffer.IsOk()
+	 ||  m_backBuffer.GetWidth()  < rect.width  ||  m_backBuffer.GetWidth()  > rect.width*2
+	 ||  m_backBuffer.GetHeight() < rect.height ||  m_backBuffer.GetHeight() > rect.height*2 )
+	{
+		memDc.SelectObject(wxNullBitmap);
+		m_backBuffer = wxBitmap(rect.width, rect.height);
+		if( m_backBuffer.IsOk() )
+		{
+			memDc.SelectObject(m_backBuffer);
+		}
+
+		if( !m_backBuffer.IsOk() || !memDc.IsOk() )
+		{
+			RedrawAll(dc, &rect);
+			RedrawFinalLines(dc);
+			return;
+		}
+	}
+
+	memDc.SetDeviceOrigin(-rect.x, -rect.y);
+	RedrawAll(memDc, &rect);
+	RedrawFinalLines(memDc);
+	memDc.SetDeviceOrigin(0, 0);
+	dc.Blit(rect.x, rect.y, rect.width, rect.height, &memDc, 0, 0);
+}
+
+
+void SjSkinWindow::RedrawViaBackBuffer(wxDC& dc, wxMemoryDC& memDc, const wxRegion& region)
+{
+	// redraw rectangle by rectangle; for many small rectangles, the bounding box is faster
+	#define MAX_REGION_RECTS 8
+	int rectCount = 0;
+	wxRegionIterator iterator(region);
+	for( ; iterator; iterator++ ) { rectCount++; }
+
+	if( rectCount > MAX_REGION_RECTS )
+	{
+		RedrawViaBackBuffer(dc, memDc, region.GetBox());
+	}
+	else
+	{
+		for( iterator.Reset(region); iterator; iterator++ )
+		{
+			RedrawViaBackBuffer(dc, memDc, iterator.GetRect());
+		}
+	}
+}
+
+
+void SjSkinWindow::EndSkinTargetUpdates()
+{
+	wxASSERT( m_updateBatch > 0 );
+	if( --m_updateBatch > 0 || m_updateRegion.IsEmpty() )
+	{
+		return;
+	}
+
+	wxRegion region = m_updateRegion;
+	m_updateRegion.Clear();
+	m_paintStat.m_batchRedraws++;
+
+	if( !m_currLayout )
+	{
+		return;
+	}
+
+	wxClientDC  dc(this);
+	wxMemoryDC  memDc;
+	if( SelectBackBuffer(memDc) )
+	{
+		RedrawViaBackBuffer(dc, memDc, region);
+		ReleaseBackBuffer(memDc);
+	}
+	else
+	{
+		wxRect rect = region.GetBox();
+		RedrawAll(dc, &rect);
+		RedrawFinalLines(dc);
+	}
+}
+
+
 void SjSkinWindow::RedrawAll(wxDC& dc,
-                             const wxRect* rect /*may be NULL*/,
-                             long finalMoveX, long finalMoveY)
+                             const wxRect* rect /*may be NULL*/)
 {
 	// layout okay?
 	if( !m_currLayout )
@@ -3951,53 +4331,56 @@ void SjSkinWindow::RedrawAll(wxDC& dc,
 		return; // error
 	}
 
-	// draw all items
-	SjSkinItem*           item;
-	SjSkinItemList::Node* itemnode = m_currLayout->m_itemList.GetFirst();
-	while( itemnode )
+	// collect the items to draw
+	wxArrayPtrVoid items;
+	if( rect && m_itemGrid.IsBuiltFor(m_currLayout) )
 	{
-		item = itemnode->GetData();
-		wxASSERT(item);
-
-		// paint item
-		if( item->m_usesPaint )
+		m_itemGrid.GetItems(*rect, items);
+	}
+	else
+	{
+		SjSkinItemList::Node* itemnode = m_currLayout->m_itemList.GetFirst();
+		while( itemnode )
 		{
+			SjSkinItem* item = itemnode->GetData();
+			wxASSERT(item);
+
 			if( rect == NULL
 			 || rect->Intersects(item->m_rect) )
 			{
-				if( finalMoveX || finalMoveY )
-				{
-					item->m_rect.x += finalMoveX;
-					item->m_rect.y += finalMoveY;
-					item->OnSize();
-				}
+				items.Add(item);
+			}
 
-				#ifdef SJ_SKIN_USE_HIDE
-				if( !item->m_hidden )
-				{
-				#endif
-					item->HideDragImage();
-					item->OnPaint(dc);
-					item->ShowDragImage();
-				#ifdef SJ_SKIN_USE_HIDE
-				}
-				#endif
+			itemnode = itemnode->GetNext();
+		}
+	}
 
-				if( finalMoveX || finalMoveY )
-				{
-					item->m_rect.x -= finalMoveX;
-					item->m_rect.y -= finalMoveY;
-					item->OnSize();
-				}
+	// draw the items
+	SjSkinItem*   item;
+	size_t        i, iCount = items.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		item = (SjSkinItem*)items[i];
+
+		// paint item
+		if( item->m_usesPaint )
+		{
+			#ifdef SJ_SKIN_USE_HIDE
+			if( !item->m_hidden )
+			{
+			#endif
+				item->HideDragImage();
+				item->OnPaint(dc);
+				item->ShowDragImage();
+			#ifdef SJ_SKIN_USE_HIDE
 			}
+			#endif
 		}
-
-		itemnode = itemnode->GetNext();
 	}
 }
 
 
-void SjSkinWindow::RedrawFinalLines(wxDC& dc, long finalMoveX, long finalMoveY)
+void SjSkinWindow::RedrawFinalLines(wxDC& dc)
 {
 	// draw debug outline
 	if( m_currLayout )
@@ -4026,7 +4409,7 @@ void SjSkinWindow::RedrawFinalLines(wxDC& dc, long finalMoveX, long finalMoveY)
 				}
 
 				item->HideDragImage();
-				dc.DrawRectangle(item->m_rect.x+finalMoveX, item->m_rect.y+finalMoveY, item->m_rect.width, item->m_rect.height);
+				dc.DrawRectangle(item->m_rect.x, item->m_rect.y, item->m_rect.width, item->m_rect.height);
 				item->ShowDragImage();
 
 				itemnode = itemnode->GetNext();
@@ -4040,6 +4423,101 @@ void SjSkinWindow::RedrawFinalLines(wxDC& dc, long finalMoveX, long finalMoveY)
 }
 
 
+wxString SjSkinWindow::GetPaintBenchmarkReport()
+{
+	// replay the typical paint and mouse motion events against the current layout:
+	// repainting the whole window, repainting each item as done by SjSkinItem::RedrawMe()
+	// and hit tests on a raster of points, the latter also with the linear search for comparison
+	#define BENCH_FULL_PAINTS   50
+	#define BENCH_RASTER        4
+
+	if( !m_currLayout )
+	{
+		return wxT("Skin benchmark: No skin loaded.");
+	}
+
+	wxMemoryDC memDc;
+	if( !SelectBackBuffer(memDc) )
+	{
+		return wxT("Skin benchmark: Cannot create the back buffer.");
+	}
+
+	// the paints go to a window-sized bitmap instead of the screen
+	wxSize size = GetClientSize();
+	wxRect allRect(0, 0, size.x, size.y);
+	wxBitmap screenBitmap(size.x, size.y);
+	wxMemoryDC screenDc(screenBitmap);
+	wxStopWatch stopWatch;
+	long i, x, y;
+
+	stopWatch.Start();
+	for( i = 0; i < BENCH_FULL_PAINTS; i++ )
+	{
+		RedrawViaBackBuffer(screenDc, memDc, allRect);
+	}
+	double fullPaintUs = stopWatch.TimeInMicro().ToDouble() / BENCH_FULL_PAINTS;
+
+	// item paints via the scratch bitmap and, for comparison, directly into a window-sized bitmap
+	long itemCount = 0, itemPaints = 0;
+	double itemPaintUs = 0.0, itemPaintWindowUs = 0.0;
+	SjSkinItemList::Node* itemnode = m_currLayout->m_itemList.GetFirst();
+	while( itemnode )
+	{
+		SjSkinItem* item = itemnode->GetData();
+		itemCount++;
+		if( item->m_usesPaint && !item->m_rect.IsEmpty() )
+		{
+			stopWatch.Start();
+			RedrawViaBackBuffer(screenDc, memDc, item->m_rect);
+			itemPaintUs += stopWatch.TimeInMicro().ToDouble();
+
+			stopWatch.Start();
+			RedrawAll(screenDc, &item->m_rect);
+			RedrawFinalLines(screenDc);
+			itemPaintWindowUs += stopWatch.TimeInMicro().ToDouble();
+
+			itemPaints++;
+		}
+		itemnode = itemnode->GetNext();
+	}
+	if( itemPaints )
+	{
+		itemPaintUs /= itemPaints;
+		itemPaintWindowUs /= itemPaints;
+	}
+
+	ReleaseBackBuffer(memDc);
+
+	long hits = 0, points = 0;
+	stopWatch.Start();
+	for( y = 0; y < size.y; y += BENCH_RASTER )
+	{
+		for( x = 0; x < size.x; x += BENCH_RASTER )
+		{
+			if( FindClickableItem(x, y) ) hits++;
+			points++;
+		}
+	}
+	double hitTestUs = points? stopWatch.TimeInMicro().ToDouble() / points : 0.0;
+
+	stopWatch.Start();
+	for( y = 0; y < size.y; y += BENCH_RASTER )
+	{
+		for( x = 0; x < size.x; x += BENCH_RASTER )
+		{
+			FindClickableItemLinear(x, y);
+		}
+	}
+	double hitTestLinearUs = points? stopWatch.TimeInMicro().ToDouble() / points : 0.0;
+
+	return wxString::Format(wxT("Skin benchmark: %i items in %ix%i pixels; full paint %.0f us, item paint %.1f us avg, %.1f us avg in a window-sized buffer (%i items), hit test %.3f us avg, linear %.3f us avg (%i points, %i hits)"),
+		(int)itemCount, (int)size.x, (int)size.y,
+		fullPaintUs,
+		itemPaintUs, itemPaintWindowUs, (int)itemPaints,
+		hitTestUs, hitTestLinearUs, (int)points, (int)hits);
+}
+
+
 void SjSkinWindow::OnEraseBackground(wxEraseEvent&)
 {
 	// we won't erease the background explcitly, this is done on
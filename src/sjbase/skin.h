@@ -40,6 +40,7 @@ class SjImgThread;
 class SjImageThereEvent;
 #if SJ_USE_SCRIPTS
 class SjSee;
+class SjPeaks;
 #endif
 
 
@@ -140,6 +141,7 @@ public:
 		vmin        = 0;
 		vmax        = 0;
 		thumbSize   = 0;
+		peaks       = NULL;
 	}
 
 	SjSkinValue&    operator =          (const SjSkinValue& o)
@@ -147,10 +149,18 @@ public:
 		vmin      = o.vmin;
 		vmax      = o.vmax;
 		thumbSize = o.thumbSize;
+		peaks     = o.peaks;
 		string    = o.string;
 		return *this;
 	}
 
+	// the peaks are compared by their pointer only; if the peaks are changed, other values normally change, too
+	bool            operator ==         (const SjSkinValue& o) const
+	{	return (value==o.value && vmin==o.vmin && vmax==o.vmax && thumbSize==o.thumbSize
+		     && peaks==o.peaks && string==o.string);
+	}
+	bool            operator !=         (const SjSkinValue& o) const { return !(*this==o); }
+
 	long            value;              // - 0/1/2/... for <button> normal/selected/other/...
 	                                    // - position for <scrollbar>
 	                                    // - VFLAG_* for <box>
@@ -181,6 +191,8 @@ public:
 
 	long            thumbSize;          // used by <scrollbar>, if != 0, the max. value decreases by thumbSize
 
+	const SjPeaks*  peaks;              // used by <scrollbar>, optional waveform overview, drawn if the skin defines a peak colour
+
 	wxString        string;            // used by <box>
 };
 
@@ -515,6 +527,7 @@ class SjSkinScrollbarItem : public SjSkinItem
 {
 public:
 	                SjSkinScrollbarItem ();
+	                ~SjSkinScrollbarItem();
 	bool            Create              (const wxHtmlTag&, wxString& error);
 	void            SetValue            (const SjSkinValue&);
 	void            OnMouseLeftDown     (long x, long y, bool doubleClick, long accelFlags);
@@ -553,6 +566,11 @@ private:
 	                m_subsequentTimer;
 	bool            m_hideIfUnused,
 	                m_hideScrollbar;
+	// waveform overview, only used for horizontal scrollbars with a peak colour
+	SjPeaks*        m_peaks;
+	wxPen           m_peaksPen;
+	void            DrawPeaks           (wxDC& dc);
+
 	void            SwapNDrawPart       (wxDC& dc, SjSkinScrollbarItemPart&, bool alignMToR = FALSE);
 	SjSkinScrollbarItemPart* SwapNFindPart (long x, long y);
 	void            CheckNSendValue     (long newValue);
@@ -597,6 +615,7 @@ class SjSkinTarget
 private:
 	SjSkinTarget        ()
 	{
+		m_valueSet = FALSE;
 		#ifdef SJ_SKIN_USE_HIDE
 		m_hidden = FALSE;
 		#endif
@@ -607,6 +626,7 @@ private:
 
 	// the value of the target
 	SjSkinValue  m_value;
+	bool            m_valueSet;
 	#ifdef SJ_SKIN_USE_HIDE
 	bool            m_hidden;
 	#endif
@@ -766,6 +786,48 @@ enum SjLoadLayoutFlag
 };
 
 
+class SjSkinPaintStat
+{
+public:
+	// counters to measure the painting load, eg. on idle; they're never reset
+	                SjSkinPaintStat     () { memset(this, 0, sizeof(SjSkinPaintStat)); }
+	long            m_targetUpdates;        // calls to SetSkinTargetValue()
+	long            m_targetUpdatesSkipped; // ... skipped as the value was not changed
+	long            m_itemRedraws;          // items redrawn by a changed value etc.
+	long            m_itemRedrawsCoalesced; // ... deferred to the end of an update batch
+	long            m_batchRedraws;         // update batches with at least one item to redraw
+	long            m_paintEvents;          // paint events sent by the system
+};
+
+
+class SjSkinItemGrid
+{
+public:
+	// The item rectangles of a layout sorted into a grid of cells, each cell lists
+	// the items touching it in painting order. Used to find the items to redraw
+	// and the item under the mouse without checking all items of the layout.
+	                SjSkinItemGrid      ();
+	                ~SjSkinItemGrid     () { Clear(); }
+	void            Clear               ();
+	void            Build               (SjSkinLayout*, long width, long height);
+	bool            IsBuiltFor          (const SjSkinLayout* layout) const { return (m_layout!=NULL && m_layout==layout); }
+	void            GetItems            (const wxRect&, wxArrayPtrVoid& retItems); // in painting order
+	SjSkinItem*     FindClickableItem   (long x, long y) const;
+	bool            Contains            (long x, long y) const { return (x>=0 && y>=0 && x<m_cols*m_cellSize && y<m_rows*m_cellSize); }
+
+private:
+	SjSkinLayout*   m_layout;
+	wxArrayPtrVoid  m_items;            // all items in painting order
+	wxArrayLong*    m_cells;            // indices to m_items, ascending
+	long            m_cellSize,
+	                m_cols,
+	                m_rows;
+	wxArrayLong     m_stamps;           // used by GetItems() to skip items already seen in another cell
+	long            m_currStamp;
+	bool            GetCellRange        (const wxRect&, long& col1, long& row1, long& col2, long& row2) const;
+};
+
+
 class SjSkinWindow : public wxFrame
 {
 public:
@@ -826,6 +888,15 @@ public:
 	// only clickable targets are found
 	int             FindTargetId        (long x, long y) const { SjSkinItem* i=FindClickableItem(x, y); return i? i->m_targetId : 0; }
 
+	// replays paint and mouse motion events against the current layout, used by --skinbenchmark
+	wxString        GetPaintBenchmarkReport();
+
+	// between BeginSkinTargetUpdates() and EndSkinTargetUpdates(), the items are not redrawn
+	// immediately; instead, all changed rectangles are redrawn at once by EndSkinTargetUpdates()
+	void            BeginSkinTargetUpdates () { m_updateBatch++; }
+	void            EndSkinTargetUpdates   ();
+	const SjSkinPaintStat& GetPaintStat () const { return m_paintStat; }
+
 	// direct links to some items in the current layout
 	SjSkinColour*   m_workspaceColours;
 	SjSkinColour    m_workspaceColours__[SJ_COLOUR_COUNT];
@@ -891,7 +962,9 @@ private:
 	void            CalcItemRectangles  (long width, long height);
 	void            CalcChildItemRectangles (SjSkinItem* parent);
 	SjSkinItem*     FindClickableItem   (long x, long y) const;
+	SjSkinItem*     FindClickableItemLinear (long x, long y) const;
 	SjSkinItem*     FindFirstItemByTargetId (int targetId) const;
+	SjSkinItemGrid  m_itemGrid;
 	void            SaveSizes           ();
 
 	// mouse handling
@@ -919,9 +992,18 @@ private:
 	void            OnPaint             (wxPaintEvent&);
 	void            OnImageThere        (SjImageThereEvent&);
 
-	// drawing
-	void            RedrawAll           (wxDC&, const wxRect* rect = NULL, long finalMoveX = 0, long finalMoveY = 0);
-	void            RedrawFinalLines    (wxDC&, long finalMoveX = 0, long finalMoveY = 0);
+	// drawing; the back buffer is a scratch bitmap of about the size of the rectangle redrawn, it is kept between the paint events
+	void            RedrawAll           (wxDC&, const wxRect* rect = NULL);
+	void            RedrawFinalLines    (wxDC&);
+	wxBitmap        m_backBuffer;
+	bool            m_backBufferInUse;
+	bool            SelectBackBuffer    (wxMemoryDC&);
+	void            ReleaseBackBuffer   (wxMemoryDC&);
+	void            RedrawViaBackBuffer (wxDC&, wxMemoryDC&, const wxRect&);
+	void            RedrawViaBackBuffer (wxDC&, wxMemoryDC&, const wxRegion&);
+	int             m_updateBatch;
+	wxRegion        m_updateRegion;
+	SjSkinPaintStat m_paintStat;
 	                DECLARE_EVENT_TABLE ()
 
 	// friend classes
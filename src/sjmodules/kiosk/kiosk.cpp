@@ -2105,20 +2105,20 @@ bool SjKioskModule::CanEnqueue(const wxArrayString& requestedUrls, bool urlsVeri
 	{
 		unsigned long estimatedPlayingTime = SjTools::GetMsTicks() + g_mainFrame->m_player.GetEnqueueTime();
 
+		SjQueue& queue = g_mainFrame->m_player.m_queue;
 		SjPlaylist tempPlaylist;
 		tempPlaylist.Add(requestedUrls, urlsVerified);
 		wxASSERT( requestedUrlsCount == tempPlaylist.GetCount() );
 		for( long i = 0; i < requestedUrlsCount; i++ )
 		{
 			SjPlaylistEntry& entry = tempPlaylist.Item(i);
-			wxArrayLong allQueuePos;
-			if( g_mainFrame->GetAllQueuePosByUrl(entry.GetUrl(), allQueuePos, true/*unplayedOnly*/) > 0 )
+			if( queue.IsEnqueuedUnplayed(entry.GetUrl()) )
 			{
 				g_mainFrame->SetDisplayMsg(_("This track is already in queue,\nplease try again later."), SDM_KIOSK_CANNOT_ENQUEUE_MS);
 				return false;
 			}
 
-			if( g_mainFrame->m_player.m_queue.IsBoring(entry.GetLeadArtistName(), entry.GetTrackName(), estimatedPlayingTime) )
+			if( queue.IsBoring(entry.GetLeadArtistName(), entry.GetTrackName(), estimatedPlayingTime) )
 			{
 				g_mainFrame->SetDisplayMsg(_("This track or artist was just played,\nplease try again later."), SDM_KIOSK_CANNOT_ENQUEUE_MS);
 				return false;
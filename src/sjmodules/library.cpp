@@ -100,8 +100,10 @@
 #include <wx/spinctrl.h>
 #include <sjtools/imgthread.h>
 #include <sjbase/browser.h>
+#include <sjbase/browser_list.h>
 #include <sjbase/columnmixer.h>
 #include <sjtools/msgbox.h>
+#include <sjtools/console.h>
 #include <sjmodules/library.h>
 #include <sjmodules/kiosk/kiosk.h>
 #include <sjmodules/advsearch.h>
@@ -414,7 +416,16 @@ SjLibraryModule::SjLibraryModule(SjInterfaceBase* interf)
 	m_file  = wxT("memory:library.lib");
 	m_name  = _("Combine tracks to albums");
 	m_searchOffsets = NULL;
+	m_searchOffsetsMax = 0;
 	m_searchOffsetsCount = -1; // no search
+	m_searchThread = NULL;
+	m_searchThreadFailed = false;
+	m_dictsVersion = 0;
+	memset(m_dictThreads, 0, sizeof(m_dictThreads));
+	m_filterHashVersion = 0;
+	m_searchThreadFilterVersion = -1;
+	m_searchRefinable = false;
+	m_updateGen = 0;
 	m_filterAzFirstHidden = FALSE;
 	m_hiliteRegExOk = false;
 
@@ -522,6 +533,25 @@ bool SjLibraryModule::FirstLoad()
 			sql.AddColumn(wxT("tracks"), wxT("vis INTEGER DEFAULT 0")); // added in 15.1beta, may be removed soon
 		}
 
+		if( !sql.ColumnExists(wxT("tracks"), wxT("updategen")) )
+		{
+			sql.AddColumn(wxT("tracks"), wxT("updategen INTEGER DEFAULT 0")); // the update generation, see UpdateAllCol()
+		}
+
+		if( !sql.ColumnExists(wxT("tracks"), wxT("keyartist")) )
+		{
+			// the album keys, see CombineTracksToAlbums()
+			sql.AddColumn(wxT("tracks"), wxT("keydir INTEGER DEFAULT 0"));
+			sql.AddColumn(wxT("tracks"), wxT("keyartist INTEGER DEFAULT 0"));
+			sql.AddColumn(wxT("tracks"), wxT("keyalbum INTEGER DEFAULT 0"));
+			sql.AddColumn(wxT("tracks"), wxT("keygenre INTEGER DEFAULT 0"));
+			sql.Query(wxT("CREATE INDEX tracksindex11 ON tracks (keydir);"));
+			sql.Query(wxT("CREATE INDEX tracksindex12 ON tracks (keyartist);"));
+			sql.Query(wxT("CREATE INDEX tracksindex13 ON tracks (keyalbum);"));
+			sql.Query(wxT("CREATE INDEX tracksindex14 ON tracks (keygenre);"));
+			sql.ConfigDeleteEntry(wxT("library/albumkeys"));
+		}
+
 		// create album table, if not exists
 		if( !sql.TableExists(wxT("albums")) )
 		{
@@ -547,6 +577,13 @@ bool SjLibraryModule::FirstLoad()
 				return FALSE;
 			}
 		}
+
+		if( !sql.ColumnExists(wxT("albums"), wxT("sortstr")) )
+		{
+			sql.AddColumn(wxT("albums"), wxT("sortstr TEXT")); // needed to insert albums without a complete recombination
+			sql.Query(wxT("CREATE INDEX albumsindex06 ON albums (sortstr);"));
+			sql.ConfigDeleteEntry(wxT("library/albumkeys"));
+		}
 	}
 
 	// currently not needed, however, this may be useful for future updates of the library
@@ -561,6 +598,16 @@ bool SjLibraryModule::FirstLoad()
 
 void SjLibraryModule::LastUnload()
 {
+	StopDictThreads();
+	InvalidateDicts();
+
+	if( m_searchThread )
+	{
+		m_searchThread->Shutdown();
+		delete m_searchThread;
+		m_searchThread = NULL;
+	}
+
 	if( m_searchOffsets )
 	{
 		free(m_searchOffsets);
@@ -580,9 +627,23 @@ void SjLibraryModule::LastUnload()
 bool SjLibraryModule::WriteTrackInfo(SjTrackInfo* t, long trackId, bool writeArtIds)
 {
 	wxSqlt sql;
+	long   keys[SJ_ALBUMKEY_COUNT] = { 0, 0, 0, 0 };
 
 	wxASSERT(trackId>0);
 
+	// forget the cached information about this track, an empty URL forgets everything;
+	// if the URL changes, the information cached for the old URL are no longer valid as well
+	g_mainFrame->m_columnMixer.InvalidateQuickInfo(t->m_url);
+	if( t->m_validFields & SJ_TI_URL )
+	{
+		sql.Query(wxT("SELECT url FROM tracks WHERE id=") + sql.UParam(trackId) + wxT(";"));
+		if( sql.Next() && sql.GetString(0) != t->m_url )
+		{
+			g_mainFrame->m_columnMixer.InvalidateQuickInfo(sql.GetString(0));
+		}
+	}
+	m_searchRefinable = false;
+
 	wxString artIds;
 	if( writeArtIds )
 	{
@@ -623,6 +684,43 @@ bool SjLibraryModule::WriteTrackInfo(SjTrackInfo* t, long trackId, bool writeArt
 		}
 	}
 
+	// get the old values; used to update the dictionaries and to check if the album may change
+	{
+		sql.Query(wxT("SELECT trackname, leadartistname, orgartistname, composername, albumname, genrename, groupname, comment, url, year, albumid FROM tracks WHERE id=") + sql.UParam(trackId) + wxT(";"));
+		if( sql.Next() )
+		{
+			wxString oldUrl = sql.GetString(8);
+			wxString newUrl = (t->m_validFields & SJ_TI_URL)? t->m_url : oldUrl;
+
+			UpdateDict(SJ_TI_TRACKNAME,         sql.GetString(0), t->m_trackName);
+			UpdateDict(SJ_TI_LEADARTISTNAME,    sql.GetString(1), t->m_leadArtistName);
+			UpdateDict(SJ_TI_ORGARTISTNAME,     sql.GetString(2), t->m_orgArtistName);
+			UpdateDict(SJ_TI_COMPOSERNAME,      sql.GetString(3), t->m_composerName);
+			UpdateDict(SJ_TI_ALBUMNAME,         sql.GetString(4), t->m_albumName);
+			UpdateDict(SJ_TI_GENRENAME,         sql.GetString(5), t->m_genreName);
+			UpdateDict(SJ_TI_GROUPNAME,         sql.GetString(6), t->m_groupName);
+			UpdateDict(SJ_TI_COMMENT,           sql.GetString(7), t->m_comment);
+			UpdateDict(SJ_TI_URL,               oldUrl,           newUrl);
+
+			long oldAlbumId = sql.GetLong(10);
+			if( oldAlbumId == 0
+			 || sql.GetString(1) != t->m_leadArtistName
+			 || sql.GetString(4) != t->m_albumName
+			 || sql.GetString(5) != t->m_genreName
+			 || sql.GetLong(9)   != (long)t->m_year
+			 || oldUrl           != newUrl )
+			{
+				m_albumPendingTracks.Insert(trackId, 1);
+				if( oldAlbumId )
+				{
+					m_albumPendingAlbums.Insert(oldAlbumId, 1);
+				}
+			}
+
+			GetAlbumKeys(t->m_leadArtistName, t->m_albumName, t->m_genreName, newUrl, keys);
+		}
+	}
+
 	// write track data
 	// we're not writing autovol here; this is done in PlaybackDone()
 
@@ -652,6 +750,10 @@ bool SjLibraryModule::WriteTrackInfo(SjTrackInfo* t, long trackId, bool writeArt
 	            wxT("beatsperminute=")  + sql.UParam(t->m_beatsPerMinute)   + wxT(", ")
 	            wxT("rating=")          + sql.UParam(t->m_rating)           + wxT(", ")
 	            wxT("year=")            + sql.UParam(t->m_year)             + wxT(", ")
+	            wxT("keydir=")          + sql.LParam(keys[0])               + wxT(", ")
+	            wxT("keyartist=")       + sql.LParam(keys[1])               + wxT(", ")
+	            wxT("keyalbum=")        + sql.LParam(keys[2])               + wxT(", ")
+	            wxT("keygenre=")        + sql.LParam(keys[3])               + wxT(", ")
 	            wxT("artids='")         + artIds                            + wxT("' ")
 	            wxT(" WHERE id=") + sql.UParam(trackId) + wxT(";")) )
 	{
@@ -674,15 +776,11 @@ bool SjLibraryModule::Callback_MarkAsUpdated(const wxString& urlBegin, long chec
 	{
 		wxSqlt sql;
 
-		sql.Query(wxT("SELECT COUNT(*) FROM tracks WHERE url LIKE '") + sql.QParam(urlBegin) + wxT("%'"));
+		wxString urlCond = sql.PrefixCond(wxT("url"), urlBegin);
+		sql.Query(wxT("SELECT COUNT(*) FROM tracks WHERE ") + urlCond + wxT(";"));
 		if( sql.GetLong(0) == checkTrackCount )
 		{
-			sql.Query(wxT("SELECT id FROM tracks WHERE url LIKE '") + sql.QParam(urlBegin) + wxT("%'"));
-			while( sql.Next() )
-			{
-				m_updatedTracks.Add(sql.GetLong(0));
-			}
-
+			sql.Query(wxT("UPDATE tracks SET updategen=") + sql.LParam(m_updateGen) + wxT(" WHERE ") + urlCond + wxT(";"));
 			return TRUE;
 		}
 	}
@@ -701,7 +799,7 @@ bool SjLibraryModule::Callback_CheckTrackInfo(const wxString& url, uint32_t actu
 		{
 			if( (uint32_t)sql.GetLong(1) == actualCrc )
 			{
-				m_updatedTracks.Add(sql.GetLong(0));
+				StampUpdateGen(sql.GetLong(0));
 				return TRUE;
 			}
 		}
@@ -780,10 +878,11 @@ bool SjLibraryModule::Callback_ReceiveTrackInfo(SjTrackInfo* trackInfo)
 			}
 
 			trackId = sql.GetInsertId();
+			UpdateDict(SJ_TI_URL, wxEmptyString, trackInfo->m_url);
 		}
 	}   /* sql deleted */
 
-	m_updatedTracks.Add(trackId);
+	StampUpdateGen(trackId);
 
 	// update track info
 	if( !WriteTrackInfo(trackInfo, trackId) )
@@ -798,6 +897,26 @@ bool SjLibraryModule::Callback_ReceiveTrackInfo(SjTrackInfo* trackInfo)
 }
 
 
+void SjLibraryModule::FlushUpdateGen()
+{
+	// stamp the collected tracks with a single query instead of one query per track
+	size_t i, iCount = m_updateGenIds.GetCount();
+	if( iCount == 0 )
+		return;
+
+	wxSqlt   sql;
+	wxString idsStr;
+	for( i = 0; i < iCount; i++ )
+	{
+		if( i ) idsStr += wxT(",");
+		idsStr += sql.LParam(m_updateGenIds[i]);
+	}
+
+	sql.Query(wxT("UPDATE tracks SET updategen=") + sql.LParam(m_updateGen) + wxT(" WHERE id IN (") + idsStr + wxT(");"));
+	m_updateGenIds.Empty();
+}
+
+
 bool SjLibraryModule::UpdateAllCol(wxWindow* parent, bool deepUpdate)
 {
 	wxSqlt               sql;
@@ -806,9 +925,12 @@ bool SjLibraryModule::UpdateAllCol(wxWindow* parent, bool deepUpdate)
 	m_deepUpdate            = deepUpdate;
 	m_updateStartingTime    = wxDateTime::Now().GetAsDOS();
 
-	m_updatedTracks.Clear();
+	m_updateGen             = sql.ConfigRead(wxT("library/updategen"), 0L) + 1;
+	m_updateGenIds.Empty();
+	sql.ConfigWrite(wxT("library/updategen"), m_updateGen);
 	SavePendingData();
 	ForgetRememberedValues();
+	SjAdvSearch::ClearCache(); // the cached selections would be dropped anyway, this avoids recording all changes
 
 	// go through all music library scanner modules
 	// and receive the track information by SjLibraryModule::ReceiveTrackInfo()
@@ -823,6 +945,7 @@ bool SjLibraryModule::UpdateAllCol(wxWindow* parent, bool deepUpdate)
 
 			if( !scannerModule->IterateTrackInfo(this) )
 			{
+				m_updateGenIds.Empty();
 				return FALSE; // user abort
 			}
 
@@ -830,80 +953,441 @@ bool SjLibraryModule::UpdateAllCol(wxWindow* parent, bool deepUpdate)
 		}
 	}
 
+	FlushUpdateGen();
+
 	// remove non-updated tracks
 	SjBusyInfo::Set(_("Updating music library")+wxString(wxT("...")), TRUE);
 
+	sql.Query(wxT("SELECT DISTINCT albumid FROM tracks WHERE updategen<>") + sql.LParam(m_updateGen) + wxT(";"));
+	while( sql.Next() )
+	{
+		if( sql.GetLong(0) )
+		{
+			m_albumPendingAlbums.Insert(sql.GetLong(0), 1); // the albums of the deleted tracks must be recombined
+		}
+	}
+
+	if( !sql.Query(wxT("DELETE FROM tracks WHERE updategen<>") + sql.LParam(m_updateGen) + wxT(";")) )
+	{
+		return FALSE;
+	}
+
+	if( sql.GetChangedRows() >= 1000 )
+	{
+		transaction.Vacuum();
+	}
+
+	// update albums; genres and groups are rebuilt on demand
+	InvalidateDicts();
+	if( !CombineTracksToAlbums(TRUE/*allowIncremental*/) )
+	{
+		return FALSE;
+	}
+
+	// success
+	transaction.Commit();
+	ForgetRememberedValues();
+	return TRUE;
+}
+
+
+/*******************************************************************************
+ * SjLibraryDict
+ ******************************************************************************/
+
+
+class SjLibraryDictEntry
+{
+public:
+	                SjLibraryDictEntry  (const wxString& folded, const wxString& value, long count)
+		: m_folded(folded), m_value(value), m_count(count) { }
+	wxString        m_folded;
+	wxString        m_value;
+	long            m_count;
+};
+
+
+static int SjLibraryDictCmp(const wxString& folded1, const wxString& value1, const wxString& folded2, const wxString& value2)
+{
+	int ret = folded1.Cmp(folded2);
+	return ret? ret : value1.Cmp(value2);
+}
+
+
+static int SjLibraryDictQsortCmp(const void* arg1, const void* arg2)
+{
+	SjLibraryDictEntry* e1 = *((SjLibraryDictEntry**)arg1);
+	SjLibraryDictEntry* e2 = *((SjLibraryDictEntry**)arg2);
+	return SjLibraryDictCmp(e1->m_folded, e1->m_value, e2->m_folded, e2->m_value);
+}
+
+
+void SjLibraryDict::Clear()
+{
+	long i;
+	for( i = 0; i < m_count; i++ )
+	{
+		delete m_entries[i];
+	}
+
+	if( m_entries )
+	{
+		free(m_entries);
+		m_entries = NULL;
+	}
+
+	m_count = 0;
+	m_alloc = 0;
+	m_valid = false;
+}
+
+
+void SjLibraryDict::Build(const wxString& fieldName, wxSqltDb* db)
+{
+	Clear();
+
+	// collect all values unsorted ...
+	wxSqlt sql(db);
+	sql.Query(wxT("SELECT ") + fieldName + wxT(", COUNT(*) FROM tracks GROUP BY ") + fieldName + wxT(";"));
+	while( sql.Next() )
 	{
-		wxString updatedTracksStr = m_updatedTracks.GetAsString();
-		if( !updatedTracksStr.IsEmpty() )
+		wxString value = sql.GetString(0);
+		value.Trim(TRUE);
+		value.Trim(FALSE);
+		if( !value.IsEmpty() )
 		{
-			if( !sql.Query(wxT("DELETE FROM tracks WHERE NOT (id IN (") + updatedTracksStr + wxT("));")) )
+			if( m_count >= m_alloc )
 			{
-				return FALSE;
+				m_alloc = m_alloc? m_alloc*2 : 256;
+				m_entries = (SjLibraryDictEntry**)realloc(m_entries, m_alloc*sizeof(SjLibraryDictEntry*));
 			}
+			m_entries[m_count++] = new SjLibraryDictEntry(value.Lower(), value, sql.GetLong(1));
+		}
+	}
 
-			if( sql.GetChangedRows() >= 1000 )
+	// ... sort them and merge values that were different before trimming
+	if( m_count > 1 )
+	{
+		qsort(m_entries, m_count, sizeof(SjLibraryDictEntry*), SjLibraryDictQsortCmp);
+
+		long src, dest = 0;
+		for( src = 1; src < m_count; src++ )
+		{
+			if( m_entries[src]->m_value == m_entries[dest]->m_value )
 			{
-				transaction.Vacuum();
+				m_entries[dest]->m_count += m_entries[src]->m_count;
+				delete m_entries[src];
+			}
+			else
+			{
+				m_entries[++dest] = m_entries[src];
 			}
 		}
+		m_count = dest+1;
+	}
+
+	m_valid = true;
+}
+
+
+long SjLibraryDict::Find(const wxString& folded, const wxString& value, bool& found) const
+{
+	// returns the index of the first entry equal to or larger than the given one
+	long lo = 0, hi = m_count, mid;
+	while( lo < hi )
+	{
+		mid = (lo+hi) / 2;
+		if( SjLibraryDictCmp(m_entries[mid]->m_folded, m_entries[mid]->m_value, folded, value) < 0 )
+			lo = mid+1;
 		else
+			hi = mid;
+	}
+
+	found = (lo < m_count && m_entries[lo]->m_value == value);
+	return lo;
+}
+
+
+void SjLibraryDict::Add(const wxString& value__, long count)
+{
+	wxString value(value__);
+	value.Trim(TRUE);
+	value.Trim(FALSE);
+	if( !m_valid || value.IsEmpty() )
+		return;
+
+	wxString folded = value.Lower();
+	bool found;
+	long index = Find(folded, value, found);
+	if( found )
+	{
+		m_entries[index]->m_count += count;
+		return;
+	}
+
+	if( m_count >= m_alloc )
+	{
+		m_alloc = m_alloc? m_alloc*2 : 256;
+		m_entries = (SjLibraryDictEntry**)realloc(m_entries, m_alloc*sizeof(SjLibraryDictEntry*));
+	}
+
+	memmove(&m_entries[index+1], &m_entries[index], (m_count-index)*sizeof(SjLibraryDictEntry*));
+	m_entries[index] = new SjLibraryDictEntry(folded, value, count);
+	m_count++;
+}
+
+
+void SjLibraryDict::Remove(const wxString& value__)
+{
+	wxString value(value__);
+	value.Trim(TRUE);
+	value.Trim(FALSE);
+	if( !m_valid || value.IsEmpty() )
+		return;
+
+	bool found;
+	long index = Find(value.Lower(), value, found);
+	if( found )
+	{
+		m_entries[index]->m_count--;
+		if( m_entries[index]->m_count <= 0 )
 		{
-			if( !sql.Query(wxT("DELETE FROM tracks;")) )
-			{
-				return FALSE;
-			}
+			delete m_entries[index];
+			m_count--;
+			memmove(&m_entries[index], &m_entries[index+1], (m_count-index)*sizeof(SjLibraryDictEntry*));
+		}
+	}
+}
 
-			transaction.Vacuum(); // GetChangedRows() won't work as DELETE FROM without WHERE recreates the table in sqlite
+
+bool SjLibraryDict::Complete(const wxString& prefix, wxString& ret) const
+{
+	// find the first value starting with the given prefix that is longer than the prefix
+	wxString folded = prefix.Lower();
+	size_t   foldedLen = folded.Len();
+	bool     found;
+	long     index;
+	for( index = Find(folded, wxEmptyString, found); index < m_count; index++ )
+	{
+		const SjLibraryDictEntry* e = m_entries[index];
+		if( e->m_folded.Len() < foldedLen || e->m_folded.compare(0, foldedLen, folded) != 0 )
+			break;
+
+		if( e->m_value.Len() > prefix.Len() )
+		{
+			ret = e->m_value;
+			return true;
 		}
 	}
 
-	m_updatedTracks.Clear();
+	return false;
+}
+
 
-	// update albums, genres and groups
-	if( !CombineTracksToAlbums()
-	        || !UpdateUniqueValues(wxT("genrename"))
-	        || !UpdateUniqueValues(wxT("groupname")) )
+void SjLibraryDict::Swap(SjLibraryDict& o)
+{
+	SjLibraryDictEntry** entries = m_entries; m_entries = o.m_entries; o.m_entries = entries;
+	long count = m_count;                     m_count = o.m_count;     o.m_count = count;
+	long alloc = m_alloc;                     m_alloc = o.m_alloc;     o.m_alloc = alloc;
+	bool valid = m_valid;                     m_valid = o.m_valid;     o.m_valid = valid;
+}
+
+
+void SjLibraryDict::GetValues(wxArrayString& ret) const
+{
+	ret.Alloc(ret.GetCount()+m_count);
+
+	long index;
+	for( index = 0; index < m_count; index++ )
 	{
-		return FALSE;
+		ret.Add(m_entries[index]->m_value);
 	}
+}
 
-	// success
-	transaction.Commit();
-	ForgetRememberedValues();
-	return TRUE;
+
+void SjLibraryDict::GetValues(SjSSHash& ret) const
+{
+	long index;
+	for( index = 0; index < m_count; index++ )
+	{
+		ret.Insert(m_entries[index]->m_value, wxEmptyString);
+	}
 }
 
 
-bool SjLibraryModule::UpdateUniqueValues(const wxString& name)
+static const struct
 {
-	wxASSERT( name == wxT("genrename") || name == wxT("groupname") );
+	long            what;
+	const wxChar*   name;
+}
+s_libraryDictFields[SJ_LIBDICT_COUNT] =
+{
+	{ SJ_TI_TRACKNAME,      wxT("trackname")        },
+	{ SJ_TI_LEADARTISTNAME, wxT("leadartistname")   },
+	{ SJ_TI_ORGARTISTNAME,  wxT("orgartistname")    },
+	{ SJ_TI_COMPOSERNAME,   wxT("composername")     },
+	{ SJ_TI_ALBUMNAME,      wxT("albumname")        },
+	{ SJ_TI_GENRENAME,      wxT("genrename")        },
+	{ SJ_TI_GROUPNAME,      wxT("groupname")        },
+	{ SJ_TI_COMMENT,        wxT("comment")          },
+	{ SJ_TI_URL,            wxT("url")              },
+};
 
-	wxSqlt          sql;
-	wxString        currValue;
-	wxArrayString   allValuesArray;
-	wxString        allValuesString;
 
-	SjBusyInfo::Set(wxString::Format(name==wxT("genrename")? _("Updating genres...") : _("Updating groups...")), TRUE);
+class SjLibraryDictThread : public wxThread
+{
+public:
+	// builds a dictionary on a read-only connection; the larger dictionaries,
+	// eg. of the URLs, would block the first keypress otherwise
+	SjLibraryDictThread(const wxString& fieldName, long version)
+		: wxThread(wxTHREAD_JOINABLE)
+	{
+		m_fieldName = fieldName;
+		m_version   = version;
+		m_db        = NULL;
+	}
+	~SjLibraryDictThread()
+	{
+		if( m_db ) delete m_db;
+	}
+	bool Start()
+	{
+		wxSqltDb* defaultDb = wxSqltDb::GetDefault();
+		if( defaultDb == NULL )
+			return false;
 
-	sql.Query(wxString::Format(wxT("SELECT %s FROM tracks GROUP BY %s ORDER BY %s;"), name.c_str(), name.c_str(), name.c_str()));
-	while( sql.Next() )
+		m_db = new wxSqltDb(defaultDb->GetFile(), true/*read-only*/);
+		if( !m_db->IsOk() )
+			return false;
+
+		return (Create() == wxTHREAD_NO_ERROR && Run() == wxTHREAD_NO_ERROR);
+	}
+	void Abort()
+	{
+		// the thread is waited for by the caller, the result is dropped
+		m_db->Interrupt();
+	}
+
+	SjLibraryDict   m_dict;
+	long            m_version;
+
+private:
+	void* Entry()
+	{
+		m_dict.Build(m_fieldName, m_db);
+
+		// wxSqlt::Next() does not tell us about errors, eg. if the database was locked
+		int err = sqlite3_errcode(m_db->GetDb());
+		if( err != SQLITE_OK && err != SQLITE_ROW && err != SQLITE_DONE )
+		{
+			m_dict.Clear();
+		}
+		return NULL;
+	}
+	wxString        m_fieldName;
+	wxSqltDb*       m_db;
+};
+
+
+SjLibraryDict* SjLibraryModule::GetDict(long what, bool inBackground)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	int i;
+	for( i = 0; i < SJ_LIBDICT_COUNT; i++ )
 	{
-		currValue = sql.GetString(0);
-		currValue.Trim(TRUE);
-		currValue.Trim(FALSE);
-		if( !currValue.IsEmpty()
-		        && allValuesArray.Index(currValue)==wxNOT_FOUND )
+		if( s_libraryDictFields[i].what == what )
 		{
-			allValuesArray.Add(currValue);
+			// take over the result of a finished thread; if the dictionary was changed
+			// in between, the result is outdated and dropped
+			SjLibraryDictThread* thread = m_dictThreads[i];
+			if( thread && !thread->IsAlive() )
+			{
+				thread->Wait();
+				if( !thread->m_dict.IsValid() )
+				{
+					inBackground = FALSE; // the thread failed, build it synchronously
+				}
+				else if( thread->m_version == m_dictsVersion && !m_dicts[i].IsValid() )
+				{
+					m_dicts[i].Swap(thread->m_dict);
+				}
+				delete thread;
+				m_dictThreads[i] = NULL;
+			}
 
-			allValuesString += currValue + wxT("\n");
+			if( !m_dicts[i].IsValid() )
+			{
+				if( inBackground )
+				{
+					if( m_dictThreads[i] == NULL )
+					{
+						thread = new SjLibraryDictThread(s_libraryDictFields[i].name, m_dictsVersion);
+						if( thread->Start() )
+						{
+							m_dictThreads[i] = thread;
+							return NULL; // not yet available
+						}
+						delete thread; // build it synchronously below
+					}
+					else
+					{
+						return NULL; // not yet available
+					}
+				}
+
+				m_dicts[i].Build(s_libraryDictFields[i].name);
+			}
+			return &m_dicts[i];
 		}
 	}
 
-	sql.ConfigWrite(wxT("library/") + name, allValuesString);
+	return NULL;
+}
 
-	return TRUE;
+
+void SjLibraryModule::StopDictThreads()
+{
+	int i;
+	for( i = 0; i < SJ_LIBDICT_COUNT; i++ )
+	{
+		if( m_dictThreads[i] )
+		{
+			m_dictThreads[i]->Abort();
+			m_dictThreads[i]->Wait();
+			delete m_dictThreads[i];
+			m_dictThreads[i] = NULL;
+		}
+	}
+}
+
+
+void SjLibraryModule::InvalidateDicts()
+{
+	int i;
+	for( i = 0; i < SJ_LIBDICT_COUNT; i++ )
+	{
+		m_dicts[i].Clear();
+	}
+	m_dictsVersion++;
+}
+
+
+void SjLibraryModule::UpdateDict(long what, const wxString& oldValue, const wxString& newValue)
+{
+	int i;
+	for( i = 0; i < SJ_LIBDICT_COUNT; i++ )
+	{
+		if( s_libraryDictFields[i].what == what )
+		{
+			m_dicts[i].Remove(oldValue);
+			m_dicts[i].Add(newValue);
+			if( m_dictThreads[i] )
+			{
+				m_dictsVersion++; // a running thread may have missed the change
+			}
+		}
+	}
 }
 
 
@@ -924,6 +1408,7 @@ public:
 		m_year              = year;
 		m_albumId           = albumId;
 		m_url               = url;
+		m_keysChanged       = FALSE;
 	}
 
 	long        m_id;
@@ -934,6 +1419,8 @@ public:
 	long        m_albumId;
 	wxString    m_url;
 	bool        m_updated;
+	long        m_keys[SJ_ALBUMKEY_COUNT];
+	bool        m_keysChanged; // if set, m_keys should be written to the database
 };
 
 
@@ -942,8 +1429,10 @@ class SjUpdateAlbum
 public:
 	SjUpdateAlbum(long step)
 	{
-		m_trackIds = NULL;
-		m_step     = step;
+		m_trackIds   = NULL;
+		m_step       = step;
+		m_albumId    = 0;
+		m_albumIndex = -1;
 	}
 
 	~SjUpdateAlbum()
@@ -962,6 +1451,7 @@ public:
 	wxString        m_albumName;
 	wxString        m_url, m_sort;
 	wxArrayLong*    m_trackIds;
+	long            m_albumId, m_albumIndex; // only used by PatchAlbumIndex()
 };
 
 
@@ -1138,70 +1628,333 @@ void SjLibraryModule::GetPossibleAlbumArts(long albumId, wxArrayLong& albumArtId
 	sql.Query(wxString::Format(wxT("SELECT artiduser FROM albums WHERE id=%lu;"), albumId));
 	if( sql.Next() )
 	{
-		currArtId = sql.GetLong(0);
-		if( currArtId && albumArtIds.Index(currArtId)==wxNOT_FOUND )
+		currArtId = sql.GetLong(0);
+		if( currArtId && albumArtIds.Index(currArtId)==wxNOT_FOUND )
+		{
+			albumArtIds.Add(currArtId);
+			m_addedArtIds.Insert(albumId, currArtId);
+		}
+	}
+
+	// sort the ids now (should be done before albumArtUrls are set, see http://www.silverjuke.net/forum/topic-2746.html )
+	if( !albumArtIds.IsEmpty() )
+	{
+		sql.Query(wxString::Format(wxT("SELECT id FROM arts WHERE id IN(%s) ORDER BY url;"), SjTools::Implode(albumArtIds, wxT(",")).c_str()));
+		albumArtIds.Clear();
+		while( sql.Next() )
+		{
+			albumArtIds.Add(sql.GetLong(0));
+		}
+	}
+
+	if( addAutoCover )
+	{
+		// we also add the temp. art ID only if the caller wants everything
+		// (indicated by "addAutoCover" in this case)
+		currArtId = m_addedArtIds.Lookup(albumId);
+		if( currArtId && albumArtIds.Index(currArtId)==wxNOT_FOUND )
+		{
+			sql.Query(wxString::Format(wxT("SELECT id FROM arts WHERE id=%lu;"), currArtId)); // make sure, the record still exists
+			if( sql.Next() )
+			{
+				albumArtIds.Add(currArtId);
+			}
+		}
+
+		// add auto cover (should be last for cosmetic reasons when using a list in menus)
+		if( albumArtIds.Index(SJ_DUMMY_COVER_ID)==wxNOT_FOUND )
+		{
+			albumArtIds.Add(SJ_DUMMY_COVER_ID);
+		}
+	}
+
+	// get the URLs if wanted
+	if( albumArtUrls )
+	{
+		int i, idsCount = (int)albumArtIds.GetCount();
+		for( i = 0; i < idsCount; i++ )
+		{
+			currArtId = albumArtIds.Item(i);
+			if( currArtId == SJ_DUMMY_COVER_ID )
+			{
+				albumArtUrls->Add(GetDummyCoverUrl(albumId));
+			}
+			else
+			{
+				sql.Query(wxString::Format(wxT("SELECT url FROM arts WHERE id=%lu;"), currArtId));
+				albumArtUrls->Add(sql.Next()? sql.GetString(0) : wxString(wxT("")));
+				// also add empty string, the returned array must
+				// have the same size as the input array
+			}
+		}
+	}
+}
+
+
+static long SjLibraryModule_AlbumKey(const wxString& normalisedStr)
+{
+	if( normalisedStr.IsEmpty() )
+	{
+		return 0;
+	}
+
+	long key = (long)(int32_t)SjTools::Crc32AddString(SjTools::Crc32Init(), normalisedStr);
+	return key? key : 1; // 0 is reserved for "no key"; collisions just let us recombine some more albums
+}
+
+
+void SjLibraryModule::GetAlbumKeys(const wxString& leadArtistName, const wxString& albumName, const wxString& genreName, const wxString& url,
+                                   long keys[SJ_ALBUMKEY_COUNT])
+{
+	// the keys match the hashes used by the different steps in CombineTracksToAlbums()
+	keys[0] = (m_flags&SJ_LIB_CREATEALBUMSBY_DIR)?   SjLibraryModule_AlbumKey(SjUpdateAlbum::GetUrlAsHash(url)) : 0;
+	keys[1] = SjLibraryModule_AlbumKey(SjNormaliseString(m_omitArtist.Apply(leadArtistName), SJ_NUM_SORTABLE|SJ_NUM_TO_END));
+	keys[2] = SjLibraryModule_AlbumKey(SjNormaliseString(m_omitAlbum.Apply(albumName), SJ_NUM_SORTABLE|SJ_NUM_TO_END));
+	keys[3] = (m_flags&SJ_LIB_CREATEALBUMSBY_GENRE)? SjLibraryModule_AlbumKey(SjNormaliseString(m_omitArtist.Apply(genreName), SJ_NUM_SORTABLE|SJ_NUM_TO_END)) : 0;
+}
+
+
+wxString SjLibraryModule::GetAlbumKeysSignature()
+{
+	// if any of these settings change, the stored album keys and sort strings are invalid
+	return wxString::Format(wxT("%i/%i/%i/%i/"), (int)(m_flags&SJ_LIB_CREATEALBUMSBY_MASK), (int)m_n1, (int)m_n2, (int)m_sort)
+	       + m_omitArtist.GetWords() + wxT("/") + m_omitAlbum.GetWords() + wxT("/") + m_coverFinder.GetWords();
+}
+
+
+#define SJ_COMBINE_INCREMENTAL_MAX 20000 // if more tracks are affected, the albums are recombined completely
+
+bool SjLibraryModule::GetAffectedAlbumTracks(SjLLHash& ret)
+{
+	// get all tracks whose album may change because of the pending changes;
+	// returns false if a complete recombination is needed.
+	wxSqlt          sql;
+	long            id, k;
+	SjHashIterator  iterator;
+
+	ret.Clear();
+
+	if( sql.ConfigRead(wxT("library/albumkeys"), wxT("")) != GetAlbumKeysSignature()
+	 || m_albumPendingTracks.GetCount() > SJ_COMBINE_INCREMENTAL_MAX )
+	{
+		return false;
+	}
+
+	// start with the changed tracks and the tracks of their previous albums -
+	// except the "rest" album which is not combined by any key
+	SjLLHash newIds;
+	while( m_albumPendingTracks.Iterate(iterator, &id) )
+	{
+		ret.Insert(id, 1);
+		newIds.Insert(id, 1);
+	}
+
+	if( m_albumPendingAlbums.GetCount() )
+	{
+		sql.Query(wxT("SELECT id FROM tracks WHERE albumid IN (") + m_albumPendingAlbums.GetKeysAsString() + wxT(") ")
+		          wxT("AND albumid NOT IN (SELECT id FROM albums WHERE url='album:-/-');"));
+		while( sql.Next() )
+		{
+			id = sql.GetLong(0);
+			if( !ret.Lookup(id) )
+			{
+				ret.Insert(id, 1);
+				newIds.Insert(id, 1);
+			}
+		}
+	}
+
+	// add all tracks sharing any key with the affected tracks until nothing changes
+	static const wxChar* keyColumns[SJ_ALBUMKEY_COUNT] = { wxT("keydir"), wxT("keyartist"), wxT("keyalbum"), wxT("keygenre") };
+	SjLLHash usedKeys[SJ_ALBUMKEY_COUNT];
+	while( newIds.GetCount() )
+	{
+		if( ret.GetCount() > SJ_COMBINE_INCREMENTAL_MAX )
+		{
+			return false;
+		}
+
+		wxString newKeys[SJ_ALBUMKEY_COUNT];
+		sql.Query(wxT("SELECT keydir, keyartist, keyalbum, keygenre FROM tracks WHERE id IN (") + newIds.GetKeysAsString() + wxT(");"));
+		while( sql.Next() )
+		{
+			for( k = 0; k < SJ_ALBUMKEY_COUNT; k++ )
+			{
+				long key = sql.GetLong(k);
+				if( key && !usedKeys[k].Lookup(key) )
+				{
+					usedKeys[k].Insert(key, 1);
+					newKeys[k] += (newKeys[k].IsEmpty()? wxT("") : wxT(",")) + sql.LParam(key);
+				}
+			}
+		}
+
+		wxString cond;
+		for( k = 0; k < SJ_ALBUMKEY_COUNT; k++ )
+		{
+			if( !newKeys[k].IsEmpty() )
+			{
+				cond += (cond.IsEmpty()? wxT("") : wxT(" OR ")) + wxString(keyColumns[k]) + wxT(" IN (") + newKeys[k] + wxT(")");
+			}
+		}
+
+		newIds.Clear();
+		if( !cond.IsEmpty() )
+		{
+			sql.Query(wxT("SELECT id FROM tracks WHERE ") + cond + wxT(";"));
+			while( sql.Next() )
+			{
+				id = sql.GetLong(0);
+				if( !ret.Lookup(id) )
+				{
+					ret.Insert(id, 1);
+					newIds.Insert(id, 1);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
+#define SJ_PATCH_ALBUMS_MAX 1000 // if more albums are moved, all albums are sorted again
+
+bool SjLibraryModule::PatchAlbumIndex(SjLLHash& computedAlbums, SjLLHash& repositionAlbums, SjLLHash& oldAlbums, SjLLHash& azToUpdate)
+{
+	// after an incremental recombination, remove unused albums and move the
+	// new and the changed albums to their position in the sorted list;
+	// the positions are found by SjLibraryModule_CmpAlbums() as on complete
+	// recombinations, the album table is read once and only the albums whose
+	// index changes are written
+	wxSqlt          sql;
+	SjHashIterator  iterator;
+	long            id, i;
+
+	// find out the albums no longer used and delete them
+	{
+		SjLLHash candidates;
+		while( oldAlbums.Iterate(iterator, &id) )
+		{
+			if( !computedAlbums.Lookup(id) )
+				candidates.Insert(id, 1);
+		}
+
+		if( candidates.GetCount() )
+		{
+			wxString removedAlbums;
+			sql.Query(wxT("SELECT id, az FROM albums WHERE id IN (") + candidates.GetKeysAsString() + wxT(") ")
+			          wxT("AND NOT EXISTS (SELECT id FROM tracks WHERE albumid=albums.id);"));
+			while( sql.Next() )
+			{
+				removedAlbums += (removedAlbums.IsEmpty()? wxT("") : wxT(",")) + sql.LParam(sql.GetLong(0));
+				azToUpdate.Insert(sql.GetLong(1), 1);
+			}
+
+			if( !removedAlbums.IsEmpty() )
+			{
+				sql.Query(wxT("DELETE FROM albums WHERE id IN (") + removedAlbums + wxT(");"));
+			}
+		}
+	}
+
+	// read all albums; the albums not moved keep their relative order, so
+	// ordering them by their old index is the same as sorting them
+	SjUpdateAlbumList   allAlbums;
+	allAlbums.DeleteContents(TRUE);
+	SjUpdateAlbumList   keptAlbums, movedAlbums; // the albums are owned by allAlbums
+	SjUpdateAlbum*      currAlbum;
+	sql.Query(wxT("SELECT id, sortstr, albumindex FROM albums ORDER BY albumindex;"));
+	while( sql.Next() )
+	{
+		currAlbum = new SjUpdateAlbum(0);
+		currAlbum->m_albumId    = sql.GetLong(0);
+		currAlbum->m_sort       = sql.GetString(1);
+		currAlbum->m_albumIndex = sql.GetLong(2);
+		allAlbums.Append(currAlbum);
+
+		if( currAlbum->m_albumIndex < 0 || repositionAlbums.Lookup(currAlbum->m_albumId) )
+			movedAlbums.Append(currAlbum);
+		else
+			keptAlbums.Append(currAlbum);
+	}
+
+	if( !SjBusyInfo::Set() ) { return FALSE; }
+
+	// get the new order
+	SjUpdateAlbumList           sortedAlbums; // the albums are owned by allAlbums
+	SjUpdateAlbumList::Node*    currAlbumNode;
+	if( (long)movedAlbums.GetCount() > SJ_PATCH_ALBUMS_MAX )
+	{
+		// too many albums moved, merging is not faster than sorting all albums
+		allAlbums.Sort(SjLibraryModule_CmpAlbums);
+		for( currAlbumNode = allAlbums.GetFirst(); currAlbumNode; currAlbumNode = currAlbumNode->GetNext() )
 		{
-			albumArtIds.Add(currArtId);
-			m_addedArtIds.Insert(albumId, currArtId);
+			sortedAlbums.Append(currAlbumNode->GetData());
 		}
-	}
 
-	// sort the ids now (should be done before albumArtUrls are set, see http://www.silverjuke.net/forum/topic-2746.html )
-	if( !albumArtIds.IsEmpty() )
-	{
-		sql.Query(wxString::Format(wxT("SELECT id FROM arts WHERE id IN(%s) ORDER BY url;"), SjTools::Implode(albumArtIds, wxT(",")).c_str()));
-		albumArtIds.Clear();
+		sql.Query(wxT("SELECT DISTINCT az FROM albums;"));
 		while( sql.Next() )
 		{
-			albumArtIds.Add(sql.GetLong(0));
+			azToUpdate.Insert(sql.GetLong(0), 1);
 		}
 	}
-
-	if( addAutoCover )
+	else
 	{
-		// we also add the temp. art ID only if the caller wants everything
-		// (indicated by "addAutoCover" in this case)
-		currArtId = m_addedArtIds.Lookup(albumId);
-		if( currArtId && albumArtIds.Index(currArtId)==wxNOT_FOUND )
+		// sort the moved albums and merge them into the kept ones
+		movedAlbums.Sort(SjLibraryModule_CmpAlbums);
+		SjUpdateAlbumList::Node* keptNode  = keptAlbums.GetFirst();
+		SjUpdateAlbumList::Node* movedNode = movedAlbums.GetFirst();
+		while( keptNode || movedNode )
 		{
-			sql.Query(wxString::Format(wxT("SELECT id FROM arts WHERE id=%lu;"), currArtId)); // make sure, the record still exists
-			if( sql.Next() )
+			const SjUpdateAlbum* kept  = keptNode?  keptNode->GetData()  : NULL;
+			const SjUpdateAlbum* moved = movedNode? movedNode->GetData() : NULL;
+			if( kept == NULL || (moved && SjLibraryModule_CmpAlbums(&moved, &kept) < 0) )
 			{
-				albumArtIds.Add(currArtId);
+				sortedAlbums.Append((SjUpdateAlbum*)moved);
+				movedNode = movedNode->GetNext();
+			}
+			else
+			{
+				sortedAlbums.Append((SjUpdateAlbum*)kept);
+				keptNode = keptNode->GetNext();
 			}
 		}
+	}
 
-		// add auto cover (should be last for cosmetic reasons when using a list in menus)
-		if( albumArtIds.Index(SJ_DUMMY_COVER_ID)==wxNOT_FOUND )
+	// write the changed indices
+	for( currAlbumNode = sortedAlbums.GetFirst(), i = 0; currAlbumNode; currAlbumNode = currAlbumNode->GetNext(), i++ )
+	{
+		currAlbum = currAlbumNode->GetData();
+		if( currAlbum->m_albumIndex != i )
 		{
-			albumArtIds.Add(SJ_DUMMY_COVER_ID);
+			sql.Query(wxT("UPDATE albums SET albumindex=") + sql.LParam(i) + wxT(" WHERE id=") + sql.LParam(currAlbum->m_albumId) + wxT(";"));
+		}
+
+		if( (i % 1000) == 0 )
+		{
+			if( !SjBusyInfo::Set() ) { return FALSE; }
 		}
 	}
 
-	// get the URLs if wanted
-	if( albumArtUrls )
+	// the first album of each letter may have changed
+	long az;
+	while( azToUpdate.Iterate(iterator, &az) )
 	{
-		int i, idsCount = (int)albumArtIds.GetCount();
-		for( i = 0; i < idsCount; i++ )
+		sql.Query(wxT("UPDATE albums SET azfirst=0 WHERE az=") + sql.LParam(az) + wxT(" AND azfirst<>0;"));
+		sql.Query(wxT("SELECT id FROM albums WHERE az=") + sql.LParam(az) + wxT(" ORDER BY albumindex LIMIT 1;"));
+		if( sql.Next() )
 		{
-			currArtId = albumArtIds.Item(i);
-			if( currArtId == SJ_DUMMY_COVER_ID )
-			{
-				albumArtUrls->Add(GetDummyCoverUrl(albumId));
-			}
-			else
-			{
-				sql.Query(wxString::Format(wxT("SELECT url FROM arts WHERE id=%lu;"), currArtId));
-				albumArtUrls->Add(sql.Next()? sql.GetString(0) : wxString(wxT("")));
-				// also add empty string, the returned array must
-				// have the same size as the input array
-			}
+			id = sql.GetLong(0);
+			sql.Query(wxT("UPDATE albums SET azfirst=") + sql.LParam(az) + wxT(" WHERE id=") + sql.LParam(id) + wxT(";"));
 		}
 	}
+
+	return SjBusyInfo::Set();
 }
 
 
-bool SjLibraryModule::CombineTracksToAlbums()
+bool SjLibraryModule::CombineTracksToAlbums(bool allowIncremental)
 {
 	// init
 	bool                    ret = FALSE;
@@ -1219,25 +1972,43 @@ bool SjLibraryModule::CombineTracksToAlbums()
 	wxArrayLong*            trackIds;
 	long                    trackIdsCount;
 
+	// if possible, recombine only the albums of the tracks changed since the last call;
+	// as tracks without a common key are never combined, these are all
+	// tracks sharing any key with the changed tracks (see GetAffectedAlbumTracks())
+	SjLLHash                affectedTracks;
+	bool                    incremental = allowIncremental && GetAffectedAlbumTracks(affectedTracks);
+	wxString                tracksCond;
+	if( incremental )
+	{
+		tracksCond = affectedTracks.GetCount()? (wxT(" WHERE id IN (") + affectedTracks.GetKeysAsString() + wxT(")")) : wxString(wxT(" WHERE 0"));
+	}
+
 	ForgetRememberedValues();
 
 	SjBusyInfo::Set(_("Combining tracks to albums..."), TRUE);
 
-	// read all tracks
-	if( (m_flags&SJ_LIB_CREATEALBUMSBY_DIR) )
+	// read all (affected) tracks
 	{
-		sql.Query(wxT("SELECT id, leadartistname, albumname, genrename, year, albumid, url FROM tracks;"));
+		long keys[SJ_ALBUMKEY_COUNT], k;
+		bool byDir = (m_flags&SJ_LIB_CREATEALBUMSBY_DIR)!=0;
+		sql.Query(wxT("SELECT id, leadartistname, albumname, genrename, year, albumid, url, keydir, keyartist, keyalbum, keygenre FROM tracks") + tracksCond + wxT(";"));
 		while( sql.Next() )
 		{
-			allTracks.Insert(sql.GetLong(0), (long)new SjUpdateAlbumTrack(sql.GetString(1), sql.GetString(2), sql.GetString(3), sql.GetLong(4), sql.GetLong(5), sql.GetString(6)));
-		}
-	}
-	else
-	{
-		sql.Query(wxT("SELECT id, leadartistname, albumname, genrename, year, albumid FROM tracks;"));
-		while( sql.Next() )
-		{
-			allTracks.Insert(sql.GetLong(0), (long)new SjUpdateAlbumTrack(sql.GetString(1), sql.GetString(2), sql.GetString(3), sql.GetLong(4), sql.GetLong(5), wxT("")));
+			currTrack = new SjUpdateAlbumTrack(sql.GetString(1), sql.GetString(2), sql.GetString(3), sql.GetLong(4), sql.GetLong(5), byDir? sql.GetString(6) : wxString());
+
+			if( !incremental )
+			{
+				// check the album keys, they may be invalid if the settings have changed
+				GetAlbumKeys(currTrack->m_leadArtistName, currTrack->m_albumName, currTrack->m_genreName, sql.GetString(6), keys);
+				for( k = 0; k < SJ_ALBUMKEY_COUNT; k++ )
+				{
+					currTrack->m_keys[k] = keys[k];
+					if( keys[k] != sql.GetLong(7+k) )
+						currTrack->m_keysChanged = TRUE;
+				}
+			}
+
+			allTracks.Insert(sql.GetLong(0), (long)currTrack);
 		}
 	}
 
@@ -1562,9 +2333,12 @@ bool SjLibraryModule::CombineTracksToAlbums()
 		wxArrayString               artUrls;
 		long                        albumId, i, artId;
 		int                         lastAz=0, thisAz, azFirst;
+		bool                        reposition;
 
 		SjIdCollector               updatedAlbums;
 
+		SjLLHash                    computedAlbums, repositionAlbums, oldAlbums, azToUpdate; // only used if incremental
+
 		currAlbumNode = allAlbums.GetFirst();
 		while( currAlbumNode )
 		{
@@ -1572,15 +2346,21 @@ bool SjLibraryModule::CombineTracksToAlbums()
 			wxASSERT( currAlbum );
 
 			// insert album into album table if not yet there, get album ID
-			sql.Query(wxT("SELECT id FROM albums WHERE url='") + sql.QParam(currAlbum->m_url) + wxT("';"));
+			sql.Query(wxT("SELECT id, sortstr, az, albumindex FROM albums WHERE url='") + sql.QParam(currAlbum->m_url) + wxT("';"));
 			if( sql.Next() )
 			{
 				albumId = sql.GetLong(0);
+				reposition = (sql.GetString(1) != currAlbum->m_sort || sql.GetLong(3) < 0);
+				if( reposition )
+				{
+					azToUpdate.Insert(sql.GetLong(2), 1);
+				}
 			}
 			else
 			{
-				sql.Query(wxT("INSERT INTO albums (url) VALUES ('") + sql.QParam(currAlbum->m_url) + wxT("');"));
+				sql.Query(wxT("INSERT INTO albums (url, albumindex) VALUES ('") + sql.QParam(currAlbum->m_url) + wxT("', -1);"));
 				albumId = sql.GetInsertId();
+				reposition = TRUE;
 			}
 
 			// get a-z
@@ -1616,11 +2396,21 @@ bool SjLibraryModule::CombineTracksToAlbums()
 				currTrackId = trackIds->Item(i);
 				currTrack = (SjUpdateAlbumTrack*)allTracks.Lookup(currTrackId);
 				wxASSERT(currTrack);
-				if( currTrack->m_albumId != albumId )
+				if( currTrack->m_keysChanged )
+				{
+					sql.Query(wxString::Format(wxT("UPDATE tracks SET albumid=%lu, keydir=%i, keyartist=%i, keyalbum=%i, keygenre=%i WHERE id=%lu;"),
+					                           albumId, (int)currTrack->m_keys[0], (int)currTrack->m_keys[1], (int)currTrack->m_keys[2], (int)currTrack->m_keys[3], currTrackId));
+				}
+				else if( currTrack->m_albumId != albumId )
 				{
 					sql.Query(wxString::Format(wxT("UPDATE tracks SET albumid=%lu WHERE id=%lu;"),
 					                           albumId, currTrackId));
 				}
+
+				if( incremental && currTrack->m_albumId )
+				{
+					oldAlbums.Insert(currTrack->m_albumId, 1);
+				}
 			}
 
 			// get art to use
@@ -1630,17 +2420,38 @@ bool SjLibraryModule::CombineTracksToAlbums()
 			artId/*Index*/ = m_coverFinder.Apply(artUrls, currAlbum->m_albumName);
 			artId/*Convert back to Id*/ = artId == -1? 0 : artIds.Item(artId);
 
-			// save album data
-			sql.Query(wxT("UPDATE albums SET ")
-			          wxT("albumindex=")        + sql.UParam(currAlbumIndex)                + wxT(", ")
-			          wxT("leadartistname='")   + sql.QParam(currAlbum->m_leadArtistName)   + wxT("', ")
-			          wxT("albumname='")        + sql.QParam(currAlbum->m_albumName)        + wxT("', ")
-			          wxT("az=")                + sql.LParam(thisAz)                        + wxT(", ")
-			          wxT("azfirst=")           + sql.LParam(azFirst? thisAz : 0)           + wxT(", ")
-			          wxT("artidauto=")         + sql.UParam(artId)                         + wxT(" ")
-			          wxT("WHERE id=") + sql.UParam(albumId) + wxT(";"));
-
-			updatedAlbums.Add(albumId);
+			// save album data; on incremental updates, the position is set by PatchAlbumIndex()
+			if( incremental )
+			{
+				sql.Query(wxT("UPDATE albums SET ")
+				          wxT("leadartistname='")   + sql.QParam(currAlbum->m_leadArtistName)   + wxT("', ")
+				          wxT("albumname='")        + sql.QParam(currAlbum->m_albumName)        + wxT("', ")
+				          wxT("az=")                + sql.LParam(thisAz)                        + wxT(", ")
+				          wxT("sortstr='")          + sql.QParam(currAlbum->m_sort)             + wxT("', ")
+				          wxT("artidauto=")         + sql.UParam(artId)                         + wxT(" ")
+				          wxT("WHERE id=") + sql.UParam(albumId) + wxT(";"));
+
+				computedAlbums.Insert(albumId, 1);
+				if( reposition )
+				{
+					repositionAlbums.Insert(albumId, 1);
+					azToUpdate.Insert(thisAz, 1);
+				}
+			}
+			else
+			{
+				sql.Query(wxT("UPDATE albums SET ")
+				          wxT("albumindex=")        + sql.UParam(currAlbumIndex)                + wxT(", ")
+				          wxT("leadartistname='")   + sql.QParam(currAlbum->m_leadArtistName)   + wxT("', ")
+				          wxT("albumname='")        + sql.QParam(currAlbum->m_albumName)        + wxT("', ")
+				          wxT("az=")                + sql.LParam(thisAz)                        + wxT(", ")
+				          wxT("azfirst=")           + sql.LParam(azFirst? thisAz : 0)           + wxT(", ")
+				          wxT("sortstr='")          + sql.QParam(currAlbum->m_sort)             + wxT("', ")
+				          wxT("artidauto=")         + sql.UParam(artId)                         + wxT(" ")
+				          wxT("WHERE id=") + sql.UParam(albumId) + wxT(";"));
+
+				updatedAlbums.Add(albumId);
+			}
 
 			// yield
 			if( (currAlbumIndex % 10) == 0 )
@@ -1654,6 +2465,17 @@ bool SjLibraryModule::CombineTracksToAlbums()
 		}
 
 		// remove some albums
+		if( incremental )
+		{
+			SjHashIterator iterator3;
+			while( m_albumPendingAlbums.Iterate(iterator3, &albumId) )
+			{
+				oldAlbums.Insert(albumId, 1);
+			}
+
+			if( !PatchAlbumIndex(computedAlbums, repositionAlbums, oldAlbums, azToUpdate) ) { goto Cleanup; }
+		}
+		else
 		{
 			wxString updatedAlbumsStr = updatedAlbums.GetAsString();
 			if( !updatedAlbumsStr.IsEmpty() )
@@ -1674,13 +2496,21 @@ bool SjLibraryModule::CombineTracksToAlbums()
 		}
 
 		// success
+		if( !incremental )
+		{
+			sql.ConfigWrite(wxT("library/albumkeys"), GetAlbumKeysSignature());
+		}
 		transaction.Commit();
+		m_albumPendingTracks.Clear();
+		m_albumPendingAlbums.Clear();
 		ret = TRUE;
 	}
 
 	// cleanup
 Cleanup:
 
+	CancelSearch(); // a pending result may refer to the old album indices
+
 	if( m_searchOffsets )
 	{
 		free(m_searchOffsets); // free as the number of columns may increase, re-set on next search
@@ -2095,137 +2925,565 @@ bool SjLibraryEditDlg::GetUrls(wxArrayString& retUrls, int what)
 		// get prev/next track
 		if( !g_mainFrame->m_browser->ChangeSelection(what==1? SJ_SEL_NEXT : SJ_SEL_PREV) )
 		{
-			return FALSE;
+			return FALSE;
+		}
+
+		m_urls.Clear();
+		g_mainFrame->m_libraryModule->GetSelectedUrls(m_urls);
+	}
+
+	// return the urls in scope
+	retUrls = m_urls;
+	return TRUE;
+}
+
+
+void SjLibraryEditDlg::OnUrlChanged(const wxString& oldUrl, const wxString& newUrl)
+{
+	if( !newUrl.IsEmpty() )
+	{
+		int index = m_urls.Index(oldUrl);
+		if( index != wxNOT_FOUND )
+		{
+			m_urls[index] = newUrl;
+		}
+	}
+}
+
+
+/*******************************************************************************
+ * SjLibraryModule User Actions
+ ******************************************************************************/
+
+
+class SjLibrarySearchResult
+{
+public:
+	SjLibrarySearchResult(long offsetsMax, bool gatherAzFirst, long generation)
+	{
+		m_generation        = generation;
+		m_offsetsMax        = offsetsMax;
+		m_offsetsCount      = 0;
+		m_gatherAzFirst     = gatherAzFirst;
+		m_offsets           = (long*)malloc(sizeof(long)*offsetsMax);
+		m_tracksPerAlbum    = (long*)malloc(sizeof(long)*offsetsMax);
+		if( m_tracksPerAlbum ) { memset(m_tracksPerAlbum, 0, sizeof(long)*offsetsMax); }
+		int i; for(i=0; i<27; i++) m_azFirst[i] = -1;
+	}
+	~SjLibrarySearchResult()
+	{
+		if( m_offsets ) free(m_offsets);
+		if( m_tracksPerAlbum ) free(m_tracksPerAlbum);
+	}
+	bool            IsOk                () const { return (m_offsets!=NULL && m_tracksPerAlbum!=NULL); }
+
+	long            m_generation;
+	long            m_offsetsMax;
+	long*           m_offsets;          // album indices, owned by this object until published
+	long            m_offsetsCount;
+	long*           m_tracksPerAlbum;   // number of tracks found per album index
+	bool            m_gatherAzFirst;
+	long            m_azFirst[27];
+	SjLLHash        m_tracksHash;
+};
+
+
+class SjLibrarySearchThread : public wxThread
+{
+public:
+	                SjLibrarySearchThread ();
+	                ~SjLibrarySearchThread();
+
+	// all functions except Entry() and IsStale() are called from the main thread
+	bool            Start               ();
+	void            AddJob              (const wxString& query, bool gatherAzFirst, long offsetsMax, SjLLHash* filterHash, SjLLHash* refineHash);
+	void            Cancel              ();
+	SjLibrarySearchResult* TakeResult   ();
+	void            Shutdown            ();
+	bool            IsStale             (long generation);
+
+	// the copy of SjLibraryModule::m_filterHash used for INFILTER(), only
+	// accessed by the search thread
+	SjLLHash*       m_filterHash;
+
+	// the copy of the previous result used for INREFINE() by the current job,
+	// only accessed by the search thread
+	SjLLHash*       m_refineHash;
+
+private:
+	void*           Entry               ();
+
+	wxSqltDb*       m_db;               // read-only connection, used by the search thread only (but may be interrupted by others)
+
+	// the following members are protected by m_mutex
+	wxMutex         m_mutex;
+	wxCondition     m_condition;
+	long            m_generation;       // incremented for each new job and on cancel, results with another generation are outdated
+	long            m_runningGeneration;// 0 if the thread is idle
+	bool            m_hasJob;
+	bool            m_exit;
+	wxString        m_jobQuery;
+	bool            m_jobGatherAzFirst;
+	long            m_jobOffsetsMax;
+	SjLLHash*       m_jobFilterHash;
+	SjLLHash*       m_jobRefineHash;
+	SjLibrarySearchResult* m_result;
+};
+
+
+#define LARGE_ALBUM 2 // albums with at least 2 tracks should have
+// the change to appear early in the list; this should be
+// true for almost all albums. however, we compare not the
+// number of REAL tracks but the FOUND tracks.
+static long* g_tracksPerAlbum = NULL;
+static int compareOffsets(const void *arg1, const void *arg2)
+{
+	wxASSERT( g_tracksPerAlbum );
+
+	long o1 = *((long*)arg1), o2 = *((long*)arg2);
+	long t1 = g_tracksPerAlbum[o1], t2 = g_tracksPerAlbum[o2];
+
+	if( t1 >= LARGE_ALBUM && t2 >= LARGE_ALBUM )
+	{
+		return o1-o2;
+	}
+	else if( t1 >= LARGE_ALBUM )
+	{
+		return -1;
+	}
+	else if( t2 >= LARGE_ALBUM )
+	{
+		return 1;
+	}
+
+	return o1-o2;
+}
+
+
+extern "C"
+{
+	static SjLLHash* g_filterHash = NULL;
+	static void sqlite_infilter(sqlite3_context* context, int argc, sqlite3_value** argv)
+	{
+		sqlite3_result_int(context, g_filterHash->Lookup(sqlite3_value_int(argv[0])));
+	}
+
+	static void sqlite_infilter_thread(sqlite3_context* context, int argc, sqlite3_value** argv)
+	{
+		SjLLHash* filterHash = ((SjLibrarySearchThread*)sqlite3_user_data(context))->m_filterHash;
+		sqlite3_result_int(context, filterHash? filterHash->Lookup(sqlite3_value_int(argv[0])) : 0);
+	}
+
+	static SjLLHash* g_refineHash = NULL;
+	static void sqlite_inrefine(sqlite3_context* context, int argc, sqlite3_value** argv)
+	{
+		sqlite3_result_int(context, g_refineHash->Lookup(sqlite3_value_int(argv[0])));
+	}
+
+	static void sqlite_inrefine_thread(sqlite3_context* context, int argc, sqlite3_value** argv)
+	{
+		SjLLHash* refineHash = ((SjLibrarySearchThread*)sqlite3_user_data(context))->m_refineHash;
+		sqlite3_result_int(context, refineHash? refineHash->Lookup(sqlite3_value_int(argv[0])) : 0);
+	}
+};
+
+
+static bool SjLibraryRunSearch(wxSqlt& sql, const wxString& query, SjLibrarySearchResult* r,
+                               SjLibrarySearchThread* thread /*NULL if not called from the search thread*/)
+{
+	#if 0//def __WXDEBUG__
+		wxString queryDebug__(query);
+		queryDebug__.Replace(wxT("%"), wxT("%%"));
+		wxLogDebug(queryDebug__);
+	#endif
+	sql.Query(query);
+
+	// go through result:
+	long lastAlbumIndex = -1, thisAlbumIndex;
+	long thisAlbumAz, lastAlbumAz = -1;
+	long rows = 0;
+	while( sql.Next() )
+	{
+		// check for outdated searches from time to time
+		// (if the query is interrupted, Next() just returns false)
+		if( thread && (++rows & 0xFF) == 0 && thread->IsStale(r->m_generation) )
+		{
+			return false;
+		}
+
+		thisAlbumIndex = sql.GetLong(1);
+		wxASSERT( thisAlbumIndex >= lastAlbumIndex );
+
+		if( lastAlbumIndex != thisAlbumIndex )
+		{
+			wxASSERT( r->m_offsetsCount < r->m_offsetsMax );
+			if( r->m_offsetsCount >= r->m_offsetsMax /*proofe anyway for corrupted databases*/ )
+			{
+				break;
+			}
+
+			r->m_offsets[r->m_offsetsCount] = thisAlbumIndex;
+			lastAlbumIndex = thisAlbumIndex;
+
+			if( r->m_gatherAzFirst )
+			{
+				thisAlbumAz = sql.GetLong(2);
+				wxASSERT( thisAlbumAz >= lastAlbumAz );
+				wxASSERT( thisAlbumAz >= 'a' && thisAlbumAz <= ('z'+1) );
+				if( thisAlbumAz != lastAlbumAz
+				        && thisAlbumAz >= 'a' && thisAlbumAz <= ('z'+1) )
+				{
+					r->m_azFirst[thisAlbumAz-'a'] = r->m_offsetsCount;
+					lastAlbumAz = thisAlbumAz;
+				}
+			}
+
+			r->m_offsetsCount++;
+		}
+
+		wxASSERT( thisAlbumIndex < r->m_offsetsMax );
+		if( thisAlbumIndex < r->m_offsetsMax /*proofe anyway for corrupted databases*/ )
+		{
+			r->m_tracksPerAlbum[thisAlbumIndex]++;
+		}
+
+		r->m_tracksHash.Insert(sql.GetLong(0), 1);
+	}
+
+	return (thread==NULL || !thread->IsStale(r->m_generation));
+}
+
+
+SjLibrarySearchThread::SjLibrarySearchThread()
+	: wxThread(wxTHREAD_JOINABLE), m_condition(m_mutex)
+{
+	m_filterHash        = NULL;
+	m_refineHash        = NULL;
+	m_db                = NULL;
+	m_generation        = 1;
+	m_runningGeneration = 0;
+	m_hasJob            = false;
+	m_exit              = false;
+	m_jobGatherAzFirst  = false;
+	m_jobOffsetsMax     = 0;
+	m_jobFilterHash     = NULL;
+	m_jobRefineHash     = NULL;
+	m_result            = NULL;
+}
+
+
+SjLibrarySearchThread::~SjLibrarySearchThread()
+{
+	if( m_result )          delete m_result;
+	if( m_jobFilterHash )   delete m_jobFilterHash;
+	if( m_jobRefineHash )   delete m_jobRefineHash;
+	if( m_filterHash )      delete m_filterHash;
+	if( m_refineHash )      delete m_refineHash;
+	if( m_db )              delete m_db;
+}
+
+
+bool SjLibrarySearchThread::Start()
+{
+	// open a second, read-only connection; as the main connection uses
+	// write-ahead logging, we can read while the main thread writes
+	wxSqltDb* defaultDb = wxSqltDb::GetDefault();
+	if( defaultDb == NULL || !m_condition.IsOk() )
+		return false;
+
+	m_db = new wxSqltDb(defaultDb->GetFile(), true/*read-only*/);
+	if( !m_db->IsOk() )
+		return false;
+
+	sqlite3_create_function(m_db->GetDb(), "infilter", 1, SQLITE_ANY, this, sqlite_infilter_thread, NULL, NULL);
+	sqlite3_create_function(m_db->GetDb(), "inrefine", 1, SQLITE_ANY, this, sqlite_inrefine_thread, NULL, NULL);
+
+	if( Create() != wxTHREAD_NO_ERROR
+	 || Run() != wxTHREAD_NO_ERROR )
+		return false;
+
+	return true;
+}
+
+
+void* SjLibrarySearchThread::Entry()
+{
+	wxString    query;
+	bool        gatherAzFirst;
+	long        offsetsMax, generation;
+	SjLLHash*   filterHash;
+	SjLLHash*   refineHash;
+
+	wxLog::SetThreadActiveTarget(SjLogGui::s_this);
+
+	while( 1 )
+	{
+		// wait for the next job
+		{
+			wxMutexLocker locker(m_mutex);
+			while( !m_hasJob && !m_exit )
+			{
+				m_condition.Wait();
+			}
+
+			if( m_exit )
+			{
+				return NULL;
+			}
+
+			query           = wxString(m_jobQuery.c_str()); // deep copy, the string is used by the main thread
+			gatherAzFirst   = m_jobGatherAzFirst;
+			offsetsMax      = m_jobOffsetsMax;
+			filterHash      = m_jobFilterHash;
+			m_jobFilterHash = NULL;
+			refineHash      = m_jobRefineHash;
+			m_jobRefineHash = NULL;
+			m_hasJob        = false;
+			generation      = m_generation;
+			m_runningGeneration = generation;
+		}
+
+		if( filterHash )
+		{
+			if( m_filterHash ) delete m_filterHash;
+			m_filterHash = filterHash;
+		}
+
+		// the previous result is only valid for this job
+		if( m_refineHash ) delete m_refineHash;
+		m_refineHash = refineHash;
+
+		// do the search
+		SjLibrarySearchResult* result = new SjLibrarySearchResult(offsetsMax, gatherAzFirst, generation);
+		bool ok = false;
+		if( result->IsOk() )
+		{
+			wxSqlt sql(m_db);
+			ok = SjLibraryRunSearch(sql, query, result, this);
+		}
+
+		// hand over the result to the main thread, if it is still needed
+		bool informMainThread = false;
+		{
+			wxMutexLocker locker(m_mutex);
+			m_runningGeneration = 0;
+			if( ok && generation == m_generation )
+			{
+				if( m_result ) delete m_result;
+				m_result = result;
+				result = NULL;
+				informMainThread = true;
+			}
+		}
+
+		if( result )
+		{
+			delete result;
 		}
 
-		m_urls.Clear();
-		g_mainFrame->m_libraryModule->GetSelectedUrls(m_urls);
+		if( informMainThread && g_mainFrame )
+		{
+			g_mainFrame->GetEventHandler()->QueueEvent(new wxCommandEvent(wxEVT_COMMAND_MENU_SELECTED, IDO_SEARCHDONE));
+		}
 	}
 
-	// return the urls in scope
-	retUrls = m_urls;
-	return TRUE;
+	return NULL;
 }
 
 
-void SjLibraryEditDlg::OnUrlChanged(const wxString& oldUrl, const wxString& newUrl)
+void SjLibrarySearchThread::AddJob(const wxString& query, bool gatherAzFirst, long offsetsMax, SjLLHash* filterHash, SjLLHash* refineHash)
 {
-	if( !newUrl.IsEmpty() )
+	wxMutexLocker locker(m_mutex);
+
+	m_generation++;
+
+	m_jobQuery          = wxString(query.c_str());
+	m_jobGatherAzFirst  = gatherAzFirst;
+	m_jobOffsetsMax     = offsetsMax;
+	if( filterHash )
 	{
-		int index = m_urls.Index(oldUrl);
-		if( index != wxNOT_FOUND )
-		{
-			m_urls[index] = newUrl;
-		}
+		// if there is no new filter, a filter from a job not yet started is kept
+		if( m_jobFilterHash ) delete m_jobFilterHash;
+		m_jobFilterHash = filterHash;
 	}
-}
+	if( m_jobRefineHash ) delete m_jobRefineHash;
+	m_jobRefineHash     = refineHash;
+	m_hasJob            = true;
 
+	if( m_result )
+	{
+		delete m_result;
+		m_result = NULL;
+	}
 
-/*******************************************************************************
- * SjLibraryModule User Actions
- ******************************************************************************/
+	// stop the outdated query; as we hold the mutex, the thread cannot
+	// start the new job before
+	if( m_runningGeneration )
+	{
+		m_db->Interrupt();
+	}
 
+	m_condition.Signal();
+}
 
-#define LARGE_ALBUM 2 // albums with at least 2 tracks should have
-// the change to appear early in the list; this should be
-// true for almost all albums. however, we compare not the
-// number of REAL tracks but the FOUND tracks.
-static long* g_tracksPerAlbum = NULL;
-static int compareOffsets(const void *arg1, const void *arg2)
+
+void SjLibrarySearchThread::Cancel()
 {
-	wxASSERT( g_tracksPerAlbum );
+	wxMutexLocker locker(m_mutex);
 
-	long o1 = *((long*)arg1), o2 = *((long*)arg2);
-	long t1 = g_tracksPerAlbum[o1], t2 = g_tracksPerAlbum[o2];
+	m_generation++;
+	m_hasJob = false;
 
-	if( t1 >= LARGE_ALBUM && t2 >= LARGE_ALBUM )
+	if( m_result )
 	{
-		return o1-o2;
+		delete m_result;
+		m_result = NULL;
 	}
-	else if( t1 >= LARGE_ALBUM )
+
+	if( m_runningGeneration )
 	{
-		return -1;
+		m_db->Interrupt();
 	}
-	else if( t2 >= LARGE_ALBUM )
+}
+
+
+SjLibrarySearchResult* SjLibrarySearchThread::TakeResult()
+{
+	wxMutexLocker locker(m_mutex);
+
+	SjLibrarySearchResult* ret = m_result;
+	m_result = NULL;
+	if( ret && ret->m_generation != m_generation )
 	{
-		return 1;
+		delete ret;
+		ret = NULL;
 	}
 
-	return o1-o2;
+	return ret;
 }
 
 
-extern "C"
+bool SjLibrarySearchThread::IsStale(long generation)
+{
+	wxMutexLocker locker(m_mutex);
+	return (generation != m_generation);
+}
+
+
+void SjLibrarySearchThread::Shutdown()
 {
-	static SjLLHash* g_filterHash = NULL;
-	static void sqlite_infilter(sqlite3_context* context, int argc, sqlite3_value** argv)
 	{
-		sqlite3_result_int(context, g_filterHash->Lookup(sqlite3_value_int(argv[0])));
+		wxMutexLocker locker(m_mutex);
+		m_exit = true;
+		m_generation++;
+		if( m_runningGeneration )
+		{
+			m_db->Interrupt();
+		}
+		m_condition.Signal();
 	}
-};
 
+	Wait();
+}
 
-SjSearchStat SjLibraryModule::SetSearch(const SjSearch& search, bool deepSearch)
+
+long SjLibraryModule::GetSearchOffsetsMax()
 {
-	wxASSERT( wxThread::IsMain() );
+	// get the max. numbers of albums, this is the number of offsets needed
+	if( m_searchOffsets == NULL )
+	{
+		wxSqlt sql;
+		sql.Query(wxT("SELECT COUNT(*) FROM albums;"));
+		m_searchOffsetsMax = sql.GetLong(0);
+	}
 
-	wxSqlt          sql;
-	SjSearchStat    retStat;
+	return m_searchOffsetsMax;
+}
 
-	// create the filter IDs, if needed
-	if( deepSearch || m_search.m_adv!=search.m_adv )
+
+static bool SjLibraryContainsWord(const wxString& haystack, const wxString& needle)
+{
+	// case-insensitive search as done by LIKE - which folds ASCII characters only
+	size_t haystackLen = haystack.Len(), needleLen = needle.Len(), h, n;
+	for( h = 0; h+needleLen <= haystackLen; h++ )
 	{
-		if( g_filterHash == NULL )
+		for( n = 0; n < needleLen; n++ )
 		{
-			g_filterHash = &m_filterHash;
-			sqlite3_create_function(sql.GetDb()->GetDb(), "infilter", 1, SQLITE_ANY, NULL, sqlite_infilter, NULL, NULL);
+			wxChar c1 = haystack[h+n], c2 = needle[n];
+			if( c1 >= 'A' && c1 <= 'Z' ) c1 += 'a'-'A';
+			if( c2 >= 'A' && c2 <= 'Z' ) c2 += 'a'-'A';
+			if( c1 != c2 )
+				break;
 		}
 
-		retStat = search.m_adv.GetAsSql(&m_filterHash, m_filterCond);
+		if( n == needleLen )
+			return true;
 	}
-	m_search = search;
+	return false;
+}
 
-	// cancel search?
-	if( !search.IsSet() )
+
+bool SjLibraryModule::IsSearchRefinement(const SjSearch& newSearch)
+{
+	// check if the new search can only narrow the current result - this is true
+	// if every current word is a part of a new word, eg. "beat" -> "beatles".
+	// in this case, we only need to check the tracks found before.
+	if( !m_searchRefinable
+	 ||  m_searchOffsets == NULL
+	 ||  m_searchOffsetsCount < 0
+	 || !(g_advSearchModule->m_flags&SJ_SEARCHFLAG_SEARCHSINGLEWORDS)
+	 ||  (g_advSearchModule->m_flags&SJ_SEARCHFLAG_SIMPLEGENRELOOKUP)
+	 || !newSearch.m_simple.IsSet()
+	 ||  newSearch.m_adv != m_search.m_adv )
 	{
-		m_searchOffsetsCount = -1;
-		m_searchTracksHash.Clear();
-		return retStat; // search canceled - no tracks found
+		return false;
 	}
 
-	// allocate memory for the search offsets if not yet done
-	if( m_searchOffsets == NULL )
+	wxArrayString oldWords = SjTools::Explode(m_search.m_simple.GetWords(), wxT(' '), 1);
+	wxArrayString newWords = SjTools::Explode(newSearch.m_simple.GetWords(), wxT(' '), 1);
+	size_t o, n, oCount = oldWords.GetCount(), nCount = newWords.GetCount();
+	for( o = 0; o < oCount; o++ )
 	{
-		sql.Query(wxT("SELECT COUNT(*) FROM albums;")); // get the max. numbers of albums
-		m_searchOffsetsMax = sql.GetLong(0);
-		if( m_searchOffsetsMax <= 0 )
+		if( !oldWords[o].IsEmpty() )
 		{
-			return retStat; // no error but nothing to search for
-		}
+			for( n = 0; n < nCount; n++ )
+			{
+				if( SjLibraryContainsWord(newWords[n], oldWords[o]) )
+					break;
+			}
 
-		m_searchOffsets = (long*)malloc(sizeof(long)*m_searchOffsetsMax);
-		if( m_searchOffsets == NULL )
-		{
-			return retStat; /* error */
+			if( n == nCount )
+				return false; // the search gets wider
 		}
 	}
 
-	// allocate temp. memory for the number of tracks per
-	// album and for moving "large" albums to the beginning
-	wxASSERT( m_searchOffsetsMax > 0 );
-	g_tracksPerAlbum = (long*)malloc(sizeof(long)*m_searchOffsetsMax);
-	if( g_tracksPerAlbum == NULL ) { return retStat; /* error */ }
-	memset(g_tracksPerAlbum, 0, sizeof(long)*m_searchOffsetsMax);
+	return true;
+}
+
 
-	// build query string
+wxString SjLibraryModule::BuildSearchQuery(const SjSearch& search, bool refine, bool& gatherAzFirst)
+{
 	wxString    query;
-	bool        gatherAzFirst = !m_search.m_simple.IsSet();
+
+	gatherAzFirst = !search.m_simple.IsSet();
 
 	query =  wxT("SELECT tracks.id,albumindex");
 	if( gatherAzFirst ) { query += wxT(",albums.az"); }
 	query += wxT(" FROM tracks, albums WHERE");
 
-	if( m_search.m_simple.IsSet() )
+	if( refine )
+	{
+		// check only the tracks of the previous result; this should be the
+		// first condition so that the LIKE conditions are skipped for other
+		// tracks.  INREFINE() looks up m_searchTracksHash (or the copy given to
+		// the search thread), this avoids pasting thousands of IDs into the query
+		if( m_searchTracksHash.GetCount() )
+			query += wxT(" INREFINE(tracks.id) AND");
+		else
+			query += wxT(" (0) AND");
+	}
+
+	if( search.m_simple.IsSet() )
 	{
 		wxString simpleSearchWords = search.m_simple.GetWords();
 		wxString simpleCond;
@@ -2273,11 +3531,6 @@ SjSearchStat SjLibraryModule::SetSearch(const SjSearch& search, bool deepSearch)
 		// add to query
 		query += wxT(" (") + simpleCond + wxT(") ");
 	}
-	else if( gatherAzFirst )
-	{
-		int i; for(i=0; i<27; i++) m_filterAzFirst[i] = -1;
-		m_filterAzFirstHidden = FALSE;
-	}
 
 	if( search.m_adv.IsSet() )
 	{
@@ -2288,56 +3541,28 @@ SjSearchStat SjLibraryModule::SetSearch(const SjSearch& search, bool deepSearch)
 	query += wxT(" AND albums.id=albumid ") // <-- should be the last condition as this won't eliminate any row itself
 	         wxT("ORDER BY albumindex;");
 
-	// query database
-	{
-		wxSqlt  sql;
-		#if 0//def __WXDEBUG__
-				wxString queryDebug__(query);
-				queryDebug__.Replace(wxT("%"), wxT("%%"));
-				wxLogDebug(queryDebug__);
-		#endif
-		sql.Query(query);
-
-		// go through result:
-		long lastAlbumIndex = -1, thisAlbumIndex;
-		long thisAlbumAz, lastAlbumAz = -1;
-		m_searchOffsetsCount = 0;
-		m_searchTracksHash.Clear();
-		while( sql.Next() )
-		{
-			thisAlbumIndex = sql.GetLong(1);
-			wxASSERT( thisAlbumIndex >= lastAlbumIndex );
-
-			if( lastAlbumIndex != thisAlbumIndex )
-			{
-				wxASSERT( m_searchOffsetsCount < m_searchOffsetsMax );
-				m_searchOffsets[m_searchOffsetsCount] = thisAlbumIndex;
-				lastAlbumIndex = thisAlbumIndex;
+	return query;
+}
 
-				if( gatherAzFirst )
-				{
-					thisAlbumAz = sql.GetLong(2);
-					wxASSERT( thisAlbumAz >= lastAlbumAz );
-					wxASSERT( thisAlbumAz >= 'a' && thisAlbumAz <= ('z'+1) );
-					if( thisAlbumAz != lastAlbumAz
-					        && thisAlbumAz >= 'a' && thisAlbumAz <= ('z'+1) )
-					{
-						m_filterAzFirst[thisAlbumAz-'a'] = m_searchOffsetsCount;
-						lastAlbumAz = thisAlbumAz;
-					}
-				}
 
-				m_searchOffsetsCount++;
-			}
+void SjLibraryModule::PublishSearchResult(SjLibrarySearchResult* r)
+{
+	wxASSERT( wxThread::IsMain() );
 
-			wxASSERT( thisAlbumIndex < m_searchOffsetsMax );
-			if( thisAlbumIndex < m_searchOffsetsMax /*proofe anyway for corrupted databases*/ )
-			{
-				g_tracksPerAlbum[thisAlbumIndex]++;
-			}
+	// take over the result, m_searchOffsets and m_searchTracksHash are
+	// only accessed by the main thread, so there is no inconsistent state visible
+	if( m_searchOffsets ) free(m_searchOffsets);
+	m_searchOffsets = r->m_offsets;
+	r->m_offsets = NULL;
+	m_searchOffsetsMax = r->m_offsetsMax;
+	m_searchOffsetsCount = r->m_offsetsCount;
+	m_searchTracksHash.Swap(r->m_tracksHash);
+	m_searchRefinable = true;
 
-			m_searchTracksHash.Insert(sql.GetLong(0), 1);
-		}
+	if( r->m_gatherAzFirst )
+	{
+		int i; for(i=0; i<27; i++) m_filterAzFirst[i] = r->m_azFirst[i];
+		m_filterAzFirstHidden = FALSE;
 	}
 
 	// check, if the selected tracks are still in search
@@ -2367,21 +3592,184 @@ SjSearchStat SjLibraryModule::SetSearch(const SjSearch& search, bool deepSearch)
 	// However, we do this only if the simple search ist set
 	if( m_search.m_simple.IsSet() )
 	{
+		g_tracksPerAlbum = r->m_tracksPerAlbum;
 		qsort(m_searchOffsets, m_searchOffsetsCount, sizeof(long), compareOffsets);
+		g_tracksPerAlbum = NULL;
 	}
 	else if( m_searchOffsetsCount < 20 )
 	{
 		// for very small albums view, hide the display "Albums - A" etc.
 		m_filterAzFirstHidden = TRUE;
 	}
+}
+
+
+SjSearchStat SjLibraryModule::SetSearch(const SjSearch& search, bool deepSearch)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	wxSqlt          sql;
+	SjSearchStat    retStat;
+
+	// a pending background search is outdated now
+	CancelSearch();
+
+	// does the new search only narrow the current result? (check before m_search is changed)
+	bool refine = !deepSearch && IsSearchRefinement(search);
+
+	// create the filter IDs, if needed
+	if( deepSearch || m_search.m_adv!=search.m_adv )
+	{
+		if( g_filterHash == NULL )
+		{
+			g_filterHash = &m_filterHash;
+			sqlite3_create_function(sql.GetDb()->GetDb(), "infilter", 1, SQLITE_ANY, NULL, sqlite_infilter, NULL, NULL);
+		}
+
+		retStat = search.m_adv.GetAsSqlCached(&m_filterHash, m_filterCond);
+		m_filterHashVersion++;
+	}
+	m_search = search;
+
+	// cancel search?
+	if( !search.IsSet() )
+	{
+		m_searchOffsetsCount = -1;
+		m_searchTracksHash.Clear();
+		return retStat; // search canceled - no tracks found
+	}
+
+	// anything to search for?
+	long offsetsMax = GetSearchOffsetsMax();
+	if( offsetsMax <= 0 )
+	{
+		return retStat; // no error but nothing to search for
+	}
+
+	// build query string and query database
+	if( refine && g_refineHash == NULL )
+	{
+		g_refineHash = &m_searchTracksHash;
+		sqlite3_create_function(sql.GetDb()->GetDb(), "inrefine", 1, SQLITE_ANY, NULL, sqlite_inrefine, NULL, NULL);
+	}
+
+	bool        gatherAzFirst;
+	wxString    query = BuildSearchQuery(m_search, refine, gatherAzFirst);
+
+	SjLibrarySearchResult result(offsetsMax, gatherAzFirst, 0);
+	if( !result.IsOk() )
+	{
+		return retStat; /* error */
+	}
+
+	SjLibraryRunSearch(sql, query, &result, NULL);
+
+	// make the result visible
+	PublishSearchResult(&result);
 
 	// done
-	free(g_tracksPerAlbum);
 	retStat.m_totalResultCount = m_searchTracksHash.GetCount();
 	return retStat;
 }
 
 
+bool SjLibraryModule::StartSearch(const SjSearch& search)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	// only simple searches are done in the background; changing the advanced
+	// search needs to calculate the filter which is done synchronously
+	if( !search.m_simple.IsSet()
+	 ||  search.m_adv != m_search.m_adv
+	 ||  m_searchThreadFailed )
+	{
+		return false;
+	}
+
+	long offsetsMax = GetSearchOffsetsMax();
+	if( offsetsMax <= 0 )
+	{
+		return false;
+	}
+
+	// start the search thread, if not yet done
+	if( m_searchThread == NULL )
+	{
+		m_searchThread = new SjLibrarySearchThread();
+		if( !m_searchThread->Start() )
+		{
+			wxLogDebug(wxT("Cannot start the search thread, searching in the main thread."));
+			delete m_searchThread;
+			m_searchThread = NULL;
+			m_searchThreadFailed = true;
+			return false;
+		}
+		m_searchThreadFilterVersion = -1;
+	}
+
+	// the thread gets its own copy of the filter if it has changed
+	SjLLHash* filterHash = NULL;
+	if( search.m_adv.IsSet()
+	 && m_searchThreadFilterVersion != m_filterHashVersion )
+	{
+		filterHash = new SjLLHash;
+		*filterHash = m_filterHash;
+		m_searchThreadFilterVersion = m_filterHashVersion;
+	}
+
+	// a refinement gets its own copy of the current result, the main thread
+	// may change m_searchTracksHash while the job runs
+	bool        refine = IsSearchRefinement(search);
+	SjLLHash*   refineHash = NULL;
+	if( refine )
+	{
+		refineHash = new SjLLHash;
+		*refineHash = m_searchTracksHash;
+	}
+
+	// start the job, any previous job is cancelled
+	bool        gatherAzFirst;
+	wxString    query = BuildSearchQuery(search, refine, gatherAzFirst);
+
+	m_pendingSearch = search;
+	m_searchThread->AddJob(query, gatherAzFirst, offsetsMax, filterHash, refineHash);
+	return true;
+}
+
+
+bool SjLibraryModule::FinishSearch(SjSearchStat& retStat)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	if( m_searchThread == NULL )
+	{
+		return false;
+	}
+
+	SjLibrarySearchResult* result = m_searchThread->TakeResult();
+	if( result == NULL )
+	{
+		return false; // outdated or already taken
+	}
+
+	m_search = m_pendingSearch;
+	PublishSearchResult(result);
+	delete result;
+
+	retStat.m_totalResultCount = m_searchTracksHash.GetCount();
+	return true;
+}
+
+
+void SjLibraryModule::CancelSearch()
+{
+	if( m_searchThread )
+	{
+		m_searchThread->Cancel();
+	}
+}
+
+
 void SjLibraryModule::GetIdsInView(SjLLHash* ret,
                                    bool ignoreSimpleSearchIfNull,
                                    bool ignoreAdvSearchIfNull)
@@ -2461,6 +3849,7 @@ long SjLibraryModule::DelInsSelection(bool del)
 			{
 				m_filterHash.Remove(selectedId);
 			}
+			m_filterHashVersion++;
 
 			// make sure, the hash is always regarded
 			// (SjAdvSearch::GetAsSql() may have returned some other, optimized query)
@@ -2713,54 +4102,67 @@ bool SjLibraryModule::GetTrackInfo(const wxString& url, SjTrackInfo& trackInfo,
 }
 
 
-wxArrayString SjLibraryModule::GetUniqueValues(long what)
+void SjLibraryModule::LoadQuickInfo(const wxArrayString& urls, SjQuickInfoCache& cache)
 {
-	wxString        name = what==SJ_TI_GENRENAME? wxT("genrename") : wxT("groupname");
+	size_t i, iCount = urls.GetCount();
+	if( iCount == 0 )
+		return;
 
-	wxSqlt          sql;
-	wxString        allValuesString = sql.ConfigRead(wxT("library/") + name, wxEmptyString);
-	wxArrayString   allValuesArray;
+	wxSqlt   sql;
+	wxString urlsStr;
+	for( i = 0; i < iCount; i++ )
+	{
+		if( i ) urlsStr += wxT(",");
+		urlsStr += wxT("'") + sql.QParam(urls[i]) + wxT("'");
+	}
 
-	wxString        currValue;
+	sql.Query(wxT("SELECT url, trackName, leadArtistName, playtimeMs, albumName FROM tracks WHERE url IN (") + urlsStr + wxT(");"));
 
-	wxStringTokenizer tkz(allValuesString, wxT("\n\r"));
-	while( tkz.HasMoreTokens() )
+	SjQuickInfo info;
+	while( sql.Next() )
 	{
-		currValue = tkz.GetNextToken();
-		if( !currValue.IsEmpty() )
-		{
-			allValuesArray.Add(currValue);
-		}
+		info.m_trackName      = sql.GetString(1);
+		info.m_leadArtistName = sql.GetString(2);
+		info.m_playtimeMs     = sql.GetLong  (3);
+		info.m_albumName      = sql.GetString(4);
+		cache.Insert(sql.GetString(0), info);
+	}
+}
+
+
+wxArrayString SjLibraryModule::GetUniqueValues(long what)
+{
+	wxASSERT( what == SJ_TI_GENRENAME || what == SJ_TI_GROUPNAME );
+
+	wxArrayString   allValuesArray;
+	SjLibraryDict*  dict = GetDict(what);
+	if( dict )
+	{
+		dict->GetValues(allValuesArray);
 	}
 
 	return allValuesArray;
 }
 
 
-bool SjLibraryModule::GetAutoComplete(long what, const wxString& in, wxString& out, bool internalCall)
+void SjLibraryModule::GetUniqueValues(long what, SjSSHash& ret)
 {
-	wxString    name;
-	wxSqlt      sql;
+	wxASSERT( what == SJ_TI_GENRENAME || what == SJ_TI_GROUPNAME );
 
-	if( what == SJ_TI_ALBUMNAME )      { name = wxT("albumname");      }
-	else if( what == SJ_TI_GENRENAME )      { name = wxT("genrename");      }
-	else if( what == SJ_TI_GROUPNAME )      { name = wxT("groupname");      }
-	else if( what == SJ_TI_LEADARTISTNAME ) { name = wxT("leadartistname"); }
-	else if( what == SJ_TI_ORGARTISTNAME )  { name = wxT("orgartistname");  }
-	else if( what == SJ_TI_COMPOSERNAME )   { name = wxT("composername");   }
-	else if( what == SJ_TI_COMMENT )        { name = wxT("comment");        }
-	else if( what == SJ_TI_TRACKNAME )      { name = wxT("trackname");      }
-	else if( what == SJ_TI_URL )            { name = wxT("url");            }
+	SjLibraryDict* dict = GetDict(what);
+	if( dict )
+	{
+		dict->GetValues(ret);
+	}
+}
 
 
-	sql.Query(wxT("SELECT ") + name + wxT(" FROM tracks WHERE ") + name + wxT(" LIKE '") + sql.QParam(in) + wxT("%' ORDER BY ") + name + wxT(" LIMIT 1;"));
-	if( sql.Next() )
+bool SjLibraryModule::GetAutoComplete(long what, const wxString& in, wxString& out, bool internalCall)
+{
+	SjLibraryDict* dict = GetDict(what, TRUE/*inBackground, no completion until the dictionary is ready*/);
+	if( dict && dict->Complete(in, out) )
 	{
-		out = sql.GetString(0);
-		if( out.Len() > in.Len() )
-		{
-			return TRUE;
-		}
+		return TRUE;
 	}
 
 	if( !internalCall )
@@ -4262,6 +5664,12 @@ void SjLibraryModule::PlaybackDone(const wxString& url, unsigned long newStartin
 	sql.Query(wxString::Format(wxT("UPDATE tracks SET timesplayed=%lu, lastplayed=%lu, autovol=%i, playtimems=%i WHERE id=%lu;"),
 	                           oldTimesPlayed+1, newStartingTime, (int)newGainLong, (int)newPlaytimeMs,
 	                           id));
+
+	// the list view caches the rows
+	if( !SjMainApp::IsInShutdown() && g_mainFrame->m_browser )
+	{
+		g_mainFrame->m_browser->GetListBrowser()->InvalidateTrack(id);
+	}
 }
 
 
@@ -5049,6 +6457,7 @@ public:
 	long            GetTrackCount       () { return m_idsCount; }
 	void            GetTrack            (long offset, SjTrackInfo&, long& albumId, long& special);
 	long            GetTrackSpecial     (long offset);
+	long            GetTrackId          (long offset) { return m_ids[offset].id; }
 	bool            IsTrackSelected     (long offset) { return m_module->m_selectedTrackIds.Lookup(m_ids[offset].id)!=0; }
 	void            SelectTrack         (long offset, bool select) { m_module->m_selectedTrackIds.InsertOrRemove(m_ids[offset].id, select? 1L : 0L); }
 	long            Url2TrackOffset     (const wxString& url); // return -1 if not in view
@@ -52,6 +52,38 @@ private:
 };
 
 
+class SjLibraryDictEntry;
+class SjLibraryDict
+{
+public:
+	// an in-memory dictionary of all distinct values of a track field with
+	// their number of occurrences, sorted case-insensitively; used for auto
+	// completion and lists of unique values without querying the database.
+	                SjLibraryDict       () { m_entries = NULL; m_count = 0; m_alloc = 0; m_valid = false; }
+	                ~SjLibraryDict      () { Clear(); }
+	void            Clear               (); // the dictionary is invalid until Build() is called
+	bool            IsValid             () const { return m_valid; }
+	void            Build               (const wxString& fieldName, wxSqltDb* db=NULL); // db may be a read-only connection of another thread
+	void            Swap                (SjLibraryDict& o);
+
+	// maintaining, empty values are ignored
+	void            Add                 (const wxString& value, long count=1);
+	void            Remove              (const wxString& value);
+
+	// lookup
+	bool            Complete            (const wxString& prefix, wxString& ret) const;
+	void            GetValues           (wxArrayString& ret) const;
+	void            GetValues           (SjSSHash& ret) const;
+
+private:
+	SjLibraryDictEntry** m_entries;
+	long            m_count, m_alloc;
+	bool            m_valid;
+	long            Find                (const wxString& folded, const wxString& value, bool& found) const;
+};
+#define SJ_LIBDICT_COUNT 9
+
+
 // do not change the flag values are they're saved to disk!
 #define SJ_LIB_SHOWDISKNR             0x00000001L
 #define SJ_LIB_SHOWTRACKNR            0x00000002L
@@ -79,6 +111,11 @@ private:
 #define SJ_SHORTENED_ARTISTNAME_LEN 24
 
 
+class SjLibrarySearchThread;
+class SjLibraryDictThread;
+class SjLibrarySearchResult;
+
+
 class SjLibraryModule : public SjColModule
 {
 public:
@@ -86,6 +123,16 @@ public:
 
 	SjSearchStat    SetSearch           (const SjSearch&, bool deepSearch);
 
+	// Background search: StartSearch() returns false if the search cannot be
+	// done in the background, use SetSearch() then.  Otherwise, IDO_SEARCHDONE
+	// is sent to the main frame when the search is done and FinishSearch()
+	// should be called to make the result visible; FinishSearch() returns false
+	// if the result is outdated.  Each call to StartSearch(), SetSearch() or
+	// CancelSearch() cancels any pending background search.
+	bool            StartSearch         (const SjSearch&);
+	bool            FinishSearch        (SjSearchStat&);
+	void            CancelSearch        ();
+
 	void            GetIdsInView        (SjLLHash* ret, bool ignoreSimpleSearchIfNull=FALSE, bool ignoreAdvSearchIfNull=FALSE);
 
 	SjEmbedTo       EmbedTo             () { return SJ_EMBED_TO_MUSICLIB; }
@@ -121,13 +168,16 @@ public:
 	long            DelInsSelection     (bool del);
 
 	// misc.
-	wxArrayString   GetUniqueValues     (long what);
+	wxArrayString   GetUniqueValues     (long what); // only SJ_TI_GENRENAME and SJ_TI_GROUPNAME
+	void            GetUniqueValues     (long what, SjSSHash& ret); // the same as a hash, for fast lookups
+	void            UpdateDict          (long what, const wxString& oldValue, const wxString& newValue); // to be called if a value is changed without WriteTrackInfo()
 
 	bool            GetAutoComplete     (long what, const wxString& in, wxString& out, bool internalCall = FALSE);
 	void            DoAutoComplete      (long what, int& oldTypedLen, wxWindow*);
 
 
 	bool            GetTrackInfo        (const wxString& url, SjTrackInfo&, long flags, bool logErrors);
+	void            LoadQuickInfo       (const wxArrayString& urls, SjQuickInfoCache&); // adds the information of all given URLs found in the library with a single query
 	void            PlaybackDone        (const wxString& url, unsigned long startingTime, double newGain, long realDecodedBytes);
 	void            GetAutoVol          (const wxString& url, double* trackGain, double* albumGain) const; // set to < 0 if unknown
 	double          GetAutoVol          (const wxString& url, bool useAlbumGainIfPossible);
@@ -198,6 +248,15 @@ private:
 	long            m_searchOffsetsCount; // -1 indicated "no search", use HasSearch() for testing
 	SjLLHash        m_searchTracksHash;
 	SjSearch        m_search;
+	SjLibrarySearchThread* m_searchThread;
+	bool            m_searchThreadFailed;
+	SjSearch        m_pendingSearch;
+	long            m_filterHashVersion, m_searchThreadFilterVersion; // m_filterHashVersion is incremented whenever m_filterHash changes
+	long            GetSearchOffsetsMax ();
+	bool            m_searchRefinable;    // false if the tracks may have changed since m_searchTracksHash was created
+	bool            IsSearchRefinement  (const SjSearch& newSearch);
+	wxString        BuildSearchQuery    (const SjSearch&, bool refine, bool& gatherAzFirst);
+	void            PublishSearchResult (SjLibrarySearchResult*);
 	bool            HasSearch           () {return m_searchOffsetsCount==-1? FALSE : TRUE;}
 	bool            IsInSearch          (long trackId) {return m_searchOffsetsCount==-1? TRUE : (m_searchTracksHash.Lookup(trackId)!=0); }
 	bool            ModifySearch        (int keyCode, bool modifiersPressed);
@@ -228,7 +287,20 @@ private:
 
 	bool            m_deepUpdate;
 	unsigned long   m_updateStartingTime; // the DOS timestamp the update process started
-	SjIdCollector   m_updatedTracks;
+	long            m_updateGen;          // all tracks found by the current update are stamped with this value
+	wxArrayLong     m_updateGenIds;       // tracks not yet stamped, written in chunks by FlushUpdateGen()
+	void            StampUpdateGen      (long trackId) { m_updateGenIds.Add(trackId); if( m_updateGenIds.GetCount() >= 512 ) { FlushUpdateGen(); } }
+	void            FlushUpdateGen      ();
+
+	// album keys: tracks that do not share any key are never combined to the same album,
+	// this allows to recombine only the albums of changed tracks, see CombineTracksToAlbums()
+	#define         SJ_ALBUMKEY_COUNT 4
+	void            GetAlbumKeys        (const wxString& leadArtistName, const wxString& albumName, const wxString& genreName, const wxString& url, long keys[SJ_ALBUMKEY_COUNT]);
+	wxString        GetAlbumKeysSignature();
+	bool            GetAffectedAlbumTracks(SjLLHash& ret);
+	bool            PatchAlbumIndex     (SjLLHash& computedAlbums, SjLLHash& repositionAlbums, SjLLHash& oldAlbums, SjLLHash& azToUpdate);
+	SjLLHash        m_albumPendingTracks; // tracks changed since the last call to CombineTracksToAlbums()
+	SjLLHash        m_albumPendingAlbums; // the previous albums of these tracks and of deleted tracks
 
 	SjCoverFinder   m_coverFinder;
 
@@ -243,8 +315,14 @@ private:
 
 	bool            WriteTrackInfo      (SjTrackInfo*, long trackId, bool writeArtIds=TRUE);
 
-	bool            CombineTracksToAlbums();
-	bool            UpdateUniqueValues  (const wxString& name);
+	bool            CombineTracksToAlbums(bool allowIncremental=FALSE); // if allowIncremental is set, only the albums of tracks changed since the last call may be recombined
+
+	SjLibraryDict   m_dicts[SJ_LIBDICT_COUNT];
+	SjLibraryDictThread* m_dictThreads[SJ_LIBDICT_COUNT];
+	long            m_dictsVersion;     // incremented on each change, results of outdated threads are dropped
+	SjLibraryDict*  GetDict             (long what, bool inBackground=FALSE); // builds the dictionary if needed, NULL for unsupported fields or if built in background
+	void            InvalidateDicts     ();
+	void            StopDictThreads     ();
 
 	SjLibrarySort   m_sort;
 	long            m_n1, m_n2; /* see top of library.cpp */
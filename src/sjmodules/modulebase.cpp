@@ -41,6 +41,12 @@
 #include <sjtools/console.h>
 #include <sjtools/fs_inet.h>
 #include <see_dom/sj_see.h>
+#ifdef __WXMSW__
+#include <windows.h>
+#include <wx/msw/winundef.h> // undef symbols conflicting with wxWidgets
+#elif defined(__linux__)
+#include <sys/vfs.h>
+#endif
 
 #include <wx/listimpl.cpp>
 WX_DEFINE_LIST(SjModuleList);
@@ -83,6 +89,37 @@ SjModuleSystem::~SjModuleSystem()
 }
 
 
+static bool isLocalDbFile__(const wxString& path)
+{
+	// returns FALSE if the file is known to be on a network drive
+	#if defined(__WXMSW__)
+		if( path.StartsWith("\\\\") )
+			return FALSE; // UNC path
+		wxString root = path.Left(3);
+		if( root.Len() == 3 && root[1] == ':' )
+			return ::GetDriveType(root.c_str()) != DRIVE_REMOTE;
+		return TRUE;
+	#elif defined(__linux__)
+		struct statfs fs;
+		if( statfs(path.mb_str(wxConvFile), &fs) != 0
+		 && statfs(wxPathOnly(path).mb_str(wxConvFile), &fs) != 0 )
+			return TRUE; // unknown, assume local
+		switch( (unsigned long)fs.f_type )
+		{
+			case 0x6969UL:      // NFS
+			case 0x517BUL:      // SMB
+			case 0xFF534D42UL:  // CIFS
+			case 0xFE534D42UL:  // SMB2
+			case 0x65735546UL:  // FUSE, eg. sshfs
+				return FALSE;
+		}
+		return TRUE;
+	#else
+		return TRUE;
+	#endif
+}
+
+
 static void fileName2Url__(wxSqlt& sql, const wxString& table)
 {
 	wxArrayLong   ids;
@@ -147,6 +184,24 @@ void SjModuleSystem::Init()
 		if( !db->IsOk() ) { SjMainApp::FatalError(); }
 		db->SetDefault();
 
+		// ...use write-ahead logging, this allows reading from other connections
+		// (eg. the background search) while the main connection is writing.
+		// the journal mode is stored in the database file and WAL does not work
+		// on network shares, so we use it only for local files and allow
+		// disabling it by "main/idxWal=0" (eg. if the file is shared with older tools)
+		{
+			wxSqlt sql;
+			if( g_tools->m_config->Read("main/idxWal", SJ_DEF_SQLITE_WAL)!=0
+			 && isLocalDbFile__(g_tools->m_dbFile) )
+			{
+				sql.Query("PRAGMA journal_mode=WAL;");
+			}
+			else
+			{
+				sql.Query("PRAGMA journal_mode=DELETE;"); // undo a previous conversion
+			}
+		}
+
 		// ...the database version: if the major version of the database is
 		// _larger_, the database cannot be opened.  However, the version
 		// normally does not change at all as we can add tables and fields as
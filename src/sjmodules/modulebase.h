@@ -416,6 +416,7 @@ public:
 	#define         SJ_LISTVIEW_SPECIAL_DARK            0x08
 	virtual void    GetTrack            (long offset, SjTrackInfo&, long& albumId, long& special) = 0;
 	virtual long    GetTrackSpecial     (long offset) = 0;
+	virtual long    GetTrackId          (long offset) = 0; // cheap, no database access
 
 
 	virtual wxString GetUpText          () = 0;
@@ -35,6 +35,7 @@
 #include <sjmodules/tageditor/tageditorsplit.h>
 #include <sjmodules/tageditor/tageditorreplace.h>
 #include <sjmodules/tageditor/tageditorfreedb.h>
+#include <sjmodules/tageditor/tagwriter.h>
 #include <sjmodules/help/htmlwindow.h>
 #include <tagger/tg_a_tagger_frontend.h>
 #include <tagger/tg_bytefile.h>
@@ -1458,6 +1459,13 @@ void SjTagEditorDlg::Dlg2Data_CopyAll(SjTagEditorPlugin* plugin, bool& reloadDat
 
 		long                updateStartingTime = wxDateTime::Now().GetAsDOS();
 
+		// the tags are written in the background, the library is updated when a file is done;
+		// all library updates go to a single transaction which is also committed on cancel
+		// as the files written so far should be in sync with the library
+		SjTagWriter         tagWriter;
+		bool                writeTags = g_tagEditorModule->GetWriteId3Tags();
+		wxSqltTransaction   transaction;
+
 		wxBusyCursor*       busyCursor = new wxBusyCursor;
 		SjBusyInfo*         busyInfo = NULL;
 		bool                updateGenres = FALSE,
@@ -1465,8 +1473,9 @@ void SjTagEditorDlg::Dlg2Data_CopyAll(SjTagEditorPlugin* plugin, bool& reloadDat
 		                    updateAlbums = FALSE;
 
 		// write all modifications
-		wxArrayString oldGenres = lib->GetUniqueValues(SJ_TI_GENRENAME);
-		wxArrayString oldGroups = lib->GetUniqueValues(SJ_TI_GROUPNAME);
+		SjSSHash oldGenres, oldGroups;
+		lib->GetUniqueValues(SJ_TI_GENRENAME, oldGenres);
+		lib->GetUniqueValues(SJ_TI_GROUPNAME, oldGroups);
 		long changedFields = 0;
 		for( i = 0; i < modCount; i++ )
 		{
@@ -1478,10 +1487,16 @@ void SjTagEditorDlg::Dlg2Data_CopyAll(SjTagEditorPlugin* plugin, bool& reloadDat
 			{
 				if( !lastUrl.IsEmpty() )
 				{
-					Data2Dsk_Write(lastUrl, ti, updateAlbums);
+					Data2Dsk_Write(lastUrl, ti, updateAlbums, &tagWriter);
 					lastUrl.Empty();
 				}
 
+				if( !Data2Dsk_TakeResults(tagWriter) )
+				{
+					canceled = TRUE;
+					break; // user abort
+				}
+
 				ti.Clear();
 				if( !lib->GetTrackInfo(modItem->GetUrl(), ti, SJ_TI_FULLINFO, FALSE) )
 				{
@@ -1491,7 +1506,7 @@ void SjTagEditorDlg::Dlg2Data_CopyAll(SjTagEditorPlugin* plugin, bool& reloadDat
 				ti.m_timeModified = updateStartingTime;
 				lastUrl = modItem->GetUrl();
 
-				if( !SjBusyInfo::Set(lastUrl, i==0) )
+				if( !SjBusyInfo::Set(writeTags? wxString() : lastUrl, i==0) ) // if tags are written, the files are counted by Data2Dsk_TakeResults()
 				{
 					canceled = TRUE;
 					break; // user abort
@@ -1513,7 +1528,7 @@ void SjTagEditorDlg::Dlg2Data_CopyAll(SjTagEditorPlugin* plugin, bool& reloadDat
 						updateAlbums = TRUE;
 					}
 
-					if( oldGenres.Index(ti.m_genreName) == wxNOT_FOUND )
+					if( oldGenres.Lookup(ti.m_genreName) == NULL )
 					{
 						updateGenres = TRUE;
 					}
@@ -1524,7 +1539,7 @@ void SjTagEditorDlg::Dlg2Data_CopyAll(SjTagEditorPlugin* plugin, bool& reloadDat
 			{
 				if( changedFields&SJ_TI_GROUPNAME )
 				{
-					if( oldGroups.Index(ti.m_groupName) == wxNOT_FOUND )
+					if( oldGroups.Lookup(ti.m_groupName) == NULL )
 					{
 						updateGroups = TRUE;
 					}
@@ -1555,10 +1570,29 @@ void SjTagEditorDlg::Dlg2Data_CopyAll(SjTagEditorPlugin* plugin, bool& reloadDat
 			}
 		}
 
-		if( !lastUrl.IsEmpty() )
+		if( !lastUrl.IsEmpty() && !canceled )
+		{
+			Data2Dsk_Write(lastUrl, ti, updateAlbums, &tagWriter);
+		}
+
+		// wait for the tags being written; on cancel, the files currently being written are finished
+		if( canceled )
+		{
+			tagWriter.Cancel();
+		}
+
+		while( tagWriter.IsBusy() )
 		{
-			Data2Dsk_Write(lastUrl, ti, updateAlbums);
+			wxMilliSleep(20);
+			if( !Data2Dsk_TakeResults(tagWriter) || !SjBusyInfo::Set() )
+			{
+				tagWriter.Cancel();
+				canceled = TRUE;
+			}
 		}
+		Data2Dsk_TakeResults(tagWriter);
+
+		transaction.Commit();
 
 		// update the rest
 
@@ -1570,18 +1604,10 @@ void SjTagEditorDlg::Dlg2Data_CopyAll(SjTagEditorPlugin* plugin, bool& reloadDat
 			// but this is more complicated.
 			g_mainFrame->EndAllSearch();
 
-			lib->CombineTracksToAlbums();
-		}
-
-		if( updateGenres )
-		{
-			lib->UpdateUniqueValues(wxT("genrename"));
+			lib->CombineTracksToAlbums(TRUE/*allowIncremental*/);
 		}
 
-		if( updateGroups )
-		{
-			lib->UpdateUniqueValues(wxT("groupname"));
-		}
+		// (the lists of genres and groups are updated by WriteTrackInfo())
 
 		// update view
 
@@ -1703,6 +1729,7 @@ void SjTagEditorDlg::RenameDone__(const wxString& oldUrl, const wxString& newUrl
 
 		// update database
 		sql.Query(wxT("UPDATE tracks SET url='") + sql.QParam(newUrl) + wxT("' WHERE url='") + sql.QParam(oldUrl) + wxT("';"));
+		g_mainFrame->m_libraryModule->UpdateDict(SJ_TI_URL, oldUrl, newUrl);
 	}
 
 	// inform the main frame about the change --
@@ -1790,7 +1817,7 @@ void SjTagEditorDlg::WaitForWriteAccess__(const wxString& url)
 }
 
 
-bool SjTagEditorDlg::Data2Dsk_Write(const wxString& orgUrl, SjTrackInfo& ti, bool& updateAlbums)
+bool SjTagEditorDlg::Data2Dsk_Write(const wxString& orgUrl, SjTrackInfo& ti, bool& updateAlbums, SjTagWriter* tagWriter)
 {
 	SjLibraryModule* lib = g_mainFrame->m_libraryModule;
 
@@ -1845,9 +1872,7 @@ bool SjTagEditorDlg::Data2Dsk_Write(const wxString& orgUrl, SjTrackInfo& ti, boo
 		}
 	}
 
-	// write the data
-	lib->WriteTrackInfo(&ti, ti.m_id, FALSE/*don't write art ids (not loaded)*/);
-
+	// write the tags; this is done in the background unless the player waits for the file
 	if( g_tagEditorModule->GetWriteId3Tags() )
 	{
 		SjScannerModule* scannerModule = g_mainFrame->m_moduleSystem.FindScannerModuleByUrl(ti.m_url);
@@ -1855,13 +1880,17 @@ bool SjTagEditorDlg::Data2Dsk_Write(const wxString& orgUrl, SjTrackInfo& ti, boo
 		{
 			wxASSERT( scannerModule->IsLoaded() );
 
+			if( tagWriter && !stopped && tagWriter->Add(scannerModule, ti) )
+			{
+				return TRUE; // the library is updated by Data2Dsk_TakeResults()
+			}
+
 			scannerModule->SetTrackInfo(ti.m_url, ti);
 		}
 	}
 
-	// RenameDone__() with no new url set will
-	// just inform the needed instances about the modified data.
-	RenameDone__(ti.m_url, wxT(""));
+	// write the data
+	Data2Dsk_WriteDone(ti);
 
 	// done so far -- restart player, if stopped
 Data2Dsk_Write_Done:
@@ -1875,6 +1904,35 @@ Data2Dsk_Write_Done:
 }
 
 
+void SjTagEditorDlg::Data2Dsk_WriteDone(SjTrackInfo& ti)
+{
+	g_mainFrame->m_libraryModule->WriteTrackInfo(&ti, ti.m_id, FALSE/*don't write art ids (not loaded)*/);
+
+	// RenameDone__() with no new url set will
+	// just inform the needed instances about the modified data.
+	RenameDone__(ti.m_url, wxT(""));
+}
+
+
+bool SjTagEditorDlg::Data2Dsk_TakeResults(SjTagWriter& tagWriter)
+{
+	// update the library for the files written by the tag writer;
+	// returns FALSE if the user has cancelled the process
+	bool ret = TRUE;
+	SjTrackInfo ti;
+	while( tagWriter.TakeResult(ti) )
+	{
+		Data2Dsk_WriteDone(ti);
+
+		if( !SjBusyInfo::Set(ti.m_url) )
+		{
+			ret = FALSE;
+		}
+	}
+	return ret;
+}
+
+
 /*******************************************************************************
  *  SjTagEditorModule
  ******************************************************************************/
@@ -117,6 +117,7 @@ private:
 
 
 class SjTagEditorPlugin;
+class SjTagWriter;
 
 
 class SjTagEditorDlg : public SjDialog
@@ -164,7 +165,9 @@ private:
 	bool            Dlg2Data_IsChecked  (int id);
 
 	// Transferring data -> disk
-	bool            Data2Dsk_Write      (const wxString& orgUrl, SjTrackInfo&, bool& updateAlbums);
+	bool            Data2Dsk_Write      (const wxString& orgUrl, SjTrackInfo&, bool& updateAlbums, SjTagWriter* = NULL);
+	void            Data2Dsk_WriteDone  (SjTrackInfo&);
+	bool            Data2Dsk_TakeResults(SjTagWriter&);
 
 	// Creating the dialog
 	wxTextCtrl*     CreateTextCtrl      (wxWindow* parent, wxSizer*, int id, const wxSize&, int borderTop, bool multiLine = FALSE);
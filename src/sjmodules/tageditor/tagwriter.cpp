@@ -0,0 +1,239 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    tagwriter.cpp
+ * Authors: Björn Petersen
+ * Purpose: Writing the tags of several files in the background
+ *
+ ******************************************************************************/
+
+
+#include <sjbase/base.h>
+#include <sjmodules/tageditor/tagwriter.h>
+
+
+/*******************************************************************************
+ * SjTagWriterThread
+ ******************************************************************************/
+
+
+class SjTagWriterJob
+{
+public:
+	SjScannerModule* m_scannerModule;
+	SjTrackInfo      m_trackInfo;
+};
+
+
+class SjTagWriterThread : public wxThread
+{
+public:
+	SjTagWriterThread(SjTagWriter* writer)
+		: wxThread(wxTHREAD_JOINABLE)
+	{
+		m_writer = writer;
+	}
+
+private:
+	void*           Entry               ();
+	SjTagWriter*    m_writer;
+};
+
+
+void* SjTagWriterThread::Entry()
+{
+	// SetTrackInfo() logs errors itself; the messages are shown by the main thread
+	SjTagWriterJob* job;
+	while( (job=m_writer->TakeJob()) != NULL )
+	{
+		job->m_scannerModule->SetTrackInfo(job->m_trackInfo.m_url, job->m_trackInfo);
+		m_writer->AddResult(job);
+	}
+
+	return NULL;
+}
+
+
+/*******************************************************************************
+ * SjTagWriter - called by the threads
+ ******************************************************************************/
+
+
+SjTagWriterJob* SjTagWriter::TakeJob()
+{
+	wxMutexLocker locker(m_mutex);
+
+	while( !m_exit && m_todo.IsEmpty() )
+	{
+		m_condition.Wait();
+	}
+
+	if( m_todo.IsEmpty() ) {
+		return NULL; // m_exit is set and nothing left
+	}
+
+	SjTagWriterJob* job = (SjTagWriterJob*)m_todo[0];
+	m_todo.RemoveAt(0);
+	m_busyCount++;
+	return job;
+}
+
+
+void SjTagWriter::AddResult(SjTagWriterJob* job)
+{
+	wxMutexLocker locker(m_mutex);
+
+	m_done.Add(job);
+	m_busyCount--;
+}
+
+
+/*******************************************************************************
+ * SjTagWriter - called by the main thread
+ ******************************************************************************/
+
+
+SjTagWriter::SjTagWriter()
+	: m_condition(m_mutex)
+{
+	m_threadCount = 0;
+	m_busyCount   = 0;
+	m_exit        = false;
+}
+
+
+SjTagWriter::~SjTagWriter()
+{
+	wxASSERT( wxThread::IsMain() );
+
+	Cancel();
+
+	{
+		wxMutexLocker locker(m_mutex);
+		m_exit = true;
+		m_condition.Broadcast();
+	}
+
+	for( int i = 0; i < m_threadCount; i++ )
+	{
+		m_threads[i]->Wait();
+		delete m_threads[i];
+	}
+
+	size_t i, iCount = m_done.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		delete (SjTagWriterJob*)m_done[i];
+	}
+}
+
+
+void SjTagWriter::StartThreads()
+{
+	// writing tags is mainly disk i/o, however, more than one thread helps
+	// as rewriting a file is often delayed by the file system or by virus scanners
+	int threadCount = wxThread::GetCPUCount();
+	if( threadCount < 2 ) { threadCount = 2; }
+	if( threadCount > SJ_TAGWRITER_MAX_THREADS ) { threadCount = SJ_TAGWRITER_MAX_THREADS; }
+
+	for( int i = 0; i < threadCount; i++ )
+	{
+		SjTagWriterThread* thread = new SjTagWriterThread(this);
+		if( thread->Create() != wxTHREAD_NO_ERROR ) {
+			delete thread;
+			break;
+		}
+		if( thread->Run() != wxTHREAD_NO_ERROR ) {
+			delete thread;
+			break;
+		}
+		m_threads[m_threadCount++] = thread;
+	}
+}
+
+
+bool SjTagWriter::Add(SjScannerModule* scannerModule, const SjTrackInfo& trackInfo)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	// start the threads on the first call; if this fails, the caller should write the tags itself
+	if( m_threadCount == 0 )
+	{
+		if( !m_condition.IsOk() ) {
+			return false;
+		}
+
+		StartThreads();
+		if( m_threadCount == 0 ) {
+			return false;
+		}
+	}
+
+	SjTagWriterJob* job = new SjTagWriterJob;
+	job->m_scannerModule = scannerModule;
+	job->m_trackInfo     = trackInfo;
+
+	wxMutexLocker locker(m_mutex);
+	m_todo.Add(job);
+	m_condition.Signal();
+	return true;
+}
+
+
+bool SjTagWriter::TakeResult(SjTrackInfo& retTrackInfo)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	SjTagWriterJob* job;
+	{
+		wxMutexLocker locker(m_mutex);
+		if( m_done.IsEmpty() ) {
+			return false;
+		}
+		job = (SjTagWriterJob*)m_done[0];
+		m_done.RemoveAt(0);
+	}
+
+	retTrackInfo = job->m_trackInfo;
+	delete job;
+	return true;
+}
+
+
+bool SjTagWriter::IsBusy()
+{
+	wxMutexLocker locker(m_mutex);
+	return (!m_todo.IsEmpty() || m_busyCount > 0);
+}
+
+
+void SjTagWriter::Cancel()
+{
+	// files already being written are finished and can be fetched by TakeResult() as usual
+	wxMutexLocker locker(m_mutex);
+
+	size_t i, iCount = m_todo.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		delete (SjTagWriterJob*)m_todo[i];
+	}
+	m_todo.Empty();
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    tagwriter.h
+ * Authors: Björn Petersen
+ * Purpose: Writing the tags of several files in the background
+ *
+ ******************************************************************************/
+
+
+#ifndef __SJ_TAGWRITER_H__
+#define __SJ_TAGWRITER_H__
+
+
+class SjScannerModule;
+class SjTagWriterThread;
+class SjTagWriterJob;
+
+
+class SjTagWriter
+{
+public:
+	// The tags are written by some worker threads using SjScannerModule::SetTrackInfo().
+	// All functions must be called from the main thread; the finished files should be
+	// fetched by TakeResult() regularly, the caller may update the library then.
+	// The destructor cancels the files not yet started and waits for the others.
+	                SjTagWriter         ();
+	                ~SjTagWriter        ();
+	bool            Add                 (SjScannerModule*, const SjTrackInfo&);
+	bool            TakeResult          (SjTrackInfo& retTrackInfo);
+	bool            IsBusy              ();
+	void            Cancel              ();
+
+private:
+	#define         SJ_TAGWRITER_MAX_THREADS 4
+	SjTagWriterThread* m_threads[SJ_TAGWRITER_MAX_THREADS];
+	int             m_threadCount;
+	void            StartThreads        ();
+
+	// the following members are protected by m_mutex
+	wxMutex         m_mutex;
+	wxCondition     m_condition;
+	wxArrayPtrVoid  m_todo;
+	wxArrayPtrVoid  m_done;
+	int             m_busyCount;
+	bool            m_exit;
+	SjTagWriterJob* TakeJob             ();
+	void            AddResult           (SjTagWriterJob*);
+
+	friend class    SjTagWriterThread;
+};
+
+
+#endif // __SJ_TAGWRITER_H__
@@ -44,8 +44,40 @@ void SjCdgRaw::Rewind()
 	m_presetColourIndex = -1;
 	m_borderColourIndex = -1;
 	m_transparentColour = -1;
-	m_updatedParts      = ALL_PARTS;
 	m_hasData           = false;
+
+	ClearDirty();
+	m_dirtyAll          = true;
+}
+
+
+void SjCdgRaw::ClearDirty()
+{
+	memset(m_dirtyTiles, 0, CDG_TILES_W * CDG_TILES_H);
+	m_dirtyAll = false;
+}
+
+
+void SjCdgRaw::SaveKeyframe(SjCdgKeyframe* kf) const
+{
+	memcpy(kf->m_screen, m_screen, CDG_SCREEN_W * CDG_SCREEN_H);
+	memcpy(kf->m_colourTable, m_colourTable, 16 * 3);
+	kf->m_presetColourIndex = m_presetColourIndex;
+	kf->m_borderColourIndex = m_borderColourIndex;
+	kf->m_transparentColour = m_transparentColour;
+	kf->m_hasData           = m_hasData;
+}
+
+
+void SjCdgRaw::RestoreKeyframe(const SjCdgKeyframe* kf)
+{
+	memcpy(m_screen, kf->m_screen, CDG_SCREEN_W * CDG_SCREEN_H);
+	memcpy(m_colourTable, kf->m_colourTable, 16 * 3);
+	m_presetColourIndex = kf->m_presetColourIndex;
+	m_borderColourIndex = kf->m_borderColourIndex;
+	m_transparentColour = kf->m_transparentColour;
+	m_hasData           = kf->m_hasData;
+	m_dirtyAll          = true;
 }
 
 
@@ -103,7 +135,7 @@ void SjCdgRaw::AddSubcode(const SjCdgSubcode* subcode)
 
 			case CDG_INST_DEF_TRANSP_COL:
 				m_transparentColour = subcode->data[0] & 0x0F;
-				m_updatedParts = ALL_PARTS;
+				m_dirtyAll = true;
 				break;
 
 			case CDG_INST_LOAD_COL_TBL_0_7:
@@ -129,7 +161,7 @@ void SjCdgRaw::AddSubcode(const SjCdgSubcode* subcode)
 void SjCdgRaw::PresetScreen()
 {
 	memset(m_screen, m_presetColourIndex, CDG_SCREEN_W*CDG_SCREEN_H);
-	m_updatedParts = ALL_PARTS;
+	m_dirtyAll = true;
 }
 
 
@@ -155,7 +187,7 @@ void SjCdgRaw::LoadColourTable(const SjCdgSubcode* subcode, int startIndex)
 		*dest++ = b << 4;
 	}
 
-	m_updatedParts = ALL_PARTS;
+	m_dirtyAll = true;
 }
 
 
@@ -196,29 +228,11 @@ void SjCdgRaw::TileBlock(const SjCdgSubcode* subcode, bool doXor)
 		}
 	}
 
-	// mark the updated parts ...
-	int partIndex = 0;
-
-	// ... remove the left and top border for easier calculations
-	tile_y -= 12;
-	tile_x -= 6;
-
-	// ... go through all 24 parts and check the intersections with the tiles
-	for( y = 0; y < CDG_IMAGE_H; y += PART_HEIGHT )
-	{
-		for( x = 0; x < CDG_IMAGE_W; x += PART_WIDTH )
-		{
-			if( tile_x+6  >= x
-			        && tile_x    <= x+PART_WIDTH
-			        && tile_y+12 >= y
-			        && tile_y    <= y+PART_HEIGHT )
-			{
-				m_updatedParts |= 1<<partIndex;
-			}
-
-			partIndex++;
-		}
-	}
+	// mark the tile as being updated; if this is the first tile at all, the
+	// whole screen changes from the background to the preset colour
+	m_dirtyTiles[(tile_y/12)*CDG_TILES_W + tile_x/6] = 1;
+	if( !m_hasData )
+		m_dirtyAll = true;
 
 	m_hasData = true;
 }
@@ -254,7 +268,7 @@ void SjCdgRaw::Scroll(const SjCdgSubcode* subcode, bool scrollRotate)
 				else
 					memset(m_screen, color, CDG_SCREEN_W*12);
 
-				m_updatedParts = ALL_PARTS;
+				m_dirtyAll = true;
 				break;
 
 			case 2: // ... 12 pixels up
@@ -266,7 +280,7 @@ void SjCdgRaw::Scroll(const SjCdgSubcode* subcode, bool scrollRotate)
 				else
 					memset(m_screen+CDG_SCREEN_W*CDG_IMAGE_H, color, CDG_SCREEN_W*12);
 
-				m_updatedParts = ALL_PARTS;
+				m_dirtyAll = true;
 				break;
 		}
 	}
@@ -58,6 +58,9 @@ struct SjCdgSubcode
 #define CDG_MASK                    0x3F
 
 
+class SjCdgKeyframe;
+
+
 class SjCdgRaw
 {
 public:
@@ -65,6 +68,8 @@ public:
 	void            Rewind              ();
 	void            AddSubcode          (const SjCdgSubcode* subcode);
 	static bool     IsDataSubcode       (const SjCdgSubcode* subcode);
+	void            SaveKeyframe        (SjCdgKeyframe*) const;
+	void            RestoreKeyframe     (const SjCdgKeyframe*);
 	#define         CDG_IMAGE_W     294 // 294/6  = 49 tiles (+1 for the border)
 	#define         CDG_IMAGE_H     204 // 204/12 = 17 tiles (+1 for the border)
 
@@ -72,12 +77,14 @@ public:
 	#define         CDG_SCREEN_H    216
 	unsigned char   m_screen[CDG_SCREEN_W * CDG_SCREEN_H];
 
-	#define         PARTS_PER_ROW   6
-	#define         PARTS_PER_COL   4
-	#define         PART_WIDTH      (CDG_IMAGE_W / PARTS_PER_ROW)
-	#define         PART_HEIGHT     (CDG_IMAGE_H / PARTS_PER_COL)
-	#define         ALL_PARTS       0xFFFFFFL
-	unsigned long   m_updatedParts;
+	// tiles modified since the last call to ClearDirty(); if m_dirtyAll is set,
+	// the whole screen must be redrawn (palette, scrolling, presets etc.)
+	#define         CDG_TILES_W     50
+	#define         CDG_TILES_H     18
+	unsigned char   m_dirtyTiles[CDG_TILES_W * CDG_TILES_H];
+	bool            m_dirtyAll;
+	bool            IsTileDirty         (int tileX, int tileY) const { return m_dirtyTiles[tileY*CDG_TILES_W + tileX]!=0; }
+	void            ClearDirty          ();
 
 	unsigned char   m_colourTable[16 * 3];
 	int             m_presetColourIndex;
@@ -94,4 +101,17 @@ private:
 };
 
 
+// a snapshot of the screen state, used for fast seeking
+class SjCdgKeyframe
+{
+public:
+	unsigned char   m_screen[CDG_SCREEN_W * CDG_SCREEN_H];
+	unsigned char   m_colourTable[16 * 3];
+	int             m_presetColourIndex;
+	int             m_borderColourIndex;
+	int             m_transparentColour;
+	bool            m_hasData;
+};
+
+
 #endif /* __SJ_CDG_RAW_H__ */
@@ -29,6 +29,13 @@
 #include <sjbase/base.h>
 #include <sjmodules/vis/vis_cdg_reader.h>
 #include <sjmodules/vis/vis_cdg_raw.h>
+#ifdef __WXMSW__
+#include <wx/msw/wrapwin.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 
 SjCdgReader::SjCdgReader(wxFSFile* fsFile)
@@ -38,16 +45,33 @@ SjCdgReader::SjCdgReader(wxFSFile* fsFile)
 	m_eof                   = false;
 	m_eokMs                 = 0; // unknown
 
-	m_fsFileData            = (unsigned char*)malloc(SJ_CDG_REALLOC_EVERY);
-	m_fsFileDataAllocated   = SJ_CDG_REALLOC_EVERY;
+	m_fsFileData            = NULL;
+	m_fsFileDataAllocated   = 0;
 	m_fsFileDataLoaded      = 0;
 	m_fsFileDataPos         = 0;
+	m_fsFileDataMapped      = false;
+
+	m_keyframes.Add(NULL); // keyframe #0 is the rewound screen
+
+	if( !MapFile() )
+	{
+		m_fsFileData            = (unsigned char*)malloc(SJ_CDG_REALLOC_EVERY);
+		m_fsFileDataAllocated   = SJ_CDG_REALLOC_EVERY;
+	}
 }
 
 
 SjCdgReader::~SjCdgReader()
 {
-	free(m_fsFileData);
+	int i, iCount = m_keyframes.GetCount();
+	for( i = 0; i < iCount; i++ )
+		delete (SjCdgKeyframe*)m_keyframes[i];
+
+	if( m_fsFileDataMapped )
+		UnmapFile();
+	else
+		free(m_fsFileData);
+
 	delete m_fsFile;
 }
 
@@ -65,89 +89,179 @@ long SjCdgReader::Ms2Bytes(long ms)
 }
 
 
-bool SjCdgReader::SetPosition(long ms)
+bool SjCdgReader::MapFile()
 {
-	if( m_eokMs != 0 && ms > m_eokMs )
+	// map local files into memory, this way we neither have to read nor to
+	// allocate anything while seeking.  Files eg. inside ZIP archives are read
+	// piecewise by LoadData().
+	wxString location = m_fsFile->GetLocation();
+	if( location.Find(wxT('#')) != wxNOT_FOUND )
 		return false;
 
-	long newFilePos = Ms2Bytes(ms);
+	wxString path = wxFileSystem::URLToFileName(location).GetFullPath();
+	if( !::wxFileExists(path) )
+		return false;
 
-	if( newFilePos > m_fsFileDataPos )
-	{
-		// read all data up to the new position
-		if( newFilePos > m_fsFileDataLoaded && !m_eof )
-		{
-			wxInputStream* stream = m_fsFile->GetStream();
-			size_t fileBytes = stream->GetSize(); // may be 0 for unknown!
+	wxFile file(path);
+	if( !file.IsOpened() )
+		return false;
 
-			long tenSecondsBytes = Ms2Bytes(10000);
-			long bytesToRead = (newFilePos - m_fsFileDataLoaded) + tenSecondsBytes;
-			if( fileBytes > 0 )
-			{
-				// do not leave a little part alone at the end of the file
-				// (otherwise we cannot determinate the end)
-				long bytesStillLeft = (fileBytes-m_fsFileDataLoaded)-bytesToRead;
-				if( bytesStillLeft < tenSecondsBytes )
-				{
-					bytesToRead += bytesStillLeft + tenSecondsBytes/*force EOF*/;
-				}
-			}
+	wxFileOffset fileBytes = file.Length();
+	fileBytes -= fileBytes % sizeof(SjCdgSubcode);
+	if( fileBytes <= 0 || fileBytes > 0x7FFFFFFFL )
+		return false;
 
+	void* data;
+	#ifdef __WXMSW__
+		HANDLE mapping = ::CreateFileMapping((HANDLE)_get_osfhandle(file.fd()), NULL, PAGE_READONLY, 0, 0, NULL);
+		if( mapping == NULL )
+			return false;
+		data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, (SIZE_T)fileBytes);
+		::CloseHandle(mapping); // the view holds a reference to the mapping
+		if( data == NULL )
+			return false;
+	#else
+		data = mmap(NULL, (size_t)fileBytes, PROT_READ, MAP_PRIVATE, file.fd(), 0);
+		if( data == MAP_FAILED )
+			return false;
+	#endif
+
+	// the file handle may be closed now, the mapping stays valid
+	m_fsFileData            = (unsigned char*)data;
+	m_fsFileDataAllocated   = (long)fileBytes;
+	m_fsFileDataLoaded      = (long)fileBytes;
+	m_fsFileDataMapped      = true;
+	m_eof                   = true;
+	CalcEok(0);
+	return true;
+}
 
-			long freeBytes = m_fsFileDataAllocated-m_fsFileDataLoaded;
-			if( bytesToRead > freeBytes )
-			{
-				long bytesToAllocate = bytesToRead + SJ_CDG_REALLOC_EVERY;
 
-				m_fsFileData = (unsigned char*)realloc(m_fsFileData, m_fsFileDataAllocated+bytesToAllocate);
+void SjCdgReader::UnmapFile()
+{
+	#ifdef __WXMSW__
+		::UnmapViewOfFile(m_fsFileData);
+	#else
+		munmap(m_fsFileData, (size_t)m_fsFileDataAllocated);
+	#endif
+	m_fsFileData = NULL;
+	m_fsFileDataMapped = false;
+}
 
-				m_fsFileDataAllocated += bytesToAllocate;
-			}
 
-			stream->Read(m_fsFileData+m_fsFileDataLoaded, bytesToRead);
+void SjCdgReader::CalcEok(long startPos)
+{
+	// calculate the end of the data by searching the last data subcode
+	long testDataPos = m_fsFileDataLoaded - (m_fsFileDataLoaded % sizeof(SjCdgSubcode)) - sizeof(SjCdgSubcode);
+	long lastDataPos = startPos;
+	while( testDataPos >= startPos )
+	{
+		if( SjCdgRaw::IsDataSubcode((SjCdgSubcode*) (m_fsFileData+testDataPos)) )
+		{
+			lastDataPos = testDataPos;
+			break;
+		}
+		testDataPos -= sizeof(SjCdgSubcode);
+	}
 
-			long bytesReallyRead = stream->LastRead();
+	m_eokMs = (long) (((float)lastDataPos) / BYTES_PER_MS) + 800;/*a little time for the last data*/;
+}
 
-			m_fsFileDataLoaded += bytesReallyRead;
 
-			if( bytesReallyRead < bytesToRead || stream->Eof() )
-			{
-				m_eof = true;
+void SjCdgReader::LoadData(long newFilePos)
+{
+	// read all data up to the new position
+	wxInputStream* stream = m_fsFile->GetStream();
+	size_t fileBytes = stream->GetSize(); // may be 0 for unknown!
 
-				// now calculate the read end of the data
-				long testDataPos = m_fsFileDataPos;
-				long endTestDataPos = m_fsFileDataLoaded;
-				long lastDataPos = testDataPos;
-				while( testDataPos < endTestDataPos )
-				{
-					if( SjCdgRaw::IsDataSubcode((SjCdgSubcode*) (m_fsFileData+testDataPos)) )
-						lastDataPos = testDataPos;
-					testDataPos += sizeof(SjCdgSubcode);
-				}
-#ifdef __WXDEBUG__
-				SjCdgRaw::IsDataSubcode((SjCdgSubcode*) (m_fsFileData+lastDataPos));
-#endif
-				m_eokMs = (long) (((float)lastDataPos) / BYTES_PER_MS) + 800;/*a little time for the last data*/;
-			}
+	long tenSecondsBytes = Ms2Bytes(10000);
+	long bytesToRead = (newFilePos - m_fsFileDataLoaded) + tenSecondsBytes;
+	if( fileBytes > 0 )
+	{
+		// do not leave a little part alone at the end of the file
+		// (otherwise we cannot determinate the end)
+		long bytesStillLeft = (fileBytes-m_fsFileDataLoaded)-bytesToRead;
+		if( bytesStillLeft < tenSecondsBytes )
+		{
+			bytesToRead += bytesStillLeft + tenSecondsBytes/*force EOF*/;
 		}
+	}
 
-		if( newFilePos > m_fsFileDataLoaded )
+	long freeBytes = m_fsFileDataAllocated-m_fsFileDataLoaded;
+	if( bytesToRead > freeBytes )
+	{
+		// if the file size is known, allocate the whole file at once
+		// instead of growing the buffer again and again
+		long bytesToAllocate = bytesToRead + SJ_CDG_REALLOC_EVERY;
+		if( fileBytes > 0 && (long)fileBytes + tenSecondsBytes > m_fsFileDataAllocated + bytesToAllocate )
 		{
-			newFilePos = m_fsFileDataLoaded;
+			bytesToAllocate = ((long)fileBytes + tenSecondsBytes) - m_fsFileDataAllocated;
 		}
+
+		m_fsFileData = (unsigned char*)realloc(m_fsFileData, m_fsFileDataAllocated+bytesToAllocate);
+
+		m_fsFileDataAllocated += bytesToAllocate;
 	}
-	else if( newFilePos < m_fsFileDataPos )
+
+	stream->Read(m_fsFileData+m_fsFileDataLoaded, bytesToRead);
+
+	long bytesReallyRead = stream->LastRead();
+
+	m_fsFileDataLoaded += bytesReallyRead;
+
+	if( bytesReallyRead < bytesToRead || stream->Eof() )
 	{
-		// execute the file from the beginning
-		m_screen.Rewind();
-		m_fsFileDataPos = 0;
+		m_eof = true;
+		CalcEok(m_fsFileDataPos);
 	}
-	else
+}
+
+
+bool SjCdgReader::SetPosition(long ms)
+{
+	if( m_eokMs != 0 && ms > m_eokMs )
+		return false;
+
+	long newFilePos = Ms2Bytes(ms);
+	if( newFilePos == m_fsFileDataPos )
 	{
 		// same position, nothing to do
 		return true;
 	}
 
+	if( newFilePos > m_fsFileDataLoaded && !m_eof )
+	{
+		LoadData(newFilePos);
+	}
+
+	if( newFilePos > m_fsFileDataLoaded )
+	{
+		newFilePos = m_fsFileDataLoaded - (m_fsFileDataLoaded % sizeof(SjCdgSubcode));
+	}
+
+	// start from the nearest keyframe before the new position if we seek
+	// backwards or if the keyframe is behind the current position.
+	// keyframes are created in order, so all keyframes up to the last one exist.
+	long keyframeIndex = newFilePos / SJ_CDG_KEYFRAME_BYTES;
+	if( keyframeIndex >= (long)m_keyframes.GetCount() )
+	{
+		keyframeIndex = m_keyframes.GetCount() - 1;
+	}
+
+	long keyframePos = keyframeIndex * SJ_CDG_KEYFRAME_BYTES;
+	if( newFilePos < m_fsFileDataPos || keyframePos > m_fsFileDataPos )
+	{
+		if( keyframeIndex > 0 )
+		{
+			m_screen.RestoreKeyframe((SjCdgKeyframe*)m_keyframes[keyframeIndex]);
+		}
+		else
+		{
+			m_screen.Rewind();
+		}
+		m_fsFileDataPos = keyframePos;
+	}
+
 	wxASSERT( (m_fsFileDataPos % sizeof(SjCdgSubcode)) == 0 );
 	wxASSERT( (newFilePos % sizeof(SjCdgSubcode)) == 0 );
 
@@ -156,12 +270,90 @@ bool SjCdgReader::SetPosition(long ms)
 		m_screen.AddSubcode((SjCdgSubcode*) (m_fsFileData+m_fsFileDataPos));
 
 		m_fsFileDataPos += sizeof(SjCdgSubcode);
+
+		// create a keyframe if we've just reached a keyframe position for the first time
+		if( (m_fsFileDataPos % SJ_CDG_KEYFRAME_BYTES) == 0
+		 && (m_fsFileDataPos / SJ_CDG_KEYFRAME_BYTES) == (long)m_keyframes.GetCount() )
+		{
+			SjCdgKeyframe* keyframe = new SjCdgKeyframe;
+			m_screen.SaveKeyframe(keyframe);
+			m_keyframes.Add(keyframe);
+		}
 	}
 
 	return true;
 }
 
 
+void SjCdgReader::RenderBackImage(SjVisBg& bg, const wxRect& destRect)
+{
+	// render the given rectangle of m_backImage from the CDG screen; as the
+	// source position is calculated from the whole image, any rectangle can be
+	// rendered without seams to the neighbours
+	long                        scaledW = m_backRect.width, scaledH = m_backRect.height;
+	unsigned char*              destData = m_backImage.GetData();
+	const unsigned char*        palette = m_screen.m_colourTable;
+	const unsigned char*        colour;
+	static const unsigned char  blackPixel[3] = { 0, 0, 0 };
+
+	long transpColourIndex = m_screen.m_presetColourIndex;
+	if( transpColourIndex >= 0 )
+	{
+		colour = &palette[transpColourIndex*3];
+		if( colour[0]+colour[1]+colour[2] >= 255 )
+			transpColourIndex = -1;
+	}
+
+	const unsigned char* currSrcLinePtr, *currBgLinePtr, *prevSrcLinePtr;
+	unsigned char*       currDestLinePtr;
+	long destX, destY, srcY, srcX, colourIndex;
+	bool hasData = m_screen.m_hasData;
+	for( destY = destRect.y; destY < destRect.y+destRect.height; destY++ )
+	{
+		/* calculate current source y position (rounded integer position) */
+		srcY = CDG_IMAGE_H * destY / scaledH;
+
+		/* buffer current input scanline (saves us some multiplications) */
+		currSrcLinePtr = &m_screen.m_screen[ (srcY+12/*12=border top*/)*CDG_SCREEN_W + 6/*6=border left*/ ];
+		prevSrcLinePtr = currSrcLinePtr-CDG_SCREEN_W;
+
+		/* buffer current output scanline (saves us some multiplications) */
+		currDestLinePtr = &destData[ (scaledW * destY + destRect.x) * 3 ];
+
+		currBgLinePtr = bg.GetBackgroundBits(m_backRect.x+destRect.x, m_backRect.y+destY, destRect.width);
+
+		for( destX = destRect.x; destX < destRect.x+destRect.width; destX++ )
+		{
+			/* calculate current source x position (rounded integer position) */
+			srcX = CDG_IMAGE_W * destX / scaledW;
+
+			colourIndex = currSrcLinePtr [ srcX ];
+			if( !hasData )
+			{
+				colour = &currBgLinePtr[ (destX-destRect.x) * 3 ];
+			}
+			else if( colourIndex == transpColourIndex )
+			{
+				colour = &currBgLinePtr[ (destX-destRect.x) * 3 ];
+				if( srcX > 0
+				        && prevSrcLinePtr[srcX-1] != transpColourIndex )
+				{
+					colour = blackPixel;
+				}
+			}
+			else
+			{
+				colour = &palette[ colourIndex * 3 ];
+			}
+
+			*currDestLinePtr++ = *colour++;
+			*currDestLinePtr++ = *colour++;
+			*currDestLinePtr++ = *colour;
+		}
+	}
+}
+
+
 void SjCdgReader::Render(wxDC& dc, SjVisBg& bg, bool pleaseUpdateAll)
 {
 	wxSize      dcSize = dc.GetSize(); if( dcSize.y <= 0 ) return;
@@ -183,102 +375,75 @@ void SjCdgReader::Render(wxDC& dc, SjVisBg& bg, bool pleaseUpdateAll)
 		scaledH = long( (float)scaledW / orgAspect );
 	}
 
-	// make sure, the width and the height are a multiple of PARTS_PER_ROW/PARTS_PER_COL
-	long scaledPartW = scaledW / PARTS_PER_ROW;
-	long scaledPartH = scaledH / PARTS_PER_COL;
-	if( scaledPartW <= 0 || scaledPartH <= 0 ) return;
-	scaledW = scaledPartW * PARTS_PER_ROW;
-	scaledH = scaledPartH * PARTS_PER_COL;
+	if( scaledW <= 0 || scaledH <= 0 ) return;
 
 	// find center
 	scaledX = (dcSize.x - scaledW) / 2;
 	scaledY = (dcSize.y - scaledH) / 2;
 
-	// create an image for the parts
-	wxImage partImage((int)scaledPartW, (int)scaledPartH, false);
-	unsigned char* destData = partImage.GetData();
-
-	// go through all parts
-	const unsigned char*        palette = m_screen.m_colourTable;
-	const unsigned char*        colour;
-	static const unsigned char  blackPixel[3] = { 0, 0, 0 };
-
-	long transpColourIndex = m_screen.m_presetColourIndex;
-	if( transpColourIndex >= 0 )
+	// (re-)create the back image if the size has changed
+	wxRect backRect(scaledX, scaledY, scaledW, scaledH);
+	if( backRect != m_backRect || !m_backImage.IsOk() )
 	{
-		colour = &palette[transpColourIndex*3];
-		if( colour[0]+colour[1]+colour[2] >= 255 )
-			transpColourIndex = -1;
+		m_backImage.Create((int)scaledW, (int)scaledH, false);
+		m_backRect = backRect;
+		pleaseUpdateAll = true;
 	}
 
-	const unsigned char* currSrcLinePtr, *currBgLinePtr, *prevSrcLinePtr;
-	unsigned char*       currDestLinePtr;
-	long partX, partY, partIndex = 0, destX, destY, srcY, srcX, colourIndex;
-	bool hasData = m_screen.m_hasData;
-	for( partY = 0; partY < PARTS_PER_COL; partY++ )
+	if( pleaseUpdateAll || m_screen.m_dirtyAll )
+	{
+		// redraw everything, needed for palette changes, scrolling etc.
+		RenderBackImage(bg, wxRect(0, 0, scaledW, scaledH));
+
+		wxBitmap scaledBitmap(m_backImage);
+		dc.DrawBitmap(scaledBitmap, scaledX, scaledY, true);
+	}
+	else
 	{
-		for( partX = 0; partX < PARTS_PER_ROW; partX++ )
+		// redraw the dirty tiles only; adjacent dirty tiles in a row are
+		// combined to a single rectangle
+		int tileX, tileY, firstTileX;
+		long srcX0, srcY0, srcX1, srcY1;
+		for( tileY = 0; tileY < CDG_TILES_H; tileY++ )
 		{
-			if( m_screen.m_updatedParts & (1<<partIndex)
-			        || pleaseUpdateAll )
+			for( tileX = 0; tileX < CDG_TILES_W; )
 			{
-				// create the part
-				for( destY = 0; destY < scaledPartH; destY++ )
+				if( !m_screen.IsTileDirty(tileX, tileY) )
 				{
-					/* calculate current source y position (rounded integer position) */
-					srcY = PART_HEIGHT * destY / scaledPartH;
-
-					/* buffer current input scanline (saves us some multiplications) */
-					currSrcLinePtr = &m_screen.m_screen[
-					                     (partY*PART_HEIGHT+srcY+12/*12=border top*/)*CDG_SCREEN_W
-					                     +   partX*PART_WIDTH+6/*6=border left*/ ];
-
-					prevSrcLinePtr = (currSrcLinePtr > m_screen.m_screen)? currSrcLinePtr-CDG_SCREEN_W : NULL;
-
-					/* buffer current output scanline (saves us some multiplications) */
-					currDestLinePtr = &destData[ scaledPartW * destY * 3 ];
-
-					currBgLinePtr = bg.GetBackgroundBits(
-					                    scaledX+partX*scaledPartW, scaledY+partY*scaledPartH+destY, scaledPartW);
-
-					for( destX = 0; destX < scaledPartW; destX++ )
-					{
-						/* calculate current source x position (rounded integer position) */
-						srcX = PART_WIDTH * destX / scaledPartW;
-
-						colourIndex = currSrcLinePtr [ srcX ];
-						if( !hasData )
-						{
-							colour = &currBgLinePtr[ destX * 3 ];
-						}
-						else if( colourIndex == transpColourIndex )
-						{
-							colour = &currBgLinePtr[ destX * 3 ];
-							if( prevSrcLinePtr && srcX > 0
-							        && prevSrcLinePtr[srcX-1] != transpColourIndex )
-							{
-								colour = blackPixel;
-							}
-						}
-						else
-						{
-							colour = &palette[ colourIndex * 3 ];
-						}
-
-						*currDestLinePtr++ = *colour++;
-						*currDestLinePtr++ = *colour++;
-						*currDestLinePtr++ = *colour;
-					}
+					tileX++;
+					continue;
 				}
 
-				wxBitmap scaledBitmap(partImage);
-				dc.DrawBitmap(scaledBitmap, scaledX+partX*scaledPartW, scaledY+partY*scaledPartH, true);
+				firstTileX = tileX;
+				while( tileX < CDG_TILES_W && m_screen.IsTileDirty(tileX, tileY) )
+					tileX++;
+
+				// get the source rectangle without the border; add one pixel to
+				// the right and to the bottom as the shadow depends on the pixel
+				// left above
+				srcX0 = wxMax(firstTileX*6 - 6, 0);
+				srcY0 = wxMax(tileY*12 - 12, 0);
+				srcX1 = wxMin(tileX*6 - 6 + 1, CDG_IMAGE_W);
+				srcY1 = wxMin(tileY*12 + 12 - 12 + 1, CDG_IMAGE_H);
+
+				// convert to the destination rectangle, the destination pixels
+				// are the ones whose source pixel lies in the source rectangle
+				wxRect destRect;
+				destRect.x      = (srcX0*scaledW + CDG_IMAGE_W-1) / CDG_IMAGE_W;
+				destRect.y      = (srcY0*scaledH + CDG_IMAGE_H-1) / CDG_IMAGE_H;
+				destRect.width  = (srcX1*scaledW + CDG_IMAGE_W-1) / CDG_IMAGE_W - destRect.x;
+				destRect.height = (srcY1*scaledH + CDG_IMAGE_H-1) / CDG_IMAGE_H - destRect.y;
+				if( destRect.width <= 0 || destRect.height <= 0 )
+					continue;
+
+				RenderBackImage(bg, destRect);
+
+				wxBitmap scaledBitmap(m_backImage.GetSubImage(destRect));
+				dc.DrawBitmap(scaledBitmap, scaledX+destRect.x, scaledY+destRect.y, true);
 			}
-
-			partIndex++;
 		}
 	}
 
-	m_screen.m_updatedParts = 0;
+	m_screen.ClearDirty();
 }
 
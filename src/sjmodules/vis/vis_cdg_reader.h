@@ -53,9 +53,25 @@ private:
 	long            m_fsFileDataAllocated;
 	long            m_fsFileDataLoaded;
 	unsigned char*  m_fsFileData;
+	bool            m_fsFileDataMapped; // if set, m_fsFileData is a read-only mapping of the whole file
 
 	long            m_fsFileDataPos;
 
+	// keyframe #n is the screen state at the file position n*SJ_CDG_KEYFRAME_BYTES;
+	// keyframe #0 is always NULL and stands for a rewound screen
+	#define         SJ_CDG_KEYFRAME_BYTES (5*75*96) // 5 seconds, see Ms2Bytes()
+	wxArrayPtrVoid  m_keyframes;
+
+	// the scaled screen as drawn the last time; only dirty tiles are re-rendered
+	// into this image, m_backRect is its position in the DC
+	wxImage         m_backImage;
+	wxRect          m_backRect;
+	void            RenderBackImage     (SjVisBg&, const wxRect& destRect);
+
+	bool            MapFile             ();
+	void            UnmapFile           ();
+	void            LoadData            (long newFilePos);
+	void            CalcEok             (long startPos);
 	static long     Ms2Bytes            (long ms);
 };
 
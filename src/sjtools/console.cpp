@@ -104,7 +104,7 @@ SjLogListCtrl::SjLogListCtrl(SjLogGui* logGui, wxWindow* parent, wxWindowID id,
 	InsertColumn(1, _("Scope"));
 	InsertColumn(2, _("Time"));
 
-	SetItemCount(logGui->m_aPacked.GetCount());
+	SetItemCount(logGui->GetEntryCount());
 
 	ScrollDownTo(aIndex);
 }
@@ -112,17 +112,18 @@ SjLogListCtrl::SjLogListCtrl(SjLogGui* logGui, wxWindow* parent, wxWindowID id,
 
 wxString SjLogListCtrl::OnGetItemText(long index, long column) const
 {
-	unsigned long severity, time;
-	wxString      msg, scope;
-	SjLogGui::ExplodeMessage(m_logGui->m_aPacked[index], severity, time, msg, scope);
+	if( index < 0 || index >= m_logGui->GetEntryCount() ) {
+		return wxT("");
+	}
 
+	const SjLogEntry& entry = m_logGui->GetEntry(index);
 	if( column == 0 )
 	{
-		return SjLogGui::SingleLine(msg);
+		return SjLogGui::SingleLine(entry.m_msg);
 	}
 	else if( column == 1 )
 	{
-		return scope;
+		return entry.m_scope;
 	}
 	else
 	{
@@ -132,17 +133,18 @@ wxString SjLogListCtrl::OnGetItemText(long index, long column) const
 			// default format
 			fmt = _T("%c");
 		}
-		return TimeStamp(fmt, time);
+		return TimeStamp(fmt, entry.m_time);
 	}
 }
 
 
 int SjLogListCtrl::OnGetItemImage(long index) const
 {
-	unsigned long severity, time;
-	wxString      msg, scope;
-	SjLogGui::ExplodeMessage(m_logGui->m_aPacked[index], severity, time, msg, scope);
-	return GetSeverityImage(severity);
+	if( index < 0 || index >= m_logGui->GetEntryCount() ) {
+		return 2;
+	}
+
+	return GetSeverityImage(m_logGui->GetEntry(index).m_severity);
 }
 
 
@@ -171,7 +173,7 @@ wxString SjLogListCtrl::GetSeverityChar(long severity)
 
 void SjLogListCtrl::MessagesChanged(long firstNewIndex)
 {
-	long newCount = m_logGui->m_aPacked.GetCount();
+	long newCount = m_logGui->GetEntryCount();
 	SetItemCount(newCount);
 	SizeChanged();
 	ScrollDownTo(newCount-1);
@@ -181,7 +183,7 @@ void SjLogListCtrl::MessagesChanged(long firstNewIndex)
 
 void SjLogListCtrl::ScrollDownTo(long aIndex)
 {
-	long count = m_logGui->m_aPacked.GetCount();
+	long count = m_logGui->GetEntryCount();
 	if( count > 0 )
 	{
 		if( aIndex < 0 || aIndex >= count ) {
@@ -330,19 +332,17 @@ SjLogDialog::SjLogDialog(SjLogGui* logGui,
 
 	// text
 	wxString msg;
-	if( aIndex < 0 || aIndex >= (long)logGui->m_aPacked.GetCount() )
+	if( aIndex < 0 || aIndex >= logGui->GetEntryCount() )
 	{
 		msg = wxString::Format(
 		  // TRANSLATORS: %i will be replaced by a number
-		  wxPLURAL("%i message", "%i messages", m_logGui->m_aPacked.GetCount()),
-		  (int)m_logGui->m_aPacked.GetCount());
+		  wxPLURAL("%i message", "%i messages", logGui->GetEntryCount()),
+		  (int)logGui->GetEntryCount());
 		m_showingDetails = true;
 	}
 	else
 	{
-		unsigned long severity, time;
-		wxString scope;
-		SjLogGui::ExplodeMessage(logGui->m_aPacked[aIndex], severity, time, msg, scope);
+		msg = logGui->GetEntry(aIndex).m_msg;
 		m_showingDetails = false;
 	}
 
@@ -406,8 +406,8 @@ void SjLogDialog::MessagesChanged(long firstNewIndex)
 
 	m_msg->SetLabel(wxString::Format(
 	  // TRANSLATORS: %i will be replaced by a number
-	  wxPLURAL("%i message", "%i messages", m_logGui->m_aPacked.GetCount()),
-	  (int)m_logGui->m_aPacked.GetCount()));
+	  wxPLURAL("%i message", "%i messages", m_logGui->GetEntryCount()),
+	  (int)m_logGui->GetEntryCount()));
 	Layout();
 
 	m_listCtrl->MessagesChanged(firstNewIndex);
@@ -525,14 +525,14 @@ void SjLogDialog::OnEval(wxCommandEvent& event)
 
 		// prepare execute
 		m_see->SetExecutionScope(_("Console"));
-		size_t oldCount1 = m_logGui->m_aMessages.GetCount();
-		size_t oldCount2 = m_logGui->m_aPacked.GetCount();
+		size_t        oldCount1 = m_logGui->m_aMessages.GetCount();
+		unsigned long oldCount2 = m_logGui->GetEntriesAdded();
 
 		// execute
 		if( m_see->Execute(script) )
 		{
 			// print the result (if not empty or if nothng has been logged by Execute())
-			bool     sthLogged = (oldCount1!=m_logGui->m_aMessages.GetCount() || oldCount2!=m_logGui->m_aPacked.GetCount());
+			bool     sthLogged = (oldCount1!=m_logGui->m_aMessages.GetCount() || oldCount2!=m_logGui->GetEntriesAdded());
 			wxString result = m_see->GetResultString();
 			if( !sthLogged || !result.IsEmpty() )
 			{
@@ -553,11 +553,11 @@ void SjLogDialog::OnEval(wxCommandEvent& event)
 
 void SjLogDialog::OnClear(wxCommandEvent& event)
 {
-	if( !m_logGui->m_aPacked.IsEmpty() )
+	if( m_logGui->GetEntryCount() > 0 )
 	{
 		if( SjMessageBox(_("Clear all messages?"), SJ_PROGRAM_NAME, wxICON_QUESTION|wxYES_NO, this) == wxYES )
 		{
-			m_logGui->m_aPacked.Clear();
+			m_logGui->ClearEntries();
 			MessagesChanged(-1);
 		}
 	}
@@ -632,21 +632,20 @@ void SjLogDialog::OnSave(wxCommandEvent& event)
 
 	bool ok = rc != 0;
 
-	size_t count = m_logGui->m_aPacked.GetCount();
-	for ( size_t n = 0; ok && (n < count); n++ )
+	long count = m_logGui->GetEntryCount();
+	for ( long n = 0; ok && (n < count); n++ )
 	{
-		unsigned long severity, time;
-		wxString      msg, scope;
-		SjLogGui::ExplodeMessage(m_logGui->m_aPacked[n], severity, time, msg, scope);
-		if( !scope.IsEmpty() )
-			scope = wxT(" [") + scope + wxT("]");
-		msg = SjLogGui::SingleLine(msg);
+		const SjLogEntry& entry = m_logGui->GetEntry(n);
+		wxString scope;
+		if( !entry.m_scope.IsEmpty() )
+			scope = wxT(" [") + entry.m_scope + wxT("]");
+		wxString msg = SjLogGui::SingleLine(entry.m_msg);
 
 		wxString line;
-		line << TimeStamp(wxT("%Y-%m-%d %H:%M:%S"), (time_t)time)
-		     << wxString::Format(".%03i", (int)time%1000)
+		line << TimeStamp(wxT("%Y-%m-%d %H:%M:%S"), (time_t)entry.m_time)
+		     << wxString::Format(".%03i", (int)entry.m_time%1000)
 		     << wxT(": ")
-		     << SjLogListCtrl::GetSeverityChar(severity)
+		     << SjLogListCtrl::GetSeverityChar(entry.m_severity)
 		     << wxT(": ")
 		     << msg
 		     << scope
@@ -691,6 +690,18 @@ void SjLogDialog::DoClose()
 SjLogGui* SjLogGui::s_this = NULL;
 
 
+// a record logged by another thread, forwarded to wxLogGui on the next Flush()
+class SjLogRecord
+{
+public:
+	                SjLogRecord         (wxLogLevel level, const wxString& msg, const wxLogRecordInfo& info)
+		: m_level(level), m_msg(msg), m_info(info) { }
+	wxLogLevel      m_level;
+	wxString        m_msg;
+	wxLogRecordInfo m_info;
+};
+
+
 SjLogGui::SjLogGui()
 	: wxLogGui()
 {
@@ -703,6 +714,11 @@ SjLogGui::SjLogGui()
 	m_catchErrorsInMainThread = 0;
 	m_autoOpen = -1;
 
+	m_entries = new SjLogEntry[SJ_LOG_MAX_ENTRIES];
+	m_entryFirst = 0;
+	m_entryCount = 0;
+	m_entriesAdded = 0;
+
 	// set active logging target to this
 	m_oldTarget = wxLog::SetActiveTarget(this);
 	wxASSERT( wxLog::GetLogLevel() >= wxLOG_Info ); // true for wx 2.x and 3.x (we want wxLogInfo to work, however, we _pop up_ a message dialog only for warnings and errors)
@@ -726,6 +742,14 @@ SjLogGui::~SjLogGui()
 
 	// clear the global logging target
 	s_this = NULL;
+
+	size_t i, iCount = m_threadRecords.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		delete (SjLogRecord*)m_threadRecords[i];
+	}
+
+	delete [] m_entries;
 }
 
 
@@ -812,42 +836,78 @@ void SjLogGui::DoLogRecord(wxLogLevel level, const wxString& msg, const wxLogRec
 		}
 	}
 
-	// forward to GUI logging
+	// forward to GUI logging; as the image thread, the search thread and the HTTP thread set us as
+	// their log target, we may be called from any thread, but wxLogGui is not thread-safe.
+	// So records from other threads are queued and forwarded by Flush() on the main thread.
+	if( !wxThread::IsMain() )
+	{
+		wxCriticalSectionLocker locker(m_critical);
+		m_threadRecords.Add(new SjLogRecord(level, msg, info));
+		wxWakeUpIdle();
+		return;
+	}
+
 	wxLogGui::DoLogRecord(level, msg, info);
 }
 
 
-void SjLogGui::ExplodeMessage(const wxString& all___, unsigned long& severity, unsigned long& time, wxString& msg, wxString& scope)
+void SjLogGui::FlushThreadRecords()
 {
-	wxString temp;
+	wxASSERT( wxThread::IsMain() );
+
+	wxArrayPtrVoid records;
+	{
+		wxCriticalSectionLocker locker(m_critical);
+		records = m_threadRecords;
+		m_threadRecords.Clear();
+	}
 
-	// get and strip severity
-	temp = all___.BeforeFirst(wxT('|'));
-	temp.ToULong(&severity);
-	msg = all___.AfterFirst(wxT('|'));
+	size_t i, iCount = records.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		SjLogRecord* record = (SjLogRecord*)records[i];
+		wxLogGui::DoLogRecord(record->m_level, record->m_msg, record->m_info);
+		delete record;
+	}
+}
 
-	// get and strip time
-	temp = msg.BeforeFirst(wxT('|'));
-	temp.ToULong(&time);
-	msg = msg.AfterFirst(wxT('|'));
 
-	// now "msg" is message and optional scope enclosured by "[]"
-	scope.Empty();
-	int p = msg.Find(wxT('['), true/*from end*/);
-	if( p!=-1 )
+void SjLogGui::AddEntry(wxLogLevel level, time_t time, const wxString& all)
+{
+	// add an entry to the ring buffer, if it is full, the oldest entry is overwritten
+	wxASSERT( wxThread::IsMain() );
+
+	SjLogEntry* entry;
+	if( m_entryCount < SJ_LOG_MAX_ENTRIES )
 	{
-		scope = msg.Mid(p+1);
-		if( scope.Len()>=1 && scope.Last()==wxT(']') )
-		{
-			scope = scope.Left(scope.Len()-1);
-			msg = msg.Left(p).Trim();
-		}
+		entry = &m_entries[(m_entryFirst+m_entryCount)%SJ_LOG_MAX_ENTRIES];
+		m_entryCount++;
+	}
+	else
+	{
+		entry = &m_entries[m_entryFirst];
+		m_entryFirst = (m_entryFirst+1)%SJ_LOG_MAX_ENTRIES;
+	}
+	m_entriesAdded++;
+
+	entry->m_severity = (unsigned long)level;
+	entry->m_time     = (unsigned long)time;
+
+	// the message is followed by an optional scope enclosured by "[]"
+	entry->m_msg = all;
+	entry->m_scope.Empty();
+	int p = all.Find(wxT('['), true/*from end*/);
+	if( p!=-1 && all.Last()==wxT(']') )
+	{
+		entry->m_scope = all.Mid(p+1, all.Len()-p-2);
+		entry->m_msg = all.Left(p).Trim();
 	}
 
 	// some finalizing translations (some stuff is logged before the translation system is available)
-	if( msg.StartsWith(wxT("Loading "), &temp) )
+	wxString temp;
+	if( entry->m_msg.StartsWith(wxT("Loading "), &temp) )
 	{
-		msg.Printf(_("Loading %s"), temp.c_str());
+		entry->m_msg.Printf(_("Loading %s"), temp.c_str());
 	}
 }
 
@@ -870,33 +930,38 @@ void SjLogGui::Flush()
 {
 	wxASSERT( wxThread::IsMain() );
 
+	FlushThreadRecords();
+
 	if( m_bHasMessages )
 	{
-		// copy all messages to our "all time buffer"
+		// copy all messages to our "all time buffer"; this is the only place, the
+		// ring buffer is modified, so it is touched from the main thread only
 		m_bHasMessages = false;
 
-		#define MAX_MESSAGES 1000
-		while( m_aPacked.GetCount() > MAX_MESSAGES*2 ) {
-			m_aPacked.RemoveAt(0, MAX_MESSAGES);
-		}
-
-		long firstNewIndex = m_aPacked.GetCount();
+		unsigned long firstNewSerial = m_entriesAdded;
 		long i, iCount = m_aMessages.GetCount();
 		wxLogLevel level;
 		long errorIndex = -1, warningIndex = -1, messageIndex = -1;
 		for( i = 0; i < iCount; i++ )
 		{
 			level = m_aSeverity[i];
-			if( level == wxLOG_Error ) errorIndex = m_aPacked.GetCount();
-			if( level == wxLOG_Warning ) warningIndex = m_aPacked.GetCount();
-			if( level == wxLOG_Message ) messageIndex = m_aPacked.GetCount();
+			if( level == wxLOG_Error ) errorIndex = (long)(m_entriesAdded-firstNewSerial);
+			if( level == wxLOG_Warning ) warningIndex = (long)(m_entriesAdded-firstNewSerial);
+			if( level == wxLOG_Message ) messageIndex = (long)(m_entriesAdded-firstNewSerial);
 
-			m_aPacked.Add(wxString::Format(wxT("%lu|%lu|%s"),
-			                               (unsigned long)level, (unsigned long)m_aTimes[i], m_aMessages[i].c_str()));
+			AddEntry(level, m_aTimes[i], m_aMessages[i]);
 		}
 
 		Clear();
 
+		// convert the positions in this batch to indices in the ring buffer; if the batch was larger
+		// than the ring buffer, the first entries may be dropped
+		long firstNewIndex = m_entryCount - (long)(m_entriesAdded-firstNewSerial);
+		if( errorIndex!=-1 )   { errorIndex   = wxMax(firstNewIndex+errorIndex, 0L);   }
+		if( warningIndex!=-1 ) { warningIndex = wxMax(firstNewIndex+warningIndex, 0L); }
+		if( messageIndex!=-1 ) { messageIndex = wxMax(firstNewIndex+messageIndex, 0L); }
+		if( firstNewIndex < 0 ) { firstNewIndex = 0; }
+
 		// any errors or warnings? (for "info/verbose" we do not open the dialog
 		// - even not for messages in wx 3.x as they are equal to info/verbose and we use them for logging)
 		// (wxLogInfo and wxLogMessage both results in a message, however, wxLogInfo is not executed if verbose is not set)
@@ -921,7 +986,7 @@ void SjLogGui::Flush()
 		     if ( errorIndex!=-1 )      { style = wxICON_STOP;        aIndex = errorIndex;              }
 		else if ( warningIndex!=-1 )    { style = wxICON_EXCLAMATION; aIndex = warningIndex;            }
 		else if ( messageIndex!=-1 )    { style = wxICON_INFORMATION; aIndex = messageIndex;            }
-		else                            { style = wxICON_INFORMATION; aIndex = m_aPacked.GetCount()-1;  }
+		else                            { style = wxICON_INFORMATION; aIndex = m_entryCount-1;          }
 
 		// show the dialog ...
 		if( !autoOpenNow )
@@ -929,12 +994,9 @@ void SjLogGui::Flush()
 			// show in display
 			if( g_mainFrame && !g_mainFrame->InConstruction() )
 			{
-				if( style == wxICON_STOP )
+				if( style == wxICON_STOP && m_entryCount > 0 )
 				{
-					unsigned long severity, time;
-					wxString      msg, scope;
-					SjLogGui::ExplodeMessage(m_aPacked.Last(), severity, time, msg, scope);
-					g_mainFrame->SetDisplayMsg(msg);
+					g_mainFrame->SetDisplayMsg(GetEntry(m_entryCount-1).m_msg);
 				}
 			}
 		}
@@ -30,6 +30,17 @@
 #define __SJ_CONSOLE_H__
 
 
+class SjLogEntry
+{
+public:
+	// a single message as shown in the console, split up when added
+	unsigned long   m_severity;
+	unsigned long   m_time;
+	wxString        m_msg;
+	wxString        m_scope;
+};
+
+
 class SjLogGui : public wxLogGui
 {
 public:
@@ -39,8 +50,14 @@ public:
 	static void     DiscardAll          () { if(s_this) { s_this->Clear(); } }
 	static void     OpenManually        ();
 
-	// all messages, these may be much more than the "most recent" ones
-	static void     ExplodeMessage      (const wxString&, unsigned long& severity, unsigned long& time, wxString& msg, wxString& scope);
+	// all messages, these may be much more than the "most recent" ones; the oldest
+	// messages are dropped if there are more than SJ_LOG_MAX_ENTRIES.
+	// Index 0 is the oldest message; the functions must be called from the main thread.
+	#define         SJ_LOG_MAX_ENTRIES  2000
+	long            GetEntryCount       () const { return m_entryCount; }
+	const SjLogEntry& GetEntry          (long index) const { wxASSERT( index>=0 && index<m_entryCount ); return m_entries[(m_entryFirst+index)%SJ_LOG_MAX_ENTRIES]; }
+	unsigned long   GetEntriesAdded     () const { return m_entriesAdded; }
+	void            ClearEntries        () { m_entryFirst = 0; m_entryCount = 0; }
 	static wxString SingleLine          (const wxString&);
 
 	// auto open?
@@ -58,7 +75,14 @@ private:
 	// private
 	static SjLogGui* s_this;
 
-	wxArrayString   m_aPacked;
+	SjLogEntry*     m_entries;          // ring buffer of SJ_LOG_MAX_ENTRIES
+	long            m_entryFirst,
+	                m_entryCount;
+	unsigned long   m_entriesAdded;     // never decreased, used to detect new messages
+	void            AddEntry            (wxLogLevel, time_t, const wxString&);
+
+	wxArrayPtrVoid  m_threadRecords;    // records logged by other threads, protected by m_critical
+	void            FlushThreadRecords  ();
 
 	long            m_catchErrors;
 	long            m_catchErrorsInMainThread;
@@ -79,6 +103,7 @@ private:
 	friend class    SjLogDialog;
 	friend class    SjImgThread;  // to access s_this needed for wxLog::SetThreadActiveTarget()
 	friend class    SjHttpThread; //                - " -
+	friend class    SjLibrarySearchThread; //       - " -
 };
 
 
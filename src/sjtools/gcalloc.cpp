@@ -25,6 +25,11 @@
  *
  *******************************************************************************
  *
+ * Memory layout: Blocks up to GC_MAX_CLASS_BYTES are placed in arenas of
+ * blocks with the same size class, the mark and allocation bits are held in
+ * bitmaps beside the arenas.  For any address, the arena and the block is
+ * found in O(1), see GcFindBlock().
+ *
  * Testing scripts:
  * var i = 0; program.setTimeout(function(){print('block'+i++)}, 10, true)
  *
@@ -34,14 +39,33 @@
 #include <sjbase/base.h>
 #include <sjtools/gcalloc.h>
 #if SJ_USE_SCRIPTS
+#ifdef __WXMSW__
+#include <malloc.h>
+#endif
 
 
 #define GcADR uintptr_t
 
 
-struct GcBlock // total size of the structure is 8*4 = 32 - this is a fine size!
+/* Small blocks are allocated from "arenas" of GC_PAGE_BYTES; each arena only
+holds blocks of one size class and is aligned to its size, so the arena of any
+address is found by masking out the lower bits and a lookup in s_gc_arenaHash.
+Larger blocks are malloc()'d separately and are found by their address in
+s_gc_largeHash.  Both lookups are O(1), there is no need to sort or search
+all block addresses during the cleanup. */
+#define GC_PAGE_SHIFT       16
+#define GC_PAGE_BYTES       (1<<GC_PAGE_SHIFT)
+#define GC_MAX_CLASS_BYTES  2048
+#define GC_LARGE            -1
+
+static const uint32_t s_gc_classBytes[] = { 16, 32, 48, 64, 80, 96, 128, 160, 192, 256, 320, 384, 512, 768, 1024, 1536, GC_MAX_CLASS_BYTES };
+#define GC_CLASS_COUNT      ((int)(sizeof(s_gc_classBytes)/sizeof(s_gc_classBytes[0])))
+
+
+struct GcPage;
+struct GcBlock // total size of the structure is 8*4 = 32 (32 bit) or 48 (64 bit), so the data following are aligned to 16 bytes
 {
-	GcBlock*        next;
+	GcPage*         page;
 	uint32_t        size;
 	int32_t         flags;
 
@@ -49,19 +73,321 @@ struct GcBlock // total size of the structure is 8*4 = 32 - this is a fine size!
 	                            // 1   : may have references through other blocks, please check!
 	                            // >=2 : known to have static references, do not free, use as anchor
 
-	int32_t         oneRefValidated; // used only during cleanup
+	int32_t         unused;
 	SJ_GC_PROC      finalizeFn;
 	void*           finalizeUserData1;
 	void*           finalizeUserData2;
 };
 
-static GcBlock*     s_gc_firstBlock     = NULL;
-SjGcSystem          g_gc_system = { 0, 0, 0, 0, 0, 0, 0 };
+
+struct GcPage // an arena or a single large block
+{
+	GcPage*         next;           // list of all pages, used for marking and sweeping
+	GcPage*         prev;
+	GcPage*         nextFree;       // list of arenas with free slots, one list per size class
+	GcPage*         prevFree;
+	bool            inFreeList;
+
+	int             sizeClass;      // GC_LARGE for a single, separately allocated block
+	char*           base;
+	uint32_t        slotBytes;
+	uint32_t        slotCount;
+	uint32_t        slotsUsed;
+	uint32_t        slotsTouched;   // slots at and after this index were never used
+	void*           freeSlots;      // freed slots, linked through their first pointer
+
+	uint32_t*       allocBits;      // the bitmaps are not stored in the blocks, so marking
+	uint32_t*       markBits;       // does not touch the memory of blocks without pointers
+	uint32_t        largeBits[2];   // bitmap storage for GC_LARGE
+};
+
+#define GC_BIT_TEST(b, i)   ((b)[(i)>>5] &   (1U<<((i)&31)))
+#define GC_BIT_SET(b, i)    ((b)[(i)>>5] |=  (1U<<((i)&31)))
+#define GC_BIT_CLEAR(b, i)  ((b)[(i)>>5] &= ~(1U<<((i)&31)))
+#define GC_BIT_WORDS(n)     (((n)+31)/32)
+
+#define GC_SLOT(p, b)       ((uint32_t)((((char*)(b))-(p)->base)/(p)->slotBytes))
+#define GC_BLOCK(p, s)      ((GcBlock*)((p)->base+(s)*(p)->slotBytes))
+
+
+static GcPage*      s_gc_firstPage      = NULL;
+static GcPage*      s_gc_freePages[GC_CLASS_COUNT];
+static unsigned char s_gc_classBySize[GC_MAX_CLASS_BYTES/16+1];
+static sjhash       s_gc_arenaHash;     // arena number (address>>GC_PAGE_SHIFT) -> GcPage
+static sjhash       s_gc_largeHash;     // block data address -> GcPage
+static bool         s_gc_initialized    = false;
+static GcADR        s_gc_minAdr         = ~((GcADR)0);
+static GcADR        s_gc_maxAdr         = 0;
+SjGcSystem          g_gc_system = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 
 #define CHECK_BLOCK(b)  \
     wxASSERT( (b->flags&SJ_GC_FLAGS_MAGIC_MASK) == SJ_GC_FLAGS_MAGIC ); \
     wxASSERT(  b->references >= 0 ); \
-    wxASSERT(  b->oneRefValidated == 0 || b->oneRefValidated == 1 );
+    wxASSERT(  b->page && b->page->base <= (char*)b );
+
+
+/*******************************************************************************
+ * Pages
+ ******************************************************************************/
+
+
+static void GcInit()
+{
+	int sizeClass = 0;
+	for( int i = 0; i <= GC_MAX_CLASS_BYTES/16; i++ )
+	{
+		while( s_gc_classBytes[sizeClass] < (uint32_t)i*16 )
+			sizeClass++;
+		s_gc_classBySize[i] = (unsigned char)sizeClass;
+	}
+
+	for( int i = 0; i < GC_CLASS_COUNT; i++ )
+		s_gc_freePages[i] = NULL;
+
+	sjhashInit(&s_gc_arenaHash, SJHASH_POINTER, 0);
+	sjhashInit(&s_gc_largeHash, SJHASH_POINTER, 0);
+	s_gc_initialized = true;
+}
+
+
+static void GcAddPage(GcPage* page, GcADR firstAdr, GcADR lastAdr)
+{
+	page->prev = NULL;
+	page->next = s_gc_firstPage;
+	if( s_gc_firstPage )
+		s_gc_firstPage->prev = page;
+	s_gc_firstPage = page;
+
+	if( firstAdr < s_gc_minAdr ) s_gc_minAdr = firstAdr;
+	if( lastAdr  > s_gc_maxAdr ) s_gc_maxAdr = lastAdr;
+}
+
+
+static void GcRemovePage(GcPage* page)
+{
+	if( page->prev )
+		page->prev->next = page->next;
+	else
+		s_gc_firstPage = page->next;
+
+	if( page->next )
+		page->next->prev = page->prev;
+}
+
+
+static void GcAddToFreeList(GcPage* page)
+{
+	wxASSERT( !page->inFreeList && page->sizeClass != GC_LARGE );
+	page->prevFree = NULL;
+	page->nextFree = s_gc_freePages[page->sizeClass];
+	if( page->nextFree )
+		page->nextFree->prevFree = page;
+	s_gc_freePages[page->sizeClass] = page;
+	page->inFreeList = true;
+}
+
+
+static void GcRemoveFromFreeList(GcPage* page)
+{
+	wxASSERT( page->inFreeList );
+	if( page->prevFree )
+		page->prevFree->nextFree = page->nextFree;
+	else
+		s_gc_freePages[page->sizeClass] = page->nextFree;
+
+	if( page->nextFree )
+		page->nextFree->prevFree = page->prevFree;
+	page->inFreeList = false;
+}
+
+
+static GcPage* GcNewArena(int sizeClass)
+{
+	void* base;
+	#ifdef __WXMSW__
+		base = _aligned_malloc(GC_PAGE_BYTES, GC_PAGE_BYTES);
+	#else
+		if( posix_memalign(&base, GC_PAGE_BYTES, GC_PAGE_BYTES) != 0 )
+			base = NULL;
+	#endif
+	if( base == NULL )
+		return NULL;
+
+	uint32_t slotBytes = sizeof(GcBlock) + s_gc_classBytes[sizeClass];
+	uint32_t slotCount = GC_PAGE_BYTES / slotBytes;
+	uint32_t bitWords  = GC_BIT_WORDS(slotCount);
+
+	GcPage* page = (GcPage*)calloc(1, sizeof(GcPage) + 2*bitWords*sizeof(uint32_t));
+	if( page == NULL )
+	{
+		#ifdef __WXMSW__
+			_aligned_free(base);
+		#else
+			free(base);
+		#endif
+		return NULL;
+	}
+
+	page->sizeClass = sizeClass;
+	page->base      = (char*)base;
+	page->slotBytes = slotBytes;
+	page->slotCount = slotCount;
+	page->allocBits = (uint32_t*)(page+1);
+	page->markBits  = page->allocBits + bitWords;
+
+	sjhashInsert(&s_gc_arenaHash, (void*)(((GcADR)base)>>GC_PAGE_SHIFT), 0, page);
+	GcAddPage(page, ((GcADR)base)+sizeof(GcBlock), ((GcADR)base)+(slotCount-1)*slotBytes+sizeof(GcBlock));
+	GcAddToFreeList(page);
+
+	g_gc_system.curPageCount++;
+	return page;
+}
+
+
+static void GcDeleteArena(GcPage* page)
+{
+	wxASSERT( page->sizeClass != GC_LARGE && page->slotsUsed == 0 );
+
+	if( page->inFreeList )
+		GcRemoveFromFreeList(page);
+	GcRemovePage(page);
+	sjhashInsert(&s_gc_arenaHash, (void*)(((GcADR)page->base)>>GC_PAGE_SHIFT), 0, NULL);
+
+	#ifdef __WXMSW__
+		_aligned_free(page->base);
+	#else
+		free(page->base);
+	#endif
+	free(page);
+
+	g_gc_system.curPageCount--;
+}
+
+
+static GcBlock* GcAllocSlot(int sizeClass)
+{
+	GcPage* page = s_gc_freePages[sizeClass];
+	if( page == NULL )
+	{
+		page = GcNewArena(sizeClass);
+		if( page == NULL )
+			return NULL;
+	}
+
+	GcBlock* block;
+	uint32_t slot;
+	if( page->freeSlots )
+	{
+		block = (GcBlock*)page->freeSlots;
+		page->freeSlots = *((void**)block);
+		slot = GC_SLOT(page, block);
+	}
+	else
+	{
+		slot = page->slotsTouched++;
+		block = GC_BLOCK(page, slot);
+	}
+
+	GC_BIT_SET(page->allocBits, slot);
+	GC_BIT_SET(page->markBits, slot); // allocate "black": a pending sweep must not free the new block
+
+	page->slotsUsed++;
+	if( page->slotsUsed == page->slotCount )
+		GcRemoveFromFreeList(page);
+
+	block->page = page;
+	return block;
+}
+
+
+static GcBlock* GcAllocLarge(unsigned long size)
+{
+	GcBlock* block = (GcBlock*)malloc(sizeof(GcBlock) + size);
+	if( block == NULL )
+		return NULL;
+
+	GcPage* page = (GcPage*)calloc(1, sizeof(GcPage));
+	if( page == NULL )
+	{
+		free(block);
+		return NULL;
+	}
+
+	page->sizeClass     = GC_LARGE;
+	page->base          = (char*)block;
+	page->slotBytes     = sizeof(GcBlock) + size;
+	page->slotCount     = 1;
+	page->slotsUsed     = 1;
+	page->slotsTouched  = 1;
+	page->allocBits     = &page->largeBits[0];
+	page->markBits      = &page->largeBits[1];
+	GC_BIT_SET(page->allocBits, 0);
+	GC_BIT_SET(page->markBits, 0);
+
+	GcADR adr = ((GcADR)block) + sizeof(GcBlock);
+	sjhashInsert(&s_gc_largeHash, (void*)adr, 0, page);
+	GcAddPage(page, adr, adr);
+
+	g_gc_system.curPageCount++;
+
+	block->page = page;
+	return block;
+}
+
+
+static void GcFreeBlock(GcBlock* block)
+{
+	// the finalize function is called by the caller
+	GcPage* page = block->page;
+	if( page->sizeClass == GC_LARGE )
+	{
+		GcRemovePage(page);
+		sjhashInsert(&s_gc_largeHash, (void*)(((GcADR)block)+sizeof(GcBlock)), 0, NULL);
+		free(block);
+		free(page);
+		g_gc_system.curPageCount--;
+	}
+	else
+	{
+		uint32_t slot = GC_SLOT(page, block);
+		GC_BIT_CLEAR(page->allocBits, slot);
+
+		*((void**)block) = page->freeSlots;
+		page->freeSlots = block;
+
+		wxASSERT( page->slotsUsed > 0 );
+		page->slotsUsed--;
+		if( !page->inFreeList )
+			GcAddToFreeList(page);
+	}
+}
+
+
+static inline GcBlock* GcFindBlock(GcADR adr)
+{
+	// find the block starting at the given data address in O(1), returns NULL if there is no such block
+	GcPage* page = (GcPage*)sjhashFind(&s_gc_arenaHash, (void*)(adr>>GC_PAGE_SHIFT), 0);
+	if( page )
+	{
+		GcADR offset = adr - ((GcADR)page->base) - sizeof(GcBlock);
+		GcADR slot = offset / page->slotBytes;
+		if( slot < page->slotsTouched
+		 && slot * page->slotBytes == offset
+		 && GC_BIT_TEST(page->allocBits, slot) )
+		{
+			return GC_BLOCK(page, slot);
+		}
+		return NULL;
+	}
+
+	page = (GcPage*)sjhashFind(&s_gc_largeHash, (void*)adr, 0);
+	if( page )
+	{
+		return (GcBlock*)page->base;
+	}
+
+	return NULL;
+}
 
 
 /*******************************************************************************
@@ -77,32 +403,30 @@ void* SjGcAlloc(unsigned long size, long flags,
 
 	// runtime check of our assumptions
 	wxASSERT( sizeof(GcADR) == sizeof(void*) );
-	wxASSERT( (sizeof(void*)==4 && sizeof(GcBlock)==32) || (sizeof(void*)==8 && sizeof(GcBlock)==48) ); // not really important, but interesting
+	wxASSERT( (sizeof(void*)==4 && sizeof(GcBlock)==32) || (sizeof(void*)==8 && sizeof(GcBlock)==48) ); // data are aligned as if malloc()'d
 	wxASSERT( sizeof(char) == 1 );
 
 	// allocate the memory
 	if( size <= 0 )
 		return NULL;
 
-	GcBlock* ptr = (GcBlock*)malloc(sizeof(GcBlock) + size);
+	if( !s_gc_initialized )
+		GcInit();
+
+	GcBlock* ptr = size <= GC_MAX_CLASS_BYTES? GcAllocSlot(s_gc_classBySize[(size+15)/16]) : GcAllocLarge(size);
 	if( ptr == NULL )
 		return NULL;
 
-	// set up block and add the block to the list of blocks
+	// set up block
 	ptr->size               = size;
 	ptr->flags              = flags | SJ_GC_FLAGS_MAGIC;
 	ptr->references         = flags&SJ_GC_ALLOC_STATIC? 2 : 1;
-	ptr->oneRefValidated    = 1;
 	ptr->finalizeFn         = finalizeFn;
 	ptr->finalizeUserData1  = userData1;
 	ptr->finalizeUserData2  = userData2;
 
 	CHECK_BLOCK( ptr );
 
-	// add to list of blocks
-	ptr->next               = s_gc_firstBlock;
-	s_gc_firstBlock         = ptr;
-
 	// some statistics
 	g_gc_system.curSize += size;
 	if( g_gc_system.curSize > g_gc_system.peakSize )
@@ -205,15 +529,22 @@ bool SjGcHasStaticRef(void* ptr)
 
 void SjGcShutdown()
 {
-	GcBlock *cur = s_gc_firstBlock, *next;
-	while( cur )
+	GcPage *page = s_gc_firstPage, *next;
+	while( page )
 	{
-		CHECK_BLOCK( cur );
+		for( uint32_t slot = 0; slot < page->slotsTouched; slot++ )
+		{
+			if( GC_BIT_TEST(page->allocBits, slot) )
+			{
+				GcBlock* cur = GC_BLOCK(page, slot);
+				CHECK_BLOCK( cur );
 
-		if( cur->finalizeFn )
-			cur->finalizeFn(cur->finalizeUserData1, (char*)cur+sizeof(GcBlock), cur->finalizeUserData2);
+				if( cur->finalizeFn )
+					cur->finalizeFn(cur->finalizeUserData1, (char*)cur+sizeof(GcBlock), cur->finalizeUserData2);
+			}
+		}
 
-		next = cur->next;
+		next = page->next;
 
 		#ifdef __WXDEBUG__
 
@@ -221,15 +552,38 @@ void SjGcShutdown()
 			// just let the OS free the memory, there is no advantage
 			// to do it here (but some disadvantages,  eg. speed)
 
-			free(cur);
+			if( page->sizeClass == GC_LARGE )
+			{
+				free(page->base);
+			}
+			else
+			{
+				#ifdef __WXMSW__
+					_aligned_free(page->base);
+				#else
+					free(page->base);
+				#endif
+			}
+			free(page);
 
 		#endif
 
-		cur = next;
+		page = next;
 	}
 
-	s_gc_firstBlock = NULL;
+	if( s_gc_initialized )
+	{
+		sjhashClear(&s_gc_arenaHash);
+		sjhashClear(&s_gc_largeHash);
+		s_gc_initialized = false;
+	}
+
+	s_gc_firstPage = NULL;
+	s_gc_minAdr = ~((GcADR)0);
+	s_gc_maxAdr = 0;
 	g_gc_system.curSize = 0;
+	g_gc_system.curBlockCount = 0;
+	g_gc_system.curPageCount = 0;
 }
 
 
@@ -238,220 +592,163 @@ void SjGcShutdown()
  ******************************************************************************/
 
 
-static GcADR s_gc_minAdr, s_gc_maxAdr, *s_gc_allAdr = NULL, s_gc_allAdrCount;
-static long s_infoAssumedPointers, s_infoPointersFollowed;
+static GcBlock**    s_gc_markStack = NULL;
+static long         s_gc_markStackCount = 0, s_gc_markStackAlloc = 0;
+static bool         s_gc_markFailed;
+static bool         s_gc_sweepPending = false;
+static GcPage*      s_gc_sweepPage = NULL;  // the next page to sweep
+static long         s_infoAssumedPointers, s_infoPointersFollowed;
+static unsigned long s_infoBlocksFreed, s_infoBytesFreed, s_infoOldSize, s_infoOldBlockCount, s_infoPauseMs;
 
 
-static void SjGcSweep(GcBlock* block)
+static void SjGcMark(GcBlock* block)
 {
-	// mark block as checked
-	wxASSERT( block->oneRefValidated == 0 );
-	CHECK_BLOCK( block );
-	block->oneRefValidated = 1;
+	// mark the block as being used; the block content is searched for pointers later from SjGcDrain()
+	GcPage* page = block->page;
+	uint32_t slot = GC_SLOT(page, block);
+	if( GC_BIT_TEST(page->markBits, slot) )
+		return;
+	GC_BIT_SET(page->markBits, slot);
 
 	// if the block is allocated to contain strings only,
 	// there is no need to check the content for pointers
 	if( (block->flags&SJ_GC_ALLOC_STRING) )
 		return;
 
-	GcADR   *dataPtr, *dataEnd, adr;
-	GcBlock *cur2;
-	int     left, right, mid;
-
-
-	// go through all possible addresses of the block
-	dataPtr = (GcADR*) ( ((char*)block)     + sizeof(GcBlock)   );
-	dataEnd = (GcADR*) ( ((char*)dataPtr)   + block->size       );
-	while( dataPtr < dataEnd )
+	if( s_gc_markStackCount == s_gc_markStackAlloc )
 	{
-		adr = *dataPtr;
-
-		if(  adr >= s_gc_minAdr
-		 &&  adr <= s_gc_maxAdr )
+		long newAlloc = s_gc_markStackAlloc? s_gc_markStackAlloc*2 : 1024;
+		GcBlock** newStack = (GcBlock**)realloc(s_gc_markStack, newAlloc*sizeof(GcBlock*));
+		if( newStack == NULL )
 		{
-			s_infoAssumedPointers ++;
-
-			// binary search for adr in s_gc_allAdr
-			left = 0; right = s_gc_allAdrCount - 1;
-			while( left <= right )
-			{
-				mid = left + ((right - left) / 2);
-				if( s_gc_allAdr[mid] > adr )
-				{
-					right = mid - 1;
-				}
-				else if( s_gc_allAdr[mid] < adr )
-				{
-					left = mid + 1;
-				}
-				else
-				{
-					cur2 = (GcBlock*)( s_gc_allAdr[mid]-sizeof(GcBlock) );
-					CHECK_BLOCK( cur2 );
-					if( !cur2->oneRefValidated
-					        /*&& cur2->references -- no needed, only blocks with referenced are added to s_gc_allAdr[]*/ )
-					{
-						// pointer found!
-						s_infoPointersFollowed ++;
-						SjGcSweep(cur2);
-					}
-					break;
-				}
-			}
-
-			// sequential search
-			#if 0
-				cur2 = s_gc_firstBlock;
-				while( cur2 )
-				{
-					CHECK_BLOCK( cur2 );
-
-					if( adr == ((GcADR)cur2) + sizeof(GcBlock) )
-					{
-						if( !cur2->oneRefValidated
-								&&  cur2->references/*in contras to the binary search above, this comparison is needed here!*/ )
-						{
-							// pointer found!
-							s_infoPointersFollowed ++;
-							SjGcSweep(cur2);
-						}
-						break;
-					}
-					cur2 = cur2->next;
-				}
-			#endif
+			s_gc_markFailed = true; // we cannot trace all blocks, nothing will be freed in this run
+			return;
 		}
-
-		// check the next possible pointer ("++" goes to the next pointer (normally +4 bytes as GcADR is just "unsigned long")
-		dataPtr ++;
+		s_gc_markStack = newStack;
+		s_gc_markStackAlloc = newAlloc;
 	}
+	s_gc_markStack[s_gc_markStackCount++] = block;
 }
 
 
-static int compareAdr(const void *arg1, const void *arg2)
+static void SjGcDrain()
 {
-	// CAVE: do not use arg1-arg2 as the pointer may be 64bit and the return value may be 32bit only...
-	if( *((GcADR*)arg1) < *((GcADR*)arg2) ) return -1;
-	if( *((GcADR*)arg1) > *((GcADR*)arg2) ) return  1;
-	return 0;
-}
-
-
-void SjGcDoCleanup()
-{
-	// check if garbage collection is possible at the moment - if not, it is delayed
-	// until g_gc_system.locked is 0 again.
-	wxASSERT( wxThread::IsMain() );
-	if( g_gc_system.locked > 0 )
-	{
-		g_gc_system.forceGc = 1;
-		return;
-	}
-	g_gc_system.forceGc = 0;
-
-
-	// any blocks?
-	wxASSERT( g_gc_system.curBlockCount >= 0 );
-	if( g_gc_system.curBlockCount == 0 )
-		return;
-
+	GcADR   *dataPtr, *dataEnd, adr;
+	GcBlock *block, *cur2;
 
-	// collect information of all blocks, mark all blocks as unused
-	GcBlock* curBlock;
-	long infoCleanupStartTimestamp = SjTools::GetMsTicks();
+	while( s_gc_markStackCount > 0 )
 	{
-		GcADR adr;
-
-		s_gc_minAdr         = 0; // initialize, we may get a s_gc_allAdrCount==0 after this part and the initialization with s_gc_allAdr[0] below will not be done
-		s_gc_maxAdr         = 0; //     - " -
-
-		wxASSERT( s_gc_allAdr == NULL );
-		s_gc_allAdr         = (GcADR*)malloc(g_gc_system.curBlockCount*sizeof(GcADR));
-		s_gc_allAdrCount    = 0;
+		block = s_gc_markStack[--s_gc_markStackCount];
+		CHECK_BLOCK( block );
 
-		curBlock = s_gc_firstBlock;
-		while( curBlock )
+		// go through all possible addresses of the block
+		dataPtr = (GcADR*) ( ((char*)block)     + sizeof(GcBlock)   );
+		dataEnd = dataPtr + block->size/sizeof(GcADR); // a pointer cannot be placed in a trailing partial word
+		while( dataPtr < dataEnd )
 		{
-			CHECK_BLOCK( curBlock );
+			adr = *dataPtr;
 
-			curBlock->oneRefValidated = 0;
-
-			if( curBlock->references )
+			if(  adr >= s_gc_minAdr
+			 &&  adr <= s_gc_maxAdr )
 			{
-				adr = ((GcADR)curBlock) + sizeof(GcBlock);
+				s_infoAssumedPointers ++;
 
-				s_gc_allAdr[s_gc_allAdrCount++] = adr;
+				cur2 = GcFindBlock(adr);
+				if( cur2 && cur2->references /*blocks without references are freed even if there are pointers to them*/ )
+				{
+					// pointer found!
+					CHECK_BLOCK( cur2 );
+					s_infoPointersFollowed ++;
+					SjGcMark(cur2);
+				}
 			}
 
-			// next block
-			curBlock = curBlock->next;
+			// check the next possible pointer ("++" goes to the next pointer (normally +4 bytes as GcADR is just "unsigned long")
+			dataPtr ++;
 		}
 	}
+}
 
-	if( s_gc_allAdrCount )
-	{
-		qsort(s_gc_allAdr, s_gc_allAdrCount, sizeof(GcADR), compareAdr);
 
-		s_gc_minAdr = s_gc_allAdr[0];
-		s_gc_maxAdr = s_gc_allAdr[s_gc_allAdrCount-1];
-	}
+static void SjGcMarkAll()
+{
+	// mark all blocks as unused
+	GcPage* page;
+	for( page = s_gc_firstPage; page; page = page->next )
+		memset(page->markBits, 0, GC_BIT_WORDS(page->slotCount)*sizeof(uint32_t));
 
 	// start scanning with the only blocks used directly
 	// (there may be zero used blocks, however, continue anyway as some blocks may be freed)
 	s_infoAssumedPointers = 0;
 	s_infoPointersFollowed = 0;
-	curBlock = s_gc_firstBlock;
-	while( curBlock )
+	s_gc_markFailed = false;
+	for( page = s_gc_firstPage; page; page = page->next )
 	{
-		CHECK_BLOCK( curBlock );
-
-		if(  curBlock->references >= 2 /* static? */
-		 && !curBlock->oneRefValidated /* the flag may change for any block in SjGcSweep() */)
+		for( uint32_t slot = 0; slot < page->slotsTouched; slot++ )
 		{
-			SjGcSweep(curBlock);
+			if( GC_BIT_TEST(page->allocBits, slot) )
+			{
+				GcBlock* block = GC_BLOCK(page, slot);
+				CHECK_BLOCK( block );
+				if( block->references >= 2 /* static? */ )
+				{
+					SjGcMark(block);
+					SjGcDrain();
+				}
+			}
 		}
-
-		curBlock = curBlock->next;
 	}
 
-	// free the memory that is not used
-	wxASSERT( s_gc_allAdr );
-	free(s_gc_allAdr);
-	s_gc_allAdr = NULL;
+	if( s_gc_markFailed )
+	{
+		// keep everything
+		for( page = s_gc_firstPage; page; page = page->next )
+			memcpy(page->markBits, page->allocBits, GC_BIT_WORDS(page->slotCount)*sizeof(uint32_t));
+		s_gc_markStackCount = 0;
+	}
 
-	unsigned long   infoBlocksFreed = 0;
-	unsigned long   infoBytesFreed = 0;
-	unsigned long   infoOldSize = g_gc_system.curSize;
-	unsigned long   infoOldBlockCount = g_gc_system.curBlockCount;
+	// the mark stack may be large after processing huge arrays; do not hold it until the next run
+	if( s_gc_markStackAlloc > 1024 )
 	{
-		GcBlock *toDel, *prevBlock = NULL;
+		free(s_gc_markStack);
+		s_gc_markStack = NULL;
+		s_gc_markStackAlloc = 0;
+	}
 
-		curBlock = s_gc_firstBlock;
-		while( curBlock )
-		{
-			CHECK_BLOCK( curBlock );
+	// prepare sweeping; from now on, all blocks that are not marked are known to be unused.
+	// this will not change until the sweep is done, as there are no pointers to these blocks
+	// from the stack (see SjGcLocker) and as SjGcAlloc() marks new blocks.
+	s_infoBlocksFreed = 0;
+	s_infoBytesFreed = 0;
+	s_infoOldSize = g_gc_system.curSize;
+	s_infoOldBlockCount = g_gc_system.curBlockCount;
+	g_gc_system.lastPauseMs = 0;
+	s_gc_sweepPage = s_gc_firstPage;
+	s_gc_sweepPending = true;
+}
 
-			if( curBlock->oneRefValidated )
-			{
-				prevBlock = curBlock;
-				curBlock = curBlock->next;
-			}
-			else
-			{
-				if( prevBlock )
-					prevBlock->next = curBlock->next;
-				else
-					s_gc_firstBlock = curBlock->next;
 
-				// remember the block to free
-				toDel = curBlock;
+static bool SjGcSweep(unsigned long deadline)
+{
+	// free the memory that is not used, page by page; if a deadline is given,
+	// we stop after the first page swept beyond it and return false.
+	GcPage* page;
+	while( (page=s_gc_sweepPage) != NULL )
+	{
+		s_gc_sweepPage = page->next; // the page may be freed below
 
-				// point to next
-				curBlock = curBlock->next;
+		bool isLarge = (page->sizeClass == GC_LARGE);
+		for( uint32_t slot = 0; slot < page->slotsTouched; slot++ )
+		{
+			if(  GC_BIT_TEST(page->allocBits, slot)
+			 && !GC_BIT_TEST(page->markBits, slot) )
+			{
+				GcBlock* toDel = GC_BLOCK(page, slot);
+				CHECK_BLOCK( toDel );
 
 				// free the block
-				infoBlocksFreed++;
-				infoBytesFreed += toDel->size;
+				s_infoBlocksFreed++;
+				s_infoBytesFreed += toDel->size;
 
 				wxASSERT( g_gc_system.curSize >= toDel->size );
 				wxASSERT( g_gc_system.curBlockCount > 0 );
@@ -463,16 +760,31 @@ void SjGcDoCleanup()
 				if( toDel->finalizeFn )
 					toDel->finalizeFn(toDel->finalizeUserData1, (char*)toDel+sizeof(GcBlock), toDel->finalizeUserData2);
 
-				free(toDel);
+				GcFreeBlock(toDel);
+				if( isLarge )
+					break; // the page is freed together with the block
 			}
 		}
+
+		if( !isLarge && page->slotsUsed == 0 )
+			GcDeleteArena(page);
+
+		if( deadline && s_gc_sweepPage && SjTools::GetMsTicks() >= deadline )
+			return false;
 	}
 
+	s_gc_sweepPending = false;
+	return true;
+}
+
+
+static void SjGcCycleDone()
+{
 	// integry check
 	if( g_debug )
 	{
 		// compile time assumptions, see remark (*) in gcalloc.h
-		// (in SjGcSweep() we only check for pointers on multiple of sizeof(void*))
+		// (in SjGcDrain() we only check for pointers on multiple of sizeof(void*))
 		struct just_a_test {
 			void* ptr0;
 			char  force_unaligned1;
@@ -496,40 +808,119 @@ void SjGcDoCleanup()
 
 		// runtime checks
 		unsigned long cnt = 0, cntBytes = 0;
-		GcBlock* iter = s_gc_firstBlock;
-		while( iter )
+		for( GcPage* page = s_gc_firstPage; page; page = page->next )
 		{
-			cnt++;
-			cntBytes += iter->size;
-			iter = iter->next;
+			for( uint32_t slot = 0; slot < page->slotsTouched; slot++ )
+			{
+				if( GC_BIT_TEST(page->allocBits, slot) )
+				{
+					cnt++;
+					cntBytes += GC_BLOCK(page, slot)->size;
+				}
+			}
 		}
 		wxASSERT( cnt == g_gc_system.curBlockCount );
 		wxASSERT( cntBytes == g_gc_system.curSize );
 	}
 
 	// done
-	wxASSERT( infoOldSize-g_gc_system.curSize == infoBytesFreed );
-
 	g_gc_system.sizeChangeSinceLastCleanup = 0;
 	g_gc_system.lastCleanupTimestamp = SjTools::GetMsTicks();
 
 	if( g_debug&0x04 /*4=additional script debugging, see user-guide*/ )
 	{
-		wxLogInfo ( "%i ms needed to free %iK of %iK (%i of %i blocks, %i/%i/%i possible/assumed/followed pointers) [gc]",
-					(int)(g_gc_system.lastCleanupTimestamp-infoCleanupStartTimestamp),
-					(int)(infoBytesFreed/1024),
-					(int)(infoOldSize/1024),
-					(int)infoBlocksFreed,
-					(int)infoOldBlockCount,
-					(int)(infoOldSize/sizeof(GcADR)), (int)s_infoAssumedPointers, (int)s_infoPointersFollowed
+		wxLogInfo ( "%i ms needed to free %iK of %iK (%i of %i blocks in %i pages, %i/%i/%i possible/assumed/followed pointers, %i ms max. pause) [gc]",
+					(int)s_infoPauseMs,
+					(int)(s_infoBytesFreed/1024),
+					(int)(s_infoOldSize/1024),
+					(int)s_infoBlocksFreed,
+					(int)s_infoOldBlockCount,
+					(int)g_gc_system.curPageCount,
+					(int)(s_infoOldSize/sizeof(GcADR)), (int)s_infoAssumedPointers, (int)s_infoPointersFollowed,
+					(int)g_gc_system.lastPauseMs
 				  );
 	}
 }
 
 
+static void SjGcPauseDone(unsigned long startTimestamp)
+{
+	unsigned long pauseMs = SjTools::GetMsTicks() - startTimestamp;
+	s_infoPauseMs += pauseMs;
+	if( pauseMs > g_gc_system.lastPauseMs )
+		g_gc_system.lastPauseMs = pauseMs;
+	if( pauseMs > g_gc_system.peakPauseMs )
+		g_gc_system.peakPauseMs = pauseMs;
+}
+
+
+void SjGcDoCleanup()
+{
+	// check if garbage collection is possible at the moment - if not, it is delayed
+	// until g_gc_system.locked is 0 again.
+	wxASSERT( wxThread::IsMain() );
+	if( g_gc_system.locked > 0 )
+	{
+		g_gc_system.forceGc = 1;
+		return;
+	}
+	g_gc_system.forceGc = 0;
+
+	unsigned long startTimestamp = SjTools::GetMsTicks();
+
+	// finish a collection started by SjGcDoCleanupStep()
+	if( s_gc_sweepPending )
+	{
+		SjGcSweep(0);
+		SjGcPauseDone(startTimestamp);
+		SjGcCycleDone();
+		startTimestamp = SjTools::GetMsTicks();
+	}
+
+	// any blocks?
+	if( g_gc_system.curBlockCount == 0 )
+		return;
+
+	// collect garbage
+	s_infoPauseMs = 0;
+	SjGcMarkAll();
+	SjGcSweep(0);
+	SjGcPauseDone(startTimestamp);
+	SjGcCycleDone();
+}
+
+
+bool SjGcDoCleanupStep(unsigned long maxMs)
+{
+	wxASSERT( wxThread::IsMain() );
+	if( g_gc_system.locked > 0 )
+		return false;
+
+	unsigned long startTimestamp = SjTools::GetMsTicks();
+
+	if( !s_gc_sweepPending )
+	{
+		if( g_gc_system.curBlockCount == 0 )
+			return true;
+
+		// marking is always done at once as there are no write barriers that
+		// would tell us about changed pointers while a step is pending
+		s_infoPauseMs = 0;
+		SjGcMarkAll();
+	}
+
+	bool done = SjGcSweep(startTimestamp + (maxMs? maxMs : 1));
+	SjGcPauseDone(startTimestamp);
+	if( done )
+		SjGcCycleDone();
+
+	return done;
+}
+
+
 bool SjGcNeedsCleanup()
 {
-	if( g_gc_system.forceGc )
+	if( g_gc_system.forceGc || s_gc_sweepPending )
 		return true;
 
 	if( g_gc_system.sizeChangeSinceLastCleanup > SJ_GC_CLEANUP_BYTES
@@ -543,5 +934,3 @@ bool SjGcNeedsCleanup()
 
 
 #endif // SJ_USE_SCRIPTS
-
-
@@ -44,6 +44,11 @@
  * SJ_GC_ALLOC_STATIC - call SjGcUnref().  Do _not_ use free() for delete for
  * this purpose!
  *
+ * SjGcDoCleanupStep() can be used to bound the time spent for a single
+ * collection: the marking is always done at once, however, the sweeping and
+ * the calling of the finalize functions is distributed over several steps
+ * then.  SjGcLocker uses this incremental mode when collecting implicitly.
+ *
  * Some restrictions:
  * - The framework is not thread safe!
  * - Pointers are searched only on multiples of sizeof(void*) - so, this won't
@@ -96,6 +101,13 @@ void    SjGcUnref           (void* ptr);
 void    SjGcDoCleanup       ();
 
 
+// Do the garbage collection incrementally; the function returns after about
+// maxMs milliseconds and returns true if the collection is complete then.
+// Call the function again until it returns true (or SjGcNeedsCleanup()
+// returns false).  SjGcDoCleanup() completes a pending collection.
+bool    SjGcDoCleanupStep   (unsigned long maxMs);
+
+
 // Make some assumtion if a call to SjGcDoCleanup() is useful
 bool    SjGcNeedsCleanup    ();
 
@@ -106,6 +118,7 @@ bool    SjGcNeedsCleanup    ();
 // more than the given number of bytes were allocated since the last cleanup.
 #define SJ_GC_CLEANUP_MS        30000L  // 30 seconds
 #define SJ_GC_CLEANUP_BYTES     262144L // 0.25 MB
+#define SJ_GC_STEP_MS           10L     // max. time for one SjGcDoCleanupStep() call, marking excluded
 
 
 // SjGcShutdown() just frees all blocks independingly of their state.
@@ -124,6 +137,9 @@ struct SjGcSystem
 	unsigned long   curSize;
 	unsigned long   peakSize;
 	unsigned long   curBlockCount;
+	unsigned long   curPageCount;
+	unsigned long   lastPauseMs;    // longest pause of the last collection
+	unsigned long   peakPauseMs;
 	long            locked;
 	long            forceGc;
 };
@@ -148,7 +164,7 @@ public:
 		if( g_gc_system.locked == 0 )
 		{
 			if( ::SjGcNeedsCleanup() )
-				::SjGcDoCleanup();
+				::SjGcDoCleanupStep(SJ_GC_STEP_MS);
 		}
 		g_gc_system.locked++;
 	}
@@ -47,6 +47,10 @@ public:
 	int             GetHttpStatusCode   () const { return m_httpStatusCode; }
 	wxString        GetHttpResponseHeader(const wxString& key) const;
 
+	// connections are kept alive and re-used for further requests to the same host;
+	// CloseIdleConnections() should be called before wxSocketBase::Shutdown()
+	static void     CloseIdleConnections();
+
 private:
 	// private stuff
 	wxEvtHandler*   m_rcvEvtHandler;
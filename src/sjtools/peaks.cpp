@@ -0,0 +1,239 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    peaks.cpp
+ * Authors: Björn Petersen
+ * Purpose: Waveform overview of a track
+ *
+ ******************************************************************************/
+
+
+#include <sjbase/base.h>
+#include <sjtools/peaks.h>
+#include <wx/file.h>
+
+
+#define PEAKS_MAGIC         "SjPeaks1"  // change the version if SJ_PEAKS_MS or the format changes
+#define PEAKS_MAGIC_BYTES   8
+#define PEAKS_MAX_BYTES     (1024*1024) // about 14 hours
+
+
+static wxString get_cache_name(const wxString& url)
+{
+	return url + wxT("/peaks.dat");
+}
+
+
+SjPeaks::SjPeaks()
+{
+	m_data  = NULL;
+	m_alloc = 0;
+	Clear();
+}
+
+
+SjPeaks::~SjPeaks()
+{
+	free(m_data);
+}
+
+
+void SjPeaks::Clear()
+{
+	m_url.Clear();
+	m_count      = 0;
+	m_currMin    = 0.0F;
+	m_currMax    = 0.0F;
+	m_currFrames = 0;
+}
+
+
+void SjPeaks::CopyFrom(const SjPeaks& o)
+{
+	Clear();
+	m_url = o.m_url;
+	for( long i = 0; i < o.m_count; i++ )
+	{
+		AddPeak(o.m_data[i*2]/127.0F, o.m_data[i*2+1]/127.0F);
+	}
+}
+
+
+bool SjPeaks::AddPeak(float min, float max)
+{
+	if( m_count >= m_alloc )
+	{
+		long newAlloc = m_alloc? m_alloc*2 : 1024;
+		signed char* newData = (signed char*)realloc(m_data, newAlloc*2);
+		if( newData == NULL ) {
+			return false;
+		}
+		m_data  = newData;
+		m_alloc = newAlloc;
+	}
+
+	if( min < -1.0F ) min = -1.0F;
+	if( max >  1.0F ) max =  1.0F;
+	m_data[m_count*2]   = (signed char)(min*127.0F);
+	m_data[m_count*2+1] = (signed char)(max*127.0F);
+	m_count++;
+	return true;
+}
+
+
+void SjPeaks::AddBuffer(const float* data, long bytes, int samplerate, int channels)
+{
+	if( samplerate <= 0 || channels <= 0 ) {
+		return;
+	}
+
+	long framesPerPeak = (samplerate*SJ_PEAKS_MS)/1000;
+	long frames = bytes / (channels*sizeof(float));
+	int  c;
+	float sample;
+	while( frames-- )
+	{
+		sample = 0.0F;
+		for( c = 0; c < channels; c++ ) {
+			sample += *data++;
+		}
+		sample /= channels;
+
+		if( m_currFrames == 0 ) {
+			m_currMin = sample;
+			m_currMax = sample;
+		}
+		else if( sample < m_currMin ) {
+			m_currMin = sample;
+		}
+		else if( sample > m_currMax ) {
+			m_currMax = sample;
+		}
+
+		if( ++m_currFrames >= framesPerPeak ) {
+			AddPeak(m_currMin, m_currMax);
+			m_currFrames = 0;
+		}
+	}
+}
+
+
+void SjPeaks::PadTo(long ms)
+{
+	if( ms/SJ_PEAKS_MS*2 > PEAKS_MAX_BYTES ) {
+		return;
+	}
+
+	while( GetMs() < ms )
+	{
+		if( !AddPeak(0.0F, 0.0F) ) {
+			break;
+		}
+	}
+}
+
+
+void SjPeaks::GetMinMax(long first, long last, float& min, float& max) const
+{
+	if( first < 0 ) first = 0;
+	if( last > m_count ) last = m_count;
+
+	min = 0.0F;
+	max = 0.0F;
+	if( first < last )
+	{
+		signed char cmin = m_data[first*2], cmax = m_data[first*2+1];
+		for( long i = first+1; i < last; i++ )
+		{
+			if( m_data[i*2]   < cmin ) cmin = m_data[i*2];
+			if( m_data[i*2+1] > cmax ) cmax = m_data[i*2+1];
+		}
+		min = cmin/127.0F;
+		max = cmax/127.0F;
+	}
+}
+
+
+bool SjPeaks::Load(const wxString& url)
+{
+	Clear();
+
+	wxString cacheFile = g_tools->m_cache.LookupCache(get_cache_name(url));
+	if( cacheFile.IsEmpty() ) {
+		return false;
+	}
+
+	wxFile file(cacheFile);
+	if( !file.IsOpened() ) {
+		return false;
+	}
+
+	long bytes = (long)file.Length() - PEAKS_MAGIC_BYTES;
+	if( bytes <= 0 || bytes > PEAKS_MAX_BYTES || (bytes&1) ) {
+		return false;
+	}
+
+	char magic[PEAKS_MAGIC_BYTES];
+	if( file.Read(magic, PEAKS_MAGIC_BYTES) != PEAKS_MAGIC_BYTES
+	 || memcmp(magic, PEAKS_MAGIC, PEAKS_MAGIC_BYTES) != 0 ) {
+		return false;
+	}
+
+	signed char* newData = (signed char*)realloc(m_data, bytes);
+	if( newData == NULL ) {
+		return false;
+	}
+	m_data  = newData;
+	m_alloc = bytes/2;
+
+	if( file.Read(m_data, bytes) != (ssize_t)bytes ) {
+		return false;
+	}
+
+	m_url   = url;
+	m_count = bytes/2;
+	return true;
+}
+
+
+bool SjPeaks::Save(const wxString& url)
+{
+	if( m_count <= 0 || m_count*2 > PEAKS_MAX_BYTES ) {
+		return false;
+	}
+
+	long bytes = PEAKS_MAGIC_BYTES + m_count*2;
+	char* data = (char*)malloc(bytes);
+	if( data == NULL ) {
+		return false;
+	}
+	memcpy(data, PEAKS_MAGIC, PEAKS_MAGIC_BYTES);
+	memcpy(data+PEAKS_MAGIC_BYTES, m_data, m_count*2);
+
+	// AddToCache() is thread-safe, so this may be called from the volume analyzer threads
+	bool ret = !g_tools->m_cache.AddToCache(get_cache_name(url), data, bytes).IsEmpty();
+	free(data);
+
+	if( ret ) {
+		m_url = url;
+	}
+	return ret;
+}
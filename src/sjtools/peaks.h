@@ -0,0 +1,76 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    peaks.h
+ * Authors: Björn Petersen
+ * Purpose: Waveform overview of a track
+ *
+ ******************************************************************************/
+
+
+#ifndef __SJ_PEAKS_H__
+#define __SJ_PEAKS_H__
+
+
+class SjPeaks
+{
+public:
+	// SjPeaks holds the minimum and the maximum sample value for every
+	// SJ_PEAKS_MS milliseconds of a track, all channels mixed down.
+	// One peak takes two bytes, so a track of 5 minutes needs 6 KB.
+	#define         SJ_PEAKS_MS         100
+	                SjPeaks             ();
+	                ~SjPeaks            ();
+	void            Clear               ();
+	void            CopyFrom            (const SjPeaks&);
+
+	// add a sample buffer, the buffers must be given continuously from the start of the track
+	void            AddBuffer           (const float* data, long bytes, int samplerate, int channels);
+
+	// fill up missing peaks at the end with silence, eg. if the end was skipped by crossfading
+	void            PadTo               (long ms);
+
+	// get the collected information; GetMinMax() combines the peaks first..last-1,
+	// the returned values are in the range -1.0 .. 1.0
+	wxString        GetUrl              () const { return m_url; }
+	long            GetCount            () const { return m_count; }
+	long            GetMs               () const { return m_count*SJ_PEAKS_MS; }
+	bool            IsEmpty             () const { return m_count==0; }
+	void            GetMinMax           (long first, long last, float& min, float& max) const;
+
+	// the peaks are stored in the cache of the temporary directory, identified by the URL of the track
+	bool            Load                (const wxString& url);
+	bool            Save                (const wxString& url);
+
+private:
+	wxString        m_url;
+	signed char*    m_data;             // min/max pairs, each value in the range -127..127
+	long            m_count,
+	                m_alloc;
+	bool            AddPeak             (float min, float max);
+
+	float           m_currMin,          // the peak currently being collected
+	                m_currMax;
+	long            m_currFrames;
+};
+
+
+#endif // __SJ_PEAKS_H__
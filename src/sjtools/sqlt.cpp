@@ -137,6 +137,13 @@ extern "C"
 		sqlite3_result_null(context);
 	}
 
+	static void sqlite_inidset(sqlite3_context* context, int argc, sqlite3_value** argv)
+	{
+		// inidset(set, id) returns 1 if the id is in the given set of manually included/excluded tracks,
+		// see SjAdvSearch::GetAsSql()
+		sqlite3_result_int(context, SjAdvSearch::IsInIdSet(sqlite3_value_int(argv[0]), (long)sqlite3_value_int64(argv[1]))? 1 : 0);
+	}
+
 	static void sqlite_sortable(sqlite3_context* context, int argc, sqlite3_value** argv)
 	{
 		#ifdef __WXDEBUG__
@@ -184,7 +191,7 @@ extern "C"
 wxSqltDb* wxSqltDb::s_defaultDb = NULL;
 
 
-wxSqltDb::wxSqltDb(const wxString& file)
+wxSqltDb::wxSqltDb(const wxString& file, bool readOnly)
 {
 	m_transactionCount          = 0;
 	m_transactionVacuumPending  = FALSE;
@@ -218,7 +225,7 @@ wxSqltDb::wxSqltDb(const wxString& file)
 	#endif
 	const char* fileSqlite3Str = fileCharBuf.data();
 
-	if( sqlite3_open(fileSqlite3Str, &m_sqlite) != SQLITE_OK )
+	if( sqlite3_open_v2(fileSqlite3Str, &m_sqlite, readOnly? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE), NULL) != SQLITE_OK )
 	{
 		if( m_sqlite )
 		{
@@ -238,7 +245,7 @@ wxSqltDb::wxSqltDb(const wxString& file)
 		wxSqlt sql(this);
 
 		// ... create the configuration table
-		if( !m_dbExistsBeforeOpening )
+		if( !m_dbExistsBeforeOpening && !readOnly )
 		{
 			sql.Query(wxT("CREATE TABLE config (id INTEGER PRIMARY KEY, keyname TEXT, value TEXT);"));
 			sql.Query(wxT("CREATE INDEX configindex01 ON config (keyname);"));
@@ -250,6 +257,7 @@ wxSqltDb::wxSqltDb(const wxString& file)
 	sqlite3_create_function(m_sqlite, "filetype",     1/*number of arguments*/,     SQLITE_ANY, this, sqlite_filetype,    NULL, NULL);
 	sqlite3_create_function(m_sqlite, "levensthein", -1/*any number of arguments*/, SQLITE_ANY, this, sqlite_levensthein, NULL, NULL);
 	sqlite3_create_function(m_sqlite, "queuepos",    -1/*any number of arguments*/, SQLITE_ANY, this, sqlite_queuepos,    NULL, NULL);
+	sqlite3_create_function(m_sqlite, "inidset",      2/*number of arguments*/,     SQLITE_ANY, this, sqlite_inidset,     NULL, NULL);
 	sqlite3_create_function(m_sqlite, "sortable",    -1/*any number of arguments*/, SQLITE_ANY, this, sqlite_sortable,    NULL, NULL);
 	sqlite3_create_function(m_sqlite, "nulltoend",    1/*any number of arguments*/, SQLITE_ANY, this, sqlite_nulltoend,   NULL, NULL);
 }
@@ -402,6 +410,23 @@ wxString wxSqlt::QParam(const wxString& str)
 }
 
 
+wxString wxSqlt::PrefixCond(const wxString& column, const wxString& prefix)
+{
+	// unlike "column LIKE 'prefix%'", the returned range condition is
+	// case-sensitive and can use an index on the column
+	if( prefix.IsEmpty() )
+	{
+		return wxT("(1)");
+	}
+
+	wxString upper(prefix);
+	wxChar   last = upper.Last();
+	upper.Truncate(upper.Len()-1);
+	upper.Append((wxChar)(last+1));
+	return wxT("(") + column + wxT(">='") + QParam(prefix) + wxT("' AND ") + column + wxT("<'") + QParam(upper) + wxT("')");
+}
+
+
 bool wxSqlt::Query(const wxString& query)
 {
 	int         sqlState;
@@ -477,11 +502,14 @@ int wxSqlt::FetchQuery_()
 		// error - we do not log this as this error may occur under mysterious circumstances - see
 		// http://www.silverjuke.net/forum/viewtopic.php?t=900
 		#ifdef __WXDEBUG__
-		const char* err = sqlite3_errmsg(m_db->m_sqlite);
-		SQLITE3_TO_WXSTRING(err)
-		wxLogError(errWxStr);
+		if( sqlState != SQLITE_INTERRUPT ) // interrupted by wxSqltDb::Interrupt(), this is no error
+		{
+			const char* err = sqlite3_errmsg(m_db->m_sqlite);
+			SQLITE3_TO_WXSTRING(err)
+			wxLogError(errWxStr);
 
-		wxLogError(wxT("Cannot get SQL row.")/*n/t*/);
+			wxLogError(wxT("Cannot get SQL row.")/*n/t*/);
+		}
 		#endif
 		return SQLITE_ERROR;
 	}
@@ -492,7 +520,8 @@ void wxSqlt::CloseQuery()
 {
 	if( m_stmt )
 	{
-		if( sqlite3_finalize(m_stmt) != SQLITE_OK )
+		int sqlState = sqlite3_finalize(m_stmt);
+		if( sqlState != SQLITE_OK && sqlState != SQLITE_INTERRUPT )
 		{
 			const char* err = sqlite3_errmsg(m_db->m_sqlite);
 			SQLITE3_TO_WXSTRING(err)
@@ -81,7 +81,7 @@ class wxSqlt;
 class wxSqltDb
 {
 public:
-						wxSqltDb                (const wxString& file);
+						wxSqltDb                (const wxString& file, bool readOnly=false);
 	virtual             ~wxSqltDb               ();
 
 	bool                IsOk                    () const {return m_sqlite? TRUE : FALSE; }
@@ -99,6 +99,10 @@ public:
 	long                GetSync                 ();
 	sqlite3*            GetDb                   () { return m_sqlite; }
 
+	// Interrupt() may be called from any thread and lets the currently running
+	// queries of the connection fail as soon as possible
+	void                Interrupt               () { if(m_sqlite) sqlite3_interrupt(m_sqlite); }
+
 	// some events that may be used by derived classes.
 	// the event are placed here and not in wxSqltTransaction as calling
 	// virtual functions in the constructor/destructor is not straight-forward
@@ -159,6 +163,7 @@ public:
 	static wxString QParam              (const wxString&);
 	static wxString LParam              (long v) { return wxString::Format(wxT("%i"), (int)v); }
 	static wxString UParam              (unsigned long v) { return wxString::Format(wxT("%lu"), v); }
+	static wxString PrefixCond          (const wxString& column, const wxString& prefix); // condition for "column starts with prefix"
 
 	// high level query interface, use as:
 	//  sql.Query("SELECT id, name FROM table");
@@ -29,6 +29,7 @@
 
 #include <sjbase/base.h>
 #include <wx/url.h>
+#include <wx/socket.h>
 #include <sjtools/testdrive.h>
 #include <sjtools/csv_tokenizer.h>
 #include <see_dom/sj_see.h>
@@ -62,6 +63,152 @@ static wxString CreateTestFileUsingWxFile(const wxString& fileName, const wxStri
 }
 
 
+// a minimal HTTP server on the loopback device, answers each request with "ok"
+// and counts the accepted connections; used to check that SjHttp keeps connections alive
+class SjTestHttpServer : public wxThread
+{
+public:
+	                SjTestHttpServer    (wxSocketServer* server) : wxThread(wxTHREAD_JOINABLE) { m_server = server; m_accepts = 0; m_requests = 0; m_stop = false; }
+	void*           Entry               ();
+
+	wxSocketServer* m_server;
+	wxArrayPtrVoid  m_sockets; // destroyed by the main thread
+	int             m_accepts;
+	int             m_requests;
+	volatile bool   m_stop;
+};
+
+
+void* SjTestHttpServer::Entry()
+{
+	while( !m_stop )
+	{
+		if( !m_server->WaitForAccept(0, 100) )
+		{
+			continue;
+		}
+
+		wxSocketBase* sock = m_server->Accept(false);
+		if( sock == NULL )
+		{
+			continue;
+		}
+		m_sockets.Add(sock);
+		m_accepts++;
+
+		// answer the requests until the client closes the connection
+		static const char response[] = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: keep-alive\r\n\r\nok";
+		wxString received;
+		char buf[1024];
+		sock->SetTimeout(5);
+		while( 1 )
+		{
+			sock->Read(buf, sizeof(buf));
+			size_t bytesRead = sock->LastCount();
+			if( sock->Error() || bytesRead == 0 )
+			{
+				break;
+			}
+
+			received += wxString(buf, wxConvISO8859_1, bytesRead);
+			int end;
+			while( (end=received.Find(wxT("\r\n\r\n"))) != wxNOT_FOUND )
+			{
+				received = received.Mid(end+4);
+				m_requests++;
+				sock->Write(response, sizeof(response)-1);
+			}
+		}
+		sock->Close();
+	}
+	return 0;
+}
+
+
+// compare the unplayed counters of a playlist against a brute-force scan;
+// allUrls should contain all URLs ever used in the playlist
+static void CheckPlaylistUnplayed(const SjPlaylist& playlist, const wxArrayString& allUrls)
+{
+	SjSLHash unplayedByUrl;
+	long i, j, iCount = playlist.GetCount(), unplayed = 0;
+	for( i = 0; i < iCount; i++ )
+	{
+		SjPlaylistEntry& entry = playlist.Item(i);
+		if( entry.GetPlayCount() == 0 )
+		{
+			unplayedByUrl.Insert(entry.GetUnverifiedUrl(), unplayedByUrl.Lookup(entry.GetUnverifiedUrl())+1);
+			unplayed++;
+		}
+	}
+
+	for( i = 0; i < (long)allUrls.GetCount(); i++ )
+	{
+		wxASSERT( playlist.GetUnplayedCountInPlaylist(allUrls[i]) == unplayedByUrl.Lookup(allUrls[i]) );
+	}
+
+	// count from different positions, with and without a border
+	long positions[] = { -1, 0, 1, iCount/3, iCount/2, iCount-iCount/3, iCount-1, iCount, SjTools::Rand(iCount+1) };
+	long maxCnts[] = { -1, 0, 1, 10, unplayed };
+	for( i = 0; i < (long)(sizeof(positions)/sizeof(positions[0])); i++ )
+	{
+		long bruteCnt = 0;
+		for( j = wxMax(positions[i], 0L); j < iCount; j++ )
+		{
+			if( playlist.Item(j).GetPlayCount() == 0 )
+			{
+				bruteCnt++;
+			}
+		}
+
+		for( j = 0; j < (long)(sizeof(maxCnts)/sizeof(maxCnts[0])); j++ )
+		{
+			long expected = (maxCnts[j] >= 0 && bruteCnt > maxCnts[j])? maxCnts[j] : bruteCnt;
+			wxASSERT( playlist.GetUnplayedCount(positions[i], maxCnts[j]) == expected );
+		}
+	}
+}
+
+
+// run an album search with the joined query and with the former per-album queries;
+// the statistics and the selected tracks must be equal, the timings are logged
+static void CompareAlbumSearch(const SjAdvSearch& search, const wxString& name)
+{
+	#define ALBUM_SEARCH_RUNS 5
+	SjLLHash        hash[2];
+	SjSearchStat    stat[2];
+	double          ms[2];
+	int             perQuery;
+	for( perQuery = 0; perQuery < 2; perQuery++ )
+	{
+		SjAdvSearch::s_albumsPerQuery = (perQuery!=0);
+		wxString sql;
+		wxStopWatch stopWatch;
+		for( int i = 0; i < ALBUM_SEARCH_RUNS; i++ )
+		{
+			stat[perQuery] = search.GetAsSql(&hash[perQuery], sql);
+		}
+		ms[perQuery] = stopWatch.TimeInMicro().ToDouble() / (ALBUM_SEARCH_RUNS*1000);
+	}
+	SjAdvSearch::s_albumsPerQuery = FALSE;
+
+	wxASSERT( stat[0].m_advResultCount > 0 );
+	wxASSERT( stat[0].m_advResultCount == stat[1].m_advResultCount );
+	wxASSERT( stat[0].m_mbytes == stat[1].m_mbytes );
+	wxASSERT( stat[0].m_seconds == stat[1].m_seconds );
+	wxASSERT( hash[0].GetCount() == hash[1].GetCount() );
+
+	SjHashIterator iterator;
+	long trackId;
+	while( hash[0].Iterate(iterator, &trackId) )
+	{
+		wxASSERT( hash[1].Lookup(trackId) );
+	}
+
+	wxLogInfo(wxT("Testdrive: Album search \"%s\": %i tracks, joined query %.1f ms, per-album queries %.1f ms"),
+	          name.c_str(), (int)stat[0].m_advResultCount, ms[0], ms[1]);
+}
+
+
 void SjTestdrive1()
 {
 
@@ -260,6 +407,95 @@ void SjTestdrive1()
 		wxASSERT( SjTools::GetExt(wxT("someWhat.MP3"))==wxT("mp3") );
 	}
 
+	/* Check the unplayed counters of SjPlaylist: build a playlist with many duplicates, flip play counts,
+	remove, insert and rename URLs and compare the counters against a brute-force scan from time to time
+	*/
+	{
+		#define PLAYLIST_TEST_ENTRIES   10000
+		#define PLAYLIST_TEST_URLS      1000  // so each URL is about 10 times in the playlist
+		#define PLAYLIST_TEST_STEPS     5000
+		SjPlaylist playlist;
+		wxArrayString allUrls;
+		long i, index, renamed = 0;
+		for( i = 0; i < PLAYLIST_TEST_URLS; i++ )
+		{
+			allUrls.Add(wxString::Format(wxT("stub:test%i.mp3"), (int)i));
+		}
+
+		for( i = 0; i < PLAYLIST_TEST_ENTRIES; i++ )
+		{
+			playlist.Add(allUrls[SjTools::Rand(PLAYLIST_TEST_URLS)], true, 0);
+		}
+		CheckPlaylistUnplayed(playlist, allUrls);
+
+		for( i = 0; i < PLAYLIST_TEST_STEPS; i++ )
+		{
+			index = SjTools::Rand(playlist.GetCount());
+			switch( SjTools::Rand(4) )
+			{
+				case 0:
+					playlist.Item(index).SetPlayCount(SjTools::Rand(2)? 0 : 1+SjTools::Rand(3));
+					break;
+
+				case 1:
+					{
+						wxString url = playlist.Item(index).GetUnverifiedUrl();
+						long restCount = playlist.RemoveAt(index);
+						wxASSERT( restCount == playlist.GetCountInPlaylist(url) );
+					}
+					break;
+
+				case 2:
+					playlist.Insert(allUrls[SjTools::Rand(PLAYLIST_TEST_URLS)], SjTools::Rand(playlist.GetCount()+1), true, 0);
+					break;
+
+				default:
+					{
+						wxString newUrl = wxString::Format(wxT("stub:renamed%i.mp3"), (int)renamed++);
+						allUrls.Add(newUrl);
+						playlist.OnUrlChanged(playlist.Item(index).GetUnverifiedUrl(), newUrl);
+					}
+					break;
+			}
+
+			if( i % 500 == 0 )
+			{
+				CheckPlaylistUnplayed(playlist, allUrls);
+			}
+		}
+		CheckPlaylistUnplayed(playlist, allUrls);
+
+		// RehashUrl() is called when verifying paths, one of the entries of the first path is played
+		wxString path1 = CreateTestFileUsingWxFile(wxT("playlisttest1.mp3"), wxT("test content"));
+		wxString path2 = CreateTestFileUsingWxFile(wxT("playlisttest2.mp3"), wxT("test content"));
+		allUrls.Add(path1);
+		allUrls.Add(path2);
+		for( i = 0; i < 3; i++ )
+		{
+			playlist.Insert(path1, SjTools::Rand(playlist.GetCount()+1), false, 0);
+			playlist.Insert(path2, SjTools::Rand(playlist.GetCount()+1), false, 0);
+		}
+		for( i = 0; playlist.Item(i).GetUnverifiedUrl() != path1; i++ ) ; // GetPosByUrl() would verify the URLs
+		playlist.Item(i).SetPlayCount(1);
+		CheckPlaylistUnplayed(playlist, allUrls);
+
+		for( i = 0; i < playlist.GetCount(); i++ )
+		{
+			wxString unverifiedUrl = playlist.Item(i).GetUnverifiedUrl();
+			if( unverifiedUrl == path1 || unverifiedUrl == path2 )
+			{
+				allUrls.Add(playlist.Item(i).GetUrl());
+			}
+		}
+		wxASSERT( playlist.GetUnplayedCountInPlaylist(path1) == 0 );
+		wxASSERT( playlist.GetUnplayedCountInPlaylist(path2) == 0 );
+		CheckPlaylistUnplayed(playlist, allUrls);
+
+		::wxRemoveFile(path1);
+		::wxRemoveFile(path2);
+	}
+
+
 	/* Stress wxFileSystem
 
 	In wxFileSystem, the character "#" is used to start a new protocol inside a path,
@@ -505,6 +741,127 @@ void SjTestdrive1()
 
 
 
+	/* Check that SjHttp re-uses keep-alive connections: requests 2..n must not open a new connection;
+	the latency of the first request (including the connect) and of the further requests is logged */
+	{
+		wxIPV4address addr;
+		addr.Hostname(wxT("127.0.0.1"));
+		addr.Service(0); // any free port
+		wxSocketServer* server = new wxSocketServer(addr, wxSOCKET_BLOCK|wxSOCKET_REUSEADDR);
+		if( server->IsOk() && server->GetLocal(addr) )
+		{
+			SjTestHttpServer* thread = new SjTestHttpServer(server);
+			thread->Create();
+			thread->Run();
+
+			#define HTTP_TEST_REQUESTS 20
+			SjHttp::CloseIdleConnections();
+			wxEvtHandler evtHandler;
+			SjHttp http;
+			http.Init(&evtHandler, wxID_ANY);
+			unsigned long firstMs = 0, furtherMs = 0;
+			for( int i = 0; i < HTTP_TEST_REQUESTS; i++ )
+			{
+				unsigned long startMs = SjTools::GetMsTicks();
+				http.OpenFile(wxString::Format(wxT("http://127.0.0.1:%i/test?%i"), (int)addr.Service(), i), &wxConvUTF8);
+				unsigned long ms = SjTimestampDiff(startMs, SjTools::GetMsTicks());
+				if( i == 0 ) { firstMs = ms; } else { furtherMs += ms; }
+				wxASSERT( http.GetHttpStatusCode() == 200 );
+				wxASSERT( http.GetString() == wxT("ok") );
+			}
+			SjHttp::CloseIdleConnections();
+
+			thread->m_stop = true;
+			thread->Wait();
+			wxASSERT( thread->m_requests == HTTP_TEST_REQUESTS );
+			wxASSERT( thread->m_accepts == 1 );
+			wxLogInfo(wxT("Testdrive: %i HTTP requests used %i connection(s); first request: %i ms, further requests: %.2f ms on average"),
+			          (int)HTTP_TEST_REQUESTS, thread->m_accepts, (int)firstMs, (double)furtherMs/(HTTP_TEST_REQUESTS-1));
+
+			for( size_t i = 0; i < thread->m_sockets.GetCount(); i++ )
+			{
+				((wxSocketBase*)thread->m_sockets[i])->Destroy();
+			}
+			delete thread;
+		}
+		else
+		{
+			wxLogWarning(wxT("Testdrive: Cannot start the loopback HTTP server."));
+		}
+		server->Destroy();
+	}
+
+
+
+	/* Compare the joined query used to select complete albums in SjAdvSearch::GetAsSql() against the
+	former per-album queries on a synthetic library; the default database is switched temporarily */
+	{
+		#define SEARCH_TEST_ALBUMS  2000
+		wxString path = GetTestFilePath(wxT("searchtest.db"));
+		wxSqltDb* oldDefaultDb = wxSqltDb::GetDefault();
+		{
+			wxSqltDb db(path);
+			if( db.IsOk() )
+			{
+				db.SetDefault();
+				{
+					wxSqltTransaction transaction;
+					wxSqlt sql;
+					sql.Query(wxT("CREATE TABLE tracks (id INTEGER PRIMARY KEY, url TEXT, albumid INTEGER, year INTEGER, rating INTEGER, timesplayed INTEGER, databytes INTEGER, playtimems INTEGER);"));
+					sql.Query(wxT("CREATE INDEX tracksindex01 ON tracks (albumid);"));
+					long albumId, trackNr, trackCount;
+					for( albumId = 1; albumId <= SEARCH_TEST_ALBUMS; albumId++ )
+					{
+						trackCount = 1 + SjTools::Rand(20);
+						for( trackNr = 0; trackNr < trackCount; trackNr++ )
+						{
+							// the year is unique per album, so ordering the albums by year is well-defined
+							sql.Query(wxString::Format(wxT("INSERT INTO tracks (url, albumid, year, rating, timesplayed, databytes, playtimems) VALUES ('stub:%i-%i.mp3', %i, %i, %i, %i, %i, %i);"),
+							          (int)albumId, (int)trackNr, (int)albumId, (int)(1000+albumId), (int)SjTools::Rand(6), (int)SjTools::Rand(10),
+							          (int)(2000000+SjTools::Rand(6000000)), (int)(120000+SjTools::Rand(240000))));
+						}
+					}
+					transaction.Commit();
+				}
+
+				SjAdvSearch search;
+
+				search.Init(wxT("rating, 50 albums"), SJ_SELECTSCOPE_ALBUMS, SJ_SELECTOP_ALL);
+				search.AddRule(SJ_FIELD_RATING, SJ_FIELDOP_IS_GREATER_THAN, wxT("2"));
+				search.AddRule(SJ_PSEUDOFIELD_LIMIT, SJ_FIELDOP_IS_EQUAL_TO, wxT("50"), SJ_FIELD_YEAR|SJ_FIELDFLAG_DESC, SJ_UNIT_ALBUMS);
+				CompareAlbumSearch(search, search.GetName());
+
+				search.Init(wxT("year range, 500 MB"), SJ_SELECTSCOPE_ALBUMS, SJ_SELECTOP_ALL);
+				search.AddRule(SJ_FIELD_YEAR, SJ_FIELDOP_IS_IN_RANGE, wxT("1500"), wxT("2500"));
+				search.AddRule(SJ_PSEUDOFIELD_LIMIT, SJ_FIELDOP_IS_EQUAL_TO, wxT("500"), SJ_FIELD_YEAR, SJ_UNIT_MB);
+				CompareAlbumSearch(search, search.GetName());
+
+				search.Init(wxT("play count, 600 minutes"), SJ_SELECTSCOPE_ALBUMS, SJ_SELECTOP_ALL);
+				search.AddRule(SJ_FIELD_TIMESPLAYED, SJ_FIELDOP_IS_GREATER_THAN, wxT("7"));
+				search.AddRule(SJ_PSEUDOFIELD_LIMIT, SJ_FIELDOP_IS_EQUAL_TO, wxT("600"), SJ_FIELD_YEAR|SJ_FIELDFLAG_DESC, SJ_UNIT_MINUTES);
+				CompareAlbumSearch(search, search.GetName());
+
+				search.Init(wxT("rating, 300 tracks"), SJ_SELECTSCOPE_ALBUMS, SJ_SELECTOP_ALL);
+				search.AddRule(SJ_FIELD_RATING, SJ_FIELDOP_IS_EQUAL_TO, wxT("5"));
+				search.AddRule(SJ_PSEUDOFIELD_LIMIT, SJ_FIELDOP_IS_EQUAL_TO, wxT("300"), SJ_FIELD_YEAR, SJ_UNIT_TRACKS);
+				CompareAlbumSearch(search, search.GetName());
+
+				search.Init(wxT("rating, no limit"), SJ_SELECTSCOPE_ALBUMS, SJ_SELECTOP_ALL);
+				search.AddRule(SJ_FIELD_RATING, SJ_FIELDOP_IS_GREATER_THAN, wxT("0"));
+				CompareAlbumSearch(search, search.GetName());
+			}
+			else
+			{
+				wxLogWarning(wxT("Testdrive: Cannot create the synthetic library %s."), path.c_str());
+			}
+		}
+
+		if( oldDefaultDb ) { oldDefaultDb->SetDefault(); } else { wxSqltDb::ClearDefault(); }
+		::wxRemoveFile(path);
+	}
+
+
+
 	/* Scripting tests */
 	#if SJ_USE_SCRIPTS
 	if( g_debug&0x04 )
@@ -2591,7 +2591,7 @@ void SjTools::DrawText( wxDC&           dc,
 
 bool SjTools::DrawSingleLineText(wxDC& dc, const wxString& text, wxRect& rect,
                                  const wxFont& font1, const wxFont& smallFont, const wxFont* firstCharFont,
-                                 const wxColour& hiliteColour)
+                                 const wxColour& hiliteColour, wxString* retDrawnText)
 {
 	dc.SetFont(font1);
 	bool hiliteState = false, truncated = false;
@@ -2605,7 +2605,7 @@ bool SjTools::DrawSingleLineText(wxDC& dc, const wxString& text, wxRect& rect,
 	{
 		part = text.Left(p1);
 		wxRect partRect = rect;
-		if( !DrawSingleLineText(dc, part, partRect, normalColour, hiliteColour, hiliteState) )
+		if( !DrawSingleLineText(dc, part, partRect, normalColour, hiliteColour, hiliteState, retDrawnText) )
 		{
 			long p1width = partRect.width;
 
@@ -2614,14 +2614,17 @@ bool SjTools::DrawSingleLineText(wxDC& dc, const wxString& text, wxRect& rect,
 			partRect = rect;
 			partRect.x += p1width;
 			partRect.width -= p1width;
-			truncated = DrawSingleLineText(dc, part, partRect, normalColour, hiliteColour, hiliteState);
+			wxString drawnPart;
+			truncated = DrawSingleLineText(dc, part, partRect, normalColour, hiliteColour, hiliteState, &drawnPart);
+			if( retDrawnText )
+				*retDrawnText += drawnPart;
 
 			rect.width = p1width + partRect.width;
 		}
 	}
 	else
 	{
-		truncated = DrawSingleLineText(dc, text, rect, normalColour, hiliteColour, hiliteState);
+		truncated = DrawSingleLineText(dc, text, rect, normalColour, hiliteColour, hiliteState, retDrawnText);
 	}
 
 	if( hiliteState )
@@ -2631,7 +2634,7 @@ bool SjTools::DrawSingleLineText(wxDC& dc, const wxString& text, wxRect& rect,
 
 	return truncated;
 }
-bool SjTools::DrawSingleLineText(wxDC& dc, const wxString& givenText__, wxRect& rect, const wxColour& normalColour, const wxColour& hiliteColour, bool& hiliteState)
+bool SjTools::DrawSingleLineText(wxDC& dc, const wxString& givenText__, wxRect& rect, const wxColour& normalColour, const wxColour& hiliteColour, bool& hiliteState, wxString* retDrawnText)
 {
 	bool     anyTabs = givenText__.Find(wxT("\t"))>=0, truncated = false;
 	wxCoord  textW, textH;
@@ -2677,7 +2680,11 @@ bool SjTools::DrawSingleLineText(wxDC& dc, const wxString& givenText__, wxRect&
 		if( tabCount%2 == 1 ) textToPrint.Append(wxT("\t"));
 
 		if( textW > rect.width )
+		{
+			if( retDrawnText )
+				retDrawnText->Clear();
 			return true; // truncated
+		}
 
 		truncated = true;
 	}
@@ -2712,6 +2719,9 @@ bool SjTools::DrawSingleLineText(wxDC& dc, const wxString& givenText__, wxRect&
 		dc.DrawText(textToPrint, rect.x, y);
 	}
 
+	if( retDrawnText )
+		*retDrawnText = textToPrint;
+
 	rect.width = textW;
 	return truncated;
 }
@@ -122,6 +122,9 @@ public:
 	// remove all elements from the hash
 	void            Clear               () { sjhashClear(&m_hash); }
 
+	// exchange the content of two hashes without copying the elements
+	void            Swap                (SjLLHash& o) { sjhash t = m_hash; m_hash = o.m_hash; o.m_hash = t; }
+
 private:
 	sjhash          m_hash;
 	void            CopyFrom            (SjLLHash* o);
@@ -694,9 +697,11 @@ public:
 	void            CalcTextWidthAndHeight(wxDC& dc, const wxString& text, const wxFont& font1, const wxFont& font2, int maxW, int& retW, int& retH)	{ wxRect rect(0,0,maxW,0); DrawText(dc, text, rect, font1, font2, *wxRED, FALSE); retW = rect.width; retH = rect.height; }
 	int             CalcTextHeight      (wxDC& dc, const wxString& text, const wxFont& font1, const wxFont& font2, int maxW) { wxRect rect(0,0,maxW,0); DrawText(dc, text, rect, font1, font2, *wxRED, FALSE); return rect.height; }
 
-	// same as DrawText() but only for one line of text; returns true if the text was truncated
-	bool            DrawSingleLineText  (wxDC&, const wxString&, wxRect&, const wxFont&, const wxFont& smallFont, const wxFont* firstChar, const wxColour& hiliteColour);
-	bool            DrawSingleLineText  (wxDC&, const wxString&, wxRect&, const wxColour& normalColour, const wxColour& hiliteColour, bool& hiliteState);
+	// same as DrawText() but only for one line of text; returns true if the text was truncated.
+	// retDrawnText receives the text as drawn; drawing this text again with the same width and fonts
+	// gives the same result without truncating again.
+	bool            DrawSingleLineText  (wxDC&, const wxString&, wxRect&, const wxFont&, const wxFont& smallFont, const wxFont* firstChar, const wxColour& hiliteColour, wxString* retDrawnText=NULL);
+	bool            DrawSingleLineText  (wxDC&, const wxString&, wxRect&, const wxColour& normalColour, const wxColour& hiliteColour, bool& hiliteState, wxString* retDrawnText=NULL);
 
 	// drawing bitmaps
 	void            DrawBitmap          (wxDC&, const wxBitmap*, int x, int y, int w = 0, int h = 0);
@@ -0,0 +1,393 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    volumeanalyzer.cpp
+ * Authors: Björn Petersen
+ * Purpose: Calculate the gain of unplayed tracks in the background
+ *
+ ******************************************************************************/
+
+
+#include <sjbase/base.h>
+#include <sjbase/backend.h>
+#include <sjtools/volumecalc.h>
+#include <sjtools/peaks.h>
+#include <sjtools/volumeanalyzer.h>
+
+
+#define TODO_BATCH          100   // number of tracks read from the library at once
+#define READ_FRAMES         1024
+#define READ_MAX_CHANNELS   32    // the max. number of channels delivered by SjBackendDecoder
+#define THROTTLE_SLEEP_MS   10    // pause after each READ_FRAMES while throttled
+
+
+/*******************************************************************************
+ * SjVolumeAnalyzerThread
+ ******************************************************************************/
+
+
+class SjVolumeAnalyzerThread : public wxThread
+{
+public:
+	SjVolumeAnalyzerThread(SjVolumeAnalyzer* analyzer, int threadIndex)
+		: wxThread(wxTHREAD_JOINABLE)
+	{
+		m_analyzer    = analyzer;
+		m_threadIndex = threadIndex;
+	}
+
+private:
+	void*             Entry             ();
+	double            Analyze           (const wxString& url);
+	SjVolumeAnalyzer* m_analyzer;
+	int               m_threadIndex;
+	float             m_buffer[READ_FRAMES*READ_MAX_CHANNELS];
+};
+
+
+void* SjVolumeAnalyzerThread::Entry()
+{
+	wxString url;
+	while( m_analyzer->TakeUrl(m_threadIndex, url) )
+	{
+		double gain = Analyze(url);
+		m_analyzer->AddResult(url, gain);
+
+		if( g_mainFrame )
+		{
+			g_mainFrame->GetEventHandler()->QueueEvent(new wxCommandEvent(wxEVT_COMMAND_MENU_SELECTED, m_analyzer->m_resultEventId));
+		}
+	}
+
+	return NULL;
+}
+
+
+double SjVolumeAnalyzerThread::Analyze(const wxString& url)
+{
+	SjBackendDecoder* decoder = m_analyzer->m_backend->CreateDecoder(url);
+	if( decoder == NULL ) {
+		return SJ_VOLANALYZER_FAILED;
+	}
+	decoder->SetAbortCallback(SjVolumeAnalyzer::IsExitRequested, m_analyzer);
+
+	SjVolumeCalc* volumeCalc = new SjVolumeCalc();
+	SjPeaks* peaks = new SjPeaks(); // as we decode the whole track anyway, also create the waveform overview
+	bool aborted = false;
+	long frames;
+	while( (frames=decoder->Read(m_buffer, READ_FRAMES)) > 0 )
+	{
+		volumeCalc->AddBuffer(m_buffer, frames*decoder->GetChannels()*sizeof(float), decoder->GetSamplerate(), decoder->GetChannels());
+		peaks->AddBuffer(m_buffer, frames*decoder->GetChannels()*sizeof(float), decoder->GetSamplerate(), decoder->GetChannels());
+
+		if( !m_analyzer->WaitWhileThrottled(m_threadIndex) ) {
+			aborted = true;
+			break;
+		}
+	}
+
+	// a decoder that gave up because of our exit request is not a failure of the track
+	if( decoder->Failed() && SjVolumeAnalyzer::IsExitRequested(m_analyzer) ) {
+		aborted = true;
+	}
+
+	double gain;
+	if( aborted ) {
+		gain = SJ_VOLANALYZER_ABORTED;
+	}
+	else if( decoder->Failed() || !volumeCalc->IsGainWorthSaving() ) {
+		gain = SJ_VOLANALYZER_FAILED;
+	}
+	else {
+		gain = volumeCalc->GetGain();
+	}
+
+	if( !aborted && !decoder->Failed() ) {
+		peaks->Save(url);
+	}
+
+	delete peaks;
+	delete volumeCalc;
+	delete decoder;
+	return gain;
+}
+
+
+/*******************************************************************************
+ * SjVolumeAnalyzer - called by the threads
+ ******************************************************************************/
+
+
+bool SjVolumeAnalyzer::TakeUrl(int threadIndex, wxString& retUrl)
+{
+	wxMutexLocker locker(m_mutex);
+
+	while( !m_exit
+	    && (m_todo.IsEmpty() || (m_throttle && threadIndex > 0)) )
+	{
+		m_condition.Wait();
+	}
+
+	if( m_exit ) {
+		return false;
+	}
+
+	retUrl = wxString(m_todo[0].c_str()); // deep copy, the string is used by the main thread
+	m_todo.RemoveAt(0);
+	m_busyCount++;
+	return true;
+}
+
+
+bool SjVolumeAnalyzer::WaitWhileThrottled(int threadIndex)
+{
+	bool throttle;
+	{
+		wxMutexLocker locker(m_mutex);
+		while( !m_exit && m_throttle && threadIndex > 0 ) {
+			m_condition.Wait();
+		}
+		if( m_exit ) {
+			return false;
+		}
+		throttle = m_throttle;
+	}
+
+	if( throttle ) {
+		wxMilliSleep(THROTTLE_SLEEP_MS);
+	}
+	return true;
+}
+
+
+void SjVolumeAnalyzer::AddResult(const wxString& url, double gain)
+{
+	wxMutexLocker locker(m_mutex);
+
+	m_resultUrls.Add(wxString(url.c_str()));
+	m_resultGains.Add(gain);
+	m_busyCount--;
+}
+
+
+bool SjVolumeAnalyzer::IsExitRequested(void* analyzer_)
+{
+	// used as abort callback for SjBackendDecoder::Read() so that Stop() does not wait for a stalled source
+	SjVolumeAnalyzer* analyzer = (SjVolumeAnalyzer*)analyzer_;
+	wxMutexLocker locker(analyzer->m_mutex);
+	return analyzer->m_exit;
+}
+
+
+/*******************************************************************************
+ * SjVolumeAnalyzer - called by the main thread
+ ******************************************************************************/
+
+
+SjVolumeAnalyzer::SjVolumeAnalyzer(SjBackend* backend, int resultEventId)
+	: m_condition(m_mutex)
+{
+	m_backend       = backend;
+	m_resultEventId = resultEventId;
+	m_lastTrackId   = 0;
+	m_threadCount   = 0;
+	m_busyCount     = 0;
+	m_throttle      = false;
+	m_exit          = false;
+}
+
+
+SjVolumeAnalyzer::~SjVolumeAnalyzer()
+{
+	Stop();
+}
+
+
+bool SjVolumeAnalyzer::FetchTodo()
+{
+	// add the next tracks without gain to m_todo; returns false if there are no more tracks.
+	// only local files are analyzed, eg. UPnP or server tracks are "http://..." and we do not want to download them.
+	wxSqlt sql;
+	wxArrayString urls;
+	bool anyTrack;
+	do
+	{
+		anyTrack = false;
+		sql.Query(wxString::Format(wxT("SELECT id, url FROM tracks WHERE autovol=0 AND url NOT LIKE '%%://%%' AND id>%lu ORDER BY id LIMIT %i;"), m_lastTrackId, (int)TODO_BATCH));
+		while( sql.Next() )
+		{
+			anyTrack = true;
+			m_lastTrackId = sql.GetLong(0);
+			if( m_triedUrls.Lookup(sql.GetString(1)) == 0 ) {
+				urls.Add(sql.GetString(1));
+			}
+		}
+	}
+	while( urls.IsEmpty() && anyTrack ); // a batch may consist of tried tracks only
+
+	if( urls.IsEmpty() ) {
+		return false;
+	}
+
+	wxMutexLocker locker(m_mutex);
+	size_t i, iCount = urls.GetCount();
+	for( i = 0; i < iCount; i++ ) {
+		m_todo.Add(urls[i]);
+	}
+	m_condition.Broadcast();
+	return true;
+}
+
+
+bool SjVolumeAnalyzer::Start()
+{
+	wxASSERT( wxThread::IsMain() );
+
+	if( m_threadCount > 0 || !m_condition.IsOk() ) {
+		return false; // already running or error
+	}
+
+	// anything to do?
+	m_lastTrackId = 0;
+	m_exit        = false;
+	if( !FetchTodo() ) {
+		return false;
+	}
+
+	// use all CPUs but one for the workers - they run with the lowest priority, however, the UI should stay responsive
+	int threadCount = wxThread::GetCPUCount() - 1;
+	if( threadCount < 1 ) { threadCount = 1; }
+	if( threadCount > SJ_VOLANALYZER_MAX_THREADS ) { threadCount = SJ_VOLANALYZER_MAX_THREADS; }
+
+	for( int i = 0; i < threadCount; i++ )
+	{
+		SjVolumeAnalyzerThread* thread = new SjVolumeAnalyzerThread(this, i);
+		if( thread->Create() != wxTHREAD_NO_ERROR ) {
+			delete thread;
+			break;
+		}
+		thread->SetPriority(WXTHREAD_MIN_PRIORITY);
+		if( thread->Run() != wxTHREAD_NO_ERROR ) {
+			delete thread;
+			break;
+		}
+		m_threads[m_threadCount++] = thread;
+	}
+
+	if( m_threadCount == 0 ) {
+		Stop(); // clears the todo list
+		return false;
+	}
+
+	return true;
+}
+
+
+void SjVolumeAnalyzer::Stop()
+{
+	wxASSERT( wxThread::IsMain() );
+
+	{
+		wxMutexLocker locker(m_mutex);
+		m_exit = true;
+		m_condition.Broadcast();
+	}
+
+	for( int i = 0; i < m_threadCount; i++ )
+	{
+		m_threads[i]->Wait();
+		delete m_threads[i];
+	}
+	m_threadCount = 0;
+
+	if( !SjMainApp::IsInShutdown() ) {
+		ReceiveResults(); // save what we have; as m_exit is set, this does not fetch new tracks
+	}
+
+	wxMutexLocker locker(m_mutex);
+	m_todo.Clear();
+	m_busyCount = 0;
+}
+
+
+void SjVolumeAnalyzer::SetThrottle(bool throttle)
+{
+	wxMutexLocker locker(m_mutex);
+	if( m_throttle != throttle )
+	{
+		m_throttle = throttle;
+		m_condition.Broadcast();
+	}
+}
+
+
+void SjVolumeAnalyzer::ReceiveResults()
+{
+	wxASSERT( wxThread::IsMain() );
+
+	if( SjBusyInfo::InYield() && m_threadCount > 0 ) {
+		return; // eg. the library is updated just now, the results are saved with the next call
+	}
+
+	wxArrayString urls;
+	wxArrayDouble gains;
+	bool          needsMore;
+	{
+		wxMutexLocker locker(m_mutex);
+		urls  = m_resultUrls;  m_resultUrls.Clear();
+		gains = m_resultGains; m_resultGains.Clear();
+		needsMore = (!m_exit && (long)m_todo.GetCount() < m_threadCount);
+	}
+
+	// write the gains; if the track was played in between, the gain calculated by the player is kept.
+	// tracks without a gain are remembered, otherwise they would be decoded again with every Start()
+	size_t i, iCount = urls.GetCount();
+	if( iCount )
+	{
+		wxSqlt sql;
+		for( i = 0; i < iCount; i++ )
+		{
+			if( gains[i] > 0.0 )
+			{
+				sql.Query(wxString::Format(wxT("UPDATE tracks SET autovol=%i WHERE autovol=0 AND url='"), (int)::SjGain2Long(gains[i]))
+				          + sql.QParam(urls[i]) + wxT("';"));
+			}
+			else if( gains[i] == SJ_VOLANALYZER_FAILED )
+			{
+				m_triedUrls.Insert(urls[i], 1);
+			}
+		}
+	}
+
+	// get more work; if there is nothing more to do and all workers are idle, we're done
+	if( needsMore && !FetchTodo() )
+	{
+		bool done;
+		{
+			wxMutexLocker locker(m_mutex);
+			done = (m_todo.IsEmpty() && m_busyCount == 0 && m_resultUrls.IsEmpty());
+		}
+
+		if( done ) {
+			Stop();
+		}
+	}
+}
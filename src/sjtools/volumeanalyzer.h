@@ -0,0 +1,87 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    volumeanalyzer.h
+ * Authors: Björn Petersen
+ * Purpose: Calculate the gain of unplayed tracks in the background
+ *
+ ******************************************************************************/
+
+
+#ifndef __SJ_VOLUMEANALYZER_H__
+#define __SJ_VOLUMEANALYZER_H__
+
+
+class SjBackend;
+class SjVolumeAnalyzerThread;
+
+
+#define SJ_VOLANALYZER_FAILED   -1.0
+#define SJ_VOLANALYZER_ABORTED  -2.0
+
+
+class SjVolumeAnalyzer
+{
+public:
+	// Local tracks without a gain (autovol=0) are decoded by some low-priority worker threads,
+	// the gain is calculated the same way as during playback and written to the library.
+	// Album gains are derived from the track gains as usual, see SjLibraryModule::GetAutoVol().
+	// On the way, the waveform overview of the tracks is written to the cache, see SjPeaks.
+	// All functions must be called from the main thread; when a worker has finished a track,
+	// the event given to the constructor is sent to the main frame, ReceiveResults() should be called then.
+	                SjVolumeAnalyzer    (SjBackend* backend, int resultEventId);
+	                ~SjVolumeAnalyzer   ();
+	bool            Start               ();
+	void            Stop                ();
+	bool            IsRunning           () const { return m_threadCount > 0; }
+	void            SetThrottle         (bool throttle); // set while playback is active: only one worker decodes and it pauses regularly
+	void            ReceiveResults      ();
+
+private:
+	SjBackend*      m_backend;
+	int             m_resultEventId;
+	unsigned long   m_lastTrackId;      // the tracks are analyzed in the order of their IDs
+	SjSLHash        m_triedUrls;        // tracks that failed or whose gain is not worth saving, not tried again in this session
+	bool            FetchTodo           ();
+
+	#define         SJ_VOLANALYZER_MAX_THREADS 4
+	SjVolumeAnalyzerThread* m_threads[SJ_VOLANALYZER_MAX_THREADS];
+	int             m_threadCount;
+
+	// the following members are protected by m_mutex
+	wxMutex         m_mutex;
+	wxCondition     m_condition;
+	wxArrayString   m_todo;
+	wxArrayString   m_resultUrls;
+	wxArrayDouble   m_resultGains;      // SJ_VOLANALYZER_FAILED or SJ_VOLANALYZER_ABORTED if there is no gain
+	int             m_busyCount;
+	bool            m_throttle;
+	bool            m_exit;
+	bool            TakeUrl             (int threadIndex, wxString& retUrl);
+	bool            WaitWhileThrottled  (int threadIndex);
+	void            AddResult           (const wxString& url, double gain);
+	static bool     IsExitRequested     (void* analyzer);
+
+	friend class    SjVolumeAnalyzerThread;
+};
+
+
+#endif // __SJ_VOLUMEANALYZER_H__